@@ -0,0 +1,88 @@
+#pragma once
+
+/*
+ * bench.h — shared helpers for the host benchmark (make host-bench)
+ *
+ * The benchmark links the portable pld core against POSIX stdio and times
+ * each pipeline stage over synthetic pld.dat images.  Every case runs once
+ * per (sessions, titles) fill configuration from the command line.
+ */
+
+#include "pld.h"
+
+typedef struct {
+    int         sessions;   /* live sessions in generated images (0–50000) */
+    int         titles;     /* distinct titles (1–256)                      */
+    int         iters;      /* timed iterations per stage                   */
+    const char *work_dir;   /* scratch directory for generated files        */
+} BenchConfig;
+
+typedef void (*BenchFunc)(const BenchConfig *cfg);
+
+typedef struct {
+    const char *name;
+    BenchFunc   run;
+} BenchCase;
+
+/* Monotonic clock in nanoseconds. */
+u64  bench_now_ns(void);
+
+/* Print one result line: ns/op and MB/s for bytes_per_op processed per op. */
+void bench_report(const char *stage, const BenchConfig *cfg,
+                  u64 total_ns, int iters, u64 bytes_per_op);
+
+/* Abort the run with a message; used when a stage produces wrong results. */
+void bench_fail(const char *fmt, ...);
+
+/* Heap accounting (bench_heap.c).  bench_heap_mark resets the high-water
+ * mark to the current usage and returns it; bench_heap_peak_since reports
+ * how far above that mark the heap has been since. */
+u64  bench_heap_current(void);
+u64  bench_heap_mark(void);
+u64  bench_heap_peak_since(u64 mark);
+
+/* Deterministic xorshift PRNG so every run sees the same data. */
+u32  bench_rand(u32 *state);
+
+/* Title ID for synthetic title k (0-based). */
+u64  bench_title_id(int k);
+
+/* Fill out[0..count-1] with hour-aligned sessions in chronological order,
+ * spread over `titles` titles.  Keys (title_id, timestamp) are unique. */
+void bench_gen_sessions(PldSession *out, int count, int titles, u32 seed);
+
+/* qsort s[0..n-1] by (title_id, timestamp), independently of pld_merge.c. */
+void bench_sort_sessions(PldSession *s, int n);
+
+/* Pack recs[0..n-1] into *log, allocating it first if log->entries is NULL.
+ * Aborts on failure. */
+void bench_log_pack(PldSessionLog *log, const PldSession *recs, int n);
+
+/* True if the log unpacks to exactly want[0..n-1]. */
+bool bench_log_equals(const PldSessionLog *log, const PldSession *want, int n);
+
+/* Build a full PLD_FILE_SIZE image: header, `sessions` live records in the
+ * first slots followed by 0xFF padding, and a matching summary table. */
+void bench_gen_image(u8 *image, int sessions, int titles, u32 seed);
+
+/* Write a generated image to work_dir/name; returns the full path in
+ * path_out.  Aborts on I/O failure. */
+void bench_write_image(const BenchConfig *cfg, const char *name,
+                       const u8 *image, char *path_out, size_t path_len);
+
+/* Loopback TCP (bench_net.c).  bench_tcp_pair connects *a and *b over
+ * 127.0.0.1.  bench_link_open does the same through a relay thread that
+ * carries each direction at bytes_per_sec on its own, as a full-duplex
+ * network link would (0: a direct connection); bench_link_close closes
+ * both ends and stops the relay. */
+typedef struct BenchLink BenchLink;
+
+void       bench_tcp_pair(int *a, int *b);
+BenchLink *bench_link_open(int *a, int *b, u64 bytes_per_sec);
+void       bench_link_close(BenchLink *l);
+
+/* Send / receive exactly len bytes on a blocking socket, for the benches
+ * that time a plain blocking exchange.  bench_recv_all returns len, 0 on a
+ * clean close or -1; bench_send_all returns len or -1. */
+int        bench_recv_all(int fd, void *buf, int len);
+int        bench_send_all(int fd, const void *buf, int len);
@@ -0,0 +1,215 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Per-title aggregation (pld_agg.c) against the nested summaries × sessions
+ * loop it replaces, over the configured log in NAND (chronological) order
+ * and in merged.dat (sorted) order.  The incremental path is checked by
+ * merging a remote half into a local half with the aggregate attached and
+ * comparing against a fresh build of the result.  A log referencing
+ * PLD_TITLE_MAX titles must aggregate all of them, and an aggregate that
+ * did overflow must not zero the totals of titles it lost.
+ */
+
+static PldAgg s_agg, s_fresh;
+
+/* The recompute the app ran after every merge before pld_agg.c. */
+static void ref_totals(PldFile *pld, const PldSession *e, int n)
+{
+    for (int i = 0; i < PLD_SUMMARY_COUNT; i++) {
+        PldSummary *s = &pld->summaries[i];
+        if (pld_summary_is_empty(s)) continue;
+        s->total_secs = 0;
+        for (int j = 0; j < n; j++) {
+            if (e[j].title_id == s->title_id)
+                s->total_secs += e[j].play_secs;
+        }
+    }
+}
+
+static void gen_summaries(PldFile *pld, int titles)
+{
+    memset(pld, 0, sizeof(*pld));
+    for (int i = 0; i < PLD_SUMMARY_COUNT; i++) {
+        if (i < titles) {
+            pld->summaries[i].title_id = bench_title_id(i);
+            pld->summary_count++;
+        } else {
+            pld->summaries[i].title_id = 0xFFFFFFFFFFFFFFFFULL;
+        }
+    }
+}
+
+/* Compare every field against a scan of a sorted copy of the log, and the
+ * applied summary totals against ref_totals. */
+static void check_agg(const char *what, const PldAgg *agg,
+                      const PldSessionLog *log, int titles)
+{
+    int n = log->count;
+    PldSession *s = malloc((size_t)(n + 1) * sizeof(PldSession));
+    if (!s) bench_fail("out of memory");
+    pld_log_unpack(log, s);
+    bench_sort_sessions(s, n);
+
+    int groups = 0;
+    for (int i = 0; i < n; ) {
+        PldTitleAgg want = { s[i].title_id, 0, 0, s[i].timestamp, 0, 0 };
+        u32 prev_day = 0xFFFFFFFFu;
+        for (; i < n && s[i].title_id == want.title_id; i++) {
+            want.total_secs += s[i].play_secs;
+            want.sessions++;
+            want.last_ts = s[i].timestamp;
+            if (s[i].timestamp / 86400u != prev_day) want.days++;
+            prev_day = s[i].timestamp / 86400u;
+        }
+        const PldTitleAgg *got = pld_agg_find(agg, want.title_id);
+        if (!got || got->total_secs != want.total_secs ||
+            got->sessions != want.sessions || got->first_ts != want.first_ts ||
+            got->last_ts != want.last_ts || got->days != want.days)
+            bench_fail("%s: aggregate for %016llx differs", what,
+                       (unsigned long long)want.title_id);
+        groups++;
+    }
+    if (!agg->valid || agg->count != groups)
+        bench_fail("%s: %d titles aggregated, expected %d", what,
+                   agg->count, groups);
+
+    PldFile a, b;
+    gen_summaries(&a, titles);
+    b = a;
+    ref_totals(&a, s, n);
+    free(s);
+    pld_agg_apply_totals(agg, &b);
+    if (memcmp(&a, &b, sizeof(a)) != 0)
+        bench_fail("%s: summary totals differ from nested loop", what);
+}
+
+static void check_incremental(const BenchConfig *cfg, const PldSession *all,
+                              bool add_only)
+{
+    PldSession *lbuf = malloc((size_t)(cfg->sessions + 1) * sizeof(PldSession));
+    PldSession *rbuf = malloc((size_t)(cfg->sessions + 1) * sizeof(PldSession));
+    if (!lbuf || !rbuf) bench_fail("out of memory");
+
+    /* Local: even records (chronological).  Remote: odd records plus every
+     * eighth one at half the play time, so some keys overlap; sorted, as
+     * peers send them. */
+    int nl = 0, nr = 0;
+    for (int i = 0; i < cfg->sessions; i++) {
+        if (!(i & 1)) lbuf[nl++] = all[i];
+        if ((i & 1) || !(i & 7)) {
+            rbuf[nr] = all[i];
+            rbuf[nr++].play_secs /= 2;
+        }
+    }
+    bench_sort_sessions(rbuf, nr);
+    PldSessionLog local = { NULL, 0, NULL };
+    bench_log_pack(&local, lbuf, nl);
+
+    pld_agg_build(&s_agg, &local);
+    if (pld_merge_sessions_agg(&local, rbuf, nr, add_only, &s_agg) < 0)
+        bench_fail("incremental: merge overflowed");
+    if (!s_agg.valid)
+        bench_fail("incremental: sorted merge invalidated the aggregate");
+    check_agg(add_only ? "incremental add_only" : "incremental sum",
+              &s_agg, &local, cfg->titles);
+
+    pld_sessions_free(&local);
+    free(lbuf);
+    free(rbuf);
+}
+
+static void check_wide(void)
+{
+    int n = 4 * PLD_TITLE_MAX;
+    PldSession *s = malloc((size_t)n * sizeof(PldSession));
+    if (!s) bench_fail("out of memory");
+    for (int i = 0; i < n; i++) {
+        s[i].title_id  = bench_title_id(i % PLD_TITLE_MAX);
+        s[i].timestamp = 3600u * (u32)(i / PLD_TITLE_MAX);
+        s[i].play_secs = 60;
+    }
+    bench_sort_sessions(s, n);
+    PldSessionLog log = { NULL, 0, NULL };
+    bench_log_pack(&log, s, n);
+    pld_agg_build(&s_agg, &log);
+    if (s_agg.overflow || s_agg.count != PLD_TITLE_MAX)
+        bench_fail("wide: %d of %d titles aggregated", s_agg.count,
+                   PLD_TITLE_MAX);
+    check_agg("wide", &s_agg, &log, PLD_SUMMARY_COUNT);
+
+    /* pretend the last summary's title was dropped */
+    PldFile pld;
+    gen_summaries(&pld, PLD_SUMMARY_COUNT);
+    PldSummary *lost = &pld.summaries[PLD_SUMMARY_COUNT - 1];
+    lost->title_id   = 0x0004000000FFFF00ULL;
+    lost->total_secs = 1234;
+    s_agg.overflow = true;
+    pld_agg_apply_totals(&s_agg, &pld);
+    if (lost->total_secs != 1234)
+        bench_fail("wide: overflowed aggregate zeroed a lost title's total");
+    s_agg.overflow = false;
+    pld_agg_apply_totals(&s_agg, &pld);
+    if (lost->total_secs != 0)
+        bench_fail("wide: title with no sessions kept its total");
+
+    pld_sessions_free(&log);
+    free(s);
+}
+
+void bench_pld_agg(const BenchConfig *cfg)
+{
+    PldSession *chrono = malloc((size_t)(cfg->sessions + 1) * sizeof(PldSession));
+    PldSession *sorted = malloc((size_t)(cfg->sessions + 1) * sizeof(PldSession));
+    if (!chrono || !sorted) bench_fail("out of memory");
+    bench_gen_sessions(chrono, cfg->sessions, cfg->titles, 0xa99u);
+    memcpy(sorted, chrono, (size_t)cfg->sessions * sizeof(PldSession));
+    bench_sort_sessions(sorted, cfg->sessions);
+
+    PldSessionLog chrono_log = { NULL, 0, NULL };
+    PldSessionLog sorted_log = { NULL, 0, NULL };
+    bench_log_pack(&chrono_log, chrono, cfg->sessions);
+    bench_log_pack(&sorted_log, sorted, cfg->sessions);
+
+    pld_agg_build(&s_agg, &chrono_log);
+    check_agg("chrono", &s_agg, &chrono_log, cfg->titles);
+    pld_agg_build(&s_fresh, &sorted_log);
+    check_agg("sorted", &s_fresh, &sorted_log, cfg->titles);
+    check_incremental(cfg, chrono, true);
+    check_incremental(cfg, chrono, false);
+    check_wide();
+
+    const u64 bytes = (u64)cfg->sessions * sizeof(PldSession);
+    PldFile pld;
+    gen_summaries(&pld, cfg->titles);
+    u64 t0 = bench_now_ns();
+    for (int it = 0; it < cfg->iters; it++)
+        ref_totals(&pld, chrono, cfg->sessions);
+    u64 t_ref = bench_now_ns() - t0;
+
+    t0 = bench_now_ns();
+    for (int it = 0; it < cfg->iters; it++) {
+        pld_agg_build(&s_agg, &chrono_log);
+        pld_agg_apply_totals(&s_agg, &pld);
+    }
+    u64 t_chrono = bench_now_ns() - t0;
+
+    t0 = bench_now_ns();
+    for (int it = 0; it < cfg->iters; it++) {
+        pld_agg_build(&s_agg, &sorted_log);
+        pld_agg_apply_totals(&s_agg, &pld);
+    }
+    u64 t_sorted = bench_now_ns() - t0;
+
+    bench_report("totals nested", cfg, t_ref, cfg->iters, bytes);
+    bench_report("agg chrono", cfg, t_chrono, cfg->iters, bytes);
+    bench_report("agg sorted", cfg, t_sorted, cfg->iters, bytes);
+
+    pld_sessions_free(&chrono_log);
+    pld_sessions_free(&sorted_log);
+    free(chrono);
+    free(sorted);
+}
@@ -0,0 +1,278 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/*
+ * Operation arena (pld_arena.c).  Loads and writes an image inside a
+ * PLD_ARENA_BYTES arena, and runs the startup and sync flows with one
+ * held only while they build images, as the app does, asserting each
+ * high-water mark: one image, no spills, empty at the end.  Results must
+ * match the same flows without an arena, logs must outlive it, and a
+ * flow's heap peak must not pass the malloc flow's by more than the
+ * block's slack.  Also checks the fallbacks (an arena too small spills to
+ * malloc, a second arena on one thread doesn't begin, an out-of-order free
+ * waits for the end) and that an arena is one thread's: another thread's
+ * scratch goes to malloc and it may begin its own.  Times pld_read_sd
+ * with and without an arena.
+ */
+
+/* One PLD_FILE_SIZE block and its header. */
+#define IMAGE_SLOT  (16u + ((PLD_FILE_SIZE + 15u) & ~15u))
+
+typedef struct {
+    PldFile       pld;
+    PldSessionLog log;
+} Loaded;
+
+static void load(const char *path, Loaded *l)
+{
+    if (R_FAILED(pld_read_sd(path, &l->pld, &l->log)))
+        bench_fail("pld_read_sd(%s)", path);
+}
+
+static void expect_same(const char *what, const Loaded *a, const Loaded *b)
+{
+    if (a->log.count != b->log.count ||
+        memcmp(a->log.entries, b->log.entries,
+               (size_t)a->log.count * sizeof(PldRec)) != 0 ||
+        a->log.titles->count != b->log.titles->count ||
+        memcmp(a->log.titles->ids, b->log.titles->ids,
+               (size_t)a->log.titles->count * sizeof(u64)) != 0 ||
+        memcmp(a->pld.summaries, b->pld.summaries,
+               sizeof(a->pld.summaries)) != 0)
+        bench_fail("%s: differs from the malloc flow", what);
+}
+
+static void expect_peak(const char *what, const PldArena *a, size_t peak)
+{
+    printf("%-24s %-10s peak %7zu bytes, %u spills\n", "", what, a->peak,
+           (unsigned)a->spills);
+    if (a->peak != peak || a->spills != 0)
+        bench_fail("%s: peak %zu (want %zu), %u spills", what, a->peak, peak,
+                   (unsigned)a->spills);
+}
+
+static void expect_files_equal(const char *a, const char *b)
+{
+    u8 *x = malloc(PLD_FILE_SIZE), *y = malloc(PLD_FILE_SIZE);
+    FILE *fa = fopen(a, "rb"), *fb = fopen(b, "rb");
+    if (!x || !y || !fa || !fb ||
+        fread(x, 1, PLD_FILE_SIZE, fa) != PLD_FILE_SIZE ||
+        fread(y, 1, PLD_FILE_SIZE, fb) != PLD_FILE_SIZE ||
+        memcmp(x, y, PLD_FILE_SIZE) != 0)
+        bench_fail("%s and %s differ", a, b);
+    fclose(fa);
+    fclose(fb);
+    free(y);
+    free(x);
+}
+
+/* Startup: NAND image and merged.dat in, merged.dat out, built in arena
+ * if it is non-NULL. */
+static void startup_flow(const char *nand, const char *sd, const char *out,
+                         Loaded *res, PldArena *arena)
+{
+    Loaded other;
+    load(nand, res);
+    load(sd, &other);
+    if (pld_merge_summaries(&res->pld, other.pld.summaries, PLD_SUMMARY_COUNT,
+                            true) < 0)
+        bench_fail("startup merge failed");
+    PldSession *tmp = pld_scratch_alloc((size_t)other.log.count *
+                                        sizeof(PldSession) + 1);
+    if (!tmp) bench_fail("out of memory");
+    pld_log_unpack(&other.log, tmp);
+    if (pld_merge_sessions(&res->log, tmp, other.log.count, true) < 0)
+        bench_fail("startup merge failed");
+    pld_scratch_free(tmp);
+    pld_sessions_free(&other.log);
+    if (arena && !pld_arena_begin(arena, PLD_ARENA_BYTES))
+        bench_fail("pld_arena_begin failed");
+    if (R_FAILED(pld_write_sd(out, &res->pld, &res->log)))
+        bench_fail("pld_write_sd(%s)", out);
+    if (arena) pld_arena_end(arena);
+}
+
+/* Sync: the peer's table received into scratch, merged, committed, the
+ * commit in arena if it is non-NULL. */
+static void sync_flow(const char *peer, const char *dat, const char *jnl,
+                      Loaded *local, PldArena *arena)
+{
+    Loaded remote;
+    load(peer, &remote);
+    PldSession *buf = pld_scratch_alloc(PLD_SESSION_COUNT * sizeof(PldSession));
+    if (!buf) bench_fail("out of memory");
+    pld_log_unpack(&remote.log, buf);
+    int n = remote.log.count;
+    pld_sessions_free(&remote.log);
+    if (pld_merge_sessions(&local->log, buf, n, false) < 0)
+        bench_fail("sync merge failed");
+    pld_scratch_free(buf);
+    if (pld_merge_summaries(&local->pld, remote.pld.summaries,
+                            PLD_SUMMARY_COUNT, false) < 0)
+        bench_fail("sync summary merge failed");
+    PldCommit c = { 0 };
+    if (arena && !pld_arena_begin(arena, PLD_ARENA_BYTES))
+        bench_fail("pld_arena_begin failed");
+    if (R_FAILED(pld_journal_commit(dat, jnl, &local->pld, &local->log, &c)))
+        bench_fail("pld_journal_commit(%s)", dat);
+    if (arena) pld_arena_end(arena);
+}
+
+static void expect_heap(const char *what, u64 arena, u64 plain)
+{
+    printf("%-24s %-10s heap peak %llu bytes with the arena, %llu without\n",
+           "", what, (unsigned long long)arena, (unsigned long long)plain);
+    if (arena > plain + (PLD_ARENA_BYTES - PLD_FILE_SIZE))
+        bench_fail("%s: heap peak %llu with the arena, %llu without", what,
+                   (unsigned long long)arena, (unsigned long long)plain);
+}
+
+/* Another thread, while the caller holds an arena. */
+typedef struct {
+    bool saw_arena;     /* pld_arena_current was not NULL        */
+    bool owned;         /* its scratch block landed in an arena  */
+    bool began;         /* it could begin an arena of its own    */
+} OtherThread;
+
+static void *other_thread(void *raw)
+{
+    OtherThread *o = (OtherThread *)raw;
+    o->saw_arena = pld_arena_current() != NULL;
+    void *p = pld_scratch_alloc(4096);
+    o->owned = pld_scratch_owned(p);
+    pld_scratch_free(p);
+    PldArena own;
+    o->began = pld_arena_begin(&own, 64 * 1024);
+    pld_arena_end(&own);
+    return NULL;
+}
+
+void bench_pld_arena(const BenchConfig *cfg)
+{
+    u8 *image = malloc(PLD_FILE_SIZE);
+    if (!image) bench_fail("out of memory");
+    char nand[256], sd[256], out_a[256], out_m[256];
+    /* Half each, so the union fits the log. */
+    bench_gen_image(image, cfg->sessions / 2, cfg->titles, 0xa1u);
+    bench_write_image(cfg, "arena_nand.dat", image, nand, sizeof(nand));
+    bench_gen_image(image, cfg->sessions / 2, cfg->titles, 0xa2u);
+    bench_write_image(cfg, "arena_sd.dat", image, sd, sizeof(sd));
+    snprintf(out_a, sizeof(out_a), "%s/arena_out.dat", cfg->work_dir);
+    snprintf(out_m, sizeof(out_m), "%s/arena_out_malloc.dat", cfg->work_dir);
+
+    /* Load: the image is staged in the arena, the log is not. */
+    Loaded want, got;
+    load(nand, &want);
+    PldArena arena;
+    if (!pld_arena_begin(&arena, PLD_ARENA_BYTES))
+        bench_fail("pld_arena_begin failed");
+    load(nand, &got);
+    if (pld_scratch_owned(got.log.entries) || pld_arena_current()->used != 0)
+        bench_fail("load: log left in the arena");
+    pld_arena_end(&arena);
+    expect_same("load", &got, &want);
+    expect_peak("load", &arena, IMAGE_SLOT);
+    pld_sessions_free(&got.log);
+
+    /* Write. */
+    pld_write_sd(out_m, &want.pld, &want.log);
+    pld_arena_begin(&arena, PLD_ARENA_BYTES);
+    pld_write_sd(out_a, &want.pld, &want.log);
+    pld_arena_end(&arena);
+    expect_files_equal(out_a, out_m);
+    expect_peak("write", &arena, IMAGE_SLOT);
+    pld_sessions_free(&want.log);
+
+    /* Startup. */
+    Loaded ref, res;
+    u64 mark = bench_heap_mark();
+    startup_flow(nand, sd, out_m, &ref, NULL);
+    u64 heap_malloc = bench_heap_peak_since(mark);
+    mark = bench_heap_mark();
+    startup_flow(nand, sd, out_a, &res, &arena);
+    u64 heap_arena = bench_heap_peak_since(mark);
+    expect_same("startup", &res, &ref);
+    expect_files_equal(out_a, out_m);
+    expect_peak("startup", &arena, IMAGE_SLOT);
+    expect_heap("startup", heap_arena, heap_malloc);
+
+    /* Sync, on top of the startup result. */
+    char dat_a[256], jnl_a[256], dat_m[256], jnl_m[256];
+    snprintf(dat_a, sizeof(dat_a), "%s/arena_merged.dat", cfg->work_dir);
+    snprintf(jnl_a, sizeof(jnl_a), "%s/arena_merged.jnl", cfg->work_dir);
+    snprintf(dat_m, sizeof(dat_m), "%s/arena_merged_m.dat", cfg->work_dir);
+    snprintf(jnl_m, sizeof(jnl_m), "%s/arena_merged_m.jnl", cfg->work_dir);
+    remove(dat_a); remove(jnl_a); remove(dat_m); remove(jnl_m);
+    mark = bench_heap_mark();
+    sync_flow(sd, dat_m, jnl_m, &ref, NULL);
+    heap_malloc = bench_heap_peak_since(mark);
+    mark = bench_heap_mark();
+    sync_flow(sd, dat_a, jnl_a, &res, &arena);
+    heap_arena = bench_heap_peak_since(mark);
+    expect_same("sync", &res, &ref);
+    expect_files_equal(dat_a, dat_m);
+    expect_peak("sync", &arena, IMAGE_SLOT);
+    expect_heap("sync", heap_arena, heap_malloc);
+    pld_sessions_free(&res.log);
+
+    /* Fallbacks. */
+    PldArena small, second;
+    pld_arena_begin(&small, 64 * 1024);
+    if (pld_arena_begin(&second, PLD_ARENA_BYTES))
+        bench_fail("second arena began while one was current");
+    pld_arena_end(&second);
+    load(nand, &got);
+    void *a = pld_scratch_alloc(100), *b = pld_scratch_alloc(100);
+    pld_scratch_free(a);
+    size_t held = small.used;
+    pld_scratch_free(b);
+    if (pld_arena_current() != &small || small.spills != 1 || held == 0 ||
+        small.used != held - 128)
+        bench_fail("fallbacks: %u spills, %zu then %zu bytes held",
+                   (unsigned)small.spills, held, small.used);
+
+    /* Meanwhile another thread has no arena, unless it begins one. */
+    OtherThread o;
+    pthread_t t;
+    if (pthread_create(&t, NULL, other_thread, &o) != 0)
+        bench_fail("pthread_create failed");
+    pthread_join(t, NULL);
+    if (o.saw_arena || o.owned || !o.began || pld_arena_current() != &small)
+        bench_fail("threads: other thread saw %d, owned %d, began %d",
+                   o.saw_arena, o.owned, o.began);
+    pld_arena_end(&small);
+    load(nand, &want);
+    expect_same("spilled load", &got, &want);
+    pld_sessions_free(&got.log);
+    pld_sessions_free(&want.log);
+
+    /* Timing. */
+    u64 t_malloc = 0, t_arena = 0;
+    for (int it = 0; it < cfg->iters; it++) {
+        u64 t0 = bench_now_ns();
+        load(nand, &got);
+        t_malloc += bench_now_ns() - t0;
+        pld_sessions_free(&got.log);
+
+        pld_arena_begin(&arena, PLD_ARENA_BYTES);
+        t0 = bench_now_ns();
+        load(nand, &got);
+        t_arena += bench_now_ns() - t0;
+        pld_arena_end(&arena);
+        pld_sessions_free(&got.log);
+    }
+    bench_report("read_sd (malloc)", cfg, t_malloc, cfg->iters, PLD_FILE_SIZE);
+    bench_report("read_sd (arena)", cfg, t_arena, cfg->iters, PLD_FILE_SIZE);
+
+    pld_sessions_free(&ref.log);
+    remove(dat_a); remove(jnl_a); remove(dat_m); remove(jnl_m);
+    remove(out_a);
+    remove(out_m);
+    remove(sd);
+    remove(nand);
+    free(image);
+}
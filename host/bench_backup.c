@@ -0,0 +1,166 @@
+#include "bench.h"
+#include "memprof.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Backup container (pld_backup.c) against raw 806 KB backups.  Checks that
+ * NAND-order, merged.dat-order and irregular images (holes in the session
+ * table, non-hour timestamps, half-empty slots, zeroed summaries) decode to
+ * the identical image, that damaged containers are rejected, and that the
+ * header and readers agree with a raw backup of the same image.  Times
+ * encode, decode, and the restore chooser's per-backup app count for both
+ * formats, and reports the container size.
+ */
+
+static void check_round_trip(const char *what, const u8 *image, u8 *scratch)
+{
+    u8 *buf;
+    u32 len;
+    if (R_FAILED(pld_backup_encode(image, 1234u, &buf, &len)))
+        bench_fail("%s: encode failed", what);
+    if (len >= PLD_FILE_SIZE)
+        bench_fail("%s: container is %u bytes", what, len);
+    memset(scratch, 0, PLD_FILE_SIZE);
+    if (R_FAILED(pld_backup_decode(buf, len, scratch)) ||
+        memcmp(image, scratch, PLD_FILE_SIZE) != 0)
+        bench_fail("%s: decoded image differs", what);
+
+    /* Damage: a flipped payload byte, a truncated payload. */
+    buf[sizeof(PldBackupHeader) + (len - sizeof(PldBackupHeader)) / 2] ^= 0x04;
+    if (R_SUCCEEDED(pld_backup_decode(buf, len, scratch)))
+        bench_fail("%s: corrupt container decoded", what);
+    buf[sizeof(PldBackupHeader) + (len - sizeof(PldBackupHeader)) / 2] ^= 0x04;
+    if (R_SUCCEEDED(pld_backup_decode(buf, len - 1, scratch)))
+        bench_fail("%s: truncated container decoded", what);
+    MEM_FREE(buf);
+}
+
+/* Oddities a real pld.dat may hold, on top of a generated image. */
+static void make_irregular(u8 *image, int sessions)
+{
+    PldSession *t = (PldSession *)(image + PLD_SESSION_OFFSET);
+    for (int i = 3; i < sessions; i += 97)
+        memset(&t[i], 0xFF, sizeof(PldSession));            /* hole */
+    if (sessions > 10) {
+        t[5].timestamp += 1799;                             /* off the hour */
+        t[6].timestamp  = t[2].timestamp - 86400u;          /* backwards */
+        t[7].play_secs  = 0x12345678u;
+    }
+    memset(&t[PLD_SESSION_COUNT - 1], 0xFF, sizeof(PldSession));
+    t[PLD_SESSION_COUNT - 1].play_secs = 7;                 /* half-empty */
+    PldSummary *s = (PldSummary *)(image + PLD_SUMMARY_OFFSET);
+    memset(&s[PLD_SUMMARY_COUNT - 1], 0, sizeof(PldSummary));
+}
+
+void bench_pld_backup(const BenchConfig *cfg)
+{
+    u8 *image   = malloc(PLD_FILE_SIZE);
+    u8 *odd     = malloc(PLD_FILE_SIZE);
+    u8 *scratch = malloc(PLD_FILE_SIZE);
+    if (!image || !odd || !scratch) bench_fail("out of memory");
+    bench_gen_image(image, cfg->sessions, cfg->titles, 0xb4cu);
+
+    /* merged.dat order: written back sorted by pld_write_sd. */
+    char raw_path[256], box_path[256];
+    bench_write_image(cfg, "bench_backup_raw.dat", image, raw_path,
+                      sizeof(raw_path));
+    PldFile       pld;
+    PldSessionLog log;
+    if (R_FAILED(pld_read_sd(raw_path, &pld, &log)))
+        bench_fail("pld_read_sd(%s)", raw_path);
+    pld_sort_sessions(&log);
+    u8 *sorted = pld_build_image(&pld, &log);
+    if (!sorted) bench_fail("out of memory");
+    pld_sessions_free(&log);
+
+    memcpy(odd, image, PLD_FILE_SIZE);
+    make_irregular(odd, cfg->sessions);
+    check_round_trip("nand order", image, scratch);
+    check_round_trip("sorted", sorted, scratch);
+    check_round_trip("irregular", odd, scratch);
+
+    /* File-level readers agree across formats. */
+    u8 *buf;
+    u32 len;
+    if (R_FAILED(pld_backup_encode(image, 1234u, &buf, &len)))
+        bench_fail("encode failed");
+    snprintf(box_path, sizeof(box_path), "%s/bench_backup_box.dat",
+             cfg->work_dir);
+    FILE *f = fopen(box_path, "wb");
+    if (!f || fwrite(buf, 1, len, f) != len) bench_fail("write %s", box_path);
+    fclose(f);
+
+    PldBackupHeader bh;
+    if (R_FAILED(pld_backup_read_header(box_path, &bh)) ||
+        bh.image_hash != pld_hash64(image, PLD_FILE_SIZE, 0) ||
+        bh.created != 1234u || bh.session_count != (u32)cfg->sessions)
+        bench_fail("container header is wrong");
+    if (R_SUCCEEDED(pld_backup_read_header(raw_path, &bh)))
+        bench_fail("raw backup read as a container");
+    int apps_box, apps_raw;
+    if (R_FAILED(pld_backup_app_count(box_path, &apps_box)) ||
+        R_FAILED(pld_backup_app_count(raw_path, &apps_raw)) ||
+        apps_box != apps_raw || apps_raw != pld.summary_count)
+        bench_fail("app counts differ: %d container, %d raw, %d summaries",
+                   apps_box, apps_raw, pld.summary_count);
+    if (R_FAILED(pld_backup_load(box_path, scratch)) ||
+        memcmp(scratch, image, PLD_FILE_SIZE) != 0 ||
+        R_FAILED(pld_backup_load(raw_path, scratch)) ||
+        memcmp(scratch, image, PLD_FILE_SIZE) != 0)
+        bench_fail("pld_backup_load differs from the image");
+    PldFile       back;
+    PldSessionLog back_log;
+    if (R_FAILED(pld_backup_read(box_path, &back, &back_log)) ||
+        back_log.count != cfg->sessions ||
+        back.summary_count != pld.summary_count)
+        bench_fail("pld_backup_read differs");
+    pld_sessions_free(&back_log);
+
+    u64 t0 = bench_now_ns();
+    for (int it = 0; it < cfg->iters; it++) {
+        u8 *b;
+        u32 l;
+        pld_backup_encode(image, 0, &b, &l);
+        MEM_FREE(b);
+    }
+    u64 t_enc = bench_now_ns() - t0;
+
+    t0 = bench_now_ns();
+    for (int it = 0; it < cfg->iters; it++)
+        pld_backup_decode(buf, len, scratch);
+    u64 t_dec = bench_now_ns() - t0;
+
+    int sink = 0;
+    t0 = bench_now_ns();
+    for (int it = 0; it < cfg->iters; it++) {
+        pld_backup_app_count(raw_path, &apps_raw);
+        sink += apps_raw;
+    }
+    u64 t_count_raw = bench_now_ns() - t0;
+
+    t0 = bench_now_ns();
+    for (int it = 0; it < cfg->iters; it++) {
+        pld_backup_app_count(box_path, &apps_box);
+        sink += apps_box;
+    }
+    u64 t_count_box = bench_now_ns() - t0;
+    (void)sink;
+
+    bench_report("backup encode", cfg, t_enc, cfg->iters, PLD_FILE_SIZE);
+    bench_report("backup decode", cfg, t_dec, cfg->iters, PLD_FILE_SIZE);
+    bench_report("app count raw", cfg, t_count_raw, cfg->iters, 0);
+    bench_report("app count container", cfg, t_count_box, cfg->iters, 0);
+    printf("%-24s container %u bytes (raw %u, %.1fx)\n", "", (unsigned)len,
+           (unsigned)PLD_FILE_SIZE, (double)PLD_FILE_SIZE / len);
+
+    MEM_FREE(buf);
+    remove(box_path);
+    remove(raw_path);
+    pld_scratch_free(sorted);
+    free(scratch);
+    free(odd);
+    free(image);
+}
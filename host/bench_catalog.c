@@ -0,0 +1,288 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Backup catalog (pld_catalog.c).  Stores a run of distinct backups into a
+ * scratch directory and checks that retention by count and by bytes
+ * prunes the oldest (never the newest), that the catalog always matches
+ * the directory, and that a deleted, torn, half-renamed or stale catalog
+ * is recovered, including raw backups from before the container.  Times
+ * loading the catalog against rebuilding it from a directory scan.
+ */
+
+#define T0          1700000000u
+#define KEEP        25
+#define LIST_COUNT  200
+
+static void clear_dir(const char *dir)
+{
+    DIR *d = opendir(dir);
+    if (!d) return;
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        if (ent->d_name[0] == '.') continue;
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name);
+        remove(path);
+    }
+    closedir(d);
+}
+
+/* Image i of the run: the base image with a distinct header. */
+static void vary(u8 *image, u32 i)
+{
+    memcpy(image + PLD_HEADER_OFFSET + 8, &i, sizeof(i));
+}
+
+static void store(const char *dir, u8 *image, u32 i, u32 now)
+{
+    vary(image, i);
+    Result rc = pld_backup_store_in(dir, image, now);
+    if (rc != 0)
+        bench_fail("backup %u returned %ld", (unsigned)i, (long)rc);
+}
+
+static void set_retention(int count, u64 bytes)
+{
+    PldRetention r = { count, bytes };
+    pld_backup_set_retention(&r);
+}
+
+/* The catalog lists exactly the backups in dir, newest first, with their
+ * real sizes; returns it loaded. */
+static void check_matches_dir(const char *dir, PldCatalog *cat)
+{
+    if (R_FAILED(pld_catalog_load(dir, cat)))
+        bench_fail("pld_catalog_load(%s)", dir);
+    u64 total = 0;
+    for (int i = 0; i < cat->count; i++) {
+        const PldBackupEntry *e = &cat->entries[i];
+        if (i > 0 && strcmp(cat->entries[i - 1].name, e->name) <= 0)
+            bench_fail("catalog not newest first at %d", i);
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", dir, e->name);
+        struct stat st;
+        if (stat(path, &st) != 0 || (u64)st.st_size != e->size)
+            bench_fail("%s: size %u in catalog", e->name, (unsigned)e->size);
+        total += e->size;
+    }
+    if (total != cat->total_bytes)
+        bench_fail("catalog total %llu, entries sum to %llu",
+                   (unsigned long long)cat->total_bytes,
+                   (unsigned long long)total);
+
+    int files = 0;
+    DIR *d = opendir(dir);
+    struct dirent *ent;
+    while (d && (ent = readdir(d)) != NULL) {
+        if (strncmp(ent->d_name, "pld_backup_", 11) != 0) continue;
+        files++;
+        if (pld_catalog_find(cat, ent->d_name) < 0)
+            bench_fail("%s missing from the catalog", ent->d_name);
+    }
+    if (d) closedir(d);
+    if (files != cat->count)
+        bench_fail("%d backups on disk, %d in the catalog", files, cat->count);
+}
+
+static bool catalogs_equal(const PldCatalog *a, const PldCatalog *b)
+{
+    return a->count == b->count && a->total_bytes == b->total_bytes &&
+           memcmp(a->entries, b->entries,
+                  (size_t)a->count * sizeof(PldBackupEntry)) == 0;
+}
+
+static long read_all(const char *path, u8 **out)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) bench_fail("open %s", path);
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    *out = malloc((size_t)n);
+    if (!*out || fread(*out, 1, (size_t)n, f) != (size_t)n)
+        bench_fail("read %s", path);
+    fclose(f);
+    return n;
+}
+
+static void write_all(const char *path, const u8 *buf, long n)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f || fwrite(buf, 1, (size_t)n, f) != (size_t)n)
+        bench_fail("write %s", path);
+    fclose(f);
+}
+
+static void expect_reload(const char *what, const char *dir,
+                          const PldCatalog *want)
+{
+    PldCatalog got;
+    if (R_FAILED(pld_catalog_load(dir, &got)) || !catalogs_equal(&got, want))
+        bench_fail("%s: reloaded catalog differs", what);
+    pld_catalog_free(&got);
+}
+
+/* Deleted, torn, half-renamed and stale catalogs. */
+static void check_recovery(const char *dir, u8 *image, u32 *next)
+{
+    char path[512], tmp[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, PLD_CATALOG_NAME);
+    snprintf(tmp, sizeof(tmp), "%s/%s.tmp", dir, PLD_CATALOG_NAME);
+
+    PldCatalog cat;
+    check_matches_dir(dir, &cat);
+
+    remove(path);
+    expect_reload("deleted", dir, &cat);
+
+    u8 *bytes;
+    long n = read_all(path, &bytes);
+    write_all(path, bytes, n - 5);
+    expect_reload("torn", dir, &cat);
+
+    /* Crash between removing the catalog and renaming the .tmp. */
+    rename(path, tmp);
+    expect_reload("only .tmp", dir, &cat);
+    struct stat st;
+    if (stat(path, &st) != 0 || stat(tmp, &st) == 0)
+        bench_fail("load did not finish the rename");
+
+    /* Crash before the old catalog was removed: the .tmp is newer. */
+    store(dir, image, *next, T0 + *next * 3600u);
+    (*next)++;
+    PldCatalog newer;
+    check_matches_dir(dir, &newer);
+    u8 *new_bytes;
+    long new_n = read_all(path, &new_bytes);
+    write_all(path, bytes, n);
+    write_all(tmp, new_bytes, new_n);
+    expect_reload("stale catalog and .tmp", dir, &newer);
+
+    /* A torn .tmp loses to the catalog. */
+    write_all(tmp, new_bytes, new_n - 3);
+    expect_reload("torn .tmp", dir, &newer);
+
+    free(new_bytes);
+    free(bytes);
+    pld_catalog_free(&newer);
+    pld_catalog_free(&cat);
+}
+
+/* A raw backup from an older version is picked up by the rebuild. */
+static void check_raw(const char *dir, const BenchConfig *cfg, u8 *image)
+{
+    const char *name = "pld_backup_20200101_000000.dat";
+    char path[512], cat_path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    snprintf(cat_path, sizeof(cat_path), "%s/%s", dir, PLD_CATALOG_NAME);
+    vary(image, 0xFFFFu);
+    write_all(path, image, PLD_FILE_SIZE);
+    remove(cat_path);
+
+    PldCatalog cat;
+    check_matches_dir(dir, &cat);
+    int at = pld_catalog_find(&cat, name);
+    if (at != cat.count - 1)
+        bench_fail("raw backup at %d of %d", at, cat.count);
+    const PldBackupEntry *e = &cat.entries[at];
+    if (!(e->flags & PLD_CATALOG_RAW) || e->size != PLD_FILE_SIZE ||
+        e->image_hash != pld_hash64(image, PLD_FILE_SIZE, 0) ||
+        e->session_count != (u32)cfg->sessions || e->created == 0)
+        bench_fail("raw backup entry is wrong");
+    pld_catalog_free(&cat);
+    remove(path);
+    remove(cat_path);
+}
+
+void bench_pld_catalog(const BenchConfig *cfg)
+{
+    char dir[256];
+    snprintf(dir, sizeof(dir), "%s/bench_catalog", cfg->work_dir);
+    mkdir(dir, 0777);
+    clear_dir(dir);
+
+    u8 *image = malloc(PLD_FILE_SIZE);
+    if (!image) bench_fail("out of memory");
+    bench_gen_image(image, cfg->sessions, cfg->titles, 0xca7u);
+
+    /* Count retention, dedup, and two backups in the same second. */
+    set_retention(KEEP, 0);
+    u32 next = 0;
+    for (; next < 2 * KEEP; next++)
+        store(dir, image, next, T0 + next * 3600u);
+    if (pld_backup_store_in(dir, image, T0 + next * 3600u) != PLD_RC_UNCHANGED)
+        bench_fail("identical backup was stored");
+    store(dir, image, next, T0 + (next - 1) * 3600u);
+    next++;
+
+    PldCatalog cat;
+    check_matches_dir(dir, &cat);
+    vary(image, next - 1);
+    if (cat.count != KEEP ||
+        cat.entries[0].image_hash != pld_hash64(image, PLD_FILE_SIZE, 0) ||
+        cat.entries[0].session_count != (u32)cfg->sessions)
+        bench_fail("count retention kept %d, expected %d", cat.count, KEEP);
+    u32 size = cat.entries[0].size;
+    pld_catalog_free(&cat);
+
+    check_recovery(dir, image, &next);
+    check_raw(dir, cfg, image);
+
+    /* Byte retention, and the newest survives any limit. */
+    set_retention(KEEP, (u64)size * 7 + size / 2);
+    store(dir, image, next, T0 + next * 3600u);
+    next++;
+    check_matches_dir(dir, &cat);
+    if (cat.count != 7 || cat.total_bytes > (u64)size * 7 + size / 2)
+        bench_fail("byte retention kept %d (%llu bytes)", cat.count,
+                   (unsigned long long)cat.total_bytes);
+    pld_catalog_free(&cat);
+    set_retention(KEEP, 1);
+    store(dir, image, next, T0 + next * 3600u);
+    next++;
+    check_matches_dir(dir, &cat);
+    if (cat.count != 1) bench_fail("1-byte limit kept %d", cat.count);
+    pld_catalog_free(&cat);
+
+    /* A long history: the chooser's listing cost. */
+    set_retention(LIST_COUNT, 0);
+    for (int i = 1; i < LIST_COUNT; i++, next++)
+        store(dir, image, next, T0 + next * 3600u);
+    check_matches_dir(dir, &cat);
+    if (cat.count != LIST_COUNT)
+        bench_fail("kept %d of %d", cat.count, LIST_COUNT);
+    u64 dir_bytes = cat.total_bytes;
+    pld_catalog_free(&cat);
+
+    u64 t0 = bench_now_ns();
+    for (int it = 0; it < cfg->iters; it++) {
+        pld_catalog_load(dir, &cat);
+        pld_catalog_free(&cat);
+    }
+    u64 t_load = bench_now_ns() - t0;
+
+    t0 = bench_now_ns();
+    for (int it = 0; it < cfg->iters; it++) {
+        pld_catalog_rebuild(dir, &cat);
+        pld_catalog_free(&cat);
+    }
+    u64 t_scan = bench_now_ns() - t0;
+
+    bench_report("catalog load", cfg, t_load, cfg->iters, 0);
+    bench_report("catalog rebuild (scan)", cfg, t_scan, cfg->iters, 0);
+    printf("%-24s %d backups, %llu KB, catalog %u bytes\n", "", LIST_COUNT,
+           (unsigned long long)(dir_bytes / 1024),
+           (unsigned)(16 + LIST_COUNT * sizeof(PldBackupEntry)));
+
+    set_retention(PLD_MAX_BACKUPS, 0);
+    clear_dir(dir);
+    rmdir(dir);
+    free(image);
+}
@@ -0,0 +1,353 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/*
+ * Sync payload codec (pld_codec.c).  Encodes two kinds of log, the
+ * synthetic one the other cases use and one shaped like a console's (an
+ * evening's play of one game at a time over consecutive hours, a few
+ * favourites), and 72-byte name records, with and without the LZ stage.
+ * Everything must decode back exactly when fed to the reader in uneven
+ * pieces; a cut-off or damaged payload must fail or decode to something,
+ * never run past its buffers.  Reports the size against raw records and
+ * the encode / decode rate of raw bytes, then times a first sync of two
+ * halves of a console-shaped log over a throttled link, raw and encoded.
+ */
+
+#define LINK_RATE    (1024u * 1024u)   /* bytes/s each way: a slow Wi-Fi */
+#define LINK_ITERS   2                 /* timed syncs over the link      */
+#define FEED_PIECE   777               /* bytes per pld_codec_feed       */
+#define REAL_START   473385600u        /* 2015-01-01 00:00               */
+#define NAME_LEN     64
+
+typedef struct {
+    u64  title_id;
+    char name[NAME_LEN];
+} NameRec;                             /* TitleNameEntry's layout */
+
+static const u32 s_codecs[2] = { PLD_CODEC_VARINT, PLD_CODEC_ALL };
+static const char *const s_codec_names[2] = { "varint", "varint+lz" };
+
+/* ── Inputs ─────────────────────────────────────────────────────── */
+
+/* A console's log: a stretch of one to four consecutive hours of one
+ * game every day or so, whole hours inside the stretch and part hours at
+ * its ends, three favourites getting most of the stretches. */
+static void gen_real(PldSession *out, int n, int titles, u32 seed)
+{
+    u32 rng = seed, ts = REAL_START;
+    int fav = titles < 3 ? titles : 3;
+    for (int i = 0; i < n; ) {
+        ts += 3600u * (2 + bench_rand(&rng) % 28);
+        int k = (int)(bench_rand(&rng) % 100 < 70
+                      ? bench_rand(&rng) % (u32)fav
+                      : bench_rand(&rng) % (u32)titles);
+        u32 hours = 1 + bench_rand(&rng) % 4;
+        for (u32 h = 0; h < hours && i < n; h++, i++) {
+            out[i].title_id  = bench_title_id(k);
+            out[i].timestamp = ts;
+            out[i].play_secs = h > 0 && h + 1 < hours
+                               ? 3600u : 60u + bench_rand(&rng) % 3541u;
+            ts += 3600u;
+        }
+    }
+}
+
+static void gen_names(NameRec *out, int n, u32 seed)
+{
+    static const char *const words[] = {
+        "Super", "Mario", "Kart", "Legend", "Zelda", "Pokemon", "Animal",
+        "Crossing", "Fire", "Emblem", "Monster", "Hunter", "Kirby", "Star",
+        "Fox", "Party", "Tennis", "Land", "World", "Deluxe", "3D",
+    };
+    u32 rng = seed;
+    for (int i = 0; i < n; i++) {
+        memset(&out[i], 0, sizeof(out[i]));
+        out[i].title_id = bench_title_id(i);
+        int len = 0, w = 2 + (int)(bench_rand(&rng) % 3);
+        for (int k = 0; k < w; k++)
+            len += snprintf(out[i].name + len, NAME_LEN - (size_t)len, "%s%s",
+                            k ? " " : "",
+                            words[bench_rand(&rng) % (sizeof(words) /
+                                                      sizeof(words[0]))]);
+    }
+}
+
+/* ── Encode / decode ────────────────────────────────────────────── */
+
+typedef struct {
+    const PldSession *s;
+    u32               i;
+} SessionIter;
+
+static void next_session(void *raw, void *out)
+{
+    SessionIter *it = (SessionIter *)raw;
+    *(PldSession *)out = it->s[it->i++];
+}
+
+typedef struct {
+    PldSession *dst;
+    u32         n, cap;
+} Collect;
+
+static int collect(void *raw, const void *elems, u32 n)
+{
+    Collect *c = (Collect *)raw;
+    if (n > c->cap - c->n) return -1;
+    memcpy(c->dst + c->n, elems, (size_t)n * sizeof(PldSession));
+    c->n += n;
+    return 0;
+}
+
+/* Measure, then encode, as pld_recon.c does; malloc'd payload. */
+static u8 *encode(const PldSession *s, u32 n, u32 codec, u32 *len)
+{
+    SessionIter it = { s, 0 };
+    int bound = pld_codec_encode_sessions(next_session, &it, n, codec, NULL);
+    u8 *out = malloc((size_t)bound + 1);
+    if (bound < 0 || !out) bench_fail("out of memory");
+    it.i = 0;
+    int got = pld_codec_encode_sessions(next_session, &it, n, codec, out);
+    if (got < 0 || got > bound)
+        bench_fail("encoded %d bytes, measured %d", got, bound);
+    *len = (u32)got;
+    return out;
+}
+
+/* Feed enc in pieces of piece bytes; sessions decoded, or -1. */
+static int decode(PldCodecReader *r, const u8 *enc, u32 len, u32 piece,
+                  PldSession *out, u32 cap)
+{
+    Collect c = { out, 0, cap };
+    pld_codec_reader_init(r, 0, collect, &c);
+    for (u32 at = 0; at < len; at += piece) {
+        u32 n = len - at < piece ? len - at : piece;
+        if (pld_codec_feed(r, enc + at, n) != 0) return -1;
+    }
+    return pld_codec_reader_done(r) ? (int)c.n : -1;
+}
+
+static void expect_sessions(const char *what, const PldSession *got, int n,
+                            const PldSession *want, int n_want)
+{
+    if (n != n_want ||
+        (n && memcmp(got, want, (size_t)n * sizeof(*want)) != 0))
+        bench_fail("%s: decoded %d sessions, encoded %d", what, n, n_want);
+}
+
+/* A cut-off payload must not end on a block boundary, a malformed header
+ * must be refused, and damage anywhere must stay inside the buffers. */
+static void check_damage(PldCodecReader *r, const u8 *enc, u32 len,
+                         PldSession *out, u32 cap)
+{
+    if (len > 0 && decode(r, enc, len - 1, FEED_PIECE, out, cap) >= 0)
+        bench_fail("a cut-off payload decoded");
+    static const u8 bad[4] = { 5, 0, 4, 0 };   /* stored > plain */
+    pld_codec_reader_init(r, 0, collect, NULL);
+    if (pld_codec_feed(r, bad, 4) != -1)
+        bench_fail("a block storing more than it holds was accepted");
+    u8 *copy = malloc((size_t)len + 1);
+    if (!copy) bench_fail("out of memory");
+    u32 rng = 0xBADu;
+    for (int k = 0; k < 64 && len > 0; k++) {
+        memcpy(copy, enc, len);
+        copy[bench_rand(&rng) % len] ^= (u8)(1 + bench_rand(&rng) % 255);
+        decode(r, copy, len, FEED_PIECE, out, cap);
+    }
+    free(copy);
+}
+
+static void run_log(const BenchConfig *cfg, const char *shape,
+                    const PldSession *s, int n, PldCodecReader *r,
+                    PldSession *out)
+{
+    u64 raw = (u64)n * sizeof(PldSession);
+    for (int c = 0; c < 2; c++) {
+        u32 len;
+        u8 *enc = encode(s, (u32)n, s_codecs[c], &len);
+        char what[48];
+        snprintf(what, sizeof(what), "%s, %s", s_codec_names[c], shape);
+        expect_sessions(what, out, decode(r, enc, len, FEED_PIECE, out,
+                                          (u32)n + 1), s, n);
+        expect_sessions(what, out, decode(r, enc, len, len ? len : 1, out,
+                                          (u32)n + 1), s, n);
+        if (n >= 1000 && len * 2 > raw)
+            bench_fail("%s: %u bytes encoded for %llu raw", what, len,
+                       (unsigned long long)raw);
+        if (c == 1) check_damage(r, enc, len, out, (u32)n + 1);
+
+        u64 t_enc = 0, t_dec = 0;
+        for (int it = 0; it < cfg->iters; it++) {
+            u64 t0 = bench_now_ns();
+            u32 l2;
+            u8 *e2 = encode(s, (u32)n, s_codecs[c], &l2);
+            t_enc += bench_now_ns() - t0;
+            free(e2);
+            t0 = bench_now_ns();
+            decode(r, enc, len, len ? len : 1, out, (u32)n + 1);
+            t_dec += bench_now_ns() - t0;
+        }
+        char stage[64];
+        snprintf(stage, sizeof(stage), "encode %s", what);
+        bench_report(stage, cfg, t_enc, cfg->iters, raw);
+        snprintf(stage, sizeof(stage), "decode %s", what);
+        bench_report(stage, cfg, t_dec, cfg->iters, raw);
+        printf("%-24s %u bytes for %llu raw (%.1fx)\n", "", len,
+               (unsigned long long)raw, len ? (double)raw / len : 0.0);
+        free(enc);
+    }
+}
+
+static void run_names(const BenchConfig *cfg)
+{
+    int n = cfg->titles;
+    NameRec *names = malloc((size_t)n * sizeof(NameRec));
+    if (!names) bench_fail("out of memory");
+    gen_names(names, n, 0x4A3Eu + (u32)n);
+    u64 raw = (u64)n * sizeof(NameRec);
+    for (int c = 0; c < 2; c++) {
+        int bound = pld_codec_encode_elems(names, (u32)n, sizeof(NameRec),
+                                           s_codecs[c], NULL);
+        u8 *enc = malloc((size_t)bound + 1);
+        if (bound < 0 || !enc) bench_fail("out of memory");
+        int len = pld_codec_encode_elems(names, (u32)n, sizeof(NameRec),
+                                         s_codecs[c], enc);
+        void *back;
+        u32 count;
+        if (len < 0 || len > bound ||
+            pld_codec_decode_elems(enc, (u32)len, sizeof(NameRec), &back,
+                                   &count) != 0 ||
+            count != (u32)n ||
+            memcmp(back, names, (size_t)raw) != 0)
+            bench_fail("names, %s: did not come back", s_codec_names[c]);
+        pld_scratch_free(back);
+        printf("%-24s names, %s: %d bytes for %llu raw (%.1fx)\n", "",
+               s_codec_names[c], len, (unsigned long long)raw,
+               len ? (double)raw / len : 0.0);
+        free(enc);
+    }
+    free(names);
+}
+
+/* ── Sync over a link ───────────────────────────────────────────── */
+
+typedef struct {
+    int            fd;
+    u32            codec;
+    PldSessionLog  log;
+    PldReconStats  stats;
+    int            rc;
+} Peer;
+
+static void *peer_run(void *raw)
+{
+    Peer *p = (Peer *)raw;
+    int added = pld_recon_exchange(p->fd, &p->log, NULL, p->codec, NULL, NULL,
+                                   0, NULL, NULL, &p->stats);
+    p->rc = added < 0 ? added : 0;
+    return NULL;
+}
+
+static u64 sync_pair(Peer *a, Peer *b, u32 codec, u64 rate)
+{
+    BenchLink *link = bench_link_open(&a->fd, &b->fd, rate);
+    a->codec = b->codec = codec;
+    u64 t0 = bench_now_ns();
+    pthread_t t;
+    if (pthread_create(&t, NULL, peer_run, b) != 0)
+        bench_fail("pthread_create failed");
+    peer_run(a);
+    pthread_join(t, NULL);
+    u64 ns = bench_now_ns() - t0;
+    bench_link_close(link);
+    if (a->rc != 0 || b->rc != 0)
+        bench_fail("sync with codec %u failed (%d, %d)", codec, a->rc, b->rc);
+    return ns;
+}
+
+static void run_sync(const BenchConfig *cfg, const PldSession *all, int n)
+{
+    PldSession *half[2], *want = malloc(((size_t)n + 1) * sizeof(PldSession));
+    int nh[2] = { 0, 0 };
+    half[0] = malloc(((size_t)n / 2 + 1) * sizeof(PldSession));
+    half[1] = malloc(((size_t)n / 2 + 1) * sizeof(PldSession));
+    if (!want || !half[0] || !half[1]) bench_fail("out of memory");
+    for (int i = 0; i < n; i++) {
+        half[i & 1][nh[i & 1]++] = all[i];
+        want[i] = all[i];
+    }
+    bench_sort_sessions(want, n);
+    bench_sort_sessions(half[0], nh[0]);
+    bench_sort_sessions(half[1], nh[1]);
+
+    Peer pa, pb;
+    memset(&pa, 0, sizeof(pa));
+    memset(&pb, 0, sizeof(pb));
+    static const u32 codecs[3] = { 0, PLD_CODEC_VARINT, PLD_CODEC_ALL };
+    static const char *const names[3] = { "raw", "varint", "varint+lz" };
+    int iters = cfg->iters > LINK_ITERS ? LINK_ITERS : cfg->iters;
+    for (int c = 0; c < 3; c++) {
+        u64 t = 0, wire = 0;
+        for (int it = 0; it < iters; it++) {
+            pld_sessions_free(&pa.log);
+            pld_sessions_free(&pb.log);
+            bench_log_pack(&pa.log, half[0], nh[0]);
+            bench_log_pack(&pb.log, half[1], nh[1]);
+            t += sync_pair(&pa, &pb, codecs[c], LINK_RATE);
+            wire = pa.stats.bytes_sent + pb.stats.bytes_sent;
+            if (!bench_log_equals(&pa.log, want, n) ||
+                !bench_log_equals(&pb.log, want, n))
+                bench_fail("sync, %s: %d and %d sessions, want %d", names[c],
+                           pa.log.count, pb.log.count, n);
+        }
+        char stage[32];
+        snprintf(stage, sizeof(stage), "sync %s, 1 MB/s", names[c]);
+        bench_report(stage, cfg, t, iters, wire);
+        printf("%-24s %llu bytes on the wire\n", "",
+               (unsigned long long)wire);
+    }
+
+    pld_sessions_free(&pa.log);
+    pld_sessions_free(&pb.log);
+    free(half[1]);
+    free(half[0]);
+    free(want);
+}
+
+/* ── Case ───────────────────────────────────────────────────────── */
+
+void bench_pld_codec(const BenchConfig *cfg)
+{
+    int n = cfg->sessions;
+    size_t cap = ((size_t)n + 1) * sizeof(PldSession);
+    PldSession *synth = malloc(cap), *real = malloc(cap), *out = malloc(cap);
+    PldCodecReader *r = malloc(sizeof(*r));
+    if (!synth || !real || !out || !r) bench_fail("out of memory");
+    bench_gen_sessions(synth, n, cfg->titles, 0xC0DEu);
+    bench_sort_sessions(synth, n);
+    gen_real(real, n, cfg->titles, 0xFA11u);
+
+    /* Records in any order come back as they went; a sorted log is what
+     * the codec is built for. */
+    u32 len;
+    u8 *enc = encode(real, (u32)n, PLD_CODEC_ALL, &len);
+    expect_sessions("unsorted", out,
+                    decode(r, enc, len, FEED_PIECE, out, (u32)n + 1), real, n);
+    free(enc);
+
+    run_log(cfg, "sorted", synth, n, r, out);
+    bench_sort_sessions(real, n);
+    run_log(cfg, "console", real, n, r, out);
+    run_names(cfg);
+    gen_real(real, n, cfg->titles, 0xFA11u);
+    run_sync(cfg, real, n);
+
+    free(r);
+    free(out);
+    free(real);
+    free(synth);
+}
@@ -0,0 +1,162 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Compaction / expansion kernels (pld_compact.c) against the scalar
+ * reference loop, over three slot layouts with the configured live count:
+ *
+ *   packed      live records first, then padding (what pld_write_sd emits)
+ *   sparse      live records at uniformly random slots
+ *   frag        runs of 16 live records at random 16-slot boundaries
+ *
+ * Every layout is first checked bit-exact against the reference.
+ */
+
+#define FRAG_RUN 16
+
+typedef enum { LAYOUT_PACKED, LAYOUT_SPARSE, LAYOUT_FRAGMENTED } Layout;
+
+static const char *const s_layout_names[] = { "packed", "sparse", "frag" };
+
+/* Knuth's selection sampling: pick k of n indices in increasing order. */
+static bool select_next(u32 *rng, int *remaining, int left)
+{
+    if (*remaining > 0 && (int)(bench_rand(rng) % (u32)left) < *remaining) {
+        (*remaining)--;
+        return true;
+    }
+    return false;
+}
+
+static void gen_layout(PldSession *table, Layout layout, int live,
+                       int titles, u32 seed)
+{
+    PldSession *recs = malloc((size_t)(live + 1) * sizeof(PldSession));
+    if (!recs) bench_fail("out of memory");
+    bench_gen_sessions(recs, live, titles, seed);
+    memset(table, 0xFF, PLD_SESSION_COUNT * sizeof(PldSession));
+
+    u32 rng = seed ^ 0x9e3779b9u;
+    int next = 0;
+    if (layout == LAYOUT_PACKED) {
+        memcpy(table, recs, (size_t)live * sizeof(PldSession));
+    } else if (layout == LAYOUT_SPARSE) {
+        int remaining = live;
+        for (int i = 0; i < PLD_SESSION_COUNT; i++)
+            if (select_next(&rng, &remaining, PLD_SESSION_COUNT - i))
+                table[i] = recs[next++];
+    } else {
+        int blocks    = PLD_SESSION_COUNT / FRAG_RUN;
+        int remaining = (live + FRAG_RUN - 1) / FRAG_RUN;
+        for (int b = 0; b < blocks; b++) {
+            if (!select_next(&rng, &remaining, blocks - b)) continue;
+            for (int j = 0; j < FRAG_RUN && next < live; j++)
+                table[b * FRAG_RUN + j] = recs[next++];
+        }
+    }
+    free(recs);
+}
+
+static void check_compact(const BenchConfig *cfg, Layout layout,
+                          const PldSession *table, PldSession *a, PldSession *b)
+{
+    const size_t table_bytes = PLD_SESSION_COUNT * sizeof(PldSession);
+    memcpy(a, table, table_bytes);
+    memcpy(b, table, table_bytes);
+    int na = pld_compact_sessions_ref(a, PLD_SESSION_COUNT);
+    int nb = pld_compact_sessions(b, PLD_SESSION_COUNT);
+    if (na != cfg->sessions || nb != na ||
+        memcmp(a, b, (size_t)na * sizeof(PldSession)) != 0)
+        bench_fail("%s: kernel compaction differs from reference",
+                   s_layout_names[layout]);
+
+    /* Image-style compaction: table 16 bytes past the destination. */
+    u8 *img = malloc(table_bytes + sizeof(PldSession));
+    if (!img) bench_fail("out of memory");
+    memcpy(img + sizeof(PldSession), table, table_bytes);
+    int nc = pld_compact_sessions_to((PldSession *)img,
+                                     (const PldSession *)(img + sizeof(PldSession)),
+                                     PLD_SESSION_COUNT);
+    if (nc != na || memcmp(img, a, (size_t)na * sizeof(PldSession)) != 0)
+        bench_fail("%s: shifted compaction differs from reference",
+                   s_layout_names[layout]);
+    free(img);
+
+    /* Expansion must reproduce memset(0xFF) + memcpy byte for byte. */
+    memset(b, 0xFF, table_bytes);
+    memcpy(b, a, (size_t)na * sizeof(PldSession));
+    PldSession *c = malloc(table_bytes);
+    if (!c) bench_fail("out of memory");
+    memset(c, 0x5A, table_bytes);
+    pld_expand_sessions(c, a, na);
+    if (memcmp(b, c, table_bytes) != 0)
+        bench_fail("%s: expansion differs from reference",
+                   s_layout_names[layout]);
+    free(c);
+}
+
+typedef int (*CompactFunc)(PldSession *buf, int n);
+
+static void time_compact(const BenchConfig *cfg, const char *stage,
+                         CompactFunc fn, const PldSession *table,
+                         PldSession *work)
+{
+    u64 total = 0;
+    for (int it = 0; it < cfg->iters; it++) {
+        memcpy(work, table, PLD_SESSION_COUNT * sizeof(PldSession));
+        u64 t0 = bench_now_ns();
+        fn(work, PLD_SESSION_COUNT);
+        total += bench_now_ns() - t0;
+    }
+    bench_report(stage, cfg, total, cfg->iters,
+                 PLD_SESSION_COUNT * sizeof(PldSession));
+}
+
+static void time_expand(const BenchConfig *cfg, const char *stage, bool ref,
+                        const PldSession *live, PldSession *work)
+{
+    u64 total = 0;
+    for (int it = 0; it < cfg->iters; it++) {
+        u64 t0 = bench_now_ns();
+        if (ref) {
+            memset(work, 0xFF, PLD_SESSION_COUNT * sizeof(PldSession));
+            memcpy(work, live, (size_t)cfg->sessions * sizeof(PldSession));
+        } else {
+            pld_expand_sessions(work, live, cfg->sessions);
+        }
+        total += bench_now_ns() - t0;
+    }
+    bench_report(stage, cfg, total, cfg->iters,
+                 PLD_SESSION_COUNT * sizeof(PldSession));
+}
+
+void bench_pld_compact(const BenchConfig *cfg)
+{
+    const size_t table_bytes = PLD_SESSION_COUNT * sizeof(PldSession);
+    PldSession *table = malloc(table_bytes);
+    PldSession *a     = malloc(table_bytes);
+    PldSession *b     = malloc(table_bytes);
+    if (!table || !a || !b) bench_fail("out of memory");
+
+    for (int l = LAYOUT_PACKED; l <= LAYOUT_FRAGMENTED; l++) {
+        gen_layout(table, (Layout)l, cfg->sessions, cfg->titles, 0xc0de + l);
+        check_compact(cfg, (Layout)l, table, a, b);
+
+        char stage[32];
+        snprintf(stage, sizeof(stage), "compact %s ref", s_layout_names[l]);
+        time_compact(cfg, stage, pld_compact_sessions_ref, table, a);
+        snprintf(stage, sizeof(stage), "compact %s kernel", s_layout_names[l]);
+        time_compact(cfg, stage, pld_compact_sessions, table, a);
+    }
+
+    gen_layout(table, LAYOUT_PACKED, cfg->sessions, cfg->titles, 0xc0de);
+    time_expand(cfg, "expand ref", true, table, a);
+    time_expand(cfg, "expand kernel", false, table, a);
+
+    free(table);
+    free(a);
+    free(b);
+}
@@ -0,0 +1,309 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+/*
+ * Full-duplex sync transfer (pld_wire.c).  Two peers, each on its own
+ * thread, swap what a sync moves: their logs as PldSessions, a summary
+ * per title and a 72-byte name record (TitleNameEntry's size) per title.
+ * Once as net.c did before, three phases each sent by the host and only
+ * then by the client, and once through one pld_wire_exchange; every array
+ * must arrive intact either way.  Timed over a direct loopback connection
+ * and over a throttled link carrying each direction at LINK_RATE, where
+ * the serial exchange leaves one direction idle at a time.  Also checks
+ * that a count over the receiver's limit, or a peer that hangs up, fails
+ * the call instead of hanging it.
+ */
+
+#define LINK_RATE    (8u * 1024u * 1024u)   /* bytes/s each way */
+#define LINK_ITERS   3                      /* timed syncs over the link */
+#define NAME_BYTES   72
+
+enum { ARR_SESSIONS, ARR_SUMMARIES, ARR_NAMES, ARR_COUNT };
+
+static const u32 s_max[ARR_COUNT] = {
+    PLD_SESSION_COUNT, PLD_SUMMARY_COUNT, 1024
+};
+
+typedef struct {
+    const void *data;
+    u32         count;
+    u32         elem;
+} Payload;
+
+typedef struct {
+    int      fd;
+    bool     lead;
+    bool     duplex;
+    Payload  out[ARR_COUNT];
+    void    *in[ARR_COUNT];     /* received arrays, malloc'd copies     */
+    u32      in_count[ARR_COUNT];
+    u64      sent;
+    int      rc;
+} Peer;
+
+/* ── Exchanges ──────────────────────────────────────────────────── */
+
+typedef struct {
+    const PldSession *s;
+    u32               i;
+} SessionIter;
+
+static void next_session(void *raw, void *out)
+{
+    SessionIter *it = (SessionIter *)raw;
+    memcpy(out, &it->s[it->i++], sizeof(PldSession));
+}
+
+/* net.c before pld_wire.c: per phase, the lead sends its count and
+ * array, then receives the other's; the other side the reverse.  Nagle's
+ * algorithm is off as pld_wire.c has it, which leaves the old exchange
+ * its delayed-ACK stalls: only the duplexing is measured. */
+static int serial_exchange(Peer *p)
+{
+    int one = 1;
+    setsockopt(p->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    for (int k = 0; k < ARR_COUNT; k++) {
+        const Payload *o = &p->out[k];
+        p->in[k] = malloc((size_t)s_max[k] * o->elem);
+        if (!p->in[k]) bench_fail("out of memory");
+        for (int pass = 0; pass < 2; pass++) {
+            if ((pass == 0) == p->lead) {
+                int bytes = (int)(o->count * o->elem);
+                if (bench_send_all(p->fd, &o->count, 4) != 4 ||
+                    (bytes && bench_send_all(p->fd, o->data, bytes) != bytes))
+                    return -1;
+                p->sent += 4u + (u64)bytes;
+            } else {
+                u32 n = 0;
+                if (bench_recv_all(p->fd, &n, 4) != 4 || n > s_max[k])
+                    return -1;
+                int bytes = (int)(n * o->elem);
+                if (bytes && bench_recv_all(p->fd, p->in[k], bytes) != bytes)
+                    return -1;
+                p->in_count[k] = n;
+            }
+        }
+    }
+    return 0;
+}
+
+static int duplex_exchange(Peer *p)
+{
+    SessionIter it = { p->out[ARR_SESSIONS].data, 0 };
+    PldWireOut out[ARR_COUNT];
+    PldWireIn  in[ARR_COUNT];
+    for (int k = 0; k < ARR_COUNT; k++) {
+        out[k].data  = p->out[k].data;
+        out[k].next  = NULL;
+        out[k].count = p->out[k].count;
+        out[k].elem  = p->out[k].elem;
+        in[k].data   = NULL;
+        in[k].count  = 0;
+        in[k].elem   = p->out[k].elem;
+        in[k].max    = s_max[k];
+        in[k].sink       = NULL;
+        in[k].sink_state = NULL;
+    }
+    out[ARR_SESSIONS].data = &it;
+    out[ARR_SESSIONS].next = next_session;
+
+    PldWireStats st = { 0, 0 };
+    int rc = pld_wire_exchange(p->fd, out, ARR_COUNT, in, ARR_COUNT, &st);
+    p->sent = st.bytes_sent;
+    for (int k = 0; k < ARR_COUNT; k++) {
+        size_t bytes = (size_t)in[k].count * in[k].elem;
+        p->in[k] = malloc(bytes + 1);
+        if (!p->in[k]) bench_fail("out of memory");
+        if (bytes) memcpy(p->in[k], in[k].data, bytes);
+        p->in_count[k] = in[k].count;
+    }
+    for (int k = ARR_COUNT - 1; k >= 0; k--) pld_scratch_free(in[k].data);
+    return rc;
+}
+
+static void *peer_run(void *raw)
+{
+    Peer *p = (Peer *)raw;
+    p->sent = 0;
+    memset(p->in, 0, sizeof(p->in));
+    memset(p->in_count, 0, sizeof(p->in_count));
+    p->rc = p->duplex ? duplex_exchange(p) : serial_exchange(p);
+    return NULL;
+}
+
+static void peer_drop(Peer *p)
+{
+    for (int k = 0; k < ARR_COUNT; k++) {
+        free(p->in[k]);
+        p->in[k] = NULL;
+    }
+}
+
+/* Run both peers over a fresh link; returns the wall time. */
+static u64 sync_pair(Peer *a, Peer *b, bool duplex, u64 rate)
+{
+    BenchLink *link = bench_link_open(&a->fd, &b->fd, rate);
+    a->lead   = true;
+    b->lead   = false;
+    a->duplex = b->duplex = duplex;
+    u64 t0 = bench_now_ns();
+    pthread_t t;
+    if (pthread_create(&t, NULL, peer_run, b) != 0)
+        bench_fail("pthread_create failed");
+    peer_run(a);
+    pthread_join(t, NULL);
+    u64 ns = bench_now_ns() - t0;
+    bench_link_close(link);
+    if (a->rc != 0 || b->rc != 0)
+        bench_fail("%s exchange failed (%d, %d)", duplex ? "duplex" : "serial",
+                   a->rc, b->rc);
+    return ns;
+}
+
+/* p must hold exactly what q sent. */
+static void expect_arrays(const char *what, const Peer *p, const Peer *q)
+{
+    for (int k = 0; k < ARR_COUNT; k++) {
+        const Payload *o = &q->out[k];
+        if (p->in_count[k] != o->count ||
+            (o->count &&
+             memcmp(p->in[k], o->data, (size_t)o->count * o->elem) != 0))
+            bench_fail("%s: array %d arrived as %u elements, sent %u", what,
+                       k, p->in_count[k], o->count);
+    }
+}
+
+/* ── Failure paths ──────────────────────────────────────────────── */
+
+/* One side of a failing exchange: hang up on failure, as net.c's caller
+ * does, so the other side is not left waiting. */
+static void *wire_run(void *raw)
+{
+    Peer *p = (Peer *)raw;
+    p->rc = duplex_exchange(p);
+    if (p->rc != 0) shutdown(p->fd, SHUT_RDWR);
+    return NULL;
+}
+
+static void check_failures(Peer *a, Peer *b)
+{
+    /* a sends more sessions than b takes. */
+    PldSession *fill = calloc(PLD_SESSION_COUNT + 1, sizeof(PldSession));
+    if (!fill) bench_fail("out of memory");
+    Payload saved = a->out[ARR_SESSIONS];
+    a->out[ARR_SESSIONS].data  = fill;
+    a->out[ARR_SESSIONS].count = PLD_SESSION_COUNT + 1;
+    BenchLink *link = bench_link_open(&a->fd, &b->fd, 0);
+    pthread_t t;
+    if (pthread_create(&t, NULL, wire_run, b) != 0)
+        bench_fail("pthread_create failed");
+    wire_run(a);
+    pthread_join(t, NULL);
+    if (b->rc != -1) bench_fail("a count over the limit was accepted");
+    bench_link_close(link);
+    a->out[ARR_SESSIONS] = saved;
+    peer_drop(a);
+    peer_drop(b);
+    free(fill);
+
+    /* The peer hangs up before sending anything. */
+    link = bench_link_open(&a->fd, &b->fd, 0);
+    shutdown(b->fd, SHUT_RDWR);
+    if (duplex_exchange(a) != -1) bench_fail("a closed peer went unnoticed");
+    peer_drop(a);
+    bench_link_close(link);
+}
+
+/* ── Case ───────────────────────────────────────────────────────── */
+
+void bench_pld_duplex(const BenchConfig *cfg)
+{
+    int n = cfg->sessions;
+    PldSession *sa = malloc(((size_t)n + 1) * sizeof(PldSession));
+    PldSession *sb = malloc(((size_t)n + 1) * sizeof(PldSession));
+    PldSummary *ua = calloc((size_t)cfg->titles, sizeof(PldSummary));
+    PldSummary *ub = calloc((size_t)cfg->titles, sizeof(PldSummary));
+    u8 *na = malloc((size_t)cfg->titles * NAME_BYTES);
+    u8 *nb = malloc((size_t)cfg->titles * NAME_BYTES);
+    if (!sa || !sb || !ua || !ub || !na || !nb) bench_fail("out of memory");
+    bench_gen_sessions(sa, n, cfg->titles, 0xD0C5u);
+    bench_gen_sessions(sb, n, cfg->titles, 0xB0B5u);
+    u32 seed = 0x5EEDu;
+    for (int i = 0; i < cfg->titles; i++) {
+        ua[i].title_id = ub[i].title_id = bench_title_id(i);
+        ua[i].total_secs = bench_rand(&seed);
+        ub[i].total_secs = bench_rand(&seed);
+    }
+    for (int i = 0; i < cfg->titles * NAME_BYTES; i++) {
+        na[i] = (u8)bench_rand(&seed);
+        nb[i] = (u8)bench_rand(&seed);
+    }
+
+    Peer pa, pb;
+    memset(&pa, 0, sizeof(pa));
+    memset(&pb, 0, sizeof(pb));
+    const void *da[ARR_COUNT] = { sa, ua, na }, *db[ARR_COUNT] = { sb, ub, nb };
+    const u32 counts[ARR_COUNT] = { (u32)n, (u32)cfg->titles,
+                                    (u32)cfg->titles };
+    const u32 elems[ARR_COUNT] = { sizeof(PldSession), sizeof(PldSummary),
+                                   NAME_BYTES };
+    u64 payload = 0;
+    for (int k = 0; k < ARR_COUNT; k++) {
+        payload += 4u + (u64)counts[k] * elems[k];
+        pa.out[k].data  = da[k];
+        pb.out[k].data  = db[k];
+        pa.out[k].count = pb.out[k].count = counts[k];
+        pa.out[k].elem  = pb.out[k].elem  = elems[k];
+    }
+
+    for (int duplex = 0; duplex < 2; duplex++) {
+        sync_pair(&pa, &pb, duplex, 0);
+        expect_arrays(duplex ? "duplex, a" : "serial, a", &pa, &pb);
+        expect_arrays(duplex ? "duplex, b" : "serial, b", &pb, &pa);
+        if (pa.sent != payload || pb.sent != payload)
+            bench_fail("sent %llu and %llu bytes, payload %llu",
+                       (unsigned long long)pa.sent,
+                       (unsigned long long)pb.sent,
+                       (unsigned long long)payload);
+        peer_drop(&pa);
+        peer_drop(&pb);
+    }
+    check_failures(&pa, &pb);
+
+    static const char *const links[2] = { "loopback", "8 MB/s link" };
+    for (int l = 0; l < 2; l++) {
+        u64 rate = l ? LINK_RATE : 0;
+        int iters = l && cfg->iters > LINK_ITERS ? LINK_ITERS : cfg->iters;
+        u64 t[2] = { 0, 0 }, wire = 0;
+        for (int it = 0; it < iters; it++) {
+            for (int duplex = 0; duplex < 2; duplex++) {
+                t[duplex] += sync_pair(&pa, &pb, duplex, rate);
+                wire = pa.sent + pb.sent;
+                peer_drop(&pa);
+                peer_drop(&pb);
+            }
+        }
+        char stage[32];
+        snprintf(stage, sizeof(stage), "serial, %s", links[l]);
+        bench_report(stage, cfg, t[0], iters, wire);
+        snprintf(stage, sizeof(stage), "duplex, %s", links[l]);
+        bench_report(stage, cfg, t[1], iters, wire);
+        printf("%-24s duplex takes %.0f%% of the serial time\n", "",
+               t[0] ? 100.0 * (double)t[1] / (double)t[0] : 100.0);
+    }
+
+    free(nb);
+    free(na);
+    free(ub);
+    free(ua);
+    free(sb);
+    free(sa);
+}
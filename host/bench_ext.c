@@ -0,0 +1,365 @@
+#include "bench.h"
+#include "memprof.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Extended SD dataset (pld_ext.c).  Merges CONSOLES synthetic consoles of
+ * cfg->sessions sessions each (1M at -s 50000), whose title sets are
+ * shifted so the union passes PLD_SUMMARY_COUNT, with a quarter of every
+ * console's history shared with the first.  Checks the result against a
+ * qsort-and-fold reference for summing and add_only merges, and against
+ * pld_merge_sessions when the union fits a PldSessionLog.  Round-trips
+ * merged2.dat (including an interrupted replace and a damaged block),
+ * checks one title's block-skipping range read, the NAND export and the
+ * app's idempotent fold, and times merge, write, full read and range
+ * read.
+ */
+
+#define CONSOLES     20
+#define TITLE_SHIFT  16
+
+typedef struct {
+    PldFile       pld;
+    PldSessionLog log;
+    PldSession   *sessions;
+    int           count;
+} Console;
+
+static void make_console(Console *c, int idx, const BenchConfig *cfg,
+                         const PldSession *shared)
+{
+    int n = cfg->sessions;
+    c->sessions = malloc((size_t)(n ? n : 1) * sizeof(PldSession));
+    if (!c->sessions) bench_fail("out of memory");
+    bench_gen_sessions(c->sessions, n, cfg->titles, 0xe87u + (u32)idx);
+    for (int i = 0; i < n; i++)
+        c->sessions[i].title_id += ((u64)idx * TITLE_SHIFT) << 8;
+    if (idx > 0)
+        memcpy(c->sessions + n - n / 4, shared,
+               (size_t)(n / 4) * sizeof(PldSession));
+    c->count = n;
+
+    memset(&c->pld, 0, sizeof(c->pld));
+    c->pld.header.field04 = (u32)n;
+    memset(c->pld.summaries, 0xFF, sizeof(c->pld.summaries));
+    int slot[256 + CONSOLES * TITLE_SHIFT];
+    memset(slot, 0xFF, sizeof(slot));
+    for (int i = 0; i < n; i++) {
+        const PldSession *s = &c->sessions[i];
+        int t = (int)((s->title_id - bench_title_id(0)) >> 8);
+        int k = slot[t];
+        if (k < 0) {
+            if (c->pld.summary_count == PLD_SUMMARY_COUNT) continue;
+            k = slot[t] = c->pld.summary_count;
+            PldSummary *m = &c->pld.summaries[k];
+            memset(m, 0, sizeof(*m));
+            m->title_id          = s->title_id;
+            m->first_played_days = 0xFFFF;
+            c->pld.summary_count++;
+        }
+        PldSummary *m = &c->pld.summaries[k];
+        u16 day = (u16)(s->timestamp / 86400u);
+        m->launch_count++;
+        if (day < m->first_played_days) m->first_played_days = day;
+        if (day > m->last_played_days)  m->last_played_days  = day;
+    }
+    c->log.entries = NULL;
+    bench_log_pack(&c->log, c->sessions, n);
+}
+
+/* All consoles' sessions, sorted, equal keys folded like the merge. */
+static int reference(const Console *c, bool add_only, PldSession **out)
+{
+    int total = 0;
+    for (int i = 0; i < CONSOLES; i++) total += c[i].count;
+    PldSession *r = malloc((size_t)(total ? total : 1) * sizeof(PldSession));
+    if (!r) bench_fail("out of memory");
+    int n = 0;
+    for (int i = 0; i < CONSOLES; i++) {
+        memcpy(r + n, c[i].sessions, (size_t)c[i].count * sizeof(PldSession));
+        n += c[i].count;
+    }
+    /* qsort isn't stable: tag each record with its position so add_only
+     * keeps the first console's. */
+    for (int i = 0; i < n; i++) r[i].play_secs |= (u32)i << 12;
+    bench_sort_sessions(r, n);
+    int w = 0;
+    for (int i = 0; i < n; i++) {
+        if (w > 0 && r[w - 1].title_id == r[i].title_id &&
+            r[w - 1].timestamp == r[i].timestamp) {
+            u32 a = r[w - 1].play_secs, b = r[i].play_secs;
+            bool i_first = (b >> 12) < (a >> 12);
+            if (add_only) {
+                if (i_first) r[w - 1].play_secs = b;
+            } else {
+                u32 sum = (a & 0xFFF) + (b & 0xFFF);
+                u32 tag = i_first ? b >> 12 : a >> 12;
+                r[w - 1].play_secs = (sum > 3600 ? 3600 : sum) | tag << 12;
+            }
+        } else {
+            r[w++] = r[i];
+        }
+    }
+    for (int i = 0; i < w; i++) r[i].play_secs &= 0xFFF;
+    *out = r;
+    return w;
+}
+
+static void check_sessions(const char *what, const PldSession *got, int n,
+                           const PldSession *want, int m)
+{
+    if (n != m) bench_fail("%s: %d sessions, expected %d", what, n, m);
+    for (int i = 0; i < n; i++)
+        if (got[i].title_id != want[i].title_id ||
+            got[i].timestamp != want[i].timestamp ||
+            got[i].play_secs != want[i].play_secs)
+            bench_fail("%s: session %d differs", what, i);
+}
+
+static void merge_all(PldExt *x, const Console *c, bool add_only)
+{
+    pld_ext_init(x);
+    for (int i = 0; i < CONSOLES; i++)
+        if (pld_ext_merge_log(x, &c[i].pld, &c[i].log, add_only) < 0)
+            bench_fail("pld_ext_merge_log failed");
+}
+
+static bool ext_equal(const PldExt *a, const PldExt *b)
+{
+    return a->count == b->count && a->summary_count == b->summary_count &&
+           a->rollup_count == b->rollup_count &&
+           memcmp(&a->header, &b->header, sizeof(a->header)) == 0 &&
+           memcmp(a->sessions, b->sessions,
+                  (size_t)a->count * sizeof(PldSession)) == 0 &&
+           memcmp(a->summaries, b->summaries,
+                  (size_t)a->summary_count * sizeof(PldSummary)) == 0;
+}
+
+static void check_file(const char *path, const PldExt *x)
+{
+    char tmp[300];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    PldExt back;
+    if (R_FAILED(pld_ext_write(path, x)) || R_FAILED(pld_ext_read(path, &back)) ||
+        !ext_equal(x, &back))
+        bench_fail("merged2.dat round trip differs");
+    pld_ext_free(&back);
+
+    /* Interrupted replace: only the .tmp is there. */
+    rename(path, tmp);
+    if (R_FAILED(pld_ext_read(path, &back)) || !ext_equal(x, &back))
+        bench_fail("merged2.dat not recovered from .tmp");
+    pld_ext_free(&back);
+
+    /* A flipped byte in the last block. */
+    if (x->count == 0) return;
+    FILE *f = fopen(path, "r+b");
+    if (!f || fseek(f, -3, SEEK_END) != 0) bench_fail("open %s", path);
+    int ch = fgetc(f);
+    fseek(f, -3, SEEK_END);
+    fputc(ch ^ 0x40, f);
+    fclose(f);
+    if (R_SUCCEEDED(pld_ext_read(path, &back)))
+        bench_fail("damaged merged2.dat read back");
+    pld_ext_write(path, x);
+}
+
+/* One title from the middle of the key range, against a scan. */
+static u64 check_range(const char *path, const PldExt *x)
+{
+    if (x->count == 0) return 0;
+    u64 title = x->sessions[x->count / 2].title_id;
+    int want = 0;
+    for (int i = 0; i < x->count; i++)
+        if (x->sessions[i].title_id == title) want++;
+
+    PldExtReader r;
+    PldSession *got;
+    if (R_FAILED(pld_ext_open(&r, path))) bench_fail("pld_ext_open(%s)", path);
+    int n = pld_ext_read_title(&r, title, &got);
+    if (n != want) bench_fail("range read: %d sessions, expected %d", n, want);
+    for (int i = 0; i < n; i++)
+        if (got[i].title_id != title ||
+            (i > 0 && got[i - 1].timestamp >= got[i].timestamp))
+            bench_fail("range read: session %d out of range or order", i);
+    int need = (want + PLD_EXT_BLOCK - 1) / PLD_EXT_BLOCK + 1;
+    if (r.blocks_read > need)
+        bench_fail("range read fetched %d of %u blocks", r.blocks_read,
+                   (unsigned)r.header.block_count);
+    MEM_FREE(got);
+    pld_ext_close(&r);
+    return title;
+}
+
+static void check_nand(const PldExt *x)
+{
+    PldFile pld;
+    PldSessionLog log;
+    if (R_FAILED(pld_ext_to_nand(x, &pld, &log)))
+        bench_fail("pld_ext_to_nand failed");
+    int want = x->count < PLD_SESSION_COUNT ? x->count : PLD_SESSION_COUNT;
+    if (x->summary_count <= PLD_SUMMARY_COUNT && log.count != want)
+        bench_fail("NAND export kept %d of %d sessions", log.count, want);
+    if (log.count > PLD_SESSION_COUNT ||
+        pld.summary_count > PLD_SUMMARY_COUNT ||
+        !pld_sessions_sorted(log.entries, log.count))
+        bench_fail("NAND export doesn't fit the NAND layout");
+
+    /* Nothing of a kept title newer than the oldest kept session was
+     * dropped. */
+    u32 oldest = 0xFFFFFFFFu;
+    for (int i = 0; i < log.count; i++)
+        if (log.entries[i].timestamp < oldest)
+            oldest = log.entries[i].timestamp;
+    int newer = 0;
+    for (int i = 0; i < x->count; i++)
+        if (x->sessions[i].timestamp > oldest &&
+            pld_title_find(log.titles, x->sessions[i].title_id) >= 0)
+            newer++;
+    if (newer > log.count)
+        bench_fail("NAND export dropped newer sessions (%d > %d)", newer,
+                   log.count);
+    u8 *image = pld_build_image(&pld, &log);
+    if (!image) bench_fail("pld_build_image failed");
+    pld_scratch_free(image);
+    pld_sessions_free(&log);
+}
+
+/* pld_ext_fold_log: the app's path.  Folding the same working sets again
+ * changes nothing, and every title ends up with a summary. */
+static void check_fold(const char *path, const Console *c)
+{
+    remove(path);
+    PldExt a, b;
+    for (int pass = 0; pass < 2; pass++) {
+        if (R_FAILED(pld_ext_fold_log(path, &c[0].pld, &c[0].log, NULL, 0)) ||
+            R_FAILED(pld_ext_fold_log(path, NULL, &c[1].log, c[2].sessions,
+                                      c[2].count)) ||
+            R_FAILED(pld_ext_read(path, pass ? &b : &a)))
+            bench_fail("pld_ext_fold_log failed");
+    }
+    if (!ext_equal(&a, &b)) bench_fail("second fold changed merged2.dat");
+    for (int i = 0, k = 0; i < a.count; i++) {
+        while (k < a.summary_count &&
+               a.summaries[k].title_id < a.sessions[i].title_id)
+            k++;
+        if (k == a.summary_count ||
+            a.summaries[k].title_id != a.sessions[i].title_id)
+            bench_fail("fold left session %d without a summary", i);
+    }
+    pld_ext_free(&b);
+    pld_ext_free(&a);
+}
+
+void bench_pld_ext(const BenchConfig *cfg)
+{
+    Console *c = calloc(CONSOLES, sizeof(Console));
+    if (!c) bench_fail("out of memory");
+    for (int i = 0; i < CONSOLES; i++)
+        make_console(&c[i], i, cfg, c[0].sessions);
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s/bench_merged2.dat", cfg->work_dir);
+
+    PldExt x;
+    for (int mode = 0; mode < 2; mode++) {
+        bool add_only = mode == 0;
+        const char *what = add_only ? "add_only" : "sum";
+        PldSession *want;
+        int m = reference(c, add_only, &want);
+        merge_all(&x, c, add_only);
+        check_sessions(what, x.sessions, x.count, want, m);
+
+        /* Against the capped engine while the union still fits it. */
+        if (m <= PLD_SESSION_COUNT) {
+            PldSessionLog log = { NULL, 0, NULL };
+            bench_log_pack(&log, c[0].sessions, c[0].count);
+            for (int i = 1; i < CONSOLES; i++)
+                if (pld_merge_sessions(&log, c[i].sessions, c[i].count,
+                                       add_only) < 0)
+                    bench_fail("%s: pld_merge_sessions overflowed", what);
+            if (!bench_log_equals(&log, want, m))
+                bench_fail("%s: differs from pld_merge_sessions", what);
+            pld_sessions_free(&log);
+        }
+
+        pld_ext_apply_totals(&x);
+        for (int k = 0, i = 0; k < x.summary_count; k++) {
+            u64 id = x.summaries[k].title_id;
+            u32 total = 0;
+            while (i < m && want[i].title_id < id) i++;
+            while (i < m && want[i].title_id == id) total += want[i++].play_secs;
+            if (total != x.summaries[k].total_secs ||
+                (k > 0 && x.summaries[k - 1].title_id >= id))
+                bench_fail("%s: summary %d wrong", what, k);
+        }
+        free(want);
+        if (!add_only) break;
+        pld_ext_free(&x);
+    }
+    if (cfg->sessions > 0 && cfg->titles > 1 &&
+        x.summary_count <= PLD_SUMMARY_COUNT)
+        bench_fail("title union %d fits the NAND table", x.summary_count);
+
+    check_file(path, &x);
+    u64 title = check_range(path, &x);
+    check_nand(&x);
+    check_fold(path, c);
+
+    int iters = cfg->iters / 5 > 0 ? cfg->iters / 5 : 1;
+    u64 t0 = bench_now_ns();
+    for (int it = 0; it < iters; it++) {
+        PldExt y;
+        merge_all(&y, c, false);
+        pld_ext_free(&y);
+    }
+    u64 t_merge = bench_now_ns() - t0;
+
+    t0 = bench_now_ns();
+    for (int it = 0; it < iters; it++)
+        pld_ext_write(path, &x);
+    u64 t_write = bench_now_ns() - t0;
+
+    t0 = bench_now_ns();
+    for (int it = 0; it < iters; it++) {
+        PldExt y;
+        pld_ext_read(path, &y);
+        pld_ext_free(&y);
+    }
+    u64 t_read = bench_now_ns() - t0;
+
+    t0 = bench_now_ns();
+    for (int it = 0; it < iters; it++) {
+        PldExtReader r;
+        PldSession *got = NULL;
+        pld_ext_open(&r, path);
+        pld_ext_read_title(&r, title, &got);
+        MEM_FREE(got);
+        pld_ext_close(&r);
+    }
+    u64 t_range = bench_now_ns() - t0;
+
+    u64 bytes = sizeof(PldExtHeader) +
+                (u64)x.summary_count * sizeof(PldSummary) +
+                (u64)(x.count + PLD_EXT_BLOCK - 1) / PLD_EXT_BLOCK *
+                    sizeof(PldExtBlock) +
+                (u64)x.count * sizeof(PldSession);
+    bench_report("ext merge (20 consoles)", cfg, t_merge, iters,
+                 (u64)x.count * sizeof(PldSession));
+    bench_report("ext write", cfg, t_write, iters, bytes);
+    bench_report("ext read", cfg, t_read, iters, bytes);
+    bench_report("ext read one title", cfg, t_range, iters, 0);
+    printf("%-24s %d sessions, %d titles, %llu KB\n", "", x.count,
+           x.summary_count, (unsigned long long)(bytes / 1024));
+
+    remove(path);
+    pld_ext_free(&x);
+    for (int i = 0; i < CONSOLES; i++) {
+        pld_sessions_free(&c[i].log);
+        free(c[i].sessions);
+    }
+    free(c);
+}
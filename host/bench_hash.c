@@ -0,0 +1,144 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Content hashing and sidecars (pld_hash.c).  Checks pld_hash64 against
+ * reference xxHash64 values and pld_crc32 against the CRC-32 check value,
+ * that pld_write_sd skips an unchanged image and notices a changed or
+ * replaced one, and the startup shortcut (pld_sd_matches_nand).  Times the hash over a full image and a full
+ * merged.dat write against the skipped one.
+ */
+
+static void check_vectors(void)
+{
+    static const struct {
+        const char *what;
+        size_t      len;
+        u64         seed;
+        u64         want;
+    } v[] = {
+        { "empty",     0,    0, 0xEF46DB3751D8E999ULL },
+        { "abc",       3,    0, 0x44BC2CF5AD770999ULL },
+        { "1027 bytes", 1027, 7, 0x6238BDE2ACE77002ULL },
+    };
+    u8 buf[1027];
+    for (int i = 0; i < 1024; i++) buf[i] = (u8)i;
+    memcpy(buf + 1024, "xyz", 3);
+
+    for (int i = 0; i < (int)(sizeof(v) / sizeof(v[0])); i++) {
+        const void *data = (i == 1) ? (const void *)"abc" : buf;
+        u64 got = pld_hash64(data, v[i].len, v[i].seed);
+        if (got != v[i].want)
+            bench_fail("pld_hash64(%s) = %016llx, expected %016llx", v[i].what,
+                       (unsigned long long)got, (unsigned long long)v[i].want);
+    }
+    u32 crc = pld_crc32("123456789", 9, 0);
+    if (crc != 0xCBF43926u ||
+        pld_crc32("6789", 4, pld_crc32("12345", 5, 0)) != crc)
+        bench_fail("pld_crc32 check value is %08x, expected cbf43926",
+                   (unsigned)crc);
+}
+
+static void expect_rc(const char *what, Result got, Result want)
+{
+    if (got != want)
+        bench_fail("%s returned %ld, expected %ld", what, (long)got, (long)want);
+}
+
+/* Write, rewrite, change, replace behind the sidecar's back. */
+static void check_sidecar(const char *path, PldFile *pld, PldSessionLog *log)
+{
+    pld_sidecar_remove(path);
+    remove(path);
+    expect_rc("first write", pld_write_sd(path, pld, log), 0);
+    expect_rc("unchanged write", pld_write_sd(path, pld, log), PLD_RC_UNCHANGED);
+
+    PldFile back;
+    PldSessionLog back_log;
+    PldSidecar sc;
+    if (R_FAILED(pld_read_sd(path, &back, &back_log)) ||
+        R_FAILED(pld_sidecar_read(path, &sc)) ||
+        back.image_hash != sc.image_hash)
+        bench_fail("loaded image hash differs from its sidecar");
+    pld_sessions_free(&back_log);
+
+    pld->header.unknownC ^= 1;
+    expect_rc("changed write", pld_write_sd(path, pld, log), 0);
+    pld->header.unknownC ^= 1;
+    expect_rc("changed-back write", pld_write_sd(path, pld, log), 0);
+
+    /* Another tool rewrites the file with a different header. */
+    FILE *f = fopen(path, "r+b");
+    if (!f) bench_fail("reopen %s", path);
+    PldHeader other = pld->header;
+    other.unknown8 ^= 0x5A5A5A5Au;
+    fwrite(&other, 1, sizeof(other), f);
+    fclose(f);
+    expect_rc("write over replaced file", pld_write_sd(path, pld, log), 0);
+
+    /* Startup shortcut: only a NAND-only merge result for this hash. */
+    const u64 nand = 0x1234567890ABCDEFULL;
+    if (pld_sd_matches_nand(path, nand))
+        bench_fail("plain write claims to match NAND");
+    expect_rc("merged write",
+              pld_write_sd_merged(path, pld, log, nand, true),
+              PLD_RC_UNCHANGED);
+    if (!pld_sd_matches_nand(path, nand) || pld_sd_matches_nand(path, nand + 1))
+        bench_fail("NAND match after merged write is wrong");
+    expect_rc("merged write with extra records",
+              pld_write_sd_merged(path, pld, log, nand, false),
+              PLD_RC_UNCHANGED);
+    if (pld_sd_matches_nand(path, nand))
+        bench_fail("NAND match survived a merge that added records");
+}
+
+void bench_pld_hash(const BenchConfig *cfg)
+{
+    check_vectors();
+
+    u8 *image = malloc(PLD_FILE_SIZE);
+    if (!image) bench_fail("out of memory");
+    bench_gen_image(image, cfg->sessions, cfg->titles, 0x4a5u);
+
+    char path[256];
+    bench_write_image(cfg, "bench_hash.dat", image, path, sizeof(path));
+    PldFile       pld;
+    PldSessionLog log;
+    if (R_FAILED(pld_read_sd(path, &pld, &log)))
+        bench_fail("pld_read_sd(%s)", path);
+    if (pld.image_hash != pld_hash64(image, PLD_FILE_SIZE, 0))
+        bench_fail("pld_read_sd image hash differs");
+    pld_sort_sessions(&log);
+    check_sidecar(path, &pld, &log);
+
+    volatile u64 sink = 0;
+    u64 t0 = bench_now_ns();
+    for (int it = 0; it < cfg->iters; it++)
+        sink += pld_hash64(image, PLD_FILE_SIZE, 0);
+    u64 t_hash = bench_now_ns() - t0;
+    (void)sink;
+
+    u64 t_full = 0, t_skip = 0;
+    for (int it = 0; it < cfg->iters; it++) {
+        pld_sidecar_remove(path);
+        t0 = bench_now_ns();
+        expect_rc("timed write", pld_write_sd(path, &pld, &log), 0);
+        t_full += bench_now_ns() - t0;
+        t0 = bench_now_ns();
+        expect_rc("timed rewrite", pld_write_sd(path, &pld, &log),
+                  PLD_RC_UNCHANGED);
+        t_skip += bench_now_ns() - t0;
+    }
+
+    bench_report("hash64 (image)", cfg, t_hash, cfg->iters, PLD_FILE_SIZE);
+    bench_report("write_sd changed", cfg, t_full, cfg->iters, PLD_FILE_SIZE);
+    bench_report("write_sd unchanged", cfg, t_skip, cfg->iters, PLD_FILE_SIZE);
+
+    pld_sessions_free(&log);
+    pld_sidecar_remove(path);
+    remove(path);
+    free(image);
+}
@@ -0,0 +1,92 @@
+#include "bench.h"
+
+#include <stddef.h>
+#include <string.h>
+
+/*
+ * Heap accounting for the benchmark binary.  host.mk links with
+ * -Wl,--wrap=malloc,... so every allocation made by the pld core and the
+ * bench lands here; libc's own internal allocations (stdio buffers) are not
+ * counted.  Each block carries a 16-byte header holding its size, which
+ * keeps the returned pointer 16-byte aligned.  The counters are atomic:
+ * the sync cases allocate from two peer threads at once.
+ */
+
+#define HEAP_HDR 16u
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t size);
+void  __real_free(void *p);
+
+static u64 s_heap_cur;
+static u64 s_heap_peak;
+
+static void *heap_track(void *raw, size_t size)
+{
+    if (!raw) return NULL;
+    memcpy(raw, &size, sizeof(size));
+    u64 cur  = __atomic_add_fetch(&s_heap_cur, size, __ATOMIC_RELAXED);
+    u64 peak = __atomic_load_n(&s_heap_peak, __ATOMIC_RELAXED);
+    while (cur > peak &&
+           !__atomic_compare_exchange_n(&s_heap_peak, &peak, cur, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+    return (u8 *)raw + HEAP_HDR;
+}
+
+static size_t heap_untrack(void *p)
+{
+    size_t size;
+    memcpy(&size, (u8 *)p - HEAP_HDR, sizeof(size));
+    __atomic_sub_fetch(&s_heap_cur, size, __ATOMIC_RELAXED);
+    return size;
+}
+
+void *__wrap_malloc(size_t size)
+{
+    return heap_track(__real_malloc(size + HEAP_HDR), size);
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    size_t total = n * size;
+    if (size && total / size != n) return NULL;
+    return heap_track(__real_calloc(1, total + HEAP_HDR), total);
+}
+
+void *__wrap_realloc(void *p, size_t size)
+{
+    if (!p) return __wrap_malloc(size);
+    size_t old = heap_untrack(p);
+    void *raw = __real_realloc((u8 *)p - HEAP_HDR, size + HEAP_HDR);
+    if (!raw) {
+        __atomic_add_fetch(&s_heap_cur, old, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    return heap_track(raw, size);
+}
+
+void __wrap_free(void *p)
+{
+    if (!p) return;
+    heap_untrack(p);
+    __real_free((u8 *)p - HEAP_HDR);
+}
+
+u64 bench_heap_current(void)
+{
+    return __atomic_load_n(&s_heap_cur, __ATOMIC_RELAXED);
+}
+
+u64 bench_heap_mark(void)
+{
+    u64 cur = bench_heap_current();
+    __atomic_store_n(&s_heap_peak, cur, __ATOMIC_RELAXED);
+    return cur;
+}
+
+u64 bench_heap_peak_since(u64 mark)
+{
+    return __atomic_load_n(&s_heap_peak, __ATOMIC_RELAXED) - mark;
+}
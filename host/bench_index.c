@@ -0,0 +1,146 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Per-title session index (pld_index.c) against the scan + bubble sort the
+ * detail view ran on every open.  Every summary slot's range is checked
+ * against a scan of the log, and the longest streak against the old
+ * index-array implementation.  Timings are for opening the detail view of
+ * the most-played title; the reference is skipped above REF_MAX sessions
+ * for that title, where the quadratic sort takes seconds.
+ */
+
+#define REF_MAX 8192
+
+/* The old run_detail_view: collect the title's indices, newest first. */
+static int ref_detail(const PldSession *e, int n, u64 title_id, int *out)
+{
+    int k = 0;
+    for (int i = 0; i < n; i++)
+        if (e[i].title_id == title_id)
+            out[k++] = i;
+    for (int i = 0; i < k - 1; i++) {
+        for (int j = i + 1; j < k; j++) {
+            if (e[out[i]].timestamp < e[out[j]].timestamp) {
+                int tmp = out[i];
+                out[i] = out[j];
+                out[j] = tmp;
+            }
+        }
+    }
+    return k;
+}
+
+/* The old pld_longest_streak, over indices sorted newest first. */
+static int ref_streak(const PldSession *e, const int *idx, int count)
+{
+    if (count == 0) return 0;
+    int best = 1, run = 1;
+    int prev_day = (int)(e[idx[0]].timestamp / 86400u);
+    for (int i = 1; i < count; i++) {
+        int cur_day = (int)(e[idx[i]].timestamp / 86400u);
+        if (cur_day == prev_day) continue;
+        run = (prev_day - cur_day == 1) ? run + 1 : 1;
+        if (run > best) best = run;
+        prev_day = cur_day;
+    }
+    return best;
+}
+
+static PldIndex s_index;
+
+void bench_pld_index(const BenchConfig *cfg)
+{
+    PldSession *buf = malloc((size_t)(cfg->sessions + 1) * sizeof(PldSession));
+    int        *ids = malloc(PLD_SESSION_COUNT * sizeof(int));
+    PldFile    *pld = calloc(1, sizeof(PldFile));
+    if (!buf || !ids || !pld) bench_fail("out of memory");
+
+    /* Chronological log, as read from NAND; one summary per title, stored
+     * in reverse title order so slot order differs from key order. */
+    bench_gen_sessions(buf, cfg->sessions, cfg->titles, 0x1d3u);
+    PldSessionLog chrono = { NULL, 0, NULL };
+    bench_log_pack(&chrono, buf, cfg->sessions);
+    for (int i = 0; i < PLD_SUMMARY_COUNT; i++) {
+        pld->summaries[i].title_id = (i < cfg->titles)
+            ? bench_title_id(cfg->titles - 1 - i) : 0xFFFFFFFFFFFFFFFFULL;
+    }
+
+    const PldSession *copy = buf;
+    const int n_all = cfg->sessions;
+
+    pld_index_build(&s_index, pld, &chrono);
+    if (!pld_sessions_sorted(chrono.entries, chrono.count))
+        bench_fail("index build left the log unsorted");
+
+    int heavy_slot = 0, heavy_count = -1;
+    for (int slot = 0; slot < cfg->titles; slot++) {
+        const PldRec *recs;
+        int n = pld_index_range(&s_index, slot, &recs);
+        u64 tid = pld->summaries[slot].title_id;
+        int want = 0;
+        for (int i = 0; i < n_all; i++)
+            if (copy[i].title_id == tid) want++;
+        if (n != want)
+            bench_fail("slot %d: %d sessions indexed, expected %d", slot, n, want);
+        for (int i = 0; i < n; i++) {
+            if (pld_rec_title_id(&chrono, &recs[i]) != tid ||
+                (i > 0 && recs[i].timestamp <= recs[i - 1].timestamp))
+                bench_fail("slot %d: range is not the title's sessions in order",
+                           slot);
+        }
+        if (n > heavy_count) { heavy_count = n; heavy_slot = slot; }
+
+        if (n <= REF_MAX) {
+            int k = ref_detail(copy, n_all, tid, ids);
+            for (int i = 0; i < k; i++)
+                if (copy[ids[i]].timestamp != recs[n - 1 - i].timestamp)
+                    bench_fail("slot %d: newest-first order differs", slot);
+            if (ref_streak(copy, ids, k) != pld_longest_streak(recs, n))
+                bench_fail("slot %d: streak differs", slot);
+        }
+    }
+    const PldRec *empty;
+    if (pld_index_range(&s_index, cfg->titles, &empty) != 0 || empty != NULL)
+        bench_fail("empty summary slot has sessions");
+
+    const u64 bytes = (u64)cfg->sessions * sizeof(PldSession);
+    u64 heavy_tid = pld->summaries[heavy_slot].title_id;
+    char stage[40];
+    if (heavy_count <= REF_MAX) {
+        u64 t0 = bench_now_ns();
+        for (int it = 0; it < cfg->iters; it++)
+            ref_detail(copy, n_all, heavy_tid, ids);
+        u64 t_ref = bench_now_ns() - t0;
+        snprintf(stage, sizeof(stage), "detail scan k=%d", heavy_count);
+        bench_report(stage, cfg, t_ref, cfg->iters, bytes);
+    } else {
+        printf("%-24s sessions=%6d titles=%3d   skipped (k=%d)\n",
+               "detail scan", cfg->sessions, cfg->titles, heavy_count);
+    }
+
+    u64 t0 = bench_now_ns();
+    for (int it = 0; it < cfg->iters; it++)
+        pld_index_build(&s_index, pld, &chrono);
+    u64 t_build = bench_now_ns() - t0;
+
+    volatile int sink = 0;
+    t0 = bench_now_ns();
+    for (int it = 0; it < cfg->iters; it++) {
+        const PldRec *recs;
+        sink += pld_index_range(&s_index, heavy_slot, &recs);
+    }
+    u64 t_range = bench_now_ns() - t0;
+    (void)sink;
+
+    bench_report("index build", cfg, t_build, cfg->iters, bytes);
+    bench_report("index detail", cfg, t_range, cfg->iters, 0);
+
+    pld_sessions_free(&chrono);
+    free(pld);
+    free(ids);
+    free(buf);
+}
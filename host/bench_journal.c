@@ -0,0 +1,353 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * merged.dat journal (pld_journal.c).  Crash injection: a commit cut off at
+ * any byte, or with a corrupted byte, must load as the state before it; a
+ * torn tail must be overwritten by the next commit; a journal left behind
+ * by a checkpoint must be ignored; a view with the journal overlaid must
+ * stream the replayed dataset.  Then runs the same sequence of small syncs
+ * through pld_journal_commit and through pld_write_sd and reports the SD
+ * bytes each writes per sync.
+ */
+
+#define SYNCS       64
+#define SYNC_NEW    8       /* sessions added per simulated sync */
+
+typedef struct {
+    PldFile       pld;
+    PldSessionLog log;
+} State;
+
+static void state_copy(State *dst, const State *src)
+{
+    PldSession *s = malloc((size_t)(src->log.count + 1) * sizeof(PldSession));
+    if (!s) bench_fail("out of memory");
+    pld_log_unpack(&src->log, s);
+    dst->pld = src->pld;
+    dst->log = (PldSessionLog){ NULL, 0, NULL };
+    bench_log_pack(&dst->log, s, src->log.count);
+    free(s);
+}
+
+static void state_free(State *st)
+{
+    pld_sessions_free(&st->log);
+}
+
+/* A sync: SYNC_NEW sessions in the hours after the newest one (while the
+ * log has room), one more session played in an existing hour, and the
+ * touched titles' summaries updated. */
+static void sync_step(State *st, int titles, u32 *rng)
+{
+    PldSession add[SYNC_NEW + 1];
+    int n = 0;
+    u32 newest = 0;
+    for (int i = 0; i < st->log.count; i++)
+        if (st->log.entries[i].timestamp > newest)
+            newest = st->log.entries[i].timestamp;
+    if (st->log.count + SYNC_NEW <= PLD_SESSION_COUNT) {
+        for (int i = 0; i < SYNC_NEW; i++)
+            add[n++] = (PldSession){
+                bench_title_id((int)(bench_rand(rng) % (u32)titles)),
+                newest + 3600u * (u32)(i + 1), 60u + bench_rand(rng) % 3000u };
+    }
+    if (st->log.count > 0) {
+        PldSession old;
+        pld_rec_unpack(&st->log,
+                       &st->log.entries[bench_rand(rng) % (u32)st->log.count],
+                       &old);
+        old.play_secs = 1;
+        add[n++] = old;
+    }
+    if (pld_merge_sessions(&st->log, add, n, false) < 0)
+        bench_fail("sync step overflowed the log");
+
+    for (int i = 0; i < n; i++) {
+        for (int k = 0; k < PLD_SUMMARY_COUNT; k++) {
+            PldSummary *s = &st->pld.summaries[k];
+            if (s->title_id != add[i].title_id) continue;
+            s->total_secs += add[i].play_secs;
+            s->last_played_days = (u16)(add[i].timestamp / 86400u);
+            break;
+        }
+    }
+}
+
+static bool summaries_equal(const PldFile *a, const PldFile *b)
+{
+    int na = 0, nb = 0;
+    for (int i = 0; i < PLD_SUMMARY_COUNT; i++) {
+        const PldSummary *s = &a->summaries[i];
+        if (pld_summary_is_empty(s)) continue;
+        na++;
+        int k = 0;
+        while (k < PLD_SUMMARY_COUNT && b->summaries[k].title_id != s->title_id)
+            k++;
+        if (k == PLD_SUMMARY_COUNT || memcmp(s, &b->summaries[k], sizeof(*s)))
+            return false;
+    }
+    for (int i = 0; i < PLD_SUMMARY_COUNT; i++)
+        if (!pld_summary_is_empty(&b->summaries[i])) nb++;
+    return na == nb;
+}
+
+static void expect_state(const char *what, const char *dat, const char *jnl,
+                         const State *want)
+{
+    State got;
+    if (R_FAILED(pld_journal_read(dat, jnl, &got.pld, &got.log)))
+        bench_fail("%s: pld_journal_read failed", what);
+    pld_sort_sessions(&got.log);
+
+    PldSession *s = malloc((size_t)(want->log.count + 1) * sizeof(PldSession));
+    if (!s) bench_fail("out of memory");
+    pld_log_unpack(&want->log, s);
+    bool same = bench_log_equals(&got.log, s, want->log.count);
+    free(s);
+    if (!same)
+        bench_fail("%s: sessions differ (%d, expected %d)", what,
+                   got.log.count, want->log.count);
+    if (memcmp(&got.pld.header, &want->pld.header, sizeof(PldHeader)) ||
+        !summaries_equal(&got.pld, &want->pld))
+        bench_fail("%s: header or summaries differ", what);
+    state_free(&got);
+}
+
+static void expect_rc(const char *what, Result got, Result want)
+{
+    if (got != want)
+        bench_fail("%s returned %ld, expected %ld", what, (long)got, (long)want);
+}
+
+static u8 *slurp(const char *path, u32 *len)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) bench_fail("cannot open %s", path);
+    fseek(f, 0, SEEK_END);
+    *len = (u32)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    u8 *buf = malloc(*len + 1);
+    if (!buf || fread(buf, 1, *len, f) != *len) bench_fail("read %s", path);
+    fclose(f);
+    return buf;
+}
+
+static void spill(const char *path, const u8 *buf, u32 len)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f || fwrite(buf, 1, len, f) != len) bench_fail("write %s", path);
+    fclose(f);
+}
+
+static bool exists(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (f) fclose(f);
+    return f != NULL;
+}
+
+static void commit_expect_append(const char *what, const char *dat,
+                                 const char *jnl, State *st)
+{
+    PldCommit c = { 0 };
+    expect_rc(what, pld_journal_commit(dat, jnl, &st->pld, &st->log, &c), 0);
+    if (c.checkpoint || c.written == 0)
+        bench_fail("%s: expected an append, got a checkpoint", what);
+}
+
+/* Base checkpoint, then commits A and B; every damaged copy of B's journal
+ * must load as A (or as the base, when the damage reaches into A). */
+static void check_crashes(const BenchConfig *cfg, const char *dat,
+                          const char *jnl, const State *base)
+{
+    u32 rng = 0x51u;
+    State a, b;
+    state_copy(&a, base);
+    sync_step(&a, cfg->titles, &rng);
+    commit_expect_append("commit A", dat, jnl, &a);
+    u32 len_a;
+    free(slurp(jnl, &len_a));
+
+    state_copy(&b, &a);
+    sync_step(&b, cfg->titles, &rng);
+    b.pld.header.unknownC++;
+    commit_expect_append("commit B", dat, jnl, &b);
+    expect_rc("commit B again", pld_journal_commit(dat, jnl, &b.pld, &b.log,
+                                                   NULL), PLD_RC_UNCHANGED);
+    u32 len_b;
+    u8 *full = slurp(jnl, &len_b);
+    expect_state("full journal", dat, jnl, &b);
+
+    /* Every byte near the record boundaries, sampled in between. */
+    u32 span   = len_b - len_a;
+    u32 stride = span > 96 ? span / 48 : 1;
+    for (u32 cut = len_a; cut < len_b; cut++) {
+        if (cut - len_a > 24 && len_b - cut > 24 && (cut - len_a) % stride)
+            continue;
+        spill(jnl, full, cut);
+        expect_state("torn commit", dat, jnl, &a);
+    }
+
+    u8 *bad = malloc(len_b);
+    if (!bad) bench_fail("out of memory");
+    memcpy(bad, full, len_b);
+    bad[len_a + span / 2] ^= 0x10;
+    spill(jnl, bad, len_b);
+    expect_state("corrupt commit", dat, jnl, &a);
+    bad[len_a + span / 2] ^= 0x10;
+    bad[len_a - 9] ^= 0x01;
+    spill(jnl, bad, len_b);
+    expect_state("corrupt earlier commit", dat, jnl, base);
+    free(bad);
+
+    /* The next commit after a torn tail overwrites it. */
+    spill(jnl, full, len_a + span / 2);
+    commit_expect_append("commit over torn tail", dat, jnl, &b);
+    u32 len;
+    free(slurp(jnl, &len));
+    if (len != len_b) bench_fail("torn tail left %u bytes behind", len - len_b);
+    expect_state("commit over torn tail", dat, jnl, &b);
+
+    /* Overlaid view streams the replayed dataset. */
+    PldView v;
+    if (R_FAILED(pld_view_open(&v, dat))) bench_fail("pld_view_open(%s)", dat);
+    PldJournal j;
+    if (R_FAILED(pld_journal_load(dat, jnl, &j)) || j.commits != 2)
+        bench_fail("journal load: %d commits, expected 2", j.commits);
+    pld_view_set_overlay(&v, &j);
+    State viewed = { .pld = { .header = v.header } };
+    for (int i = 0; i < PLD_SUMMARY_COUNT; i++)
+        viewed.pld.summaries[i].title_id = 0xFFFFFFFFFFFFFFFFULL;
+    for (int i = 0; i < PLD_SUMMARY_COUNT &&
+                    pld_view_next_summary(&v, &viewed.pld.summaries[i]); i++)
+        ;
+    PldSession *s = malloc((size_t)(b.log.count + 1) * sizeof(PldSession));
+    PldSession *want = malloc((size_t)(b.log.count + 1) * sizeof(PldSession));
+    if (!s || !want) bench_fail("out of memory");
+    pld_log_unpack(&b.log, want);
+    int n = 0;
+    while (n <= b.log.count && pld_view_next_session(&v, &s[n])) n++;
+    if (n != b.log.count ||
+        memcmp(s, want, (size_t)n * sizeof(PldSession)) != 0 ||
+        memcmp(&viewed.pld.header, &b.pld.header, sizeof(PldHeader)) ||
+        !summaries_equal(&viewed.pld, &b.pld))
+        bench_fail("overlaid view differs from the replayed dataset");
+    free(s);
+    free(want);
+    pld_view_close(&v);
+    pld_journal_free(&j);
+
+    /* Crash between a checkpoint write and the journal's removal. */
+    expect_rc("checkpoint A", pld_write_sd(dat, &a.pld, &a.log), 0);
+    expect_state("stale journal", dat, jnl, &a);
+    if (exists(jnl)) bench_fail("stale journal was not removed");
+
+    free(full);
+    state_free(&a);
+    state_free(&b);
+}
+
+/* Commits until one checkpoints; the journal stays under the limit. */
+static void check_threshold(const BenchConfig *cfg, const char *dat,
+                            const char *jnl, const State *base)
+{
+    u32 rng = 0x77u;
+    State st;
+    state_copy(&st, base);
+    expect_rc("base checkpoint",
+              pld_journal_checkpoint(dat, jnl, &st.pld, &st.log, NULL), 0);
+    PldCommit c = { 0 };
+    int commits = 0;
+    do {
+        sync_step(&st, cfg->titles, &rng);
+        if (R_FAILED(pld_journal_commit(dat, jnl, &st.pld, &st.log, &c)))
+            bench_fail("commit %d failed", commits);
+        if (!c.checkpoint) {
+            u32 len;
+            free(slurp(jnl, &len));
+            if (len > PLD_JOURNAL_MAX)
+                bench_fail("journal grew to %u bytes", len);
+        }
+    } while (!c.checkpoint && ++commits < 10000);
+    if (!c.checkpoint || exists(jnl))
+        bench_fail("no checkpoint after %d commits", commits);
+    expect_state("after checkpoint", dat, jnl, &st);
+    state_free(&st);
+}
+
+/* Bytes written and time taken for SYNCS syncs from base. */
+static void run_syncs(const BenchConfig *cfg, const char *dat, const char *jnl,
+                      const State *base, bool journal, u64 *bytes, u64 *ns,
+                      int *checkpoints)
+{
+    u32 rng = 0x3cu;
+    State st;
+    state_copy(&st, base);
+    remove(jnl);
+    pld_sidecar_remove(dat);
+    if (R_FAILED(pld_write_sd(dat, &st.pld, &st.log)))
+        bench_fail("write base %s", dat);
+
+    *bytes = 0;
+    *ns = 0;
+    *checkpoints = 0;
+    for (int i = 0; i < SYNCS; i++) {
+        sync_step(&st, cfg->titles, &rng);
+        PldCommit c = { 0 };
+        u64 t0 = bench_now_ns();
+        Result rc = journal
+            ? pld_journal_commit(dat, jnl, &st.pld, &st.log, &c)
+            : pld_write_sd(dat, &st.pld, &st.log);
+        *ns += bench_now_ns() - t0;
+        if (R_FAILED(rc)) bench_fail("sync %d failed", i);
+        if (!journal && rc == 0) c.written = PLD_FILE_SIZE + sizeof(PldSidecar);
+        *bytes += c.written;
+        *checkpoints += c.checkpoint;
+    }
+    expect_state(journal ? "journal syncs" : "full syncs", dat, jnl, &st);
+    state_free(&st);
+}
+
+void bench_pld_journal(const BenchConfig *cfg)
+{
+    u8 *image = malloc(PLD_FILE_SIZE);
+    if (!image) bench_fail("out of memory");
+    bench_gen_image(image, cfg->sessions, cfg->titles, 0x6e1u);
+
+    char dat[256], jnl[256];
+    bench_write_image(cfg, "bench_journal.dat", image, dat, sizeof(dat));
+    snprintf(jnl, sizeof(jnl), "%s/bench_journal.journal", cfg->work_dir);
+    free(image);
+    remove(jnl);
+    pld_sidecar_remove(dat);
+
+    State base = { .log = { NULL, 0, NULL } };
+    if (R_FAILED(pld_read_sd(dat, &base.pld, &base.log)))
+        bench_fail("pld_read_sd(%s)", dat);
+    pld_sort_sessions(&base.log);
+    expect_rc("base checkpoint",
+              pld_journal_checkpoint(dat, jnl, &base.pld, &base.log, NULL), 0);
+    expect_state("base", dat, jnl, &base);
+
+    check_crashes(cfg, dat, jnl, &base);
+    check_threshold(cfg, dat, jnl, &base);
+
+    u64 jb, jt, fb, ft;
+    int jc, fc;
+    run_syncs(cfg, dat, jnl, &base, true, &jb, &jt, &jc);
+    run_syncs(cfg, dat, jnl, &base, false, &fb, &ft, &fc);
+    bench_report("sync commit journal", cfg, jt, SYNCS, 0);
+    bench_report("sync commit full", cfg, ft, SYNCS, 0);
+    printf("%-24s %llu bytes/sync journal (%d checkpoints), %llu full rewrite\n",
+           "", (unsigned long long)(jb / SYNCS), jc,
+           (unsigned long long)(fb / SYNCS));
+
+    state_free(&base);
+    remove(jnl);
+    pld_sidecar_remove(dat);
+    remove(dat);
+}
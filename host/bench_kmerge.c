@@ -0,0 +1,213 @@
+#include "bench.h"
+#include "memprof.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Many-way merge (pld_kmerge.c) against repeated pairwise merges.  Merges
+ * FILES overlapping images of every kind the merge loads differently
+ * (NAND-order and sorted raw images, NAND-order and sorted containers)
+ * into a NAND-order log, with more files than PLD_MERGE_FANIN so the
+ * result is carried across passes, and checks sessions and summaries
+ * against pld_merge_sessions + pld_merge_summaries applied file by file,
+ * for both add_only and summing merges: once with the default memory
+ * budget (every input joined in memory) and once with SMALL_MEM, which
+ * no input fits, so each streams through a view or a scratch run.  Times
+ * the two at the default budget.
+ */
+
+#define FILES 20
+#define SMALL_MEM (64u << 10)
+
+/* Image i: the shared history minus every (i + 2)-th session, with its own
+ * play times so summed merges differ from add_only ones. */
+static void make_input(u8 *image, const u8 *base, int i)
+{
+    memcpy(image, base, PLD_FILE_SIZE);
+    PldSession *t = (PldSession *)(image + PLD_SESSION_OFFSET);
+    for (int j = 0; j < PLD_SESSION_COUNT; j++) {
+        if (pld_session_is_empty(&t[j])) continue;
+        if (j % (i + 2) == 1)
+            memset(&t[j], 0xFF, sizeof(PldSession));
+        else
+            t[j].play_secs = (t[j].play_secs + 97u * (u32)i) % 3700u;
+    }
+    PldSummary *s = (PldSummary *)(image + PLD_SUMMARY_OFFSET);
+    s[i % 3].launch_count = (u16)(i + 1);
+}
+
+/* Write image i in the form i % 4 picks. */
+static void write_input(const BenchConfig *cfg, const u8 *image, int i,
+                        char *path, size_t len)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "bench_kmerge_%02d.dat", i);
+    int kind = i % 4;
+    if (kind == 0) {
+        bench_write_image(cfg, name, image, path, len);
+        return;
+    }
+
+    /* Sorted forms go through merged.dat's writer. */
+    u8 *img = (u8 *)image;
+    u8 *sorted = NULL;
+    if (kind == 1 || kind == 3) {
+        bench_write_image(cfg, name, image, path, len);
+        PldFile pld;
+        PldSessionLog log;
+        if (R_FAILED(pld_read_sd(path, &pld, &log)))
+            bench_fail("pld_read_sd(%s)", path);
+        pld_sort_sessions(&log);
+        sorted = pld_build_image(&pld, &log);
+        pld_sessions_free(&log);
+        if (!sorted) bench_fail("out of memory");
+        img = sorted;
+    }
+    if (kind == 1) {
+        bench_write_image(cfg, name, img, path, len);
+    } else {
+        u8 *buf;
+        u32 n;
+        if (R_FAILED(pld_backup_encode(img, 0, &buf, &n)))
+            bench_fail("encode %s", name);
+        snprintf(path, len, "%s/%s", cfg->work_dir, name);
+        FILE *f = fopen(path, "wb");
+        if (!f || fwrite(buf, 1, n, f) != n) bench_fail("write %s", path);
+        fclose(f);
+        MEM_FREE(buf);
+    }
+    pld_scratch_free(sorted);
+}
+
+static void load(const char *path, PldFile *pld, PldSessionLog *log)
+{
+    if (R_FAILED(pld_read_sd(path, pld, log)))
+        bench_fail("pld_read_sd(%s)", path);
+}
+
+/* Reference: one pld_merge_sessions + pld_merge_summaries per file. */
+static int merge_pairwise(PldFile *pld, PldSessionLog *log,
+                          const char *const *paths, int n, bool add_only,
+                          PldSession *scratch)
+{
+    int added = 0;
+    for (int i = 0; i < n; i++) {
+        PldFile       back;
+        PldSessionLog back_log;
+        if (R_FAILED(pld_backup_read(paths[i], &back, &back_log)))
+            bench_fail("pld_backup_read(%s)", paths[i]);
+        pld_log_unpack(&back_log, scratch);
+        int rc = pld_merge_sessions(log, scratch, back_log.count, add_only);
+        pld_sessions_free(&back_log);
+        if (rc < 0 ||
+            pld_merge_summaries(pld, back.summaries, PLD_SUMMARY_COUNT,
+                                add_only) < 0)
+            return -1;
+        added += rc;
+    }
+    pld_sort_sessions(log);
+    return added;
+}
+
+static void check_same(const char *what, const PldFile *a_pld,
+                       const PldSessionLog *a, const PldFile *b_pld,
+                       const PldSessionLog *b)
+{
+    if (a->count != b->count)
+        bench_fail("%s: %d sessions, pairwise %d", what, a->count, b->count);
+    for (int i = 0; i < a->count; i++) {
+        PldSession x, y;
+        pld_rec_unpack(a, &a->entries[i], &x);
+        pld_rec_unpack(b, &b->entries[i], &y);
+        if (x.title_id != y.title_id || x.timestamp != y.timestamp ||
+            x.play_secs != y.play_secs)
+            bench_fail("%s: session %d differs", what, i);
+    }
+    if (a_pld->summary_count != b_pld->summary_count ||
+        memcmp(a_pld->summaries, b_pld->summaries,
+               sizeof(a_pld->summaries)) != 0)
+        bench_fail("%s: summaries differ", what);
+}
+
+void bench_pld_kmerge(const BenchConfig *cfg)
+{
+    u8 *base  = malloc(PLD_FILE_SIZE);
+    u8 *image = malloc(PLD_FILE_SIZE);
+    PldSession *scratch = malloc(PLD_SESSION_COUNT * sizeof(PldSession));
+    PldFile *pld = malloc(4 * sizeof(PldFile));
+    if (!base || !image || !scratch || !pld) bench_fail("out of memory");
+    bench_gen_image(base, cfg->sessions, cfg->titles, 0x3e46eu);
+
+    char local_path[256];
+    char paths_buf[FILES][256];
+    const char *paths[FILES];
+    make_input(image, base, FILES);
+    bench_write_image(cfg, "bench_kmerge_local.dat", image, local_path,
+                      sizeof(local_path));
+    for (int i = 0; i < FILES; i++) {
+        make_input(image, base, i);
+        write_input(cfg, image, i, paths_buf[i], sizeof(paths_buf[i]));
+        paths[i] = paths_buf[i];
+    }
+
+    for (int mode = 0; mode < 4; mode++) {
+        bool add_only = (mode & 1) == 0;
+        pld_merge_set_mem(mode < 2 ? 0 : SMALL_MEM);
+        PldSessionLog log, ref;
+        load(local_path, &pld[0], &log);
+        load(local_path, &pld[1], &ref);
+        int got  = pld_merge_many(&pld[0], &log, paths, FILES, add_only,
+                                  cfg->work_dir);
+        int want = merge_pairwise(&pld[1], &ref, paths, FILES, add_only,
+                                  scratch);
+        if (got != want)
+            bench_fail("%s: added %d, pairwise %d",
+                       add_only ? "add_only" : "sum", got, want);
+        check_same(add_only ? "add_only" : "sum", &pld[0], &log, &pld[1],
+                   &ref);
+        pld_sessions_free(&ref);
+        pld_sessions_free(&log);
+    }
+    pld_merge_set_mem(0);
+
+    /* A missing input fails the merge. */
+    {
+        PldSessionLog log;
+        load(local_path, &pld[0], &log);
+        const char *bad[2] = { paths[0], "/nonexistent/pld.dat" };
+        if (pld_merge_many(&pld[0], &log, bad, 2, true, cfg->work_dir) >= 0)
+            bench_fail("merge with a missing file succeeded");
+        pld_sessions_free(&log);
+    }
+
+    int iters = cfg->iters / 5 > 0 ? cfg->iters / 5 : 1;
+    u64 t_many = 0, t_pair = 0;
+    for (int it = 0; it < iters; it++) {
+        PldSessionLog log;
+        load(local_path, &pld[2], &log);
+        u64 t0 = bench_now_ns();
+        pld_merge_many(&pld[2], &log, paths, FILES, false, cfg->work_dir);
+        t_many += bench_now_ns() - t0;
+        pld_sessions_free(&log);
+
+        load(local_path, &pld[3], &log);
+        t0 = bench_now_ns();
+        merge_pairwise(&pld[3], &log, paths, FILES, false, scratch);
+        t_pair += bench_now_ns() - t0;
+        pld_sessions_free(&log);
+    }
+    bench_report("merge many (k-way)", cfg, t_many, iters,
+                 (u64)FILES * PLD_FILE_SIZE);
+    bench_report("merge many (pairwise)", cfg, t_pair, iters,
+                 (u64)FILES * PLD_FILE_SIZE);
+
+    for (int i = 0; i < FILES; i++)
+        remove(paths[i]);
+    remove(local_path);
+    free(pld);
+    free(scratch);
+    free(image);
+    free(base);
+}
@@ -0,0 +1,156 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Deferred session load (pld_fence_*).  Startup as it was: the whole NAND
+ * image read, merged.dat streamed into it, aggregates applied and the
+ * index built before the first frame.  Startup as it is: the summary
+ * table read on the UI thread while the same work runs behind a fence.
+ * The summaries the list starts from must be the NAND ones, and what the
+ * fence delivers must match the eager result, index included.  Checks
+ * that a fence reads not-ready until its task returns, that waiting twice
+ * is harmless, and times time-to-first-frame both ways.
+ */
+
+typedef struct {
+    const char   *nand;
+    const char   *sd;
+    PldFile       pld;
+    PldSessionLog log;
+    PldAgg        agg;
+    PldIndex      index;
+} FullLoad;
+
+static FullLoad s_eager, s_lazy;
+
+/* main.c's load_sessions_work minus the SD commit. */
+static void full_load(void *raw)
+{
+    FullLoad *l = (FullLoad *)raw;
+    if (R_FAILED(pld_read_sd(l->nand, &l->pld, &l->log)))
+        bench_fail("pld_read_sd(%s)", l->nand);
+    pld_agg_build(&l->agg, &l->log);
+    PldView v;
+    if (R_FAILED(pld_view_open(&v, l->sd)))
+        bench_fail("pld_view_open(%s)", l->sd);
+    if (pld_merge_sessions_view(&l->log, &v, true, &l->agg) < 0 ||
+        pld_merge_summaries_view(&l->pld, &v, true) < 0)
+        bench_fail("merge from %s failed", l->sd);
+    pld_view_close(&v);
+    pld_agg_refresh(&l->agg, &l->log);
+    pld_agg_apply_totals(&l->agg, &l->pld);
+    pld_index_build(&l->index, &l->pld, &l->log);
+}
+
+static void load_summary(const char *path, PldFile *out)
+{
+    PldStorage st;
+    if (R_FAILED(pld_storage_open_stdio(&st, path, false)))
+        bench_fail("open %s", path);
+    if (R_FAILED(pld_load_summary(&st, out)))
+        bench_fail("pld_load_summary(%s)", path);
+    pld_storage_close(&st);
+}
+
+static void expect_same(const FullLoad *a, const FullLoad *b)
+{
+    if (a->log.count != b->log.count ||
+        memcmp(a->log.entries, b->log.entries,
+               (size_t)a->log.count * sizeof(PldRec)) != 0 ||
+        a->log.titles->count != b->log.titles->count ||
+        memcmp(a->log.titles->ids, b->log.titles->ids,
+               (size_t)a->log.titles->count * sizeof(u64)) != 0 ||
+        memcmp(a->pld.summaries, b->pld.summaries,
+               sizeof(a->pld.summaries)) != 0)
+        bench_fail("deferred load differs from the eager one");
+    if (memcmp(a->index.begin, b->index.begin, sizeof(a->index.begin)) != 0 ||
+        memcmp(a->index.count, b->index.count, sizeof(a->index.count)) != 0)
+        bench_fail("deferred index differs from the eager one");
+}
+
+/* A task held until the caller lets it go. */
+typedef struct {
+    bool go;
+    int  result;
+} Held;
+
+static void held_task(void *raw)
+{
+    Held *h = (Held *)raw;
+    while (!__atomic_load_n(&h->go, __ATOMIC_ACQUIRE))
+        ;
+    h->result = 42;
+}
+
+static void check_fence(void)
+{
+    Held h = { false, 0 };
+    PldFence f;
+    if (!pld_fence_start(&f, held_task, &h))
+        bench_fail("pld_fence_start ran the task inline");
+    if (pld_fence_ready(&f)) bench_fail("fence ready before its task returned");
+    __atomic_store_n(&h.go, true, __ATOMIC_RELEASE);
+    while (!pld_fence_ready(&f))
+        ;
+    if (h.result != 42) bench_fail("task's write not visible at the fence");
+    pld_fence_wait(&f);
+    pld_fence_wait(&f);
+    if (!pld_fence_ready(&f) || f.thread) bench_fail("fence not released");
+}
+
+void bench_pld_lazyload(const BenchConfig *cfg)
+{
+    check_fence();
+
+    u8 *image = malloc(PLD_FILE_SIZE);
+    if (!image) bench_fail("out of memory");
+    char nand[256], sd[256];
+    /* Half each, so the union fits the log. */
+    bench_gen_image(image, cfg->sessions / 2, cfg->titles, 0x1a2u);
+    bench_write_image(cfg, "lazy_nand.dat", image, nand, sizeof(nand));
+    bench_gen_image(image, cfg->sessions / 2, cfg->titles, 0x1a3u);
+    bench_write_image(cfg, "lazy_sd.dat", image, sd, sizeof(sd));
+    free(image);
+
+    PldFile nand_pld;
+    PldSessionLog nand_log;
+    if (R_FAILED(pld_read_sd(nand, &nand_pld, &nand_log)))
+        bench_fail("pld_read_sd(%s)", nand);
+    pld_sessions_free(&nand_log);
+
+    u64 t_eager = 0, t_first = 0, t_ready = 0;
+    for (int it = 0; it < cfg->iters; it++) {
+        s_eager.nand = s_lazy.nand = nand;
+        s_eager.sd   = s_lazy.sd   = sd;
+
+        u64 t0 = bench_now_ns();
+        full_load(&s_eager);
+        t_eager += bench_now_ns() - t0;
+
+        PldFile first;
+        PldFence fence;
+        t0 = bench_now_ns();
+        pld_fence_start(&fence, full_load, &s_lazy);
+        load_summary(nand, &first);
+        t_first += bench_now_ns() - t0;
+        pld_fence_wait(&fence);
+        t_ready += bench_now_ns() - t0;
+
+        if (memcmp(first.summaries, nand_pld.summaries,
+                   sizeof(first.summaries)) != 0)
+            bench_fail("first frame's summaries are not the NAND table");
+        expect_same(&s_lazy, &s_eager);
+        pld_sessions_free(&s_eager.log);
+        pld_sessions_free(&s_lazy.log);
+    }
+    bench_report("eager (first frame)", cfg, t_eager, cfg->iters, PLD_FILE_SIZE);
+    bench_report("deferred (first frame)", cfg, t_first, cfg->iters,
+                 PLD_SUMMARY_COUNT * sizeof(PldSummary));
+    bench_report("deferred (sessions)", cfg, t_ready, cfg->iters, PLD_FILE_SIZE);
+
+    remove(sd);
+    remove(nand);
+}
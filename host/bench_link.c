@@ -0,0 +1,446 @@
+#include "bench.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+/*
+ * Connection setup (pld_link.c).  Everything runs on one thread, ticking
+ * like the frame loop does, so a tick that blocked would hang the case
+ * rather than hide in another thread; every tick is timed and one over
+ * TICK_BUDGET fails it.  Host and client links find each other and agree
+ * codecs; stand-ins for the old PLD3 client and host get the raw
+ * handshake; a stand-in host that accepts and then never speaks times the
+ * client out again and again, each retry after twice the last backoff; a
+ * stand-in client that connects and goes silent, or hangs up, sends the
+ * host back to listening, and a real client still gets in after; a
+ * refused connect and one that never completes back off too.  Last, a
+ * pld_wire_exchange with a silent peer fails after the idle timeout.
+ * The timings are shortened so the case takes a couple of seconds.
+ */
+
+#define TICK_BUDGET   5000000ull   /* ns a single tick may take           */
+#define FRAME_US      1000         /* sleep between ticks                 */
+#define SLACK_MS      60u          /* lateness allowed on a deadline      */
+#define RUN_MS        3000u        /* a scenario failing to finish        */
+#define STALL_TRIES   4            /* handshake timeouts against a stall  */
+#define WIRE_IDLE_MS  100u
+
+static u16 s_udp_port, s_tcp_port;
+
+typedef struct {
+    u64 ticks;
+    u64 total_ns;
+    u64 max_ns;
+} TickStats;
+
+static u64 now_ms(void)
+{
+    return bench_now_ns() / 1000000u;
+}
+
+static PldLinkPhase tick(PldLink *l, TickStats *ts)
+{
+    u64 t0 = bench_now_ns();
+    PldLinkPhase phase = pld_link_tick(l, t0 / 1000000u);
+    u64 dt = bench_now_ns() - t0;
+    if (dt > TICK_BUDGET)
+        bench_fail("link: a %s tick in phase %d took %.2f ms",
+                   l->host ? "host" : "client", (int)phase, (double)dt / 1e6);
+    ts->ticks++;
+    ts->total_ns += dt;
+    if (dt > ts->max_ns) ts->max_ns = dt;
+    return phase;
+}
+
+static void link_setup(PldLink *l, bool host)
+{
+    pld_link_init(l, host, s_udp_port, s_tcp_port);
+    l->bcast_addr     = INADDR_LOOPBACK;
+    l->bcast_ms       = 20;
+    l->connect_ms     = 200;
+    l->handshake_ms   = 100;
+    l->backoff_min_ms = 20;
+    l->backoff_max_ms = 160;
+    if (pld_link_open(l, now_ms()) != 0)
+        bench_fail("link: open failed (%s)", strerror(errno));
+}
+
+static void check_running(u64 start, const char *what)
+{
+    if (now_ms() - start > RUN_MS)
+        bench_fail("link: %s did not finish", what);
+}
+
+/* ── Stand-in peers (blocking sockets, never waited on) ─────────── */
+
+static struct sockaddr_in loopback(u16 port)
+{
+    struct sockaddr_in a;
+    memset(&a, 0, sizeof(a));
+    a.sin_family      = AF_INET;
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    a.sin_port        = htons(port);
+    return a;
+}
+
+static void standin_bcast(int udp, bool codec)
+{
+    static const u32 magics[2] = { PLD_LINK_MAGIC_CODEC, PLD_LINK_MAGIC };
+    struct sockaddr_in to = loopback(s_udp_port);
+    for (int i = codec ? 0 : 1; i < 2; i++)
+        sendto(udp, &magics[i], 4, 0, (struct sockaddr *)&to, sizeof(to));
+}
+
+static int standin_listen(int backlog)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    struct sockaddr_in a = loopback(s_tcp_port);
+    if (fd < 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0 ||
+        bind(fd, (struct sockaddr *)&a, sizeof(a)) < 0 ||
+        listen(fd, backlog) < 0)
+        bench_fail("link: stand-in listen failed (%s)", strerror(errno));
+    return fd;
+}
+
+/* A connection the listener has waiting, or -1. */
+static int standin_accept(int ls)
+{
+    struct pollfd p = { ls, POLLIN, 0 };
+    if (poll(&p, 1, 0) <= 0) return -1;
+    return accept(ls, NULL, NULL);
+}
+
+static int standin_connect(void)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in a = loopback(s_tcp_port);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&a, sizeof(a)) < 0)
+        bench_fail("link: stand-in connect failed (%s)", strerror(errno));
+    return fd;
+}
+
+static bool recv_word(int fd, u32 *word)
+{
+    u32 got = 0;
+    while (got < 4) {
+        struct pollfd p = { fd, POLLIN, 0 };
+        if (poll(&p, 1, 1000) <= 0) return false;
+        ssize_t n = recv(fd, (u8 *)word + got, 4 - got, 0);
+        if (n <= 0) return false;
+        got += (u32)n;
+    }
+    return true;
+}
+
+static void send_word(int fd, u32 word)
+{
+    if (send(fd, &word, 4, MSG_NOSIGNAL) != 4)
+        bench_fail("link: stand-in send failed");
+}
+
+/* ── Scenarios ──────────────────────────────────────────────────── */
+
+/* Host and client links connect; the connection carries data. */
+static void case_pair(TickStats *ts, u32 client_codecs)
+{
+    PldLink h, c;
+    link_setup(&h, true);
+    link_setup(&c, false);
+    c.codecs = client_codecs;
+    u64 start = now_ms();
+    while (h.phase != PLD_LINK_READY || c.phase != PLD_LINK_READY) {
+        if (h.phase != PLD_LINK_READY) tick(&h, ts);
+        if (c.phase != PLD_LINK_READY) tick(&c, ts);
+        check_running(start, "host and client connecting");
+        usleep(FRAME_US);
+    }
+    u32 want = client_codecs & PLD_CODEC_ALL;
+    if (h.codec != want || c.codec != want)
+        bench_fail("link: codecs %u / %u agreed, expected %u", h.codec,
+                   c.codec, want);
+    if (h.udp >= 0 || h.listen >= 0 || c.udp >= 0)
+        bench_fail("link: discovery sockets left open once READY");
+    if (h.peer_addr != htonl(INADDR_LOOPBACK) ||
+        c.peer_addr != htonl(INADDR_LOOPBACK))
+        bench_fail("link: wrong peer address");
+    u32 word = 0;
+    send_word(c.tcp, 0xC0FFEEu);
+    if (!recv_word(h.tcp, &word) || word != 0xC0FFEEu)
+        bench_fail("link: connection does not carry data");
+    pld_link_close(&c);
+    pld_link_close(&h);
+}
+
+/* A PLD3-only client: never hears of codecs, answers PLD3. */
+static void case_old_client(TickStats *ts)
+{
+    PldLink h;
+    link_setup(&h, true);
+    int fd = standin_connect();
+    u64 start = now_ms();
+    while (tick(&h, ts) != PLD_LINK_HANDSHAKE) {
+        check_running(start, "host accepting an old client");
+        usleep(FRAME_US);
+    }
+    u32 word = 0;
+    if (!recv_word(fd, &word) || word != PLD_LINK_MAGIC)
+        bench_fail("link: host did not send PLD3 first");
+    send_word(fd, PLD_LINK_MAGIC);
+    while (tick(&h, ts) != PLD_LINK_READY) {
+        check_running(start, "host finishing with an old client");
+        usleep(FRAME_US);
+    }
+    if (h.codec != 0) bench_fail("link: codec %u with an old client", h.codec);
+    close(fd);
+    pld_link_close(&h);
+}
+
+/* A PLD3-only host: the client must not answer PLD4. */
+static void case_old_host(TickStats *ts)
+{
+    int udp = socket(AF_INET, SOCK_DGRAM, 0);
+    int ls  = standin_listen(1);
+    PldLink c;
+    link_setup(&c, false);
+    standin_bcast(udp, false);
+    int fd = -1;
+    u64 start = now_ms();
+    while (fd < 0) {
+        tick(&c, ts);
+        fd = standin_accept(ls);
+        check_running(start, "client connecting to an old host");
+        usleep(FRAME_US);
+    }
+    send_word(fd, PLD_LINK_MAGIC);
+    while (tick(&c, ts) != PLD_LINK_READY) {
+        check_running(start, "client finishing with an old host");
+        usleep(FRAME_US);
+    }
+    u32 word = 0;
+    if (!recv_word(fd, &word) || word != PLD_LINK_MAGIC)
+        bench_fail("link: client answered an old host with %08x", word);
+    if (c.codec != 0) bench_fail("link: codec %u with an old host", c.codec);
+    close(fd);
+    close(ls);
+    close(udp);
+    pld_link_close(&c);
+}
+
+/* A host that accepts and never speaks: handshake timeouts, each retry
+ * after twice the last backoff, capped. */
+static void case_stalled_host(TickStats *ts)
+{
+    int udp = socket(AF_INET, SOCK_DGRAM, 0);
+    int ls  = standin_listen(STALL_TRIES + 1);
+    int held[STALL_TRIES + 1];
+    int n_held = 0;
+    PldLink c;
+    link_setup(&c, false);
+    u32 backoff = c.backoff_min_ms;
+    u64 next_bcast = 0, hs_at = 0, fail_at = 0;
+    PldLinkPhase last = c.phase;
+    u64 start = now_ms();
+    while (c.failures < STALL_TRIES || last != PLD_LINK_SCANNING) {
+        if (now_ms() >= next_bcast) {
+            standin_bcast(udp, true);
+            next_bcast = now_ms() + 20;
+        }
+        int fd = standin_accept(ls);
+        if (fd >= 0 && n_held < STALL_TRIES + 1) held[n_held++] = fd;
+        else if (fd >= 0) close(fd);
+
+        PldLinkPhase phase = tick(&c, ts);
+        u64 now = now_ms();
+        if (phase == PLD_LINK_HANDSHAKE && last != PLD_LINK_HANDSHAKE)
+            hs_at = now;
+        if (phase == PLD_LINK_BACKOFF && last != PLD_LINK_BACKOFF) {
+            if (last != PLD_LINK_HANDSHAKE ||
+                now + 1 < hs_at + c.handshake_ms ||
+                now > hs_at + c.handshake_ms + SLACK_MS)
+                bench_fail("link: stalled host dropped after %llu ms "
+                           "(phase %d), deadline %u ms",
+                           (unsigned long long)(now - hs_at), (int)last,
+                           c.handshake_ms);
+            fail_at = now;
+        }
+        if (phase == PLD_LINK_SCANNING && last == PLD_LINK_BACKOFF) {
+            if (now + 1 < fail_at + backoff || now > fail_at + backoff + SLACK_MS)
+                bench_fail("link: retried after %llu ms, backoff %u ms",
+                           (unsigned long long)(now - fail_at), backoff);
+            backoff = backoff * 2 > c.backoff_max_ms ? c.backoff_max_ms
+                                                     : backoff * 2;
+        }
+        last = phase;
+        if (now - start > RUN_MS * 2)
+            bench_fail("link: stalled host case did not finish");
+        usleep(FRAME_US);
+    }
+    if (c.failures != STALL_TRIES)
+        bench_fail("link: %u failures against a stalled host", c.failures);
+    while (n_held > 0) close(held[--n_held]);
+    close(ls);
+    close(udp);
+    pld_link_close(&c);
+}
+
+/* Clients that go silent or hang up mid-handshake: the host drops them
+ * and goes back to listening, and a real client still connects. */
+static void case_stalled_client(TickStats *ts)
+{
+    PldLink h;
+    link_setup(&h, true);
+    for (int hang_up = 0; hang_up < 2; hang_up++) {
+        int fd = standin_connect();
+        u64 start = now_ms();
+        while (tick(&h, ts) != PLD_LINK_HANDSHAKE) {
+            check_running(start, "host accepting a stalled client");
+            usleep(FRAME_US);
+        }
+        u64 hs_at = now_ms();
+        if (hang_up) close(fd);
+        while (tick(&h, ts) == PLD_LINK_HANDSHAKE) {
+            check_running(start, "host dropping a stalled client");
+            usleep(FRAME_US);
+        }
+        u64 took = now_ms() - hs_at;
+        if (h.phase != PLD_LINK_LISTENING || h.tcp >= 0)
+            bench_fail("link: host in phase %d after a stalled client",
+                       (int)h.phase);
+        if (hang_up ? took > SLACK_MS
+                    : took + 1 < h.handshake_ms ||
+                      took > h.handshake_ms + SLACK_MS)
+            bench_fail("link: host dropped a %s client after %llu ms",
+                       hang_up ? "departed" : "silent",
+                       (unsigned long long)took);
+        if (!hang_up) close(fd);
+    }
+    if (h.failures != 2)
+        bench_fail("link: host counted %u failures, expected 2", h.failures);
+
+    PldLink c;
+    link_setup(&c, false);
+    u64 start = now_ms();
+    while (h.phase != PLD_LINK_READY || c.phase != PLD_LINK_READY) {
+        if (h.phase != PLD_LINK_READY) tick(&h, ts);
+        if (c.phase != PLD_LINK_READY) tick(&c, ts);
+        check_running(start, "host recovering from stalled clients");
+        usleep(FRAME_US);
+    }
+    pld_link_close(&c);
+    pld_link_close(&h);
+}
+
+/* A broadcast with nothing listening (refused), then one from a host whose
+ * accept queue is full (the connect never completes): the client backs
+ * off promptly in the first case and at the connect deadline in the
+ * second. */
+static void case_no_connect(TickStats *ts)
+{
+    int udp = socket(AF_INET, SOCK_DGRAM, 0);
+    for (int full = 0; full < 2; full++) {
+        int ls = -1, queued[4];
+        int n_queued = 0;
+        if (full) {
+            ls = standin_listen(0);
+            /* fill the queue without accepting; later SYNs are dropped */
+            for (int i = 0; i < 4; i++) {
+                int fd = socket(AF_INET, SOCK_STREAM, 0);
+                struct sockaddr_in a = loopback(s_tcp_port);
+                if (fd < 0 || fcntl(fd, F_SETFL, O_NONBLOCK) < 0)
+                    bench_fail("link: socket failed");
+                connect(fd, (struct sockaddr *)&a, sizeof(a));
+                queued[n_queued++] = fd;
+            }
+        }
+        PldLink c;
+        link_setup(&c, false);
+        standin_bcast(udp, true);
+        u64 start = now_ms(), connect_at = 0;
+        PldLinkPhase last = c.phase;
+        while (last != PLD_LINK_BACKOFF) {
+            PldLinkPhase phase = tick(&c, ts);
+            if (phase == PLD_LINK_CONNECTING && last != PLD_LINK_CONNECTING)
+                connect_at = now_ms();
+            if (phase == PLD_LINK_HANDSHAKE)
+                bench_fail("link: connect %s", full ? "completed to a full "
+                           "queue" : "succeeded with nothing listening");
+            last = phase;
+            check_running(start, full ? "connect timeout" : "refused connect");
+            usleep(FRAME_US);
+        }
+        u64 took = now_ms() - (connect_at ? connect_at : start);
+        if (full ? (!connect_at || took + 1 < c.connect_ms ||
+                    took > c.connect_ms + SLACK_MS)
+                 : took > SLACK_MS)
+            bench_fail("link: %s connect backed off after %llu ms",
+                       full ? "stalled" : "refused", (unsigned long long)took);
+        pld_link_close(&c);
+        while (n_queued > 0) close(queued[--n_queued]);
+        if (ls >= 0) close(ls);
+    }
+    close(udp);
+}
+
+/* pld_wire_exchange against a peer that never sends or reads. */
+static void case_wire_idle(void)
+{
+    int a, b;
+    bench_tcp_pair(&a, &b);
+    u32 old = pld_wire_get_timeout();
+    pld_wire_set_timeout(WIRE_IDLE_MS);
+    u32 word = 1;
+    PldWireOut out = { &word, NULL, 1, 4 };
+    PldWireIn in;
+    memset(&in, 0, sizeof(in));
+    in.elem = 4;
+    in.max  = 1;
+    u64 t0 = now_ms();
+    int rc = pld_wire_exchange(a, &out, 1, &in, 1, NULL);
+    u64 took = now_ms() - t0;
+    pld_wire_set_timeout(old);
+    pld_scratch_free(in.data);
+    if (rc != -1 || took + 1 < WIRE_IDLE_MS || took > WIRE_IDLE_MS + SLACK_MS)
+        bench_fail("link: exchange with a silent peer returned %d after "
+                   "%llu ms, timeout %u ms", rc, (unsigned long long)took,
+                   WIRE_IDLE_MS);
+    close(a);
+    close(b);
+}
+
+void bench_pld_link(const BenchConfig *cfg)
+{
+    u16 base = (u16)(20000 + (getpid() % 20000) * 2);
+    s_udp_port = base;
+    s_tcp_port = (u16)(base + 1);
+
+    static const char *names[] = {
+        "link, pair", "link, pair, varint", "link, old peers",
+        "link, stalled host", "link, stalled client", "link, no connect",
+    };
+    for (int k = 0; k < 6; k++) {
+        TickStats ts;
+        memset(&ts, 0, sizeof(ts));
+        switch (k) {
+        case 0: case_pair(&ts, PLD_CODEC_ALL);    break;
+        case 1: case_pair(&ts, PLD_CODEC_VARINT); break;
+        case 2: case_old_client(&ts); case_old_host(&ts); break;
+        case 3: case_stalled_host(&ts);   break;
+        case 4: case_stalled_client(&ts); break;
+        case 5: case_no_connect(&ts);     break;
+        }
+        bench_report(names[k], cfg, ts.total_ns, (int)ts.ticks, 0);
+        printf("%-24s %llu ticks, longest %.3f ms\n", "",
+               (unsigned long long)ts.ticks, (double)ts.max_ns / 1e6);
+    }
+    case_wire_idle();
+    printf("%-24s silent peer failed the exchange after ~%u ms\n",
+           "link, wire idle", WIRE_IDLE_MS);
+}
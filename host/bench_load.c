@@ -0,0 +1,92 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Startup step 2: the old two-call path (pld_read_summary, then
+ * pld_read_sessions, each opening the file and issuing its own reads)
+ * against the fused pld_load_all single read.
+ */
+
+static void load_two_call(const char *path, PldFile *pld, PldSessionLog *log)
+{
+    PldStorage st;
+    if (R_FAILED(pld_storage_open_stdio(&st, path, false)))
+        bench_fail("open %s", path);
+    if (R_FAILED(pld_load_summary(&st, pld)))
+        bench_fail("pld_load_summary(%s)", path);
+    pld_storage_close(&st);
+
+    if (R_FAILED(pld_storage_open_stdio(&st, path, false)))
+        bench_fail("open %s", path);
+    if (R_FAILED(pld_load_sessions(&st, log)))
+        bench_fail("pld_load_sessions(%s)", path);
+    pld_storage_close(&st);
+}
+
+static void load_fused(const char *path, PldFile *pld, PldSessionLog *log)
+{
+    PldStorage st;
+    if (R_FAILED(pld_storage_open_stdio(&st, path, false)))
+        bench_fail("open %s", path);
+    if (R_FAILED(pld_load_all(&st, pld, log)))
+        bench_fail("pld_load_all(%s)", path);
+    pld_storage_close(&st);
+}
+
+typedef void (*LoadFunc)(const char *path, PldFile *pld, PldSessionLog *log);
+
+static void bench_load_path(const BenchConfig *cfg, const char *stage,
+                            LoadFunc load, const char *path,
+                            const PldFile *ref_pld, const PldSessionLog *ref_log)
+{
+    u64 total = 0;
+    for (int it = 0; it < cfg->iters; it++) {
+        PldFile       pld;
+        PldSessionLog log;
+        u64 t0 = bench_now_ns();
+        load(path, &pld, &log);
+        total += bench_now_ns() - t0;
+
+        if (pld.summary_count != ref_pld->summary_count ||
+            memcmp(&pld.header, &ref_pld->header, sizeof(pld.header)) != 0 ||
+            memcmp(pld.summaries, ref_pld->summaries, sizeof(pld.summaries)) != 0)
+            bench_fail("%s: summary table differs", stage);
+        if (log.count != ref_log->count ||
+            memcmp(log.entries, ref_log->entries,
+                   (size_t)log.count * sizeof(PldRec)) != 0 ||
+            log.titles->count != ref_log->titles->count ||
+            memcmp(log.titles->ids, ref_log->titles->ids,
+                   (size_t)log.titles->count * sizeof(u64)) != 0)
+            bench_fail("%s: session log differs", stage);
+        pld_sessions_free(&log);
+    }
+    bench_report(stage, cfg, total, cfg->iters, PLD_FILE_SIZE);
+}
+
+void bench_pld_load(const BenchConfig *cfg)
+{
+    u8 *image = malloc(PLD_FILE_SIZE);
+    if (!image) bench_fail("out of memory");
+    bench_gen_image(image, cfg->sessions, cfg->titles, 0x5eedu);
+
+    char path[256];
+    bench_write_image(cfg, "bench_load.dat", image, path, sizeof(path));
+
+    PldFile       ref_pld;
+    PldSessionLog ref_log;
+    load_two_call(path, &ref_pld, &ref_log);
+    if (ref_log.count != cfg->sessions)
+        bench_fail("read %d sessions, expected %d", ref_log.count, cfg->sessions);
+
+    bench_load_path(cfg, "load (summary+sessions)", load_two_call, path,
+                    &ref_pld, &ref_log);
+    bench_load_path(cfg, "load (fused read_all)", load_fused, path,
+                    &ref_pld, &ref_log);
+
+    pld_sessions_free(&ref_log);
+    remove(path);
+    free(image);
+}
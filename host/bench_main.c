@@ -0,0 +1,146 @@
+#include "bench.h"
+#include "memprof.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/*
+ * pld_bench — host benchmark for the portable pld core
+ *
+ * usage: pld_bench [-s LIST] [-t LIST] [-n ITERS] [-d DIR] [CASE...]
+ *   -s  comma-separated live-session counts   (default 0,1000,10000,50000)
+ *   -t  comma-separated distinct-title counts (default 1,32,256)
+ *   -n  timed iterations per stage            (default 20)
+ *   -d  scratch directory for generated files (default build-host)
+ *   CASE  run only the named cases (default: all)
+ */
+
+void bench_pld_core(const BenchConfig *cfg);
+void bench_pld_load(const BenchConfig *cfg);
+void bench_pld_view(const BenchConfig *cfg);
+void bench_pld_compact(const BenchConfig *cfg);
+void bench_pld_merge(const BenchConfig *cfg);
+void bench_pld_agg(const BenchConfig *cfg);
+void bench_pld_index(const BenchConfig *cfg);
+void bench_pld_packed(const BenchConfig *cfg);
+void bench_pld_hash(const BenchConfig *cfg);
+void bench_pld_journal(const BenchConfig *cfg);
+void bench_pld_backup(const BenchConfig *cfg);
+void bench_pld_catalog(const BenchConfig *cfg);
+void bench_pld_kmerge(const BenchConfig *cfg);
+void bench_pld_ext(const BenchConfig *cfg);
+void bench_pld_rollup(const BenchConfig *cfg);
+void bench_pld_parmerge(const BenchConfig *cfg);
+void bench_pld_arena(const BenchConfig *cfg);
+void bench_pld_memprof(const BenchConfig *cfg);
+void bench_pld_lazyload(const BenchConfig *cfg);
+void bench_pld_snapshot(const BenchConfig *cfg);
+void bench_pld_recon(const BenchConfig *cfg);
+void bench_pld_duplex(const BenchConfig *cfg);
+void bench_pld_codec(const BenchConfig *cfg);
+void bench_pld_link(const BenchConfig *cfg);
+
+static const BenchCase s_cases[] = {
+    { "core", bench_pld_core },
+    { "load", bench_pld_load },
+    { "view", bench_pld_view },
+    { "compact", bench_pld_compact },
+    { "merge", bench_pld_merge },
+    { "agg", bench_pld_agg },
+    { "index", bench_pld_index },
+    { "packed", bench_pld_packed },
+    { "hash", bench_pld_hash },
+    { "journal", bench_pld_journal },
+    { "backup", bench_pld_backup },
+    { "catalog", bench_pld_catalog },
+    { "kmerge", bench_pld_kmerge },
+    { "ext", bench_pld_ext },
+    { "rollup", bench_pld_rollup },
+    { "parmerge", bench_pld_parmerge },
+    { "arena", bench_pld_arena },
+    { "memprof", bench_pld_memprof },
+    { "lazyload", bench_pld_lazyload },
+    { "snapshot", bench_pld_snapshot },
+    { "recon", bench_pld_recon },
+    { "duplex", bench_pld_duplex },
+    { "codec", bench_pld_codec },
+    { "link", bench_pld_link },
+};
+#define CASE_COUNT ((int)(sizeof(s_cases) / sizeof(s_cases[0])))
+
+#define MAX_FILLS 16
+
+static int parse_list(const char *arg, int *out, int max, int lo, int hi)
+{
+    int n = 0;
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", arg);
+    for (char *tok = strtok(buf, ","); tok && n < max; tok = strtok(NULL, ",")) {
+        int v = atoi(tok);
+        if (v < lo || v > hi) {
+            fprintf(stderr, "value %d out of range [%d, %d]\n", v, lo, hi);
+            exit(2);
+        }
+        out[n++] = v;
+    }
+    return n;
+}
+
+static bool case_selected(const char *name, char **sel, int nsel)
+{
+    if (nsel == 0) return true;
+    for (int i = 0; i < nsel; i++)
+        if (strcmp(sel[i], name) == 0) return true;
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    int sessions[MAX_FILLS] = { 0, 1000, 10000, PLD_SESSION_COUNT };
+    int titles[MAX_FILLS]   = { 1, 32, PLD_SUMMARY_COUNT };
+    int n_sessions = 4, n_titles = 3;
+    int iters = 20;
+    const char *work_dir = "build-host";
+
+    char *sel[CASE_COUNT + 8];
+    int   nsel = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            n_sessions = parse_list(argv[++i], sessions, MAX_FILLS,
+                                    0, PLD_SESSION_COUNT);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            n_titles = parse_list(argv[++i], titles, MAX_FILLS,
+                                  1, PLD_SUMMARY_COUNT);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iters = atoi(argv[++i]);
+            if (iters < 1) iters = 1;
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            work_dir = argv[++i];
+        } else if (argv[i][0] != '-' && nsel < (int)(sizeof(sel) / sizeof(sel[0]))) {
+            sel[nsel++] = argv[i];
+        } else {
+            fprintf(stderr,
+                    "usage: %s [-s LIST] [-t LIST] [-n ITERS] [-d DIR] [CASE...]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    mkdir(work_dir, 0777);
+
+    for (int c = 0; c < CASE_COUNT; c++) {
+        if (!case_selected(s_cases[c].name, sel, nsel)) continue;
+        printf("── %s ──\n", s_cases[c].name);
+        for (int si = 0; si < n_sessions; si++) {
+            for (int ti = 0; ti < n_titles; ti++) {
+                BenchConfig cfg = { sessions[si], titles[ti], iters, work_dir };
+                s_cases[c].run(&cfg);
+            }
+        }
+    }
+    /* HOST_MEMPROF=1 builds: the pld core's allocations over the run. */
+    MEM_REPORT(NULL);
+    return 0;
+}
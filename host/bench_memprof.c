@@ -0,0 +1,162 @@
+#include "bench.h"
+#include "memprof.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Allocation profiler (memprof.c), called directly so it is checked in
+ * every build, not only HOST_MEMPROF=1 ones.  Per-site and per-subsystem
+ * current and peak bytes through malloc, calloc, realloc (which moves a
+ * block to the realloc's site), free, note and forget; a full block table
+ * leaving blocks untracked without skewing the figures; the JSON report.
+ * Uses the icon and texture subsystems, which the host never touches, and
+ * compares deltas, so repeated configs and profiled builds don't disturb
+ * it.  Times a tracked malloc/free pair against a plain one.
+ */
+
+#define SITE_A  "bench_memprof.c:a"
+#define SITE_B  "bench_memprof.c:b"
+#define SITE_C  "bench_memprof.c:c"
+#define SITE_D  "bench_memprof.c:d"
+
+static void *volatile s_sink;
+
+static u64 site_cur(const char *site)
+{
+    MemStat st;
+    return memprof_site_stat(site, &st) ? st.cur : 0;
+}
+
+static u64 site_peak(const char *site)
+{
+    MemStat st;
+    return memprof_site_stat(site, &st) ? st.peak : 0;
+}
+
+/* Peaks carry over from earlier configs: want the larger. */
+static void expect_site(const char *what, const char *site, u64 cur, u64 peak,
+                        u64 peak0)
+{
+    MemStat st;
+    if (peak0 > peak) peak = peak0;
+    if (!memprof_site_stat(site, &st) || st.cur != cur || st.peak != peak)
+        bench_fail("%s: %s cur %llu peak %llu (want %llu, %llu)", what, site,
+                   (unsigned long long)st.cur, (unsigned long long)st.peak,
+                   (unsigned long long)cur, (unsigned long long)peak);
+}
+
+static void check_accounting(void)
+{
+    MemStat icon0, tex0, st;
+    memprof_sub_stat(MEM_ICON, &icon0);
+    memprof_sub_stat(MEM_TEX, &tex0);
+    u64 pa = site_peak(SITE_A), pb = site_peak(SITE_B);
+
+    void *a1 = memprof_malloc(MEM_ICON, SITE_A, 1000);
+    void *a2 = memprof_malloc(MEM_ICON, SITE_A, 2000);
+    void *a3 = memprof_malloc(MEM_ICON, SITE_A, 3000);
+    void *b1 = memprof_calloc(MEM_ICON, SITE_B, 10, 100);
+    if (!a1 || !a2 || !a3 || !b1) bench_fail("out of memory");
+    expect_site("malloc", SITE_A, 6000, 6000, pa);
+    expect_site("calloc", SITE_B, 1000, 1000, pb);
+
+    memprof_free(a2);
+    expect_site("free", SITE_A, 4000, 6000, pa);
+
+    a1 = memprof_realloc(MEM_ICON, SITE_B, a1, 5000);
+    if (!a1) bench_fail("out of memory");
+    expect_site("realloc (old site)", SITE_A, 3000, 6000, pa);
+    expect_site("realloc (new site)", SITE_B, 6000, 6000, pb);
+
+    memprof_sub_stat(MEM_ICON, &st);
+    if (st.cur - icon0.cur != 9000 || st.peak < icon0.cur + 9000)
+        bench_fail("icon subsystem: cur +%llu, peak %llu",
+                   (unsigned long long)(st.cur - icon0.cur),
+                   (unsigned long long)st.peak);
+
+    /* Noted memory is never freed through the profiler. */
+    static u8 tex[4096];
+    memprof_note(MEM_TEX, SITE_C, tex, sizeof(tex));
+    memprof_sub_stat(MEM_TEX, &st);
+    if (st.cur - tex0.cur != sizeof(tex)) bench_fail("note not counted");
+    memprof_forget(tex);
+    memprof_forget(tex);           /* untracked by now: ignored */
+    memprof_free(NULL);
+    memprof_sub_stat(MEM_TEX, &st);
+    if (st.cur != tex0.cur) bench_fail("forget not counted");
+
+    memprof_free(a1);
+    memprof_free(a3);
+    memprof_free(b1);
+    memprof_sub_stat(MEM_ICON, &st);
+    if (st.cur != icon0.cur || site_cur(SITE_A) || site_cur(SITE_B))
+        bench_fail("bytes still counted after every free");
+}
+
+/* More live blocks than the table holds. */
+static void check_overflow(void)
+{
+    enum { N = MEMPROF_BLOCKS + 256 };
+    void **p = malloc(N * sizeof(void *));
+    if (!p) bench_fail("out of memory");
+    for (int i = 0; i < N; i++)
+        if (!(p[i] = memprof_malloc(MEM_ICON, SITE_D, 16)))
+            bench_fail("out of memory");
+    u64 held = site_cur(SITE_D);
+    if (held > (u64)MEMPROF_BLOCKS * 16 || held < 256 * 16)
+        bench_fail("full table: %llu bytes counted",
+                   (unsigned long long)held);
+    for (int i = 0; i < N; i++)
+        memprof_free(p[i]);
+    if (site_cur(SITE_D) != 0)
+        bench_fail("full table: %llu bytes left after freeing",
+                   (unsigned long long)site_cur(SITE_D));
+    free(p);
+}
+
+static void check_report(const BenchConfig *cfg)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s/mem.json", cfg->work_dir);
+    if (!memprof_report(path)) bench_fail("memprof_report(%s)", path);
+    FILE *f = fopen(path, "rb");
+    static char buf[64 * 1024];
+    size_t n = f ? fread(buf, 1, sizeof(buf) - 1, f) : 0;
+    if (f) fclose(f);
+    buf[n] = '\0';
+    int depth = 0;
+    for (size_t i = 0; i < n && depth >= 0; i++)
+        depth += (buf[i] == '{' || buf[i] == '[') -
+                 (buf[i] == '}' || buf[i] == ']');
+    if (n == 0 || depth != 0 || !strstr(buf, "\"subsystems\"") ||
+        !strstr(buf, "\"name\": \"icon\"") || !strstr(buf, SITE_A) ||
+        !strstr(buf, "\"untracked_blocks\""))
+        bench_fail("mem.json malformed");
+    remove(path);
+}
+
+void bench_pld_memprof(const BenchConfig *cfg)
+{
+    check_accounting();
+    check_overflow();
+    check_report(cfg);
+
+    enum { OPS = 4096 };
+    u64 t_plain = 0, t_prof = 0;
+    for (int it = 0; it < cfg->iters; it++) {
+        u64 t0 = bench_now_ns();
+        for (int i = 0; i < OPS; i++) {
+            s_sink = malloc(256);   /* kept, or the pair is elided */
+            free(s_sink);
+        }
+        t_plain += bench_now_ns() - t0;
+        t0 = bench_now_ns();
+        for (int i = 0; i < OPS; i++)
+            memprof_free(memprof_malloc(MEM_ICON, SITE_A, 256));
+        t_prof += bench_now_ns() - t0;
+    }
+    bench_report("malloc+free x4096", cfg, t_plain, cfg->iters, (u64)OPS * 256);
+    bench_report("tracked, x4096", cfg, t_prof, cfg->iters, (u64)OPS * 256);
+}
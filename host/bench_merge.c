@@ -0,0 +1,199 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * pld_merge_sessions (radix sort + merge-join over packed records) against
+ * the previous qsort / binary-search / append / qsort implementation over
+ * 16-byte PldSessions, for a local log of
+ * sessions/2 records in NAND (chronological) order and an equally sized
+ * remote log that shares `overlap` percent of its keys with local.  Remote
+ * logs are sorted (as peers send them) except for the "rnd" rows.
+ */
+
+static const int s_overlaps[] = { 0, 50, 90, 100 };
+#define OVERLAP_COUNT ((int)(sizeof(s_overlaps) / sizeof(s_overlaps[0])))
+
+static int ref_cmp(const void *a, const void *b)
+{
+    const PldSession *sa = a, *sb = b;
+    if (sa->title_id != sb->title_id) return sa->title_id < sb->title_id ? -1 : 1;
+    if (sa->timestamp != sb->timestamp) return sa->timestamp < sb->timestamp ? -1 : 1;
+    return 0;
+}
+
+static int ref_find(const PldSession *e, int n, const PldSession *k)
+{
+    int lo = 0, hi = n - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        int c = ref_cmp(&e[mid], k);
+        if (c == 0) return mid;
+        if (c < 0) lo = mid + 1; else hi = mid - 1;
+    }
+    return -1;
+}
+
+/* The pre-radix implementation as the reference.  The original searched
+ * local->count, i.e. also the unsorted tail of records appended during the
+ * loop, so it could miss a match and append a duplicate key; the reference
+ * searches only the sorted prefix, which is the behaviour it intended. */
+typedef struct {
+    PldSession *entries;
+    int         count;
+} RefLog;
+
+static int ref_merge(RefLog *local, const RefLog *remote, bool add_only)
+{
+    if (local->count > 1)
+        qsort(local->entries, (size_t)local->count, sizeof(PldSession), ref_cmp);
+    int base  = local->count;
+    int added = 0;
+    for (int i = 0; i < remote->count; i++) {
+        const PldSession *r = &remote->entries[i];
+        if (r->title_id == 0 || r->title_id == 0xFFFFFFFFFFFFFFFFULL) continue;
+        int idx = ref_find(local->entries, base, r);
+        if (idx >= 0) {
+            if (!add_only) {
+                u32 sum = local->entries[idx].play_secs + r->play_secs;
+                local->entries[idx].play_secs = sum > 3600 ? 3600 : sum;
+            }
+        } else {
+            if (local->count >= PLD_SESSION_COUNT) return -1;
+            local->entries[local->count++] = *r;
+            added++;
+        }
+    }
+    if (added > 0 && local->count > 1)
+        qsort(local->entries, (size_t)local->count, sizeof(PldSession), ref_cmp);
+    return added;
+}
+
+static u64 time_ref(const BenchConfig *cfg, bool add_only,
+                     const PldSession *local_init, int local_n,
+                     const RefLog *remote, RefLog *out)
+{
+    u64 total = 0;
+    for (int it = 0; it < cfg->iters; it++) {
+        memcpy(out->entries, local_init, (size_t)local_n * sizeof(PldSession));
+        out->count = local_n;
+        u64 t0 = bench_now_ns();
+        int added = ref_merge(out, remote, add_only);
+        total += bench_now_ns() - t0;
+        if (added < 0) bench_fail("merge overflow");
+    }
+    return total;
+}
+
+static u64 time_new(const BenchConfig *cfg, bool add_only,
+                     const PldSession *local_init, int local_n,
+                     const RefLog *remote, PldSessionLog *out)
+{
+    u64 total = 0;
+    for (int it = 0; it < cfg->iters; it++) {
+        bench_log_pack(out, local_init, local_n);
+        u64 t0 = bench_now_ns();
+        int added = pld_merge_sessions(out, remote->entries, remote->count,
+                                       add_only);
+        total += bench_now_ns() - t0;
+        if (added < 0) bench_fail("merge overflow");
+    }
+    return total;
+}
+
+void bench_pld_merge(const BenchConfig *cfg)
+{
+    int half = cfg->sessions / 2;
+
+    /* Even records of one generated log go to local, odd ones are "fresh"
+     * keys guaranteed absent from local. */
+    PldSession *all   = malloc((size_t)(2 * half + 1) * sizeof(PldSession));
+    PldSession *local = malloc((size_t)(half + 1) * sizeof(PldSession));
+    PldSession *fresh = malloc((size_t)(half + 1) * sizeof(PldSession));
+    PldSession *rbuf  = malloc((size_t)(half + 1) * sizeof(PldSession));
+    PldSession *out_a = malloc(PLD_SESSION_COUNT * sizeof(PldSession));
+    PldSessionLog b = { NULL, 0, NULL };
+    if (!all || !local || !fresh || !rbuf || !out_a || !pld_log_alloc(&b))
+        bench_fail("out of memory");
+    bench_gen_sessions(all, 2 * half, cfg->titles, 0x3e43u);
+    for (int i = 0; i < half; i++) {
+        local[i] = all[2 * i];
+        fresh[i] = all[2 * i + 1];
+    }
+
+    for (int o = 0; o < OVERLAP_COUNT; o++) {
+        int shared = (int)((long)half * s_overlaps[o] / 100);
+        for (int i = 0; i < half; i++) {
+            rbuf[i] = (i < shared) ? local[i] : fresh[i];
+            rbuf[i].play_secs = 1 + (u32)i % 3600;
+        }
+        RefLog remote = { rbuf, half };
+        RefLog a = { out_a, 0 };
+
+        /* Peers send sorted logs; also cover the unsorted case once. */
+        bool sorted_remote = true;
+        for (int pass = 0; pass < 2; pass++) {
+            if (pass == 1) {
+                if (o != 1) break;
+                sorted_remote = false;
+            } else {
+                bench_sort_sessions(rbuf, half);
+            }
+            for (int add_only = 0; add_only < 2; add_only++) {
+                u64 t_ref = time_ref(cfg, add_only, local, half, &remote, &a);
+                u64 t_new = time_new(cfg, add_only, local, half, &remote, &b);
+                if (!bench_log_equals(&b, a.entries, a.count))
+                    bench_fail("merge differs from reference (overlap %d%%)",
+                               s_overlaps[o]);
+                if (!sorted_remote) {
+                    /* Record-at-a-time pushes of an unsorted stream take the
+                     * merger's fallback path, interning titles one by one;
+                     * it must agree too. */
+                    bench_log_pack(&b, local, half);
+                    PldMerger m;
+                    pld_merger_begin(&m, &b, add_only, NULL);
+                    for (int i = 0; i < half; i++)
+                        pld_merger_push(&m, &rbuf[i], 1);
+                    if (pld_merger_end(&m) < 0 ||
+                        !bench_log_equals(&b, a.entries, a.count))
+                        bench_fail("fallback merge differs from reference");
+                }
+                if (!add_only || !sorted_remote) {
+                    char stage[40];
+                    snprintf(stage, sizeof(stage), "merge %d%%%s%s qsort",
+                             s_overlaps[o], sorted_remote ? "" : " rnd",
+                             add_only ? " add" : "");
+                    bench_report(stage, cfg, t_ref, cfg->iters,
+                                 (u64)half * 2 * sizeof(PldSession));
+                    snprintf(stage, sizeof(stage), "merge %d%%%s%s radix",
+                             s_overlaps[o], sorted_remote ? "" : " rnd",
+                             add_only ? " add" : "");
+                    bench_report(stage, cfg, t_new, cfg->iters,
+                                 (u64)half * 2 * sizeof(PldSession));
+                }
+            }
+            /* Scramble for the unsorted pass. */
+            u32 rng = 0x51u;
+            for (int i = half - 1; i > 0; i--) {
+                int j = (int)(bench_rand(&rng) % (u32)(i + 1));
+                PldSession t = rbuf[i]; rbuf[i] = rbuf[j]; rbuf[j] = t;
+            }
+        }
+    }
+
+    /* Overflow keeps every local record and leaves the log sorted. */
+    if (half > 0) {
+        bench_gen_sessions(out_a, PLD_SESSION_COUNT, cfg->titles, 0x0f10u);
+        bench_log_pack(&b, out_a, PLD_SESSION_COUNT);
+        fresh[0].title_id = 0x00040000000FFF00ull;
+        if (pld_merge_sessions(&b, fresh, 1, false) != -1 ||
+            b.count != PLD_SESSION_COUNT ||
+            !pld_sessions_sorted(b.entries, b.count))
+            bench_fail("overflow not reported cleanly");
+    }
+
+    free(all); free(local); free(fresh); free(rbuf); free(out_a);
+    pld_sessions_free(&b);
+}
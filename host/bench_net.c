@@ -0,0 +1,182 @@
+#include "bench.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+/*
+ * Loopback connections for the sync cases.  A throttled link puts a relay
+ * thread between the two ends: it forwards each direction on its own,
+ * never faster than the link rate, so a protocol that leaves one
+ * direction idle while the other transfers pays for it as it would on
+ * Wi-Fi, which loopback alone hides.
+ */
+
+#define RELAY_CHUNK  4096
+#define RELAY_BURST  2000000ull     /* ns of lateness made up by a burst */
+
+typedef struct {
+    int  src, dst;
+    u8   buf[RELAY_CHUNK];
+    int  len, pos;          /* bytes held, bytes already forwarded     */
+    bool eof;               /* src closed and everything forwarded     */
+    u64  next_ns;           /* no read from src before this            */
+} Relay;
+
+struct BenchLink {
+    int       *a, *b;       /* the caller's ends                       */
+    int        ra, rb;      /* the relay's ends                        */
+    u64        rate;        /* bytes per second each way               */
+    Relay      dir[2];      /* a to b, b to a                          */
+    pthread_t  thread;
+};
+
+void bench_tcp_pair(int *a, int *b)
+{
+    int ls = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (ls < 0 || bind(ls, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(ls, 1) < 0 ||
+        getsockname(ls, (struct sockaddr *)&addr, &len) < 0)
+        bench_fail("loopback listen failed");
+    *a = socket(AF_INET, SOCK_STREAM, 0);
+    if (*a < 0 || connect(*a, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+        bench_fail("loopback connect failed");
+    *b = accept(ls, NULL, NULL);
+    if (*b < 0) bench_fail("loopback accept failed");
+    close(ls);
+}
+
+/* Move what one direction can move now; false once it is finished. */
+static bool relay_step(BenchLink *l, Relay *r, short src_ev, short dst_ev)
+{
+    if (r->pos < r->len && (dst_ev & (POLLOUT | POLLERR | POLLHUP))) {
+        ssize_t n = send(r->dst, r->buf + r->pos, (size_t)(r->len - r->pos),
+                         MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0) r->pos += (int)n;
+        else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+            r->pos = r->len;                 /* reader gone: drop */
+    }
+    if (r->pos == r->len && !r->eof &&
+        (src_ev & (POLLIN | POLLERR | POLLHUP)) &&
+        bench_now_ns() >= r->next_ns) {
+        ssize_t n = recv(r->src, r->buf, sizeof(r->buf), MSG_DONTWAIT);
+        if (n > 0) {
+            r->len = (int)n;
+            r->pos = 0;
+            /* poll sleeps whole milliseconds: a late read may catch up,
+             * by at most RELAY_BURST */
+            u64 now = bench_now_ns();
+            if (!r->next_ns)
+                r->next_ns = now;
+            else if (r->next_ns + RELAY_BURST < now)
+                r->next_ns = now - RELAY_BURST;
+            r->next_ns += (u64)n * 1000000000ull / l->rate;
+        } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            r->eof = true;
+            r->len = r->pos = 0;
+            shutdown(r->dst, SHUT_WR);
+        }
+    }
+    return !(r->eof && r->pos == r->len);
+}
+
+static void *relay_run(void *raw)
+{
+    BenchLink *l = (BenchLink *)raw;
+    bool live[2] = { true, true };
+    while (live[0] || live[1]) {
+        struct pollfd p[2] = { { l->ra, 0, 0 }, { l->rb, 0, 0 } };
+        u64 now = bench_now_ns(), wake = 0;
+        for (int d = 0; d < 2; d++) {
+            Relay *r = &l->dir[d];
+            if (!live[d]) continue;
+            struct pollfd *src = &p[d], *dst = &p[1 - d];
+            if (r->pos < r->len)
+                dst->events |= POLLOUT;
+            else if (r->next_ns <= now)
+                src->events |= POLLIN;
+            else if (!wake || r->next_ns < wake)
+                wake = r->next_ns;
+        }
+        int timeout = wake ? (int)((wake - now) / 1000000u) + 1 : -1;
+        if (poll(p, 2, timeout) < 0 && errno != EINTR) break;
+        for (int d = 0; d < 2; d++)
+            if (live[d])
+                live[d] = relay_step(l, &l->dir[d], p[d].revents,
+                                     p[1 - d].revents);
+    }
+    return NULL;
+}
+
+BenchLink *bench_link_open(int *a, int *b, u64 bytes_per_sec)
+{
+    BenchLink *l = calloc(1, sizeof(*l));
+    if (!l) bench_fail("out of memory");
+    l->a    = a;
+    l->b    = b;
+    l->rate = bytes_per_sec;
+    if (!bytes_per_sec) {
+        bench_tcp_pair(a, b);
+        l->ra = l->rb = -1;
+        return l;
+    }
+    bench_tcp_pair(a, &l->ra);
+    bench_tcp_pair(&l->rb, b);
+    /* The relay sends whatever it has: it must add no stalls of its own. */
+    int one = 1;
+    setsockopt(l->ra, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(l->rb, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    l->dir[0].src = l->ra;
+    l->dir[0].dst = l->rb;
+    l->dir[1].src = l->rb;
+    l->dir[1].dst = l->ra;
+    if (pthread_create(&l->thread, NULL, relay_run, l) != 0)
+        bench_fail("pthread_create failed");
+    return l;
+}
+
+void bench_link_close(BenchLink *l)
+{
+    close(*l->a);
+    close(*l->b);
+    if (l->rate) {
+        pthread_join(l->thread, NULL);
+        close(l->ra);
+        close(l->rb);
+    }
+    free(l);
+}
+
+int bench_recv_all(int fd, void *buf, int len)
+{
+    int total = 0;
+    while (total < len) {
+        int n = recv(fd, (char *)buf + total, len - total, 0);
+        if (n <= 0) return n;
+        total += n;
+    }
+    return total;
+}
+
+int bench_send_all(int fd, const void *buf, int len)
+{
+    int total = 0;
+    while (total < len) {
+        int n = send(fd, (const char *)buf + total, len - total, MSG_NOSIGNAL);
+        if (n <= 0) return -1;
+        total += n;
+    }
+    return total;
+}
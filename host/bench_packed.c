@@ -0,0 +1,111 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Packed 8-byte session log (pld_pack.c) against the 16-byte PldSession
+ * array it replaces.  Checks the round trip, play_secs saturation and the
+ * dictionary limit, then times a full-log scan (the play time of the last
+ * 30 days of the log, the shape of every per-record pass the views make)
+ * over both layouts, and packing itself.
+ */
+
+#define SCAN_WINDOW (30u * 86400u)
+
+static u64 scan_raw(const PldSession *s, int n, u32 since)
+{
+    u64 total = 0;
+    for (int i = 0; i < n; i++)
+        if (s[i].timestamp >= since) total += s[i].play_secs;
+    return total;
+}
+
+static u64 scan_packed(const PldSessionLog *log, u32 since)
+{
+    u64 total = 0;
+    for (int i = 0; i < log->count; i++)
+        if (log->entries[i].timestamp >= since)
+            total += log->entries[i].play_secs;
+    return total;
+}
+
+static void check_limits(void)
+{
+    PldSession *s = malloc((PLD_TITLE_MAX + 1) * sizeof(PldSession));
+    if (!s) bench_fail("out of memory");
+    PldSessionLog log = { NULL, 0, NULL };
+
+    s[0] = (PldSession){ bench_title_id(0), 3600, 0x12345u };
+    bench_log_pack(&log, s, 1);
+    if (log.entries[0].play_secs != 0xFFFFu)
+        bench_fail("play_secs did not saturate");
+
+    for (int i = 0; i <= PLD_TITLE_MAX; i++)
+        s[i] = (PldSession){ bench_title_id(i), 3600u * (u32)i, 60 };
+    if (R_SUCCEEDED(pld_log_pack(&log, s, PLD_TITLE_MAX + 1)) || log.count != 0)
+        bench_fail("packed %d titles into a %d-title dictionary",
+                   PLD_TITLE_MAX + 1, PLD_TITLE_MAX);
+    if (R_FAILED(pld_log_pack(&log, s, PLD_TITLE_MAX)) ||
+        log.titles->count != PLD_TITLE_MAX ||
+        !bench_log_equals(&log, s, PLD_TITLE_MAX))
+        bench_fail("full dictionary round trip differs");
+
+    pld_sessions_free(&log);
+    free(s);
+}
+
+void bench_pld_packed(const BenchConfig *cfg)
+{
+    PldSession *raw = malloc((size_t)(cfg->sessions + 1) * sizeof(PldSession));
+    if (!raw) bench_fail("out of memory");
+    bench_gen_sessions(raw, cfg->sessions, cfg->titles, 0x8b7u);
+
+    PldSessionLog log = { NULL, 0, NULL };
+    bench_log_pack(&log, raw, cfg->sessions);
+    if (!bench_log_equals(&log, raw, cfg->sessions))
+        bench_fail("packed log does not unpack to its source");
+    if (log.titles->count > cfg->titles)
+        bench_fail("dictionary holds %d titles, expected at most %d",
+                   log.titles->count, cfg->titles);
+    for (int i = 1; i < log.titles->count; i++)
+        if (log.titles->ids[i - 1] >= log.titles->ids[i])
+            bench_fail("dictionary is not strictly ascending");
+    check_limits();
+
+    u32 since = cfg->sessions ? raw[cfg->sessions - 1].timestamp - SCAN_WINDOW
+                              : 0;
+    if (scan_raw(raw, cfg->sessions, since) != scan_packed(&log, since))
+        bench_fail("packed scan differs");
+
+    volatile u64 sink = 0;
+    u64 t0 = bench_now_ns();
+    for (int it = 0; it < cfg->iters; it++)
+        sink += scan_raw(raw, cfg->sessions, since);
+    u64 t_raw = bench_now_ns() - t0;
+
+    t0 = bench_now_ns();
+    for (int it = 0; it < cfg->iters; it++)
+        sink += scan_packed(&log, since);
+    u64 t_packed = bench_now_ns() - t0;
+
+    t0 = bench_now_ns();
+    for (int it = 0; it < cfg->iters; it++)
+        bench_log_pack(&log, raw, cfg->sessions);
+    u64 t_pack = bench_now_ns() - t0;
+    (void)sink;
+
+    bench_report("scan 16-byte", cfg, t_raw, cfg->iters,
+                 (u64)cfg->sessions * sizeof(PldSession));
+    bench_report("scan 8-byte", cfg, t_packed, cfg->iters,
+                 (u64)cfg->sessions * sizeof(PldRec));
+    bench_report("pack", cfg, t_pack, cfg->iters,
+                 (u64)cfg->sessions * sizeof(PldSession));
+    printf("%-24s resident %u bytes (was %u)\n", "",
+           (unsigned)PLD_LOG_BYTES,
+           (unsigned)(PLD_SESSION_COUNT * sizeof(PldSession)));
+
+    pld_sessions_free(&log);
+    free(raw);
+}
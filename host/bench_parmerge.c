@@ -0,0 +1,136 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Partitioned merge (pld_merge_sessions_par).  Merges a remote half-log,
+ * a quarter of it copies of local keys, into a local half-log for 1 to N
+ * threads (the host's cores, at least 4) and checks each result against
+ * serial pld_merge_sessions, for add_only and summing merges and for
+ * remote input in key order and in NAND (time) order.  A merge past
+ * PLD_SESSION_COUNT must fail either way.  Times every thread count.
+ */
+
+typedef struct {
+    PldSession *local;
+    int         nl;
+    PldSession *remote;
+    int         nr;
+} Inputs;
+
+static void make_inputs(Inputs *in, const BenchConfig *cfg)
+{
+    in->nl = cfg->sessions / 2;
+    in->nr = cfg->sessions - in->nl;
+    in->local  = malloc((size_t)(in->nl + 1) * sizeof(PldSession));
+    in->remote = malloc((size_t)(in->nr + 1) * sizeof(PldSession));
+    if (!in->local || !in->remote) bench_fail("out of memory");
+    bench_gen_sessions(in->local, in->nl, cfg->titles, 0x9a7u);
+    bench_gen_sessions(in->remote, in->nr, cfg->titles, 0x51du);
+    for (int i = 0; i < in->nr; i += 4) {
+        if (i >= in->nl) break;
+        in->remote[i].title_id  = in->local[i].title_id;
+        in->remote[i].timestamp = in->local[i].timestamp;
+    }
+}
+
+/* Serial reference: returns its count or -1, with the result in key order
+ * in want (the partitioned merge leaves the log in key order). */
+static int serial(const Inputs *in, const PldSession *remote, bool add_only,
+                  PldSession *want, int *added)
+{
+    PldSessionLog log = { NULL, 0, NULL };
+    bench_log_pack(&log, in->local, in->nl);
+    *added = pld_merge_sessions(&log, remote, in->nr, add_only);
+    int n = *added < 0 ? -1 : log.count;
+    if (n >= 0) {
+        pld_log_unpack(&log, want);
+        bench_sort_sessions(want, n);
+    }
+    pld_sessions_free(&log);
+    return n;
+}
+
+static void check(const char *what, const Inputs *in, const PldSession *remote,
+                  bool add_only, int threads, PldSession *want)
+{
+    int want_added;
+    int m = serial(in, remote, add_only, want, &want_added);
+
+    PldSessionLog log = { NULL, 0, NULL };
+    bench_log_pack(&log, in->local, in->nl);
+    int added = pld_merge_sessions_par(&log, remote, in->nr, add_only, threads);
+    if (added != want_added)
+        bench_fail("%s, %d threads: added %d, serial %d", what, threads, added,
+                   want_added);
+    if (m >= 0 && !bench_log_equals(&log, want, m))
+        bench_fail("%s, %d threads: differs from serial", what, threads);
+    pld_sessions_free(&log);
+}
+
+void bench_pld_parmerge(const BenchConfig *cfg)
+{
+    Inputs in;
+    make_inputs(&in, cfg);
+    PldSession *sorted = malloc((size_t)(in.nr + 1) * sizeof(PldSession));
+    PldSession *want   = malloc(PLD_SESSION_COUNT * sizeof(PldSession));
+    if (!sorted || !want) bench_fail("out of memory");
+    memcpy(sorted, in.remote, (size_t)in.nr * sizeof(PldSession));
+    bench_sort_sessions(sorted, in.nr);
+
+    int max_threads = pld_parallel_cores();
+    if (max_threads < 4) max_threads = 4;
+
+    for (int t = 1; t <= max_threads; t++) {
+        check("add_only", &in, in.remote, true, t, want);
+        check("sum", &in, in.remote, false, t, want);
+        check("sorted", &in, sorted, false, t, want);
+    }
+
+    /* Overflow: the same history an hour on, on top of a full log. */
+    if (cfg->sessions == PLD_SESSION_COUNT) {
+        PldSession *gen = malloc(PLD_SESSION_COUNT * sizeof(PldSession));
+        PldSession *late = malloc(PLD_SESSION_COUNT * sizeof(PldSession));
+        if (!gen || !late) bench_fail("out of memory");
+        bench_gen_sessions(gen, PLD_SESSION_COUNT, cfg->titles, 0x0f1u);
+        for (int i = 0; i < PLD_SESSION_COUNT; i++) {
+            late[i] = gen[i];
+            late[i].timestamp += 1800;
+        }
+        PldSessionLog log = { NULL, 0, NULL };
+        bench_log_pack(&log, gen, PLD_SESSION_COUNT);
+        if (pld_merge_sessions_par(&log, late, PLD_SESSION_COUNT, false,
+                                   max_threads) >= 0 ||
+            log.count != PLD_SESSION_COUNT)
+            bench_fail("overflowing partitioned merge succeeded");
+        pld_sessions_free(&log);
+        free(late);
+        free(gen);
+    }
+
+    /* Every thread count on unsorted input, the sync case. */
+    int iters = cfg->iters;
+    for (int t = 1; t <= max_threads; t++) {
+        u64 ns = 0;
+        for (int it = 0; it < iters; it++) {
+            PldSessionLog log = { NULL, 0, NULL };
+            bench_log_pack(&log, in.local, in.nl);
+            u64 t0 = bench_now_ns();
+            pld_merge_sessions_par(&log, in.remote, in.nr, false, t);
+            ns += bench_now_ns() - t0;
+            pld_sessions_free(&log);
+        }
+        char stage[32];
+        snprintf(stage, sizeof(stage), "merge, %d thread%s", t,
+                 t == 1 ? "" : "s");
+        bench_report(stage, cfg, ns, iters,
+                     (u64)(in.nl + in.nr) * sizeof(PldRec));
+    }
+
+    free(want);
+    free(sorted);
+    free(in.remote);
+    free(in.local);
+}
@@ -0,0 +1,126 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Core pipeline stages: the work done on every startup (read + compact +
+ * merge) and every sync (merge + write).
+ */
+
+static void bench_read(const BenchConfig *cfg, const char *path)
+{
+    u64 total = 0;
+    for (int it = 0; it < cfg->iters; it++) {
+        PldFile       pld;
+        PldSessionLog log;
+        u64 t0 = bench_now_ns();
+        Result rc = pld_read_sd(path, &pld, &log);
+        total += bench_now_ns() - t0;
+        if (R_FAILED(rc)) bench_fail("pld_read_sd(%s)", path);
+        if (log.count != cfg->sessions)
+            bench_fail("read %d sessions, expected %d", log.count, cfg->sessions);
+        pld_sessions_free(&log);
+    }
+    bench_report("read (summary+sessions)", cfg, total, cfg->iters, PLD_FILE_SIZE);
+}
+
+static void bench_compact(const BenchConfig *cfg, const u8 *image)
+{
+    PldSession *buf = malloc(PLD_SESSION_COUNT * sizeof(PldSession));
+    if (!buf) bench_fail("out of memory");
+
+    u64 total = 0;
+    for (int it = 0; it < cfg->iters; it++) {
+        memcpy(buf, image + PLD_SESSION_OFFSET,
+               PLD_SESSION_COUNT * sizeof(PldSession));
+        u64 t0 = bench_now_ns();
+        int n = pld_compact_sessions(buf, PLD_SESSION_COUNT);
+        total += bench_now_ns() - t0;
+        if (n != cfg->sessions)
+            bench_fail("compacted %d sessions, expected %d", n, cfg->sessions);
+    }
+    free(buf);
+    bench_report("compact", cfg, total, cfg->iters,
+                 PLD_SESSION_COUNT * sizeof(PldSession));
+}
+
+/* Local = first half of the generated log; remote = every other local record
+ * (exact overlap) interleaved with records shifted one hour later. */
+static void bench_merge(const BenchConfig *cfg, const u8 *image)
+{
+    const PldSession *src = (const PldSession *)(image + PLD_SESSION_OFFSET);
+    int half = cfg->sessions / 2;
+
+    PldSession *remote_buf = malloc((size_t)(half + 1) * sizeof(PldSession));
+    if (!remote_buf) bench_fail("out of memory");
+    for (int i = 0; i < half; i++) {
+        remote_buf[i] = src[i];
+        if (i & 1) remote_buf[i].timestamp += 3600;
+    }
+
+    PldSessionLog local_init = { NULL, 0, NULL };
+    PldSessionLog local      = { NULL, 0, NULL };
+    bench_log_pack(&local_init, src, half);
+    if (!pld_log_alloc(&local)) bench_fail("out of memory");
+
+    u64 total = 0;
+    for (int it = 0; it < cfg->iters; it++) {
+        memcpy(local.entries, local_init.entries, PLD_LOG_BYTES);
+        local.count = local_init.count;
+        u64 t0 = bench_now_ns();
+        int added = pld_merge_sessions(&local, remote_buf, half, false);
+        total += bench_now_ns() - t0;
+        if (added < 0) bench_fail("pld_merge_sessions overflow");
+    }
+    pld_sessions_free(&local_init);
+    pld_sessions_free(&local);
+    free(remote_buf);
+    bench_report("merge (50% overlap)", cfg, total, cfg->iters,
+                 (u64)half * 2 * sizeof(PldSession));
+}
+
+static void bench_write(const BenchConfig *cfg, const char *src_path)
+{
+    PldFile       pld;
+    PldSessionLog log;
+    if (R_FAILED(pld_read_sd(src_path, &pld, &log)))
+        bench_fail("pld_read_sd(%s)", src_path);
+
+    char out_path[256];
+    snprintf(out_path, sizeof(out_path), "%s/bench_write.dat", cfg->work_dir);
+
+    /* Drop the sidecar each time so every iteration really writes; the
+     * skipped rewrite is timed by the hash case. */
+    u64 total = 0;
+    for (int it = 0; it < cfg->iters; it++) {
+        pld_sidecar_remove(out_path);
+        u64 t0 = bench_now_ns();
+        Result rc = pld_write_sd(out_path, &pld, &log);
+        total += bench_now_ns() - t0;
+        if (rc != 0) bench_fail("pld_write_sd(%s)", out_path);
+    }
+    pld_sessions_free(&log);
+    pld_sidecar_remove(out_path);
+    remove(out_path);
+    bench_report("write (sd image)", cfg, total, cfg->iters, PLD_FILE_SIZE);
+}
+
+void bench_pld_core(const BenchConfig *cfg)
+{
+    u8 *image = malloc(PLD_FILE_SIZE);
+    if (!image) bench_fail("out of memory");
+    bench_gen_image(image, cfg->sessions, cfg->titles, 0x1234u);
+
+    char path[256];
+    bench_write_image(cfg, "bench_pld.dat", image, path, sizeof(path));
+
+    bench_read(cfg, path);
+    bench_compact(cfg, image);
+    bench_merge(cfg, image);
+    bench_write(cfg, path);
+
+    remove(path);
+    free(image);
+}
@@ -0,0 +1,410 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+/*
+ * Delta session sync (pld_recon.c).  Two in-process peers, each on its own
+ * thread, joined by a TCP connection over 127.0.0.1, sync logs that share
+ * 0 to 100% of their records (the rest split between the two, plus one
+ * shared key played differently on each side).  After the sync both logs
+ * must be identical and equal to a reference built here: every title, or
+ * span of a title settled by span, that the peers held differently merged
+ * as pld_merge_sessions does, every other range untouched.  The peer's
+ * records are merged as they arrive, so the heap peak of a sync must not
+ * grow with how many cross.  A sync that overflows a nearly full log must
+ * hand the whole merge to the caller and leave the log as it was.
+ * Compares bytes on the wire and wall time with the full exchange net.c
+ * did before: both logs, whole, in each direction.
+ */
+
+static const int s_overlap[] = { 0, 50, 90, 99, 100 };   /* percent shared */
+
+#define HEAP_SLACK  4096u   /* headers, thread start-up */
+
+typedef struct {
+    int            fd;
+    bool           lead;        /* sends first in the full exchange */
+    bool           full;        /* the old full exchange instead      */
+    PldSessionLog  log;
+    PldReconStats  stats;
+    int            rc;
+    int            full_merged; /* what PldReconFull was handed, or -1 */
+    int            full_rest;
+} Peer;
+
+/* ── Loopback harness ───────────────────────────────────────────── */
+
+/* net.c's exchange before pld_recon.c: count, then every record, the lead
+ * sending first. */
+static int full_exchange(Peer *p, PldSession **remote, int *n)
+{
+    PldSession *mine = malloc(((size_t)p->log.count + 1) * sizeof(PldSession));
+    *remote = malloc(PLD_SESSION_COUNT * sizeof(PldSession));
+    if (!mine || !*remote) bench_fail("out of memory");
+    pld_log_unpack(&p->log, mine);
+    u32 count = (u32)p->log.count, rcount = 0;
+    int bytes = (int)(count * sizeof(PldSession));
+    for (int pass = 0; pass < 2; pass++) {
+        if ((pass == 0) == p->lead) {
+            if (bench_send_all(p->fd, &count, 4) != 4 ||
+                (bytes && bench_send_all(p->fd, mine, bytes) != bytes))
+                return -1;
+            p->stats.bytes_sent += 4u + (u64)bytes;
+        } else {
+            if (bench_recv_all(p->fd, &rcount, 4) != 4 ||
+                rcount > PLD_SESSION_COUNT)
+                return -1;
+            int rbytes = (int)(rcount * sizeof(PldSession));
+            if (rbytes && bench_recv_all(p->fd, *remote, rbytes) != rbytes)
+                return -1;
+            p->stats.bytes_recv += 4u + (u64)rbytes;
+        }
+    }
+    free(mine);
+    *n = (int)rcount;
+    return 0;
+}
+
+static int note_full(void *state, const PldSessionLog *merged,
+                     const PldSession *rest, int n)
+{
+    Peer *p = (Peer *)state;
+    (void)rest;
+    p->full_merged = merged->count;
+    p->full_rest   = n;
+    return 0;
+}
+
+static void *peer_run(void *raw)
+{
+    Peer *p = (Peer *)raw;
+    memset(&p->stats, 0, sizeof(p->stats));
+    if (p->full) {
+        PldSession *remote = NULL;
+        int n = 0;
+        p->rc = full_exchange(p, &remote, &n);
+        if (p->rc == 0 && pld_merge_sessions(&p->log, remote, n, false) < 0)
+            p->rc = -1;
+        free(remote);
+    } else {
+        p->full_merged = -1;
+        int added = pld_recon_exchange(p->fd, &p->log, NULL, 0, NULL, NULL, 0,
+                                       note_full, p, &p->stats);
+        p->rc = added < 0 ? added : 0;
+    }
+    return NULL;
+}
+
+/* Sync a and b over a fresh loopback connection, b on its own thread. */
+static void run_pair(Peer *a, Peer *b, bool full)
+{
+    bench_tcp_pair(&a->fd, &b->fd);
+    a->lead = true;
+    b->lead = false;
+    a->full = b->full = full;
+    pthread_t t;
+    if (pthread_create(&t, NULL, peer_run, b) != 0)
+        bench_fail("pthread_create failed");
+    peer_run(a);
+    pthread_join(t, NULL);
+    close(a->fd);
+    close(b->fd);
+}
+
+static void sync_pair(Peer *a, Peer *b, bool full)
+{
+    run_pair(a, b, full);
+    if (a->rc != 0 || b->rc != 0)
+        bench_fail("%s sync failed (%d, %d)", full ? "full" : "delta", a->rc,
+                   b->rc);
+}
+
+/* ── Reference ──────────────────────────────────────────────────── */
+
+static int key_cmp(const PldSession *a, const PldSession *b)
+{
+    if (a->title_id != b->title_id) return a->title_id < b->title_id ? -1 : 1;
+    if (a->timestamp != b->timestamp) return a->timestamp < b->timestamp ? -1 : 1;
+    return 0;
+}
+
+static int title_cmp(const PldSession *a, const PldSession *b)
+{
+    return a->title_id == b->title_id ? 0 : a->title_id < b->title_id ? -1 : 1;
+}
+
+static int span_cmp(const PldSession *a, const PldSession *b)
+{
+    int c = title_cmp(a, b);
+    if (c) return c;
+    u32 sa = a->timestamp / PLD_RECON_SPAN, sb = b->timestamp / PLD_RECON_SPAN;
+    return sa == sb ? 0 : sa < sb ? -1 : 1;
+}
+
+typedef int (*RangeCmp)(const PldSession *, const PldSession *);
+
+/* Length of the range starting at s[i]. */
+static int run_len(const PldSession *s, int n, int i, RangeCmp cmp)
+{
+    int j = i;
+    while (j < n && cmp(&s[i], &s[j]) == 0) j++;
+    return j - i;
+}
+
+static PldReconTitle title_of(const PldSession *s, int n)
+{
+    PldReconTitle t = { n ? s[0].title_id : 0, (u32)n, 0, 0 };
+    for (int i = 0; i < n; i++)
+        if (i == 0 || span_cmp(&s[i - 1], &s[i]) != 0) t.spans++;
+    return t;
+}
+
+/* a[0..na) and b[0..nb) as one range: kept if identical, else sum-merged
+ * as pld_merge_sessions does. */
+static int merge_range(const PldSession *a, int na, const PldSession *b,
+                       int nb, PldSession *out)
+{
+    if (na == nb && memcmp(a, b, (size_t)na * sizeof(*a)) == 0) {
+        memcpy(out, a, (size_t)na * sizeof(*a));
+        return na;
+    }
+    int x = 0, y = 0, w = 0;
+    while (x < na || y < nb) {
+        int k = x == na ? 1 : y == nb ? -1 : key_cmp(&a[x], &b[y]);
+        if (k < 0) {
+            out[w++] = a[x++];
+        } else if (k > 0) {
+            out[w++] = b[y++];
+        } else {
+            PldSession s = a[x++];
+            s.play_secs += b[y++].play_secs;
+            if (s.play_secs > 3600) s.play_secs = 3600;
+            out[w++] = s;
+        }
+    }
+    return w;
+}
+
+/* Walk a and b range by range under cmp, merging each pair. */
+static int merge_ranges(const PldSession *a, int na, const PldSession *b,
+                        int nb, RangeCmp cmp, PldSession *out)
+{
+    int i = 0, j = 0, w = 0;
+    while (i < na || j < nb) {
+        int c = i == na ? 1 : j == nb ? -1 : cmp(&a[i], &b[j]);
+        int la = c <= 0 ? run_len(a, na, i, cmp) : 0;
+        int lb = c >= 0 ? run_len(b, nb, j, cmp) : 0;
+        if (cmp == title_cmp && la && lb) {
+            PldReconTitle ta = title_of(&a[i], la), tb = title_of(&b[j], lb);
+            w += pld_recon_by_span(&ta, &tb)
+                 ? merge_ranges(&a[i], la, &b[j], lb, span_cmp, &out[w])
+                 : merge_range(&a[i], la, &b[j], lb, &out[w]);
+        } else {
+            w += merge_range(&a[i], la, &b[j], lb, &out[w]);
+        }
+        i += la;
+        j += lb;
+    }
+    return w;
+}
+
+/* Span digests each side sends: those of the titles both hold differently
+ * and settle by span. */
+static void span_digests(const PldSession *a, int na, const PldSession *b,
+                         int nb, u32 *sa, u32 *sb)
+{
+    int i = 0, j = 0;
+    *sa = *sb = 0;
+    while (i < na || j < nb) {
+        int c = i == na ? 1 : j == nb ? -1 : title_cmp(&a[i], &b[j]);
+        int la = c <= 0 ? run_len(a, na, i, title_cmp) : 0;
+        int lb = c >= 0 ? run_len(b, nb, j, title_cmp) : 0;
+        if (la && lb) {
+            PldReconTitle ta = title_of(&a[i], la), tb = title_of(&b[j], lb);
+            if ((la != lb || memcmp(&a[i], &b[j], (size_t)la * sizeof(*a))) &&
+                pld_recon_by_span(&ta, &tb)) {
+                *sa += ta.spans;
+                *sb += tb.spans;
+            }
+        }
+        i += la;
+        j += lb;
+    }
+}
+
+/* Heap one side of a delta sync may use holding n records, against a peer
+ * with pt titles, the two sending s and ps span digests:
+ * digests both ways, title states, the send bitmap and the copy of the log
+ * the records are sent from.  Nothing scales with the records received. */
+static u64 sync_heap(int n, int pt, u32 s, u32 ps)
+{
+    return (u64)(PLD_TITLE_MAX + pt) * sizeof(PldReconTitle) + PLD_TITLE_MAX +
+           (u64)(s + ps) * sizeof(PldReconDigest) + ((u64)n / 32 + 1) * 4 +
+           (u64)n * sizeof(PldRec) + sizeof(PldTitleDict);
+}
+
+/* The log both peers must end with, from the two sorted inputs. */
+static int reference(const PldSession *a, int na, const PldSession *b, int nb,
+                     PldSession *out)
+{
+    return merge_ranges(a, na, b, nb, title_cmp, out);
+}
+
+static void expect_log(const char *what, const PldSessionLog *log,
+                       const PldSession *want, int n)
+{
+    if (!bench_log_equals(log, want, n))
+        bench_fail("%s: %d sessions after sync, reference has %d", what,
+                   log->count, n);
+}
+
+/* ── Scenario ───────────────────────────────────────────────────── */
+
+/* Two logs sharing pct% of cfg->sessions records, the rest dealt out
+ * alternately, with the first shared record played longer on a. */
+static void make_pair(const BenchConfig *cfg, int pct, PldSession *all,
+                      PldSession *a, int *na, PldSession *b, int *nb)
+{
+    int n = cfg->sessions;
+    bench_gen_sessions(all, n, cfg->titles, 0x7ec0u + (u32)pct);
+    int shared = (int)((long)n * pct / 100);
+    *na = *nb = 0;
+    for (int i = 0; i < n; i++) {
+        if (i < shared) {
+            a[(*na)++] = all[i];
+            b[(*nb)++] = all[i];
+        } else if ((i - shared) & 1) {
+            b[(*nb)++] = all[i];
+        } else {
+            a[(*na)++] = all[i];
+        }
+    }
+    if (shared > 0) a[0].play_secs = a[0].play_secs % 3600 + 1;
+    bench_sort_sessions(a, *na);
+    bench_sort_sessions(b, *nb);
+}
+
+static void load_peer(Peer *p, const PldSession *s, int n)
+{
+    pld_sessions_free(&p->log);
+    bench_log_pack(&p->log, s, n);
+}
+
+/* a one record short of full and b holding 300 others: each side gets
+ * more than fits, so both hand the merge over and keep their own log. */
+static void check_full(const BenchConfig *cfg, Peer *pa, Peer *pb)
+{
+    int n = PLD_SESSION_COUNT + 299;
+    PldSession *all  = malloc((size_t)n * sizeof(PldSession));
+    PldSession *want = malloc((size_t)n * sizeof(PldSession));
+    if (!all || !want) bench_fail("out of memory");
+    bench_gen_sessions(all, n, cfg->titles, 0xf011u);
+    int na = PLD_SESSION_COUNT - 1;
+    PldSession *a = all, *b = all + na;
+    int nb = n - na;
+    bench_sort_sessions(a, na);
+    bench_sort_sessions(b, nb);
+    int nwant = reference(a, na, b, nb, want);
+
+    load_peer(pa, a, na);
+    load_peer(pb, b, nb);
+    run_pair(pa, pb, false);
+    Peer *p[2] = { pa, pb };
+    for (int i = 0; i < 2; i++) {
+        if (p[i]->rc != -2 || p[i]->full_merged != PLD_SESSION_COUNT ||
+            p[i]->full_merged + p[i]->full_rest != nwant)
+            bench_fail("full, %c: returned %d, handed %d + %d of %d",
+                       'a' + i, p[i]->rc, p[i]->full_merged, p[i]->full_rest,
+                       nwant);
+    }
+    expect_log("full, a", &pa->log, a, na);
+    expect_log("full, b", &pb->log, b, nb);
+    free(want);
+    free(all);
+}
+
+void bench_pld_recon(const BenchConfig *cfg)
+{
+    size_t cap = ((size_t)cfg->sessions + 1) * sizeof(PldSession);
+    PldSession *all = malloc(cap), *a = malloc(cap), *b = malloc(cap);
+    PldSession *want = malloc(2 * cap);
+    if (!all || !a || !b || !want) bench_fail("out of memory");
+    Peer pa, pb;
+    memset(&pa, 0, sizeof(pa));
+    memset(&pb, 0, sizeof(pb));
+
+    for (size_t o = 0; o < sizeof(s_overlap) / sizeof(s_overlap[0]); o++) {
+        int pct = s_overlap[o], na, nb;
+        make_pair(cfg, pct, all, a, &na, b, &nb);
+        int nwant = reference(a, na, b, nb, want);
+
+        load_peer(&pa, a, na);
+        load_peer(&pb, b, nb);
+        u32 sa, sb;
+        span_digests(a, na, b, nb, &sa, &sb);
+        int ta = pa.log.titles->count, tb = pb.log.titles->count;
+        u64 bound = sync_heap(na, tb, sa, sb) + sync_heap(nb, ta, sb, sa) +
+                    HEAP_SLACK;
+        u64 mark = bench_heap_mark();
+        sync_pair(&pa, &pb, false);
+        u64 peak = bench_heap_peak_since(mark);
+        if (peak > bound)
+            bench_fail("delta sync peaked at %llu heap bytes, bound %llu "
+                       "(%u + %u records received)",
+                       (unsigned long long)peak, (unsigned long long)bound,
+                       pa.stats.records_recv, pb.stats.records_recv);
+        expect_log("delta, a", &pa.log, want, nwant);
+        expect_log("delta, b", &pb.log, want, nwant);
+        if (pa.stats.records_sent != pb.stats.records_recv ||
+            pa.stats.bytes_sent != pb.stats.bytes_recv ||
+            pb.stats.bytes_sent != pa.stats.bytes_recv)
+            bench_fail("delta: the two ends disagree on what crossed");
+
+        /* Synced logs: nothing but the title digests should cross. */
+        u64 digests = 12 + (u64)pa.log.titles->count * sizeof(PldReconTitle);
+        sync_pair(&pa, &pb, false);
+        if (pa.stats.records_sent || pb.stats.records_sent ||
+            pa.stats.bytes_sent > digests || pb.stats.bytes_sent > digests)
+            bench_fail("resync sent %u + %u records, %llu + %llu bytes",
+                       pa.stats.records_sent, pb.stats.records_sent,
+                       (unsigned long long)pa.stats.bytes_sent,
+                       (unsigned long long)pb.stats.bytes_sent);
+        expect_log("resync", &pa.log, want, nwant);
+
+        u64 t_delta = 0, t_full = 0, wire_delta = 0, wire_full = 0;
+        for (int it = 0; it < cfg->iters; it++) {
+            load_peer(&pa, a, na);
+            load_peer(&pb, b, nb);
+            u64 t0 = bench_now_ns();
+            sync_pair(&pa, &pb, false);
+            t_delta += bench_now_ns() - t0;
+            wire_delta = pa.stats.bytes_sent + pb.stats.bytes_sent;
+
+            load_peer(&pa, a, na);
+            load_peer(&pb, b, nb);
+            t0 = bench_now_ns();
+            sync_pair(&pa, &pb, true);
+            t_full += bench_now_ns() - t0;
+            wire_full = pa.stats.bytes_sent + pb.stats.bytes_sent;
+        }
+        char stage[32];
+        snprintf(stage, sizeof(stage), "full, %d%% shared", pct);
+        bench_report(stage, cfg, t_full, cfg->iters, wire_full);
+        snprintf(stage, sizeof(stage), "delta, %d%% shared", pct);
+        bench_report(stage, cfg, t_delta, cfg->iters, wire_delta);
+        printf("%-24s %llu bytes on the wire delta, %llu full\n", "",
+               (unsigned long long)wire_delta, (unsigned long long)wire_full);
+    }
+    check_full(cfg, &pa, &pb);
+
+    pld_sessions_free(&pa.log);
+    pld_sessions_free(&pb.log);
+    free(want);
+    free(b);
+    free(a);
+    free(all);
+}
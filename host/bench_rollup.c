@@ -0,0 +1,306 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Rollups in merged2.dat (pld_ext_rollup).  Rolls one console's history
+ * up under a long policy (daily past a year, weekly past three) and a
+ * short one, and checks that every session past the cut is gone, that
+ * periods sit on the right side of the cuts, and that totals and each
+ * title's sessions, days played and longest streak (read back through
+ * pld_ext_title_stats) match the hourly history.  Rolling up again,
+ * promoting daily rollups to weekly in a second step, re-merging the
+ * rollups and folding the hourly working set back in through
+ * pld_ext_fold_log must all give the same dataset.  Times the rollup, a
+ * merge of the newest tenth and a full read, hourly against rolled up.
+ */
+
+static const PldRollupPolicy s_long  = { 365, 3 * 365 };
+static const PldRollupPolicy s_short = { 7, 28 };
+static const PldRollupPolicy s_off   = { 0, 0 };
+
+static void copy_ext(PldExt *dst, const PldExt *src)
+{
+    pld_ext_init(dst);
+    dst->header = src->header;
+    if (pld_ext_merge_sessions(dst, src->sessions, src->count, true) < 0 ||
+        pld_ext_merge_summaries(dst, src->summaries, src->summary_count,
+                                true) < 0 ||
+        pld_ext_merge_rollups(dst, src->rollups, src->rollup_count, true) < 0)
+        bench_fail("out of memory");
+}
+
+static bool ext_equal(const PldExt *a, const PldExt *b)
+{
+    return a->count == b->count && a->summary_count == b->summary_count &&
+           a->rollup_count == b->rollup_count &&
+           memcmp(&a->header, &b->header, sizeof(a->header)) == 0 &&
+           memcmp(a->sessions, b->sessions,
+                  (size_t)a->count * sizeof(PldSession)) == 0 &&
+           memcmp(a->summaries, b->summaries,
+                  (size_t)a->summary_count * sizeof(PldSummary)) == 0 &&
+           memcmp(a->rollups, b->rollups,
+                  (size_t)a->rollup_count * sizeof(PldRollup)) == 0;
+}
+
+static u32 newest(const PldExt *x)
+{
+    u32 now = 0;
+    for (int i = 0; i < x->count; i++)
+        if (x->sessions[i].timestamp > now) now = x->sessions[i].timestamp;
+    return now;
+}
+
+/* The cuts, worked out independently of pld_ext.c. */
+static void cuts(const PldRollupPolicy *p, u32 now, u32 *day_cut,
+                 u32 *week_cut)
+{
+    u32 today = now / 86400u;
+    *day_cut = *week_cut = 0;
+    if (p->day_after && p->day_after < today)
+        *day_cut = (today - p->day_after) * 86400u;
+    if (p->week_after && p->week_after < today)
+        *week_cut = (today - p->week_after) / 7u * 7u * 86400u;
+    if (*week_cut > *day_cut) *day_cut = *week_cut;
+}
+
+static void check_layout(const char *what, const PldExt *x,
+                         const PldRollupPolicy *p, u32 now)
+{
+    u32 day_cut, week_cut;
+    cuts(p, now, &day_cut, &week_cut);
+    for (int i = 0; i < x->count; i++)
+        if (x->sessions[i].timestamp < day_cut)
+            bench_fail("%s: session %d is past the cut", what, i);
+    for (int i = 0; i < x->rollup_count; i++) {
+        const PldRollup *r = &x->rollups[i];
+        u32 end = r->start + r->days * 86400u;
+        bool ok = r->days == PLD_ROLLUP_WEEK
+                      ? end <= week_cut
+                      : r->start >= week_cut && end <= day_cut;
+        if (!ok || r->play_secs == 0 || r->sessions == 0)
+            bench_fail("%s: rollup %d misplaced", what, i);
+    }
+}
+
+/* One title's stats from the hourly sessions (sorted by key). */
+static void reference_stats(const PldExt *x, u64 title, PldExtTitleStats *out)
+{
+    memset(out, 0, sizeof(*out));
+    u32 prev = 0;
+    int run = 0;
+    for (int i = 0; i < x->count; i++) {
+        const PldSession *s = &x->sessions[i];
+        if (s->title_id != title) continue;
+        out->total_secs += s->play_secs;
+        out->sessions++;
+        u32 day = s->timestamp / 86400u;
+        if (run > 0 && day == prev) continue;
+        run = (run > 0 && day == prev + 1) ? run + 1 : 1;
+        prev = day;
+        out->days_played++;
+        if (run > out->longest_streak) out->longest_streak = run;
+    }
+}
+
+static void check_stats(const char *what, const char *path, const PldExt *hourly,
+                        int titles)
+{
+    PldExtReader r;
+    if (R_FAILED(pld_ext_open(&r, path))) bench_fail("pld_ext_open(%s)", path);
+    for (int k = 0; k < titles; k++) {
+        PldExtTitleStats got, want;
+        reference_stats(hourly, bench_title_id(k), &want);
+        if (pld_ext_title_stats(&r, bench_title_id(k), &got) < 0)
+            bench_fail("%s: pld_ext_title_stats failed", what);
+        if (got.total_secs != want.total_secs || got.sessions != want.sessions ||
+            got.days_played != want.days_played ||
+            got.longest_streak != want.longest_streak)
+            bench_fail("%s: title %d: %u s %u sessions %u days streak %d, "
+                       "expected %u s %u sessions %u days streak %d", what, k,
+                       (unsigned)got.total_secs, (unsigned)got.sessions,
+                       (unsigned)got.days_played, got.longest_streak,
+                       (unsigned)want.total_secs, (unsigned)want.sessions,
+                       (unsigned)want.days_played, want.longest_streak);
+    }
+    pld_ext_close(&r);
+}
+
+static void check_policy(const char *what, const PldExt *x,
+                         const PldSessionLog *log, const PldRollupPolicy *p,
+                         const char *path, int titles)
+{
+    u32 now = newest(x);
+    PldExt y, z;
+    copy_ext(&y, x);
+    int folded = pld_ext_rollup(&y, p, now);
+    if (folded < 0) bench_fail("%s: pld_ext_rollup failed", what);
+    if (y.count + folded != x->count)
+        bench_fail("%s: %d + %d sessions, expected %d", what, y.count, folded,
+                   x->count);
+    check_layout(what, &y, p, now);
+
+    PldExt xt;
+    copy_ext(&xt, x);
+    pld_ext_apply_totals(&xt);
+    pld_ext_apply_totals(&y);
+    if (memcmp(xt.summaries, y.summaries,
+               (size_t)y.summary_count * sizeof(PldSummary)) != 0)
+        bench_fail("%s: totals differ from the hourly ones", what);
+    pld_ext_free(&xt);
+
+    if (R_FAILED(pld_ext_write(path, &y)) || R_FAILED(pld_ext_read(path, &z)) ||
+        !ext_equal(&y, &z))
+        bench_fail("%s: round trip differs", what);
+    pld_ext_free(&z);
+    check_stats(what, path, x, titles);
+
+    /* Rolling up again does nothing. */
+    copy_ext(&z, &y);
+    if (pld_ext_rollup(&z, p, now) != 0 || !ext_equal(&y, &z))
+        bench_fail("%s: second rollup changed the dataset", what);
+    pld_ext_free(&z);
+
+    /* Days first, weeks later. */
+    PldRollupPolicy days_only = { p->day_after, 0 };
+    copy_ext(&z, x);
+    if (pld_ext_rollup(&z, &days_only, now) < 0 ||
+        pld_ext_rollup(&z, p, now) < 0)
+        bench_fail("%s: pld_ext_rollup failed", what);
+    pld_ext_apply_totals(&z);
+    if (!ext_equal(&y, &z))
+        bench_fail("%s: daily then weekly differs from weekly", what);
+    pld_ext_free(&z);
+
+    /* The app's path: the hourly working set folds back in as copies. */
+    pld_ext_set_rollup(p);
+    Result rc = pld_ext_fold_log(path, NULL, log, NULL, 0);
+    pld_ext_set_rollup(&s_off);
+    if (R_FAILED(rc) || R_FAILED(pld_ext_read(path, &z)))
+        bench_fail("%s: pld_ext_fold_log failed", what);
+    if (!ext_equal(&y, &z))
+        bench_fail("%s: folding the working set back in changed it", what);
+    pld_ext_free(&z);
+    pld_ext_free(&y);
+}
+
+/* Merge the newest tenth of the history into x, as a sync brings it. */
+static u64 time_merge(const PldExt *x, const PldSession *tail, int n, int iters)
+{
+    u64 t = 0;
+    for (int it = 0; it < iters; it++) {
+        PldExt y;
+        copy_ext(&y, x);
+        u64 t0 = bench_now_ns();
+        pld_ext_merge_sessions(&y, tail, n, true);
+        pld_ext_rollup(&y, &s_long, newest(&y));
+        t += bench_now_ns() - t0;
+        pld_ext_free(&y);
+    }
+    return t;
+}
+
+static u64 time_read(const char *path, int iters)
+{
+    u64 t0 = bench_now_ns();
+    for (int it = 0; it < iters; it++) {
+        PldExt y;
+        pld_ext_read(path, &y);
+        pld_ext_free(&y);
+    }
+    return bench_now_ns() - t0;
+}
+
+static u64 file_bytes(const PldExt *x)
+{
+    return sizeof(PldExtHeader) + (u64)x->summary_count * sizeof(PldSummary) +
+           (u64)x->rollup_count * sizeof(PldRollup) +
+           (u64)(x->count + PLD_EXT_BLOCK - 1) / PLD_EXT_BLOCK *
+               sizeof(PldExtBlock) +
+           (u64)x->count * sizeof(PldSession);
+}
+
+void bench_pld_rollup(const BenchConfig *cfg)
+{
+    int n = cfg->sessions;
+    PldSession *gen = malloc((size_t)(n ? n : 1) * sizeof(PldSession));
+    PldSummary *sum = calloc((size_t)cfg->titles, sizeof(PldSummary));
+    if (!gen || !sum) bench_fail("out of memory");
+    bench_gen_sessions(gen, n, cfg->titles, 0x7011u);
+    for (int k = 0; k < cfg->titles; k++) {
+        sum[k].title_id          = bench_title_id(k);
+        sum[k].first_played_days = 0xFFFF;
+        sum[k].unknown_e         = 1;
+    }
+    PldSessionLog log = { NULL, 0, NULL };
+    bench_log_pack(&log, gen, n);
+
+    PldExt x;
+    pld_ext_init(&x);
+    if (pld_ext_merge_sessions(&x, gen, n, true) < 0 ||
+        pld_ext_merge_summaries(&x, sum, cfg->titles, true) < 0)
+        bench_fail("out of memory");
+
+    char path[256], rolled_path[256];
+    snprintf(path, sizeof(path), "%s/bench_rollup.dat", cfg->work_dir);
+    snprintf(rolled_path, sizeof(rolled_path), "%s/bench_rollup2.dat",
+             cfg->work_dir);
+    check_policy("short", &x, &log, &s_short, rolled_path, cfg->titles);
+    check_policy("long", &x, &log, &s_long, rolled_path, cfg->titles);
+
+    int iters = cfg->iters / 5 > 0 ? cfg->iters / 5 : 1;
+    PldExt y;
+    pld_ext_init(&y);
+    u64 t_roll = 0;
+    int folded = 0;
+    for (int it = 0; it < iters; it++) {
+        pld_ext_free(&y);
+        copy_ext(&y, &x);
+        u64 t0 = bench_now_ns();
+        folded = pld_ext_rollup(&y, &s_long, newest(&y));
+        t_roll += bench_now_ns() - t0;
+    }
+    int days = 0, weeks = 0;
+    for (int i = 0; i < y.rollup_count; i++)
+        if (y.rollups[i].days == PLD_ROLLUP_DAY) days++;
+        else weeks++;
+
+    /* Both sides get the newest tenth again, a month later, as the next
+     * sync would bring it. */
+    int nt = n / 10;
+    PldSession *tail = malloc((size_t)(nt ? nt : 1) * sizeof(PldSession));
+    if (!tail) bench_fail("out of memory");
+    for (int i = 0; i < nt; i++) {
+        tail[i] = gen[n - nt + i];
+        tail[i].timestamp += 86400u * 30;
+    }
+    u64 t_merge_h = time_merge(&x, tail, nt, iters);
+    u64 t_merge_r = time_merge(&y, tail, nt, iters);
+
+    pld_ext_write(path, &x);
+    pld_ext_write(rolled_path, &y);
+    u64 t_read_h = time_read(path, iters);
+    u64 t_read_r = time_read(rolled_path, iters);
+
+    bench_report("rollup (1y day, 3y week)", cfg, t_roll, iters,
+                 (u64)x.count * sizeof(PldSession));
+    bench_report("merge tail (hourly)", cfg, t_merge_h, iters, 0);
+    bench_report("merge tail (rolled up)", cfg, t_merge_r, iters, 0);
+    bench_report("ext read (hourly)", cfg, t_read_h, iters, file_bytes(&x));
+    bench_report("ext read (rolled up)", cfg, t_read_r, iters, file_bytes(&y));
+    printf("%-24s %d sessions -> %d + %d daily + %d weekly, %llu -> %llu KB\n",
+           "", x.count, x.count - folded, days, weeks,
+           (unsigned long long)(file_bytes(&x) / 1024),
+           (unsigned long long)(file_bytes(&y) / 1024));
+
+    remove(path);
+    remove(rolled_path);
+    free(tail);
+    pld_ext_free(&y);
+    pld_ext_free(&x);
+    pld_sessions_free(&log);
+    free(sum);
+    free(gen);
+}
@@ -0,0 +1,296 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Warm-start snapshot (pld_snapshot.c).  A snapshot of a full startup load
+ * (NAND image, merged.dat checkpoint merged in, aggregates, index) plus
+ * opaque app bytes must load back byte for byte under the key it was saved
+ * with; a flipped byte in any part, a truncated file, a foreign magic or a
+ * missing file must be refused.  pld_load_all_unless must skip the parse
+ * only on a hash match, and pld_journal_state_hash must agree with and
+ * without reading merged.dat and move with each commit.  Times the cold
+ * load against the warm one (hash the image, hash SD, load the snapshot).
+ */
+
+typedef struct {
+    PldFile       pld;
+    PldSessionLog log;
+    PldAgg        agg;
+    PldIndex      index;
+} Loaded;
+
+static Loaded s_cold, s_warm;
+
+static struct {
+    u32 bytes[512];
+} s_app, s_app_back;
+
+/* main.c's load_sessions_work on the cold path, minus the commit. */
+static void cold_load(const char *nand, const char *dat, const char *jnl,
+                      Loaded *l)
+{
+    if (R_FAILED(pld_read_sd(nand, &l->pld, &l->log)))
+        bench_fail("pld_read_sd(%s)", nand);
+    pld_agg_build(&l->agg, &l->log);
+    PldJournal j;
+    PldView v;
+    if (R_FAILED(pld_journal_load(dat, jnl, &j)))
+        bench_fail("pld_journal_load(%s)", jnl);
+    if (R_FAILED(pld_view_open(&v, dat))) bench_fail("pld_view_open(%s)", dat);
+    pld_view_set_overlay(&v, &j);
+    if (pld_merge_sessions_view(&l->log, &v, true, &l->agg) < 0 ||
+        pld_merge_summaries_view(&l->pld, &v, true) < 0)
+        bench_fail("merge from %s failed", dat);
+    pld_view_close(&v);
+    pld_journal_free(&j);
+    pld_agg_refresh(&l->agg, &l->log);
+    pld_agg_apply_totals(&l->agg, &l->pld);
+    pld_index_build(&l->index, &l->pld, &l->log);
+}
+
+static void expect_same(const char *what, const Loaded *a, const Loaded *b)
+{
+    if (memcmp(&a->pld, &b->pld, sizeof(a->pld)) != 0)
+        bench_fail("%s: summaries differ", what);
+    if (a->log.count != b->log.count ||
+        memcmp(a->log.entries, b->log.entries,
+               (size_t)a->log.count * sizeof(PldRec)) != 0 ||
+        a->log.titles->count != b->log.titles->count ||
+        memcmp(a->log.titles->ids, b->log.titles->ids,
+               (size_t)a->log.titles->count * sizeof(u64)) != 0)
+        bench_fail("%s: sessions differ", what);
+    if (memcmp(&a->agg, &b->agg, sizeof(a->agg)) != 0)
+        bench_fail("%s: aggregates differ", what);
+    if (!b->index.valid || b->index.entries != b->log.entries ||
+        memcmp(a->index.begin, b->index.begin, sizeof(a->index.begin)) != 0 ||
+        memcmp(a->index.count, b->index.count, sizeof(a->index.count)) != 0)
+        bench_fail("%s: index differs", what);
+}
+
+static u64 state_hash(const char *dat, const char *jnl, bool allow_read)
+{
+    u64 h;
+    if (!pld_journal_state_hash(dat, jnl, allow_read, &h))
+        bench_fail("pld_journal_state_hash(%s, %d) failed", dat, allow_read);
+    return h;
+}
+
+static void load_snapshot(const char *path, const PldSnapKey *key, Loaded *l)
+{
+    PldSnapHeader h;
+    if (R_FAILED(pld_snapshot_header(path, &h)))
+        bench_fail("pld_snapshot_header(%s)", path);
+    if (memcmp(&h.key, key, sizeof(*key)) != 0)
+        bench_fail("snapshot key differs from the one saved");
+    if (R_FAILED(pld_snapshot_load_summaries(path, &h, &l->pld)) ||
+        R_FAILED(pld_snapshot_load_sessions(path, &h, &l->log, &l->agg,
+                                            &l->index)))
+        bench_fail("loading %s failed", path);
+}
+
+static void patch_byte(const char *path, long offset)
+{
+    FILE *f = fopen(path, "r+b");
+    if (!f || fseek(f, offset, SEEK_SET) != 0) bench_fail("open %s", path);
+    int c = fgetc(f);
+    fseek(f, offset, SEEK_SET);
+    fputc(c ^ 0x5A, f);
+    fclose(f);
+}
+
+static void truncate_to(const char *path, long len)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) bench_fail("open %s", path);
+    u8 *buf = malloc((size_t)len);
+    if (!buf || fread(buf, 1, (size_t)len, f) != (size_t)len)
+        bench_fail("read %s", path);
+    fclose(f);
+    f = fopen(path, "wb");
+    if (!f || fwrite(buf, 1, (size_t)len, f) != (size_t)len)
+        bench_fail("write %s", path);
+    fclose(f);
+    free(buf);
+}
+
+/* Each damaged copy of a good snapshot must be refused somewhere. */
+static void check_damage(const char *snap, const PldSnapKey *key,
+                         const Loaded *ref)
+{
+    const long hdr  = (long)sizeof(PldSnapHeader);
+    const long sess = hdr + (long)sizeof(PldFile);
+    const struct { const char *what; long at; } flips[] = {
+        { "summaries", hdr + 16 },
+        { "sessions",  sess + 5 },
+        { "app bytes", -8 },
+    };
+    PldSnapHeader h;
+    Loaded l;
+    for (size_t i = 0; i < sizeof(flips) / sizeof(flips[0]); i++) {
+        pld_snapshot_save(snap, key, &ref->pld, &ref->log, &ref->agg,
+                          &ref->index, &s_app, sizeof(s_app));
+        FILE *f = fopen(snap, "rb");
+        fseek(f, 0, SEEK_END);
+        long len = ftell(f);
+        fclose(f);
+        patch_byte(snap, flips[i].at < 0 ? len + flips[i].at : flips[i].at);
+        memset(&l, 0, sizeof(l));
+        if (R_FAILED(pld_snapshot_header(snap, &h)))
+            bench_fail("%s flipped: header refused", flips[i].what);
+        bool ok = R_SUCCEEDED(pld_snapshot_load_summaries(snap, &h, &l.pld)) &&
+                  R_SUCCEEDED(pld_snapshot_load_sessions(snap, &h, &l.log,
+                                                         &l.agg, &l.index));
+        if (ok) pld_sessions_free(&l.log);
+        else if (l.log.entries || l.index.valid)
+            bench_fail("%s flipped: failed load left a log or index", flips[i].what);
+        ok = ok && R_SUCCEEDED(pld_snapshot_load_app(snap, &h, &s_app_back,
+                                                     sizeof(s_app_back)));
+        if (ok) bench_fail("%s flipped: snapshot accepted", flips[i].what);
+    }
+
+    pld_snapshot_save(snap, key, &ref->pld, &ref->log, &ref->agg, &ref->index,
+                      &s_app, sizeof(s_app));
+    truncate_to(snap, sess + 100);
+    if (R_FAILED(pld_snapshot_header(snap, &h)))
+        bench_fail("truncated: header refused");
+    if (R_SUCCEEDED(pld_snapshot_load_sessions(snap, &h, &l.log, &l.agg,
+                                               &l.index)))
+        bench_fail("truncated: sessions accepted");
+    if (R_SUCCEEDED(pld_snapshot_load_app(snap, &h, &s_app_back,
+                                          sizeof(s_app_back) - 4)))
+        bench_fail("app bytes larger than the buffer accepted");
+
+    patch_byte(snap, 0);
+    if (R_SUCCEEDED(pld_snapshot_header(snap, &h)))
+        bench_fail("foreign magic accepted");
+    remove(snap);
+    if (R_SUCCEEDED(pld_snapshot_header(snap, &h)))
+        bench_fail("missing snapshot accepted");
+}
+
+static void check_load_unless(const char *nand, u64 hash)
+{
+    PldStorage st;
+    PldFile pld;
+    PldSessionLog log;
+    if (R_FAILED(pld_storage_open_stdio(&st, nand, false)))
+        bench_fail("open %s", nand);
+    if (pld_load_all_unless(&st, hash, &pld, &log) != PLD_RC_UNCHANGED ||
+        pld.image_hash != hash || log.entries)
+        bench_fail("pld_load_all_unless parsed an image it was told to skip");
+    if (R_FAILED(pld_load_all_unless(&st, hash ^ 1, &pld, &log)) ||
+        pld.image_hash != hash || !log.entries)
+        bench_fail("pld_load_all_unless skipped a different image");
+    pld_sessions_free(&log);
+    pld_storage_close(&st);
+}
+
+/* Stable until a commit changes the dataset, then moved. */
+static void check_state_hash(const char *dat, const char *jnl)
+{
+    u64 h0 = state_hash(dat, jnl, false);
+    if (state_hash(dat, jnl, true) != h0 || state_hash(dat, jnl, false) != h0)
+        bench_fail("state hash unstable");
+    PldFile pld;
+    PldSessionLog log;
+    if (R_FAILED(pld_journal_read(dat, jnl, &pld, &log)))
+        bench_fail("pld_journal_read(%s)", dat);
+    u32 newest = 0;
+    for (int i = 0; i < log.count; i++)
+        if (log.entries[i].timestamp > newest) newest = log.entries[i].timestamp;
+    PldSession add = { bench_title_id(0), newest + 3600u, 600u };
+    if (pld_merge_sessions(&log, &add, 1, false) != 1)
+        bench_fail("merging one session failed");
+    if (R_FAILED(pld_journal_commit(dat, jnl, &pld, &log, NULL)))
+        bench_fail("pld_journal_commit(%s)", jnl);
+    u64 h1 = state_hash(dat, jnl, false);
+    if (h1 == h0 || state_hash(dat, jnl, true) != h1)
+        bench_fail("state hash did not follow the commit");
+    pld_sessions_free(&log);
+}
+
+void bench_pld_snapshot(const BenchConfig *cfg)
+{
+    u8 *image = malloc(PLD_FILE_SIZE);
+    if (!image) bench_fail("out of memory");
+    char nand[256], dat[256], jnl[256], snap[256];
+    /* Half each, so the union fits the log. */
+    bench_gen_image(image, cfg->sessions / 2, cfg->titles, 0x5a1u);
+    bench_write_image(cfg, "snap_nand.dat", image, nand, sizeof(nand));
+    u64 nand_hash = pld_hash64(image, PLD_FILE_SIZE, 0);
+    bench_gen_image(image, cfg->sessions / 2, cfg->titles, 0x5a2u);
+    bench_write_image(cfg, "snap_sd.dat", image, dat, sizeof(dat));
+    free(image);
+    snprintf(jnl, sizeof(jnl), "%s/snap_sd.journal", cfg->work_dir);
+    snprintf(snap, sizeof(snap), "%s/snapshot.dat", cfg->work_dir);
+    remove(jnl);
+
+    /* A checkpoint with its sidecar, as the startup commit leaves it. */
+    PldFile sd_pld;
+    PldSessionLog sd_log;
+    if (R_FAILED(pld_read_sd(dat, &sd_pld, &sd_log)))
+        bench_fail("pld_read_sd(%s)", dat);
+    if (R_FAILED(pld_journal_checkpoint(dat, jnl, &sd_pld, &sd_log, NULL)))
+        bench_fail("pld_journal_checkpoint(%s)", dat);
+    pld_sessions_free(&sd_log);
+
+    check_load_unless(nand, nand_hash);
+    for (u32 i = 0; i < sizeof(s_app.bytes) / sizeof(s_app.bytes[0]); i++)
+        s_app.bytes[i] = i * 2654435761u;
+
+    cold_load(nand, dat, jnl, &s_cold);
+    PldSnapKey key = { nand_hash, pld_summary_hash(&s_cold.pld),
+                       state_hash(dat, jnl, false), 0x1234, 0x5678 };
+    if (R_FAILED(pld_snapshot_save(snap, &key, &s_cold.pld, &s_cold.log,
+                                   &s_cold.agg, &s_cold.index, &s_app,
+                                   sizeof(s_app))))
+        bench_fail("pld_snapshot_save(%s)", snap);
+    load_snapshot(snap, &key, &s_warm);
+    expect_same("roundtrip", &s_cold, &s_warm);
+    PldSnapHeader h;
+    pld_snapshot_header(snap, &h);
+    memset(&s_app_back, 0, sizeof(s_app_back));
+    if (h.app_size != sizeof(s_app) ||
+        R_FAILED(pld_snapshot_load_app(snap, &h, &s_app_back,
+                                       sizeof(s_app_back))) ||
+        memcmp(&s_app, &s_app_back, sizeof(s_app)) != 0)
+        bench_fail("app bytes differ");
+    pld_sessions_free(&s_warm.log);
+
+    u64 t_cold = 0, t_warm = 0;
+    for (int it = 0; it < cfg->iters; it++) {
+        pld_sessions_free(&s_cold.log);
+        u64 t0 = bench_now_ns();
+        cold_load(nand, dat, jnl, &s_cold);
+        t_cold += bench_now_ns() - t0;
+
+        t0 = bench_now_ns();
+        PldStorage st;
+        if (R_FAILED(pld_storage_open_stdio(&st, nand, false)) ||
+            pld_load_all_unless(&st, key.nand_hash, &s_warm.pld,
+                                &s_warm.log) != PLD_RC_UNCHANGED ||
+            state_hash(dat, jnl, true) != key.sd_hash)
+            bench_fail("warm start missed");
+        pld_storage_close(&st);
+        load_snapshot(snap, &key, &s_warm);
+        t_warm += bench_now_ns() - t0;
+        expect_same("warm load", &s_cold, &s_warm);
+        pld_sessions_free(&s_warm.log);
+    }
+    bench_report("cold (read+merge+index)", cfg, t_cold, cfg->iters,
+                 PLD_FILE_SIZE);
+    bench_report("warm (hash+snapshot)", cfg, t_warm, cfg->iters,
+                 PLD_FILE_SIZE);
+
+    check_damage(snap, &key, &s_cold);
+    check_state_hash(dat, jnl);
+    pld_sessions_free(&s_cold.log);
+
+    remove(snap);
+    remove(jnl);
+    remove(dat);
+    remove(nand);
+}
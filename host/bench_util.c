@@ -0,0 +1,135 @@
+#include "bench.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* 2015-01-01 00:00 in seconds since 2000-01-01 — start of synthetic logs */
+#define BENCH_EPOCH_START  473385600u
+
+u64 bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+void bench_report(const char *stage, const BenchConfig *cfg,
+                  u64 total_ns, int iters, u64 bytes_per_op)
+{
+    double ns_op = iters > 0 ? (double)total_ns / iters : 0.0;
+    double mb_s  = ns_op > 0.0 ? (double)bytes_per_op / ns_op * 1e9 / 1e6 : 0.0;
+    printf("%-24s sessions=%6d titles=%3d  %14.0f ns/op  %9.1f MB/s\n",
+           stage, cfg->sessions, cfg->titles, ns_op, mb_s);
+    fflush(stdout);
+}
+
+void bench_fail(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    fputs("FAIL: ", stderr);
+    vfprintf(stderr, fmt, ap);
+    fputc('\n', stderr);
+    va_end(ap);
+    exit(1);
+}
+
+u32 bench_rand(u32 *state)
+{
+    u32 x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+u64 bench_title_id(int k)
+{
+    return 0x0004000000030000ull + ((u64)k << 8);
+}
+
+void bench_gen_sessions(PldSession *out, int count, int titles, u32 seed)
+{
+    u32 rng = seed ? seed : 1;
+    u32 ts  = BENCH_EPOCH_START;
+    for (int i = 0; i < count; i++) {
+        /* 1–8 h apart: 50000 records span ~26 years, well short of u32 wrap */
+        ts += 3600u * (1 + bench_rand(&rng) % 8);
+        out[i].title_id  = bench_title_id((int)(bench_rand(&rng) % (u32)titles));
+        out[i].timestamp = ts;
+        out[i].play_secs = 60 + bench_rand(&rng) % 3541;
+    }
+}
+
+static int cmp_key(const void *a, const void *b)
+{
+    const PldSession *sa = a, *sb = b;
+    if (sa->title_id != sb->title_id) return sa->title_id < sb->title_id ? -1 : 1;
+    if (sa->timestamp != sb->timestamp) return sa->timestamp < sb->timestamp ? -1 : 1;
+    return 0;
+}
+
+void bench_sort_sessions(PldSession *s, int n)
+{
+    qsort(s, (size_t)n, sizeof(PldSession), cmp_key);
+}
+
+void bench_gen_image(u8 *image, int sessions, int titles, u32 seed)
+{
+    memset(image, 0xFF, PLD_FILE_SIZE);
+
+    PldHeader hdr = { 0, (u32)sessions, 0, 0 };
+    memcpy(image + PLD_HEADER_OFFSET, &hdr, sizeof(hdr));
+
+    PldSession *sess = (PldSession *)(image + PLD_SESSION_OFFSET);
+    bench_gen_sessions(sess, sessions, titles, seed);
+
+    PldSummary *sum = (PldSummary *)(image + PLD_SUMMARY_OFFSET);
+    for (int k = 0; k < titles && k < PLD_SUMMARY_COUNT; k++) {
+        memset(&sum[k], 0, sizeof(sum[k]));
+        sum[k].title_id          = bench_title_id(k);
+        sum[k].first_played_days = 0xFFFF;
+        sum[k].unknown_e         = 1;
+    }
+    for (int i = 0; i < sessions; i++) {
+        int k = (int)((sess[i].title_id - bench_title_id(0)) >> 8);
+        if (k >= PLD_SUMMARY_COUNT) continue;
+        u16 day = (u16)(sess[i].timestamp / 86400u);
+        sum[k].total_secs += sess[i].play_secs;
+        if (sum[k].launch_count < 0xFFFF) sum[k].launch_count++;
+        if (day < sum[k].first_played_days) sum[k].first_played_days = day;
+        if (day > sum[k].last_played_days)  sum[k].last_played_days  = day;
+    }
+}
+
+void bench_write_image(const BenchConfig *cfg, const char *name,
+                       const u8 *image, char *path_out, size_t path_len)
+{
+    snprintf(path_out, path_len, "%s/%s", cfg->work_dir, name);
+    FILE *f = fopen(path_out, "wb");
+    if (!f) bench_fail("cannot create %s", path_out);
+    if (fwrite(image, 1, PLD_FILE_SIZE, f) != PLD_FILE_SIZE)
+        bench_fail("short write to %s", path_out);
+    fclose(f);
+}
+
+void bench_log_pack(PldSessionLog *log, const PldSession *recs, int n)
+{
+    if (!log->entries && !pld_log_alloc(log)) bench_fail("out of memory");
+    if (R_FAILED(pld_log_pack(log, recs, n))) bench_fail("pld_log_pack failed");
+}
+
+bool bench_log_equals(const PldSessionLog *log, const PldSession *want, int n)
+{
+    if (log->count != n) return false;
+    for (int i = 0; i < n; i++) {
+        PldSession s;
+        pld_rec_unpack(log, &log->entries[i], &s);
+        if (memcmp(&s, &want[i], sizeof(s)) != 0) return false;
+    }
+    return true;
+}
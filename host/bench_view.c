@@ -0,0 +1,144 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Startup step 3: add-only merge of merged.dat into the NAND log, loading
+ * merged.dat with pld_read_sd versus streaming it through a PldView.
+ * Besides ns/op this asserts the peak heap each path needs on top of the
+ * already-resident NAND log.
+ */
+
+typedef struct {
+    PldFile       pld;
+    PldSessionLog log;
+} MergeState;
+
+static void state_init(MergeState *m, const PldFile *pld,
+                       const PldSession *init, int count)
+{
+    m->pld = *pld;
+    bench_log_pack(&m->log, init, count);
+}
+
+static void merge_read_sd(MergeState *m, const char *path)
+{
+    PldFile       sd_pld;
+    PldSessionLog sd_log;
+    if (R_FAILED(pld_read_sd(path, &sd_pld, &sd_log)))
+        bench_fail("pld_read_sd(%s)", path);
+    PldSession *raw = malloc((size_t)(sd_log.count + 1) * sizeof(PldSession));
+    if (!raw) bench_fail("out of memory");
+    pld_log_unpack(&sd_log, raw);
+    if (pld_merge_sessions(&m->log, raw, sd_log.count, true) < 0)
+        bench_fail("pld_merge_sessions overflow");
+    free(raw);
+    if (pld_merge_summaries(&m->pld, sd_pld.summaries,
+                            sd_pld.summary_count, true) < 0)
+        bench_fail("pld_merge_summaries overflow");
+    pld_sessions_free(&sd_log);
+}
+
+static void merge_view(MergeState *m, const char *path)
+{
+    PldView v;
+    if (R_FAILED(pld_view_open(&v, path)))
+        bench_fail("pld_view_open(%s)", path);
+    if (pld_merge_sessions_view(&m->log, &v, true, NULL) < 0)
+        bench_fail("pld_merge_sessions_view failed");
+    if (pld_merge_summaries_view(&m->pld, &v, true) < 0)
+        bench_fail("pld_merge_summaries_view failed");
+    pld_view_close(&v);
+}
+
+typedef void (*MergeFunc)(MergeState *m, const char *path);
+
+static u64 bench_merge_path(const BenchConfig *cfg, const char *stage,
+                            MergeFunc merge, const char *path,
+                            const PldFile *nand_pld, const PldSession *nand,
+                            int nand_count, MergeState *out)
+{
+    u64 total = 0, peak = 0;
+    for (int it = 0; it < cfg->iters; it++) {
+        state_init(out, nand_pld, nand, nand_count);
+        u64 mark = bench_heap_mark();
+        u64 t0 = bench_now_ns();
+        merge(out, path);
+        total += bench_now_ns() - t0;
+        u64 p = bench_heap_peak_since(mark);
+        if (p > peak) peak = p;
+        if (bench_heap_current() != mark)
+            bench_fail("%s leaked %llu bytes", stage,
+                       (unsigned long long)(bench_heap_current() - mark));
+    }
+    bench_report(stage, cfg, total, cfg->iters, PLD_FILE_SIZE);
+    printf("%-24s peak heap %llu bytes\n", "", (unsigned long long)peak);
+    return peak;
+}
+
+void bench_pld_view(const BenchConfig *cfg)
+{
+    /* merged.dat holds the full generated log, sorted as the app writes it;
+     * NAND holds the chronologically first half, so the add-only merge
+     * appends the second half. */
+    u8 *image = malloc(PLD_FILE_SIZE);
+    if (!image) bench_fail("out of memory");
+    bench_gen_image(image, cfg->sessions, cfg->titles, 0x7a11u);
+
+    int nand_count = cfg->sessions / 2;
+    PldSession *nand = malloc((size_t)(nand_count + 1) * sizeof(PldSession));
+    if (!nand) bench_fail("out of memory");
+    memcpy(nand, image + PLD_SESSION_OFFSET,
+           (size_t)nand_count * sizeof(PldSession));
+    bench_sort_sessions((PldSession *)(image + PLD_SESSION_OFFSET),
+                        cfg->sessions);
+
+    char path[256];
+    bench_write_image(cfg, "bench_merged.dat", image, path, sizeof(path));
+
+    PldFile nand_pld;
+    PldView iv;
+    pld_view_from_image(&iv, image);
+    memset(&nand_pld, 0xFF, sizeof(nand_pld));
+    nand_pld.header = iv.header;
+    nand_pld.summary_count = 0;
+
+    MergeState a, b;
+    if (!pld_log_alloc(&a.log) || !pld_log_alloc(&b.log))
+        bench_fail("out of memory");
+
+    u64 peak_sd = bench_merge_path(cfg, "startup merge (read_sd)", merge_read_sd,
+                                   path, &nand_pld, nand, nand_count, &a);
+    u64 peak_vw = bench_merge_path(cfg, "startup merge (view)", merge_view,
+                                   path, &nand_pld, nand, nand_count, &b);
+
+    /* The view path also registers summary titles that have no sessions,
+     * so compare unpacked records rather than dictionary indices. */
+    PldSession *ua = malloc((size_t)(a.log.count + 1) * sizeof(PldSession));
+    if (!ua) bench_fail("out of memory");
+    pld_log_unpack(&a.log, ua);
+    if (a.log.count != cfg->sessions ||
+        !bench_log_equals(&b.log, ua, a.log.count))
+        bench_fail("view merge differs from read_sd merge");
+    free(ua);
+    if (a.pld.summary_count != b.pld.summary_count ||
+        memcmp(a.pld.summaries, b.pld.summaries, sizeof(a.pld.summaries)) != 0)
+        bench_fail("view summary merge differs from read_sd merge");
+
+    /* The view path must never hold more than its page window, and the
+     * read_sd path is expected to hold a full image. */
+    if (peak_vw > PLD_VIEW_WINDOW)
+        bench_fail("view merge peaked at %llu bytes (limit %u)",
+                   (unsigned long long)peak_vw, PLD_VIEW_WINDOW);
+    if (peak_sd < PLD_SESSION_COUNT * sizeof(PldSession))
+        bench_fail("read_sd merge peaked at only %llu bytes",
+                   (unsigned long long)peak_sd);
+
+    pld_sessions_free(&a.log);
+    pld_sessions_free(&b.log);
+    free(nand);
+    remove(path);
+    free(image);
+}
@@ -0,0 +1,78 @@
+#---------------------------------------------------------------------------------
+# Host (Linux) build of the portable pld core — no devkitPro required.
+#
+#   make host-bench                       build and run the benchmark
+#   make host-bench BENCH_ARGS="-s 50000 -t 256 -n 50"
+#   make host-merge                       build the SD dump merger
+#   make host-bench HOST_MEMPROF=1        with the allocation profiler
+#                                         (host-clean first)
+#   make host-clean
+#---------------------------------------------------------------------------------
+
+HOST_CC      ?= cc
+HOST_BUILD   := build-host
+HOST_CFLAGS  := -std=gnu11 -O2 -g -Wall -Wextra -Wno-unused-parameter \
+                -pthread -Iinclude -Ihost
+HOST_LDFLAGS := -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free
+HOST_LIBS    := -pthread
+
+# make host-bench HOST_MEMPROF=1: allocation profiler, report on stdout
+ifeq ($(HOST_MEMPROF),1)
+HOST_CFLAGS  += -DPLD_MEMPROF
+endif
+
+HOST_CORE    := source/pld_core.c source/pld_storage.c source/pld_view.c \
+                source/pld_compact.c source/pld_merge.c \
+                source/pld_agg.c source/pld_index.c source/pld_pack.c \
+                source/pld_hash.c source/pld_journal.c \
+                source/pld_backup.c source/pld_catalog.c source/pld_kmerge.c \
+                source/pld_ext.c source/pld_parallel.c \
+                source/pld_arena.c source/pld_snapshot.c source/pld_recon.c \
+                source/pld_wire.c source/pld_codec.c source/pld_link.c \
+                source/memprof.c
+HOST_BENCH   := host/bench_main.c host/bench_util.c host/bench_pld.c \
+                host/bench_load.c host/bench_heap.c \
+                host/bench_view.c host/bench_compact.c \
+                host/bench_merge.c host/bench_agg.c \
+                host/bench_index.c host/bench_packed.c host/bench_hash.c \
+                host/bench_journal.c host/bench_backup.c \
+                host/bench_catalog.c host/bench_kmerge.c \
+                host/bench_ext.c host/bench_rollup.c host/bench_parmerge.c \
+                host/bench_arena.c host/bench_memprof.c \
+                host/bench_lazyload.c host/bench_snapshot.c host/bench_recon.c \
+                host/bench_net.c host/bench_duplex.c \
+                host/bench_codec.c host/bench_link.c
+
+HOST_CORE_O  := $(patsubst source/%.c,$(HOST_BUILD)/core/%.o,$(HOST_CORE))
+HOST_BENCH_O := $(patsubst host/%.c,$(HOST_BUILD)/bench/%.o,$(HOST_BENCH))
+HOST_MERGE_O := $(HOST_BUILD)/bench/merge_main.o
+
+.PHONY: host-bench host-bench-build host-merge host-clean
+
+host-bench: host-bench-build
+	@./$(HOST_BUILD)/pld_bench -d $(HOST_BUILD) $(BENCH_ARGS)
+
+host-bench-build: $(HOST_BUILD)/pld_bench
+
+$(HOST_BUILD)/pld_bench: $(HOST_CORE_O) $(HOST_BENCH_O)
+	$(HOST_CC) $(HOST_LDFLAGS) -o $@ $^ $(HOST_LIBS)
+
+host-merge: $(HOST_BUILD)/pld_merge
+
+# No allocator wrap: the counting wrappers live in the bench.
+$(HOST_BUILD)/pld_merge: $(HOST_CORE_O) $(HOST_MERGE_O)
+	$(HOST_CC) -o $@ $^ $(HOST_LIBS)
+
+$(HOST_BUILD)/core/%.o: source/%.c
+	@mkdir -p $(dir $@)
+	$(HOST_CC) $(HOST_CFLAGS) -MMD -MP -c -o $@ $<
+
+$(HOST_BUILD)/bench/%.o: host/%.c
+	@mkdir -p $(dir $@)
+	$(HOST_CC) $(HOST_CFLAGS) -MMD -MP -c -o $@ $<
+
+host-clean:
+	@echo clean host ...
+	@rm -fr $(HOST_BUILD)
+
+-include $(HOST_CORE_O:.o=.d) $(HOST_BENCH_O:.o=.d) $(HOST_MERGE_O:.o=.d)
@@ -0,0 +1,153 @@
+#include "pld.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * pld_merge — consolidate SD dumps on a PC
+ *
+ * usage: pld_merge [-a] [-x] [-r DAYS[,WEEKS]] [-d DIR] OUT IN...
+ *   -a  keep the first-seen play time for sessions in several inputs
+ *       (backups of one console) instead of summing them, as sync does
+ *   -x  write OUT as merged2.dat, without the NAND caps; IN may then also
+ *       be merged2.dat files
+ *   -r  with -x, roll sessions more than DAYS days older than the newest
+ *       into daily records, and more than WEEKS days older into weekly
+ *       ones (0 = never)
+ *   -d  scratch directory for spilled runs (default: current directory)
+ *   OUT   merged.dat-format image (or merged2.dat with -x) to write
+ *   IN    pld.dat dumps, merged.dat files or backups (raw or container);
+ *         the first is the base, the rest are merged into it in order
+ */
+
+static int usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [-a] [-x] [-r DAYS[,WEEKS]] [-d DIR] OUT IN...\n",
+            argv0);
+    return 2;
+}
+
+/* -x: every input through the uncapped dataset. */
+static int merge_ext(const char *out_path, char **in, int n, bool add_only,
+                     const PldRollupPolicy *rollup)
+{
+    PldExt x;
+    pld_ext_init(&x);
+    PldFile *pld = malloc(sizeof(PldFile));
+    if (!pld) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (int i = 0; i < n; i++) {
+        PldExt in_x;
+        PldSessionLog log = { NULL, 0, NULL };
+        int rc;
+        if (R_SUCCEEDED(pld_ext_read(in[i], &in_x))) {
+            if (x.count == 0 && x.summary_count == 0) x.header = in_x.header;
+            rc = pld_ext_merge_sessions(&x, in_x.sessions, in_x.count,
+                                        add_only);
+            if (rc >= 0 &&
+                pld_ext_merge_summaries(&x, in_x.summaries, in_x.summary_count,
+                                        add_only) < 0)
+                rc = -1;
+            if (rc >= 0 &&
+                pld_ext_merge_rollups(&x, in_x.rollups, in_x.rollup_count,
+                                      add_only) < 0)
+                rc = -1;
+            pld_ext_free(&in_x);
+        } else if (R_SUCCEEDED(pld_backup_read(in[i], pld, &log))) {
+            rc = pld_ext_merge_log(&x, pld, &log, add_only);
+            pld_sessions_free(&log);
+        } else {
+            fprintf(stderr, "%s: not a pld.dat image, backup or merged2.dat\n",
+                    in[i]);
+            return 1;
+        }
+        if (rc < 0) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+    }
+    /* Also absorbs sessions that landed in an input's rollups. */
+    u32 now = 0;
+    for (int k = 0; k < x.count; k++)
+        if (x.sessions[k].timestamp > now) now = x.sessions[k].timestamp;
+    if (pld_ext_rollup(&x, rollup, now) < 0) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    pld_ext_apply_totals(&x);
+    if (R_FAILED(pld_ext_write(out_path, &x))) {
+        fprintf(stderr, "%s: write failed\n", out_path);
+        return 1;
+    }
+    printf("%d sessions, %d rollups, %d apps from %d files -> %s\n", x.count,
+           x.rollup_count, x.summary_count, n, out_path);
+    pld_ext_free(&x);
+    free(pld);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    bool add_only = false, ext = false;
+    PldRollupPolicy rollup = { 0, 0 };
+    const char *scratch = ".";
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-a") == 0)
+            add_only = true;
+        else if (strcmp(argv[i], "-x") == 0)
+            ext = true;
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc &&
+                 sscanf(argv[i + 1], "%u,%u", &rollup.day_after,
+                        &rollup.week_after) >= 1)
+            i++;
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+            scratch = argv[++i];
+        else
+            return usage(argv[0]);
+    }
+    if (argc - i < 2) return usage(argv[0]);
+    const char *out_path = argv[i++];
+    if (ext) return merge_ext(out_path, &argv[i], argc - i, add_only, &rollup);
+
+    PldFile *pld = malloc(sizeof(PldFile));
+    PldAgg  *agg = malloc(sizeof(PldAgg));
+    PldSessionLog log = { NULL, 0, NULL };
+    if (!pld || !agg) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    if (R_FAILED(pld_backup_read(argv[i], pld, &log))) {
+        fprintf(stderr, "%s: not a pld.dat image or backup\n", argv[i]);
+        return 1;
+    }
+    int base = log.count;
+
+    int added = pld_merge_many(pld, &log, (const char *const *)&argv[i + 1],
+                               argc - i - 1, add_only, scratch);
+    if (added < 0) {
+        fprintf(stderr, "merge failed (unreadable input, or more than %d "
+                "sessions or %d titles; try -x)\n", PLD_SESSION_COUNT,
+                PLD_TITLE_MAX);
+        return 1;
+    }
+    pld_agg_build(agg, &log);
+    pld_agg_apply_totals(agg, pld);
+
+    Result rc = pld_write_sd(out_path, pld, &log);
+    if (R_FAILED(rc)) {
+        fprintf(stderr, "%s: write failed\n", out_path);
+        return 1;
+    }
+    printf("%d sessions (%d from %s, +%d from %d more), %d apps -> %s\n",
+           log.count, base, argv[i], added, argc - i - 1, pld->summary_count,
+           out_path);
+
+    pld_sessions_free(&log);
+    free(agg);
+    free(pld);
+    return 0;
+}
@@ -4,10 +4,39 @@
 #include "settings.h"
 #include "render_views.h"
 
+/* Startup session load, run behind a completion fence (main.c) while the
+ * list is drawn from the NAND summaries: reads the whole image, merges
+ * merged.dat and the journal into it and indexes the result. */
+typedef struct {
+    PldFence       fence;
+    FS_Archive     archive;     /* closed by the task */
+    PldFile        pld;         /* NAND summaries with merged.dat folded in */
+    PldSessionLog  sessions;
+    PldAgg        *agg;         /* the AppCtx's; left to the task until */
+    PldIndex      *index;       /* the load is adopted                  */
+    Result         rc;
+    u64            done_tick;   /* svcGetSystemTick as the task finished */
+
+    /* Warm start: the snapshot to take everything from if the image still
+     * hashes to its key (NULL for none), and the key of what was loaded. */
+    const PldSnapHeader *snap;
+    bool           from_snap;
+    PldSnapKey     key;
+} SessionLoad;
+
 typedef struct {
     /* Core data (owned, may be replaced by restore/reset) */
     PldFile        pld;
     PldSessionLog  sessions;
+    PldAgg        *agg;         /* per-title aggregates of sessions */
+    PldIndex      *index;       /* per-summary session ranges */
+
+    /* Pending startup load, NULL once adopted.  Until then sessions is
+     * empty, agg and index belong to the load, and pld holds only what the
+     * NAND summary table says. */
+    SessionLoad   *load;
+    Result         load_rc;     /* result of the adopted load */
+    bool           data_changed; /* by app_ctx_data_changed since */
 
     /* User preferences (persisted to SD) */
     AppSettings    settings;
@@ -55,3 +84,42 @@ typedef struct {
  * selection/scroll/animation state to zero.
  */
 void app_ctx_rebuild(AppCtx *ctx);
+
+/*
+ * Call after pld/sessions were loaded, merged or replaced: rebuilds the
+ * per-title session index, then app_ctx_rebuild, and sets data_changed.
+ */
+void app_ctx_data_changed(AppCtx *ctx);
+
+/*
+ * Adopt the startup load if it has finished, without blocking: its pld and
+ * sessions replace ctx's, and the view is rebuilt with the selection kept
+ * on the same title.  Returns true if this call adopted it.
+ */
+bool app_ctx_poll_sessions(AppCtx *ctx);
+
+/*
+ * For anything that reads sessions or writes pld data (detail view,
+ * export, sync, backup, restore, reset, settings): waits for the startup
+ * load, with a spinner only if it is still running, and adopts it.
+ * Returns false, with status_msg saying so, if the load failed.
+ */
+bool app_ctx_need_sessions(AppCtx *ctx);
+
+/* The list and ranking app_ctx_rebuild produced, as summary slots, and a
+ * hash of everything it depended on; kept in the warm-start snapshot. */
+typedef struct {
+    u64 inputs;
+    s32 n;
+    s32 rank_count;
+    s16 valid[PLD_SUMMARY_COUNT];
+    s16 ranked[RANK_MAX];
+    u32 rank_metric[RANK_MAX];
+} AppViewSnap;
+
+void app_ctx_save_view(const AppCtx *ctx, AppViewSnap *out);
+
+/* app_ctx_rebuild from a saved view, if it was built from the same pld,
+ * settings, filters, hidden list and names as ctx has now.  Returns false,
+ * leaving ctx untouched, if not. */
+bool app_ctx_restore_view(AppCtx *ctx, const AppViewSnap *snap);
@@ -4,9 +4,10 @@
 
 typedef struct {
     const PldFile       *pld;
-    const PldSessionLog *sessions;
+    const PldIndex      *index;
     Result               rc;
 } ExportArgs;
 
-Result export_data(const PldFile *pld, const PldSessionLog *sessions);
+/* index must be built over pld (see app_ctx_data_changed). */
+Result export_data(const PldFile *pld, const PldIndex *index);
 void   export_work(void *raw);
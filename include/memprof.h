@@ -0,0 +1,91 @@
+#pragma once
+
+/*
+ * memprof.h — optional allocation profiler
+ *
+ * Build with MEMPROF=1 (device: `make MEMPROF=1`, host: `make host-bench
+ * HOST_MEMPROF=1`, after a clean) to define PLD_MEMPROF.  The MEM_* macros
+ * below then route the big allocations of each subsystem through
+ * memprof.c, which keeps current and peak bytes per subsystem and per
+ * call site (file:line); MEM_REPORT writes them as JSON.  Without the flag
+ * the macros are the plain allocator calls.
+ *
+ * Blocks are found again by address, so alignment is untouched and a free
+ * of an untracked block is simply passed on.  Memory another library
+ * allocates for us (C3D_TexInit's linearAlloc) is recorded with MEM_NOTE
+ * and dropped with MEM_FORGET.
+ */
+
+#include "pld_types.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#define MEMPROF_PATH    "sdmc:/3ds/activity-log-pp/mem.json"
+#define MEMPROF_SITES   64      /* call sites; later ones share "other" */
+#define MEMPROF_BLOCKS  1024    /* live tracked blocks                 */
+
+typedef enum {
+    MEM_PLD,      /* logs, operation arenas, scratch spills        */
+    MEM_NET,      /* SOC buffer                                    */
+    MEM_ICON,     /* cover fetch and decode buffers, tile staging  */
+    MEM_TEX,      /* icon textures (linear memory)                 */
+    MEM_AUDIO,    /* MP3 data and NDSP buffers (linear memory)     */
+    MEM_SUB_COUNT
+} MemSub;
+
+typedef struct {
+    u64 cur;      /* bytes live now                  */
+    u64 peak;     /* high-water mark of cur          */
+    u32 allocs;   /* allocations made over the run   */
+} MemStat;
+
+void *memprof_malloc(MemSub sub, const char *site, size_t n);
+void *memprof_calloc(MemSub sub, const char *site, size_t n, size_t size);
+void *memprof_realloc(MemSub sub, const char *site, void *p, size_t n);
+void  memprof_free(void *p);
+#ifdef __3DS__
+void *memprof_memalign(MemSub sub, const char *site, size_t align, size_t n);
+void *memprof_linear_alloc(MemSub sub, const char *site, size_t n);
+void  memprof_linear_free(void *p);
+#endif
+
+/* Record n bytes at p allocated elsewhere, or stop tracking p. */
+void  memprof_note(MemSub sub, const char *site, const void *p, size_t n);
+void  memprof_forget(const void *p);
+
+/* Figures so far.  memprof_site_stat returns false for an unknown site. */
+void  memprof_sub_stat(MemSub sub, MemStat *out);
+bool  memprof_site_stat(const char *site, MemStat *out);
+
+/* Write the JSON report to path, or to stdout if path is NULL. */
+bool  memprof_report(const char *path);
+
+#ifdef PLD_MEMPROF
+#define MEM_STR2(x)  #x
+#define MEM_STR(x)   MEM_STR2(x)
+#define MEM_SITE     __FILE__ ":" MEM_STR(__LINE__)
+
+#define MEM_MALLOC(sub, n)          memprof_malloc((sub), MEM_SITE, (n))
+#define MEM_CALLOC(sub, n, size)    memprof_calloc((sub), MEM_SITE, (n), (size))
+#define MEM_REALLOC(sub, p, n)      memprof_realloc((sub), MEM_SITE, (p), (n))
+#define MEM_FREE(p)                 memprof_free(p)
+#define MEM_MEMALIGN(sub, a, n)     memprof_memalign((sub), MEM_SITE, (a), (n))
+#define MEM_LINEAR_ALLOC(sub, n)    memprof_linear_alloc((sub), MEM_SITE, (n))
+#define MEM_LINEAR_FREE(p)          memprof_linear_free(p)
+#define MEM_NOTE(sub, p, n)         memprof_note((sub), MEM_SITE, (p), (n))
+#define MEM_FORGET(p)               memprof_forget(p)
+#define MEM_REPORT(path)            ((void)memprof_report(path))
+#else
+#define MEM_MALLOC(sub, n)          malloc(n)
+#define MEM_CALLOC(sub, n, size)    calloc((n), (size))
+#define MEM_REALLOC(sub, p, n)      realloc((p), (n))
+#define MEM_FREE(p)                 free(p)
+#define MEM_MEMALIGN(sub, a, n)     memalign((a), (n))
+#define MEM_LINEAR_ALLOC(sub, n)    linearAlloc(n)
+#define MEM_LINEAR_FREE(p)          linearFree(p)
+#define MEM_NOTE(sub, p, n)         ((void)0)
+#define MEM_FORGET(p)               ((void)0)
+#define MEM_REPORT(path)            ((void)0)
+#endif
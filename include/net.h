@@ -5,14 +5,14 @@
 
 #define NET_TCP_PORT     12345
 #define NET_UDP_PORT     12346
-#define NET_MAGIC        0x504C4453u   /* "PLDS" */
 #define NET_SOC_BUF_SIZE 0x100000      /* 1 MiB  */
 
 typedef enum { NET_ROLE_HOST, NET_ROLE_CLIENT } NetRole;
 
 typedef enum {
     NET_STATE_WAITING,    /* host: broadcasting + waiting for TCP connect */
-    NET_STATE_SCANNING,   /* client: waiting for UDP broadcast            */
+    NET_STATE_SCANNING,   /* client: waiting for UDP broadcast, connecting,
+                             or backing off after a failed attempt     */
     NET_STATE_CONNECTED,
     NET_STATE_ERROR,
 } NetState;
@@ -20,29 +20,28 @@ typedef enum {
 typedef struct {
     NetRole  role;
     NetState state;
-    int      tcp_sock;    /* established data socket; -1 = none  */
-    int      listen_sock; /* host only: server socket; -1 = none */
-    int      udp_sock;    /* discovery socket; -1 = none         */
+    PldLink  link;        /* discovery and connection; once CONNECTED,
+                             link.tcp is the data socket and link.codec
+                             the PLD_CODEC_* both ends read (0: raw)   */
     char     peer_ip[16]; /* dotted-decimal IP of remote peer    */
     char     own_ip[16];  /* dotted-decimal IP of this device    */
-    int      bcast_timer; /* frames since last UDP broadcast     */
 } NetCtx;
 
 Result net_init(NetCtx *ctx, NetRole role);
-void   net_tick(NetCtx *ctx);   /* call once per frame */
+void   net_tick(NetCtx *ctx);   /* call once per frame; never blocks */
 void   net_shutdown(NetCtx *ctx);
 
-/* Transfer local sessions to peer and receive+merge peer's sessions into *local.
- * *new_count_out receives the number of unique sessions added from the peer.
- * Returns 0 on success, -1 on I/O error or buffer overflow. */
-int net_exchange_sessions(NetCtx *ctx, PldSessionLog *local, int *new_count_out);
-
-/* Transfer local summaries to peer and receive+merge peer's summaries into *local.
- * *new_count_out receives the number of new titles added from the peer.
- * Returns 0 on success, -1 on I/O error or table overflow. */
-int net_exchange_summaries(NetCtx *ctx, PldFile *local, int *new_count_out);
-
-/* Exchange title name databases with the peer; new names are merged into the
- * in-memory title_names store on both devices.
- * Returns 0 on success, -1 on I/O error. */
-int net_exchange_title_names(NetCtx *ctx);
+/* Sync with the peer in one pass over the connection: sessions are
+ * reconciled (pld_recon_exchange) and the ones the peer sends merged into
+ * *local, so both logs end up the same; the peer's app list is merged into
+ * pld's summaries and its title names into the in-memory title_names store.
+ * Sessions and names travel encoded with ctx->link.codec when it is
+ * non-zero.
+ * *new_sess_out / *new_apps_out receive the sessions and titles added.
+ * agg, if non-NULL, is kept in step with the merge (see pld_merge_sessions_agg).
+ * Returns 0 on success, -1 on I/O error or summary table overflow, or -2
+ * if *local filled up: what the sync merged, and the peer's sessions that
+ * did not fit, are folded into merged2.dat (PLD_EXT_PATH) instead, and
+ * *local, agg, summaries and names are left as they were. */
+int net_exchange(NetCtx *ctx, PldFile *pld, PldSessionLog *local, PldAgg *agg,
+                 int *new_sess_out, int *new_apps_out);
@@ -1,6 +1,7 @@
 #pragma once
 
-#include <3ds.h>
+#include "pld_types.h"
+#include "pld_storage.h"
 #include <stdbool.h>
 #include <stddef.h>
 
@@ -16,6 +17,10 @@
  *
  * All multi-byte fields are little-endian.
  * Epoch: seconds / days since 2000-01-01 00:00:00 UTC.
+ *
+ * Everything outside the __3DS__ blocks is portable (pld_core.c) and is
+ * also built on the host by `make host-bench`.  The libctru glue for the
+ * NAND save archive lives in pld.c.
  */
 
 /* ── File layout constants ──────────────────────────────────────── */
@@ -68,16 +73,43 @@ typedef struct {
     PldHeader  header;
     PldSummary summaries[PLD_SUMMARY_COUNT];
     int        summary_count;   /* number of non-empty entries             */
+    u64        image_hash;      /* pld_hash64 of the image this was loaded
+                                   from (pld_load_all); 0 if built in memory */
 } PldFile;
 
+/* In-memory session record: a PldSession whose title_id is replaced by an
+ * index into the owning log's title dictionary.  Logs reference a few
+ * hundred titles at most and play_secs never exceeds 3600, so this halves
+ * the resident log; PldSession remains the file and wire format. */
+typedef struct {
+    u32 timestamp;  /* as PldSession                                       */
+    u16 title;      /* index into PldSessionLog.titles->ids                */
+    u16 play_secs;  /* as PldSession (larger values saturate at 0xFFFF)    */
+} PldRec;           /* 8 bytes */
+
+#define PLD_TITLE_MAX  2048     /* distinct titles one log can reference */
+
+/* Title dictionary, kept sorted by title_id so that (title, timestamp)
+ * order on PldRec is (title_id, timestamp) order on PldSession. */
+typedef struct {
+    u64 ids[PLD_TITLE_MAX];
+    int count;
+} PldTitleDict;
+
+/* Bytes behind PldSessionLog.entries: PLD_SESSION_COUNT records, then the
+ * dictionary, in one allocation. */
+#define PLD_LOG_BYTES  (PLD_SESSION_COUNT * sizeof(PldRec) + sizeof(PldTitleDict))
+
 /* Compacted in-memory session log (only valid, non-empty entries) */
 typedef struct {
-    PldSession *entries;  /* malloc'd; entries[0..count-1] are valid */
-    int         count;    /* number of valid sessions                */
+    PldRec       *entries;  /* malloc'd (PLD_LOG_BYTES); [0..count-1] valid */
+    int           count;    /* number of valid sessions                     */
+    PldTitleDict *titles;   /* inside the entries allocation                */
 } PldSessionLog;
 
 /* ── API ────────────────────────────────────────────────────────── */
 
+#ifdef __3DS__
 /**
  * Open the Activity Log system save archive.
  * save_id: one of ACTIVITY_SAVE_ID_* for the target region.
@@ -92,28 +124,247 @@ Result pld_open_archive(FS_Archive *archive_out, u32 save_id);
  */
 Result pld_read_summary(FS_Archive archive, PldFile *out);
 
+Result pld_read_sessions(FS_Archive archive, PldSessionLog *out);
+
+/**
+ * Fused loader: open /pld.dat once, read all PLD_FILE_SIZE bytes in a single
+ * request and parse header, summary table and session log from that buffer.
+ * Equivalent to pld_read_summary + pld_read_sessions with half the opens and
+ * no second 800 KB allocation.
+ */
+Result pld_read_all(FS_Archive archive, PldFile *pld_out,
+                    PldSessionLog *sessions_out);
+
+/* pld_read_all, unless the image hashes to skip_hash (pld_load_all_unless). */
+Result pld_read_all_unless(FS_Archive archive, u64 skip_hash, PldFile *pld_out,
+                           PldSessionLog *sessions_out);
+#endif
+
+/* Storage-level equivalents of pld_read_summary / pld_read_sessions, used by
+ * both the NAND wrappers above and the SD readers below. */
+Result pld_load_summary(PldStorage *st, PldFile *out);
+Result pld_load_sessions(PldStorage *st, PldSessionLog *out);
+
+/* Storage-level pld_read_all: one PLD_FILE_SIZE read, then pld_parse_image. */
+Result pld_load_all(PldStorage *st, PldFile *pld_out,
+                    PldSessionLog *sessions_out);
+
+/* pld_load_all, except that an image hashing to skip_hash (non-zero) is
+ * not parsed: returns PLD_RC_UNCHANGED with *sessions_out empty and only
+ * pld_out->image_hash set.  For callers holding what that image parses
+ * to already (the warm-start snapshot). */
+Result pld_load_all_unless(PldStorage *st, u64 skip_hash, PldFile *pld_out,
+                           PldSessionLog *sessions_out);
+
+/* Parse a full PLD_FILE_SIZE image in place.  Header and summaries are copied
+ * out first, then live sessions are compacted and packed to the front of the
+ * same buffer, which is shrunk to PLD_LOG_BYTES and becomes
+ * sessions_out->entries.  An image from pld_scratch_alloc is packed into a
+ * pld_log_alloc block instead and released.  Takes ownership of the image
+ * (freed on failure); free the log via pld_sessions_free. */
+Result pld_parse_image(u8 *image, PldFile *pld_out,
+                       PldSessionLog *sessions_out);
+
+/* Serialize header + sessions (expanded to 50000 slots) + summaries into a
+ * PLD_FILE_SIZE image from pld_scratch_alloc; release it with
+ * pld_scratch_free.  Returns NULL on OOM. */
+u8    *pld_build_image(const PldFile *pld, const PldSessionLog *sessions);
+
+/* pld_build_image, then write the image at offset 0 of st. */
+Result pld_store_image(PldStorage *st, const PldFile *pld,
+                       const PldSessionLog *sessions);
+
 /**
  * Return true if the summary record is an empty (unused) slot.
  */
 bool pld_summary_is_empty(const PldSummary *s);
 
 bool   pld_session_is_empty(const PldSession *s);
-Result pld_read_sessions(FS_Archive archive, PldSessionLog *out);
 void   pld_sessions_free(PldSessionLog *log);
-int    pld_count_sessions_for(const PldSessionLog *log, u64 title_id);
+
+/* ── Packed session encoding (pld_pack.c) ─────────────────────── */
+
+/* Allocate an empty log with PLD_SESSION_COUNT slots.  Returns false on OOM. */
+bool   pld_log_alloc(PldSessionLog *log);
+
+/* Point entries/titles into a PLD_LOG_BYTES block (e.g. after realloc). */
+void   pld_log_attach(PldSessionLog *log, void *block);
+
+/* Replace the contents of an allocated log with src[0..n-1] (any order).
+ * src may be the log's own block, holding PldSessions from offset 0: each
+ * record is packed no further ahead than it is read.  Returns 0, or -1 if
+ * src references more than PLD_TITLE_MAX titles (the log is left empty). */
+Result pld_log_pack(PldSessionLog *log, const PldSession *src, int n);
+
+/* Pack src[0..n-1] (any order) against the log's dictionary into
+ * out[0..n-1], skipping empty slots; titles the log hasn't seen are added
+ * first in one renumbering pass.  The log's records are not moved.  Returns
+ * the packed count, or -1 if the dictionary would overflow or scratch
+ * memory runs out. */
+int    pld_log_pack_into(PldSessionLog *log, const PldSession *src, int n,
+                         PldRec *out);
+
+/* Write the log's records as PldSessions to dst[0..count-1]. */
+void   pld_log_unpack(const PldSessionLog *log, PldSession *dst);
+
+/* Dictionary position of title_id, or -1. */
+int    pld_title_find(const PldTitleDict *d, u64 title_id);
+
+/* Insert title_id if missing and return its position (-1 when full).  An
+ * insertion shifts every later position up by one; the caller renumbers
+ * its records (see pld_log_add_titles for the batched form). */
+int    pld_title_insert(PldTitleDict *d, u64 title_id);
+
+/* Add every id in ids[0..n-1] (any order, duplicates allowed) missing from
+ * the log's dictionary and renumber its records in one pass.  Returns false
+ * if the dictionary would overflow; the log is unchanged then. */
+bool   pld_log_add_titles(PldSessionLog *log, const u64 *ids, int n);
+
+static inline u64 pld_rec_title_id(const PldSessionLog *log, const PldRec *r)
+{
+    return log->titles->ids[r->title];
+}
+
+static inline void pld_rec_unpack(const PldSessionLog *log, const PldRec *r,
+                                  PldSession *out)
+{
+    out->title_id  = log->titles->ids[r->title];
+    out->timestamp = r->timestamp;
+    out->play_secs = r->play_secs;
+}
+
+/* Move the non-empty records of buf[0..n-1] to the front, preserving order.
+ * Returns the number of records kept.  Skips padding in blocks and moves
+ * live runs with memmove (see pld_compact.c). */
+int    pld_compact_sessions(PldSession *buf, int n);
+
+/* Same, reading src[0..n-1] and writing live records to dst.  dst may alias
+ * src or sit anywhere before it (e.g. compacting an image's session table
+ * down to the start of the image). */
+int    pld_compact_sessions_to(PldSession *dst, const PldSession *src, int n);
+
+/* Scalar one-record-at-a-time compaction; reference for differential tests. */
+int    pld_compact_sessions_ref(PldSession *buf, int n);
+
+/* Write live[0..count-1] to the front of a PLD_SESSION_COUNT-slot table and
+ * fill the remaining slots with the 0xFF empty marker.  live may alias table. */
+void   pld_expand_sessions(PldSession *table, const PldSession *live, int count);
 
 /* Compute the longest streak of consecutive calendar days played for one title.
- * indices[0..count-1] are indexes into sessions->entries, sorted descending by timestamp.
- * Returns 0 if count==0, else >= 1. */
-int    pld_longest_streak(const PldSessionLog *sessions,
-                          const int *indices, int count);
+ * recs[0..count-1] are that title's sessions, sorted ascending by timestamp
+ * (a pld_index_range).  Returns 0 if count==0, else >= 1. */
+int    pld_longest_streak(const PldRec *recs, int count);
+
+#define PLD_AGG_MAX        PLD_TITLE_MAX   /* distinct titles tracked: any log */
+#define PLD_AGG_HASH_BITS  12              /* table at most half full */
+#define PLD_AGG_HASH_SIZE  (1 << PLD_AGG_HASH_BITS)
+
+typedef struct {
+    u64 title_id;
+    u32 total_secs;   /* sum of play_secs                           */
+    u32 sessions;     /* number of hour records                     */
+    u32 first_ts;     /* earliest hour played (seconds since 2000)  */
+    u32 last_ts;      /* latest hour played                         */
+    u32 days;         /* distinct calendar days with play           */
+} PldTitleAgg;
+
+/* One-pass aggregate of a PldSessionLog, keyed by title_id.  Built with
+ * pld_agg_build, then kept current by merges that are handed the aggregate
+ * (pld_merge_sessions_agg and friends).  A merge that can't keep it exact
+ * clears `valid`; pld_agg_refresh rebuilds it in that case. */
+typedef struct {
+    PldTitleAgg titles[PLD_AGG_MAX];
+    s16         hash[PLD_AGG_HASH_SIZE];    /* slot index or -1          */
+    int         count;
+    bool        valid;
+    bool        overflow;   /* more than PLD_AGG_MAX titles; extras dropped,
+                               totals of missing titles unknown  */
+} PldAgg;
+
+/* reset empties it; build aggregates a whole log in one pass; refresh
+ * rebuilds only if a merge invalidated it.  find returns NULL for titles
+ * with no sessions. */
+void pld_agg_reset(PldAgg *agg);
+void pld_agg_build(PldAgg *agg, const PldSessionLog *log);
+void pld_agg_refresh(PldAgg *agg, const PldSessionLog *log);
+const PldTitleAgg *pld_agg_find(const PldAgg *agg, u64 title_id);
+
+/* Incremental updates.  pld_agg_add folds in a newly inserted record;
+ * new_day is false if a neighbour in the sorted log already covers its
+ * title and calendar day.  pld_agg_adjust applies a change in play_secs to
+ * an existing record. */
+void pld_agg_add(PldAgg *agg, const PldSession *s, bool new_day);
+void pld_agg_adjust(PldAgg *agg, u64 title_id, s32 delta_secs);
 
-/* Merge remote sessions into *local in-place.
+/* Set total_secs of every live summary from the aggregate (0 if the title
+ * has no sessions; left as it is if the aggregate overflowed without it). */
+void pld_agg_apply_totals(const PldAgg *agg, PldFile *pld);
+
+/* Merge remote sessions remote[0..remote_count-1] into *local in-place (see
+ * pld_merge.c).
  * Matching (title_id, timestamp): sum play_secs, cap at 3600 (unless add_only).
- * add_only=true: skip summing for existing entries; only append new ones.
- * Unique remote records are appended to the pre-allocated buffer.
- * Returns number of new records appended, or -1 if buffer would overflow. */
-int pld_merge_sessions(PldSessionLog *local, const PldSessionLog *remote, bool add_only);
+ * add_only=true: skip summing for existing entries; only insert new ones.
+ * The result is sorted by (title_id, timestamp).
+ * Returns number of new records added, or -1 if the log or its title
+ * dictionary would overflow. */
+int pld_merge_sessions(PldSessionLog *local, const PldSession *remote,
+                       int remote_count, bool add_only);
+
+/* pld_merge_sessions that also keeps *agg (built over *local, may be NULL)
+ * current for every record it inserts or sums into. */
+int pld_merge_sessions_agg(PldSessionLog *local, const PldSession *remote,
+                           int remote_count, bool add_only, PldAgg *agg);
+
+/* Partitioned form of pld_merge_sessions over up to `threads` threads
+ * (capped at PLD_PAR_MAX).  The remote side is packed, both sides are cut
+ * into title ranges of about equal record count, and each range is sorted
+ * and merge-joined into its own slice of one output buffer, so the slices
+ * concatenate without a re-sort.  Same result and return value as
+ * pld_merge_sessions; on overflow the log keeps its own records.  For
+ * callers holding a whole remote table of PLD_PAR_MIN_RECS or more; the
+ * app's startup and sync merges stream theirs and stay serial. */
+int pld_merge_sessions_par(PldSessionLog *local, const PldSession *remote,
+                           int remote_count, bool add_only, int threads);
+
+/* True if entries[0..n-1] are in strictly ascending (title, timestamp)
+ * order, i.e. sorted with no duplicate keys. */
+bool pld_sessions_sorted(const PldRec *entries, int n);
+
+/* Sort a log by (title_id, timestamp).  No-op if already sorted; radix
+ * sorts in the log's own tail when it is at most half full, else in a
+ * temporary buffer. */
+void pld_sort_sessions(PldSessionLog *log);
+
+/* Incremental form of pld_merge_sessions for remote records that arrive in
+ * pieces (views, network chunks).  Records pushed in ascending key order are
+ * merge-joined in one linear pass; an out-of-order record switches the rest
+ * of the merge to binary search + append + final sort.  *local must not be
+ * read between begin and end. */
+typedef struct {
+    PldSessionLog *local;
+    PldAgg        *agg;         /* optional, see pld_merge_sessions_agg */
+    bool           add_only;
+    bool           fallback;    /* remote went out of order             */
+    bool           have_last;
+    PldRec         last;        /* previous pushed remote record        */
+    int            w;           /* output cursor                        */
+    int            r;           /* local read cursor (tail of buffer)   */
+    int            sorted;      /* fallback: length of sorted prefix    */
+    int            last_title;  /* dictionary hit cache, -1 if none     */
+    int            added;
+    int            rc;          /* -1 once the log or dictionary would
+                                   overflow                             */
+} PldMerger;
+
+void pld_merger_begin(PldMerger *m, PldSessionLog *local, bool add_only,
+                      PldAgg *agg);
+void pld_merger_push(PldMerger *m, const PldSession *recs, int n);
+/* Returns number of new records added, or -1 on overflow.  On overflow the
+ * log still holds every local record plus the remote ones merged so far.
+ * Titles the log hasn't seen are added to its dictionary as they arrive;
+ * callers that know the remote titles up front can pld_log_add_titles them
+ * first to renumber once instead of once per title. */
+int  pld_merger_end(PldMerger *m);
 
 /* Merge remote compact summary array into local->summaries in-place.
  * Matching title_id: sum total_secs and launch_count (capped at UINT16_MAX),
@@ -123,52 +374,1040 @@ int pld_merge_sessions(PldSessionLog *local, const PldSessionLog *remote, bool a
  * Returns number of new titles added, or -1 if summary table is full. */
 int pld_merge_summaries(PldFile *local, const PldSummary *remote, int remote_count, bool add_only);
 
-/* Read a merged.dat from SD into *pld_out and *sessions_out.
- * sessions_out->entries is malloc'd (PLD_SESSION_COUNT capacity, compacted).
+/* Read a merged.dat from SD into *pld_out and *sessions_out (fused single
+ * read, see pld_load_all).
+ * sessions_out->entries is malloc'd (PLD_LOG_BYTES, compacted and packed).
  * Returns 0 on success, non-zero on I/O failure. */
 Result pld_read_sd(const char *path, PldFile *pld_out, PldSessionLog *sessions_out);
 
-/* Write header + sessions (expanded to 50000 slots) + summaries to SD path.
- * Returns 0 on success, non-zero on I/O failure. */
+/* Write header + sessions (expanded to 50000 slots) + summaries to SD path,
+ * and its hash sidecar.  If the sidecar shows the file already holds exactly
+ * this image, nothing is written and PLD_RC_UNCHANGED is returned.
+ * Returns 0 on success, negative on I/O failure. */
 Result pld_write_sd(const char *path, const PldFile *pld,
                     const PldSessionLog *sessions);
 
+/* pld_write_sd for merged.dat after the startup merge: the sidecar also
+ * records nand_hash (PldFile.image_hash of the NAND image merged in) and
+ * whether the file holds nothing beyond that image (see
+ * pld_sd_matches_nand). */
+Result pld_write_sd_merged(const char *path, const PldFile *pld,
+                           const PldSessionLog *sessions, u64 nand_hash,
+                           bool nand_only);
+
 /* Read src_path (must be PLD_FILE_SIZE bytes) and write a new timestamped
- * backup; prunes oldest if over PLD_MAX_BACKUPS. */
+ * backup; prunes oldest if over PLD_MAX_BACKUPS.  Returns PLD_RC_UNCHANGED
+ * without copying if the newest backup already holds the same image; when
+ * src_path has a current sidecar that is decided without reading it. */
 Result pld_backup_from_path(const char *src_path);
 
+#ifdef __3DS__
 /* Expand compacted sessions back to the full 50000-slot array, combine with
  * the updated header and summary table, and write all 806160 bytes to NAND.
  * Empty session slots are filled with the 0xFF empty marker.
  * Returns 0 on success, non-zero on I/O failure. */
 Result pld_write_pld(FS_Archive archive, const PldFile *pld,
                      const PldSessionLog *sessions);
+#endif
+
+/* ── Read-only views ────────────────────────────────────────────── */
+
+/*
+ * A PldView walks the live sessions and summaries of a pld image without
+ * materialising the 800 KB session table.  File-backed views page the image
+ * through a PLD_VIEW_WINDOW-byte buffer; buffer-backed views read straight
+ * out of a caller-provided PLD_FILE_SIZE image.  Cursors only move forward.
+ */
+
+#define PLD_VIEW_WINDOW  4096u   /* 256 session records per refill */
+
+typedef struct PldJournal PldJournal;
+
+typedef struct {
+    PldStorage  st;            /* file-backed views only                  */
+    const u8   *image;         /* buffer-backed views: caller's image     */
+    u8         *window;        /* file-backed views: malloc'd page buffer */
+    u32         win_off;       /* image offset of window[0]               */
+    u32         win_len;       /* valid bytes in window                   */
+    int         next_session;  /* slot cursor into the session table      */
+    int         next_summary;  /* slot cursor into the summary table      */
+    Result      rc;            /* first I/O error, 0 while healthy        */
+    PldHeader   header;
+    /* Journal overlay (pld_view_set_overlay), NULL if none */
+    const PldJournal *overlay;
+    int         ov_session;    /* next journal session to interleave      */
+    int         ov_summary;    /* next journal summary to check at the end */
+    bool        ov_have;       /* ov_pending holds a look-ahead record    */
+    PldSession  ov_pending;
+    u32         ov_used[PLD_SUMMARY_COUNT / 32];  /* summaries emitted   */
+} PldView;
+
+/* Open a file-backed view over an SD image.  Only the header is read here.
+ * Returns 0 on success, non-zero if the file can't be opened or read. */
+Result pld_view_open(PldView *v, const char *path);
+
+/* Wrap a caller-owned PLD_FILE_SIZE image; nothing is copied or allocated.
+ * The image must outlive the view. */
+void   pld_view_from_image(PldView *v, const u8 *image);
+
+/* Release the window and file handle (no-op for buffer-backed views). */
+void   pld_view_close(PldView *v);
+
+/* Copy the next live session / summary into *out.  Returns false at the end
+ * of the table or on I/O error; v->rc tells the two apart. */
+bool   pld_view_next_session(PldView *v, PldSession *out);
+bool   pld_view_next_summary(PldView *v, PldSummary *out);
+
+/* Restart the session or summary cursor at slot 0. */
+void   pld_view_rewind(PldView *v);
+
+/* Show the view's image with a journal replayed on top: journal sessions
+ * and summaries replace the image's records with the same key and the rest
+ * are added (sessions in key order, summaries after the image's).  The
+ * journal must outlive the view.  Call before the first read. */
+void   pld_view_set_overlay(PldView *v, const PldJournal *j);
+
+/* pld_merge_sessions_agg / pld_merge_summaries with the remote side streamed
+ * from a view.  Same return values; I/O errors on the view also return -1. */
+int    pld_merge_sessions_view(PldSessionLog *local, PldView *remote,
+                               bool add_only, PldAgg *agg);
+int    pld_merge_summaries_view(PldFile *local, PldView *remote,
+                                bool add_only);
+
+/* ── Many-way merge (pld_kmerge.c) ──────────────────────────────── */
+
+/* Files merged per pass (plus the log itself); bounds open files and
+ * scratch runs. */
+#define PLD_MERGE_FANIN  16
+
+/* Bytes of sorted inputs a pass keeps in memory by default; a pass ends
+ * before the inputs it holds could pass it. */
+#define PLD_MERGE_MEM    (2u << 20)
+
+/* Merge the SD images at paths[0..n-1] (merged.dat, raw or container
+ * backups) into *local_pld and *local: the same result as
+ * pld_merge_sessions and pld_merge_summaries applied once per path in
+ * order.  Inputs are loaded and sorted (unless already in key order) in
+ * passes of up to PLD_MERGE_FANIN - 1 paths, or fewer when the memory
+ * budget fills first, and each is merge-joined into the log over packed
+ * records.  An input that would not fit the budget even alone is streamed
+ * instead, a raw image in key order through a PldView and anything else
+ * from a temporary file in scratch_dir, and its pass becomes a tree of
+ * merge-joins over all its streams.  *local is left sorted (its block may
+ * be swapped for another PLD_LOG_BYTES block); rebuild any PldAgg over it
+ * afterwards.  Returns the number of sessions added, or -1 on I/O error or
+ * overflow, with *local and *local_pld partly merged. */
+int    pld_merge_many(PldFile *local_pld, PldSessionLog *local,
+                      const char *const *paths, int n, bool add_only,
+                      const char *scratch_dir);
+
+/* Memory budget of a pld_merge_many pass in bytes; PLD_MERGE_MEM until
+ * set, 0 restores it. */
+void   pld_merge_set_mem(u32 bytes);
+u32    pld_merge_get_mem(void);
+
+/* ── Per-title session index ────────────────────────────────────── */
+
+/*
+ * Compressed-sparse-row index over a (title_id, timestamp)-sorted session
+ * log: summary slot i owns entries[begin[i] .. begin[i] + count[i]), oldest
+ * first.  Building costs a dictionary lookup and two binary searches per
+ * live summary; the log itself is the column array, so nothing is copied.
+ * Rebuild after anything that replaces or merges into the log or the
+ * summary table.
+ */
+typedef struct {
+    const PldRec     *entries;
+    s32               begin[PLD_SUMMARY_COUNT];
+    s32               count[PLD_SUMMARY_COUNT];
+    bool              valid;
+} PldIndex;
+
+/* Sorts *log first if it is not already in key order. */
+void   pld_index_build(PldIndex *idx, const PldFile *pld, PldSessionLog *log);
+void   pld_index_invalidate(PldIndex *idx);
+void   pld_index_refresh(PldIndex *idx, const PldFile *pld, PldSessionLog *log);
+
+/* Sessions for summary slot `slot`, ascending by timestamp.  Returns the
+ * count and sets *out (NULL when the count is 0). */
+int    pld_index_range(const PldIndex *idx, int slot, const PldRec **out);
+
+/* ── Content hashing (pld_hash.c) ───────────────────────────────── */
+
+/* Success code for writes and backups skipped because the destination
+ * already holds the same image. */
+#define PLD_RC_UNCHANGED  ((Result)1)
+
+/* 64-bit non-cryptographic content hash (the xxHash64 algorithm). */
+u64    pld_hash64(const void *data, size_t len, u64 seed);
+
+/* CRC-32 (IEEE 802.3, as zlib).  Pass 0 to start, or a previous result to
+ * continue over more data. */
+u32    pld_crc32(const void *data, size_t len, u32 crc);
+
+#define PLD_SIDECAR_EXT        ".xxh"
+#define PLD_SIDECAR_MAGIC      0x48444C50u  /* "PLDH" */
+#define PLD_SIDECAR_NAND_ONLY  0x1u         /* file == NAND image nand_hash,
+                                               sorted, with totals applied */
+
+/* Hash sidecar stored next to an SD image as path + PLD_SIDECAR_EXT. */
+typedef struct {
+    u32       magic;        /* PLD_SIDECAR_MAGIC                        */
+    u32       flags;        /* PLD_SIDECAR_*                            */
+    u64       image_hash;   /* pld_hash64 of all PLD_FILE_SIZE bytes    */
+    u64       nand_hash;    /* NAND image last merged in, 0 if unknown  */
+    PldHeader header;       /* copy of the image's header               */
+} PldSidecar;               /* 40 bytes */
+
+/* Read / write / delete the sidecar of the image at path. */
+Result pld_sidecar_read(const char *path, PldSidecar *out);
+Result pld_sidecar_write(const char *path, const PldSidecar *sc);
+void   pld_sidecar_remove(const char *path);
+
+/* True if the image at path still looks like the one sc describes: it is
+ * PLD_FILE_SIZE bytes and starts with sc->header.  Reads only the header. */
+bool   pld_sidecar_current(const char *path, const PldSidecar *sc);
+
+/* True if the SD image at path is exactly what the startup merge makes of
+ * the NAND image with hash nand_hash alone, so the merge and rewrite can be
+ * skipped.  Costs a sidecar read and a header read. */
+bool   pld_sd_matches_nand(const char *path, u64 nand_hash);
 
 /* ── Backup / Restore ───────────────────────────────────────────── */
 
 #define PLD_BACKUP_DIR   "sdmc:/3ds/activity-log-pp"
 #define PLD_MERGED_PATH  "sdmc:/3ds/activity-log-pp/merged.dat"
-#define PLD_MAX_BACKUPS 10
-
-/* Filenames only (not full paths), sorted most-recent-first. */
-typedef struct {
-    char names[PLD_MAX_BACKUPS][32];
-    int  count;
-} PldBackupList;
+#define PLD_MAX_BACKUPS 10     /* default retention count */
 
+#ifdef __3DS__
 /* Write a new timestamped backup and prune oldest if over limit. */
 Result pld_backup(FS_Archive archive);
+#endif
+
+/* Write a full PLD_FILE_SIZE image as a new timestamped backup container,
+ * record it in the catalog and prune to the retention limits.  Returns
+ * PLD_RC_UNCHANGED instead if the newest backup already holds the same
+ * image.  Shared by pld_backup and pld_backup_from_path. */
+Result pld_backup_store(const u8 *image);
+
+/* pld_backup_store into dir, stamped with time now. */
+Result pld_backup_store_in(const char *dir, const u8 *image, u32 now);
+
+/* Backup container (pld_backup.c).  Backups are written as a fixed header
+ * followed by the image's session and summary tables with the 0xFF padding
+ * run-length coded and live records delta/varint coded; restoring expands
+ * them back to the identical PLD_FILE_SIZE image.  Backups from older
+ * versions are raw images and are still read. */
+#define PLD_BACKUP_MAGIC    0x42444C50u     /* "PLDB" */
+#define PLD_BACKUP_VERSION  1u
+
+typedef struct {
+    u32       magic;          /* PLD_BACKUP_MAGIC                          */
+    u16       version;        /* PLD_BACKUP_VERSION                        */
+    u16       header_size;    /* sizeof(PldBackupHeader)                   */
+    u64       image_hash;     /* pld_hash64 of the expanded image          */
+    u32       created;        /* time() when the backup was written        */
+    u32       session_count;  /* live sessions                             */
+    u16       app_count;      /* live summaries                            */
+    u16       title_count;    /* entries in the payload's title dictionary */
+    u32       payload_size;   /* bytes following this header               */
+    u32       payload_crc;    /* pld_crc32 of the payload                  */
+    u32       reserved;
+    PldHeader header;         /* the image's header                        */
+} PldBackupHeader;            /* 56 bytes */
+
+/* Encode a PLD_FILE_SIZE image into a malloc'd container (*out, *len),
+ * released with MEM_FREE (memprof.h).  Returns -1 on OOM or if the
+ * container would be no smaller than the image. */
+Result pld_backup_encode(const u8 *image, u32 created, u8 **out, u32 *len);
+
+/* Expand a container into image (PLD_FILE_SIZE bytes).  Returns -1 if it
+ * is malformed or doesn't hash to its header's image_hash. */
+Result pld_backup_decode(const u8 *buf, u32 len, u8 *image);
+
+/* Read just the container header of a backup file.  Returns -1 for raw
+ * (old-format) backups and unreadable files. */
+Result pld_backup_read_header(const char *path, PldBackupHeader *out);
 
-/* Populate *out with existing backup filenames, most-recent-first. */
-Result pld_list_backups(PldBackupList *out);
+/* Read a backup of either format into image (PLD_FILE_SIZE bytes). */
+Result pld_backup_load(const char *path, u8 *image);
+
+/* pld_read_sd for backups of either format. */
+Result pld_backup_read(const char *path, PldFile *pld_out,
+                       PldSessionLog *sessions_out);
 
 /* Read the app (summary) count from a backup file on SD without writing to
- * NAND.  Only the 6 144-byte summary table is read.  Sets *app_count on
- * success.  Returns 0 on success, non-zero on I/O failure. */
+ * NAND: from the container header, or for raw backups by paging the
+ * 6 144-byte summary table through a PldView.  Sets *app_count on success.  Returns 0 on success, non-zero on I/O failure. */
 Result pld_backup_app_count(const char *path, int *app_count);
 
+#ifdef __3DS__
 /* Restore from the given full SD path into the open archive. */
 Result pld_restore(FS_Archive archive, const char *path);
+#endif
+
+/* ── Backup catalog (pld_catalog.c) ─────────────────────────────── */
+
+/*
+ * backups.cat in the backup directory indexes every backup, newest first,
+ * so the restore chooser, dedup and pruning never open the backups
+ * themselves.  It is rewritten through a temporary on every backup and
+ * prune, and rebuilt from the directory if it is missing or damaged.
+ */
+#define PLD_CATALOG_NAME  "backups.cat"
+#define PLD_CATALOG_MAX   1000          /* entries; older backups are pruned */
+#define PLD_CATALOG_RAW   0x0001u       /* entry flag: raw 806 KB backup     */
+
+typedef struct {
+    char name[32];          /* filename in the backup directory       */
+    u64  image_hash;        /* pld_hash64 of the expanded image       */
+    u32  created;           /* time() when written                    */
+    u32  size;              /* bytes on SD                            */
+    u32  session_count;     /* live sessions                          */
+    u16  app_count;         /* live summaries                         */
+    u16  flags;             /* PLD_CATALOG_*                          */
+} PldBackupEntry;           /* 56 bytes */
+
+typedef struct {
+    PldBackupEntry *entries;        /* malloc'd, newest first */
+    int             count;
+    int             cap;
+    u64             total_bytes;    /* sum of entries[].size  */
+} PldCatalog;
+
+/* Retention limits applied after each backup.  The newest backup is
+ * always kept; max_bytes 0 means no size limit. */
+typedef struct {
+    int max_count;
+    u64 max_bytes;
+} PldRetention;
+
+/* Load dir's catalog, rebuilding (and saving) it from the directory if it
+ * is missing or damaged.  *out is valid (possibly empty) even on failure;
+ * release with pld_catalog_free. */
+Result pld_catalog_load(const char *dir, PldCatalog *out);
+
+/* Build a catalog by scanning dir, without reading or writing the
+ * catalog file. */
+Result pld_catalog_rebuild(const char *dir, PldCatalog *out);
+
+/* Replace dir's catalog with cat. */
+Result pld_catalog_save(const char *dir, const PldCatalog *cat);
+void   pld_catalog_free(PldCatalog *cat);
+
+/* Index of the entry named name, or -1. */
+int    pld_catalog_find(const PldCatalog *cat, const char *name);
+
+/* Add e in name order, replacing an entry of the same name. */
+Result pld_catalog_insert(PldCatalog *cat, const PldBackupEntry *e);
+
+/* Delete the backups (and sidecars) beyond the limits in r from dir and
+ * drop them from cat; the caller saves cat.  Returns the number removed. */
+int    pld_catalog_prune(const char *dir, PldCatalog *cat,
+                         const PldRetention *r);
+
+/* Fill e's session_count and app_count from a PLD_FILE_SIZE image. */
+void   pld_catalog_count(const u8 *image, PldBackupEntry *e);
+
+/* Retention used by pld_backup_store; defaults to PLD_MAX_BACKUPS and no
+ * size limit.  Takes effect at the next backup. */
+void   pld_backup_set_retention(const PldRetention *r);
+void   pld_backup_get_retention(PldRetention *out);
+
+/* ── Journaled merged.dat (pld_journal.c) ───────────────────────── */
+
+/*
+ * merged.dat is rewritten only at checkpoints.  In between, each commit
+ * appends the sessions and summaries that changed to merged.journal as
+ * CRC-protected records; readers replay the journal on top of the
+ * checkpoint.  An interrupted append is dropped on the next load, leaving
+ * the state of the previous commit.
+ */
+
+#define PLD_JOURNAL_PATH  "sdmc:/3ds/activity-log-pp/merged.journal"
+#define PLD_JOURNAL_MAX   (64u * 1024u)   /* checkpoint beyond this size */
+
+/* Committed journal contents, latest value per key. */
+struct PldJournal {
+    PldSession *sessions;       /* malloc'd, sorted by (title_id, timestamp) */
+    int         session_count;
+    PldSummary *summaries;      /* malloc'd, one per title_id               */
+    int         summary_count;
+    PldHeader   header;
+    bool        has_header;
+    int         commits;        /* 0: merged.dat alone is current           */
+    u32         bytes;          /* committed length of the journal file     */
+};
+
+/* Options and results for pld_journal_commit / pld_journal_checkpoint. */
+typedef struct {
+    u64  nand_hash;     /* passed to pld_write_sd_merged at a checkpoint   */
+    bool nand_only;
+    bool backup;        /* back up the persisted state before a checkpoint
+                           replaces it                                     */
+    bool checkpoint;    /* out: merged.dat was (re)written                 */
+    u32  written;       /* out: bytes written to SD                        */
+} PldCommit;
+
+/* Load the committed part of the journal at jnl_path.  A missing journal,
+ * or one left over from an older checkpoint of dat_path (it is removed),
+ * loads as empty.  Returns 0, or non-zero on OOM (*j is empty then).
+ * Free with pld_journal_free. */
+Result pld_journal_load(const char *dat_path, const char *jnl_path,
+                        PldJournal *j);
+void   pld_journal_free(PldJournal *j);
+
+/* Position of (title_id, timestamp) in j->sessions / of title_id in
+ * j->summaries, or -1. */
+int    pld_journal_find(const PldJournal *j, u64 title_id, u32 timestamp);
+int    pld_journal_find_summary(const PldJournal *j, u64 title_id);
+
+/* Replay j into a dataset loaded from its checkpoint.  Sorts *log.
+ * Returns 0, or -1 if the log or summary table would overflow. */
+Result pld_journal_apply(const PldJournal *j, PldFile *pld,
+                         PldSessionLog *log);
+
+/* pld_read_sd of the checkpoint with the journal applied. */
+Result pld_journal_read(const char *dat_path, const char *jnl_path,
+                        PldFile *pld_out, PldSessionLog *sessions_out);
+
+/* Persist *pld / *log, which replace the journaled dataset.  Only records
+ * that differ from it are appended; the dataset is checkpointed instead
+ * when the journal would pass PLD_JOURNAL_MAX, when a record was removed,
+ * or when there is no usable checkpoint.  Sorts *log.  Returns 0,
+ * PLD_RC_UNCHANGED if nothing differed, or negative on I/O failure.
+ * c may be NULL. */
+Result pld_journal_commit(const char *dat_path, const char *jnl_path,
+                          const PldFile *pld, PldSessionLog *log,
+                          PldCommit *c);
+
+/* Write *pld / *log as a new checkpoint and remove the journal (restore,
+ * reset).  Same return values as pld_write_sd. */
+Result pld_journal_checkpoint(const char *dat_path, const char *jnl_path,
+                              const PldFile *pld, const PldSessionLog *log,
+                              PldCommit *c);
+
+/* pld_backup_from_path of the journaled dataset: the checkpoint file when
+ * the journal is empty, else the replayed image. */
+Result pld_journal_backup(const char *dat_path, const char *jnl_path);
+
+/* Content hash of the journaled dataset: the checkpoint's image hash
+ * folded with the committed part of the journal.  The checkpoint hash comes
+ * from its sidecar, or with allow_read from reading merged.dat.  False if
+ * there is no checkpoint, or its hash needs a read that isn't allowed. */
+bool   pld_journal_state_hash(const char *dat_path, const char *jnl_path,
+                              bool allow_read, u64 *out);
+
+/* ── Operation arena (pld_arena.c) ──────────────────────────────── */
+
+/*
+ * One block reserved for the span of a flow that builds full images (the
+ * merged.dat checkpoint at startup, the restore point and commit of a
+ * sync), out of which the images are cut.  The block is released in one
+ * piece right after, so those 800 KB buffers stop leaving holes between
+ * the allocations that outlive the flow.  Images read in stay on the heap:
+ * there the image is shrunk into the log in place, where in the arena the
+ * log needs a block of its own beside it.
+ *
+ * pld_scratch_alloc takes from the current arena, or malloc when there is
+ * none or the request doesn't fit (counted in spills).  pld_scratch_free
+ * gives the space back when the block is the arena's newest, so the
+ * strictly nested temporaries of one flow reuse the same bytes; anything
+ * else in the arena waits for pld_arena_end.  Logs never live in the
+ * arena: images parsed from it are packed into a pld_log_alloc block.
+ *
+ * An arena is current only on the thread that began it; other threads'
+ * scratch allocations go to malloc meanwhile, and each thread may hold an
+ * arena of its own.
+ */
+
+#define PLD_ARENA_BYTES  (PLD_FILE_SIZE + 64u)    /* one image */
+
+typedef struct {
+    u8     *base;
+    size_t  cap;
+    size_t  used;
+    size_t  peak;     /* high-water mark of used, bytes                 */
+    u32     spills;   /* requests that fell back to malloc              */
+} PldArena;
+
+/* Reserve cap bytes and make a current on this thread.  Returns false,
+ * leaving nothing reserved, on OOM or when this thread already has an
+ * arena; scratch allocations then go wherever they went before. */
+bool   pld_arena_begin(PldArena *a, size_t cap);
+
+/* Release a's block and stop it being current.  peak and spills keep the
+ * operation's figures.  No-op if pld_arena_begin failed. */
+void   pld_arena_end(PldArena *a);
+
+/* This thread's current arena, or NULL. */
+const PldArena *pld_arena_current(void);
+
+/* True if p points into this thread's current arena. */
+bool   pld_scratch_owned(const void *p);
+
+void  *pld_scratch_alloc(size_t n);
+void   pld_scratch_free(void *p);
+
+/* ── Worker threads (pld_parallel.c) ────────────────────────────── */
+
+#define PLD_PAR_MAX       8        /* threads one merge is split across */
+#define PLD_PAR_MIN_RECS  8192     /* smallest merge worth splitting    */
+
+typedef void (*PldTaskFunc)(void *arg);
+
+/* Cores a merge can spread over: on device the app core and core 1, plus
+ * core 2 on New 3DS; on the host the online CPUs, capped at PLD_PAR_MAX. */
+int  pld_parallel_cores(void);
+
+/* Run func on each of the n records of arg_size bytes at args, the first
+ * on the calling thread and the rest on their own threads (inline if one
+ * can't be started), and return once all have finished. */
+void pld_run_parallel(PldTaskFunc func, void *args, size_t arg_size, int n);
+
+/* Completion fence around one background task, for work the UI can do
+ * without for a while (the startup session load).  pld_fence_start runs
+ * func(arg) on a thread of its own, below the caller's priority on device;
+ * pld_fence_ready tells without blocking whether it has returned, and once
+ * it says so everything func wrote is visible.  pld_fence_wait blocks until
+ * then and releases the thread; calling it again is harmless.  If no thread
+ * can be started, func runs inline and pld_fence_start returns false. */
+typedef struct {
+    PldTaskFunc func;
+    void       *arg;
+    bool        done;
+    void       *thread;     /* platform handle, NULL once released */
+} PldFence;
+
+bool pld_fence_start(PldFence *f, PldTaskFunc func, void *arg);
+bool pld_fence_ready(const PldFence *f);
+void pld_fence_wait(PldFence *f);
+
+/* ── Extended SD dataset (pld_ext.c) ────────────────────────────── */
+
+/*
+ * merged2.dat keeps the whole history on SD without the NAND layout's
+ * PLD_SESSION_COUNT / PLD_SUMMARY_COUNT caps:
+ *
+ *   PldExtHeader
+ *   summary_count × PldSummary    sorted by title_id
+ *   rollup_count × PldRollup      sorted by (title_id, start), see below
+ *   block_count × PldExtBlock     block index: key range, count, CRC
+ *   session blocks                PLD_EXT_BLOCK PldSessions each (the last
+ *                                 may be short), sorted by key throughout
+ *
+ * The index lets readers fetch a key range without touching the other
+ * blocks.  Files are replaced through path.tmp as backups.cat is.  The
+ * working set the app shows stays NAND-sized; pld_ext_to_nand cuts one
+ * out for pld_write_pld and merged.dat.
+ */
+#define PLD_EXT_PATH     "sdmc:/3ds/activity-log-pp/merged2.dat"
+#define PLD_EXT_MAGIC    0x32444C50u     /* "PLD2" */
+#define PLD_EXT_VERSION  2u              /* 1: no rollups */
+#define PLD_EXT_BLOCK    4096            /* sessions per block (64 KB) */
+
+typedef struct {
+    u32       magic;          /* PLD_EXT_MAGIC                             */
+    u16       version;        /* PLD_EXT_VERSION                           */
+    u16       header_size;    /* sizeof(PldExtHeader)                      */
+    u32       block_size;     /* PLD_EXT_BLOCK when written                */
+    u32       block_count;
+    u32       session_count;
+    u32       summary_count;
+    u32       index_crc;      /* pld_crc32 of summaries, rollups and index */
+    u32       rollup_count;   /* 0 in version 1 files                      */
+    PldHeader header;         /* NAND header of the first image merged in  */
+} PldExtHeader;               /* 48 bytes */
+
+typedef struct {
+    u64 first_title;          /* key of the block's first session          */
+    u64 last_title;           /* key of its last                           */
+    u32 first_ts;
+    u32 last_ts;
+    u32 count;
+    u32 crc;                  /* pld_crc32 of the block's sessions         */
+} PldExtBlock;                /* 32 bytes */
+
+/*
+ * Rollups.  Sessions older than a configurable age are folded into one
+ * record per title and day, and past a second age into one per title and
+ * 7-day period (counted from 2000-01-01).  A rollup keeps the play time,
+ * the session count and which days, and for a day which hours, were
+ * played, so totals, days played and streaks come out as they did from
+ * the hourly sessions.  The masks also make folding the same sessions in
+ * again a no-op: an hour already in a daily rollup, or a day already in
+ * a weekly one, is taken as a copy of what's there.
+ */
+#define PLD_ROLLUP_DAY   1
+#define PLD_ROLLUP_WEEK  7
+
+typedef struct {
+    u64 title_id;
+    u32 start;                /* first second of the day or week           */
+    u32 play_secs;            /* uncapped sum                              */
+    u32 hour_mask;            /* PLD_ROLLUP_DAY: bit h = hour h played     */
+    u16 sessions;             /* hourly sessions folded in (saturating)    */
+    u8  days;                 /* PLD_ROLLUP_DAY or PLD_ROLLUP_WEEK         */
+    u8  day_mask;             /* bit d = day start/86400 + d played        */
+} PldRollup;                  /* 24 bytes */
+
+/* Ages in days, measured back from the newest session; 0 = never.  A
+ * week_after at or below day_after rolls straight into weeks. */
+typedef struct {
+    u32 day_after;
+    u32 week_after;
+} PldRollupPolicy;
+
+/* Unbounded dataset in memory.  Sessions are PldSessions rather than
+ * PldRecs: the title dictionary is what caps PldSessionLog. */
+typedef struct {
+    PldHeader   header;
+    PldSession *sessions;       /* malloc'd, sorted by key, keys unique    */
+    int         count;
+    int         cap;
+    PldSummary *summaries;      /* malloc'd, sorted by title_id, live only */
+    int         summary_count;
+    int         summary_cap;
+    PldRollup  *rollups;        /* malloc'd, sorted, periods disjoint      */
+    int         rollup_count;
+    int         rollup_cap;
+} PldExt;
+
+void   pld_ext_init(PldExt *x);
+void   pld_ext_free(PldExt *x);
+
+/* pld_merge_sessions / pld_merge_summaries without the caps: remote may be
+ * in any order, and the dataset grows as needed.  The header of the first
+ * data merged into an empty dataset is kept.  Return the number of new
+ * sessions / titles, or -1 on OOM (the dataset is unchanged then). */
+int    pld_ext_merge_sessions(PldExt *x, const PldSession *remote, int n,
+                              bool add_only);
+int    pld_ext_merge_summaries(PldExt *x, const PldSummary *remote, int n,
+                               bool add_only);
+
+/* Both of the above for a parsed image or working set.  Returns the number
+ * of new sessions, or -1 on OOM. */
+int    pld_ext_merge_log(PldExt *x, const PldFile *pld,
+                         const PldSessionLog *log, bool add_only);
+
+/* Merge another dataset's rollups: equal periods fold as sessions do,
+ * overlapping ones (a day inside a week) are summed into the longer.
+ * Returns the number of new rollups, or -1 on OOM. */
+int    pld_ext_merge_rollups(PldExt *x, const PldRollup *remote, int n,
+                             bool add_only);
+
+/* Fold sessions older than p's ages (relative to now, a timestamp) into
+ * rollups, promote daily rollups past week_after to weekly ones, and
+ * absorb any session that falls inside an existing rollup, which is what
+ * merging old sessions into a rolled-up dataset leaves.  Returns the
+ * number of sessions folded away, or -1 on OOM (x is unchanged then). */
+int    pld_ext_rollup(PldExt *x, const PldRollupPolicy *p, u32 now);
+
+/* Policy pld_ext_fold_log applies, off by default. */
+void   pld_ext_set_rollup(const PldRollupPolicy *p);
+void   pld_ext_get_rollup(PldRollupPolicy *out);
+
+/* Set every summary's total_secs from the sessions and rollups (0 if it
+ * has none). */
+void   pld_ext_apply_totals(PldExt *x);
+
+/* Write x to path via path.tmp, or read it back whole (a complete .tmp
+ * left by an interrupted write wins).  Reads check every CRC and the key
+ * order; a missing file is an error, see pld_ext_fold_log. */
+Result pld_ext_write(const char *path, const PldExt *x);
+Result pld_ext_read(const char *path, PldExt *out);
+
+/* Cut a NAND-sized dataset out of x: the PLD_SUMMARY_COUNT most recently
+ * played titles and, of their sessions, the newest PLD_SESSION_COUNT.
+ * *log_out is allocated and sorted.  Returns -1 on OOM. */
+Result pld_ext_to_nand(const PldExt *x, PldFile *pld_out,
+                       PldSessionLog *log_out);
+
+/* Fold a working set, and extra[0..extra_count-1] if any, into the
+ * dataset at path (created if missing), roll it up by the policy set with
+ * pld_ext_set_rollup (ages measured from its newest session) and write it
+ * back.  Each key keeps the larger play time, launch count and date
+ * range, so folding the same data again changes nothing.  pld may be
+ * NULL; titles left without a summary get one built from their
+ * sessions. */
+Result pld_ext_fold_log(const char *path, const PldFile *pld,
+                        const PldSessionLog *log, const PldSession *extra,
+                        int extra_count);
+
+/* Block-skipping reads.  Opening reads the header and index only. */
+typedef struct {
+    PldStorage    st;
+    PldExtHeader  header;
+    PldExtBlock  *index;        /* malloc'd, header.block_count entries */
+    PldRollup    *rollups;      /* malloc'd, header.rollup_count        */
+    u32           blocks_at;    /* file offset of the first block       */
+    int           blocks_read;  /* blocks fetched since open            */
+} PldExtReader;
+
+Result pld_ext_open(PldExtReader *r, const char *path);
+void   pld_ext_close(PldExtReader *r);
+
+/* Sessions with lo <= (title_id, timestamp) <= hi into a malloc'd *out
+ * (NULL if none; release with MEM_FREE from memprof.h), reading only the
+ * blocks whose key range overlaps.
+ * Returns the count, or -1 on I/O error or a bad block CRC. */
+int    pld_ext_read_range(PldExtReader *r, const PldSession *lo,
+                          const PldSession *hi, PldSession **out);
+
+/* pld_ext_read_range over one title's sessions. */
+int    pld_ext_read_title(PldExtReader *r, u64 title_id, PldSession **out);
+
+/* One title's whole history, hourly sessions and rollups together. */
+typedef struct {
+    u32 total_secs;
+    u32 sessions;
+    u32 days_played;
+    int longest_streak;         /* consecutive days, as pld_longest_streak */
+} PldExtTitleStats;
+
+/* Returns 0 (all zero for an unknown title), or -1 on a read error. */
+int    pld_ext_title_stats(PldExtReader *r, u64 title_id,
+                           PldExtTitleStats *out);
+
+/* ── Warm-start snapshot (pld_snapshot.c) ───────────────────────── */
+
+/*
+ * What a launch derives from its inputs, saved at exit so the next launch
+ * can read it back instead of deriving it again when none has changed:
+ *
+ *   PldSnapHeader
+ *   PldFile                       the merged summary table
+ *   log_count × PldRec            the merged log, sorted
+ *   title_count × u64             its title dictionary
+ *   PldAgg
+ *   PldIndex begin[] and count[]
+ *   app_size bytes                the app's own state (view order)
+ *
+ * The key holds content hashes of the inputs; the caller decides which
+ * must match before using which part.  Summaries, sessions (log,
+ * dictionary, aggregate and index) and app bytes each have a CRC and load
+ * separately.  The header is written last, so a save cut short leaves no
+ * snapshot rather than a bad one.
+ */
+
+#define PLD_SNAPSHOT_PATH     "sdmc:/3ds/activity-log-pp/snapshot.dat"
+#define PLD_SNAPSHOT_MAGIC    0x534E4C50u   /* "PLNS" */
+#define PLD_SNAPSHOT_VERSION  2u
+
+typedef struct {
+    u64 nand_hash;          /* pld_hash64 of the NAND image               */
+    u64 summary_hash;       /* pld_summary_hash of the NAND image         */
+    u64 sd_hash;            /* pld_journal_state_hash of merged.dat       */
+    u64 names_hash;         /* title name store, 0 if unused              */
+    u64 installed_hash;     /* installed-title list, 0 if unused          */
+} PldSnapKey;
+
+typedef struct {
+    u32        magic;       /* PLD_SNAPSHOT_MAGIC                         */
+    u32        version;     /* PLD_SNAPSHOT_VERSION                       */
+    PldSnapKey key;
+    u32        log_count;
+    u32        title_count;
+    u32        app_size;
+    u32        summary_crc; /* pld_crc32 of the PldFile                   */
+    u32        session_crc; /* of log, dictionary, aggregate and index    */
+    u32        app_crc;     /* of the app bytes                           */
+} PldSnapHeader;
+
+/* Hash of the header and summary table: what step 2 reads of pld.dat,
+ * keying the snapshot's summaries before the whole image has been read. */
+u64    pld_summary_hash(const PldFile *pld);
+
+/* Write the snapshot.  idx must be built over log.  Returns 0 or -1. */
+Result pld_snapshot_save(const char *path, const PldSnapKey *key,
+                         const PldFile *pld, const PldSessionLog *log,
+                         const PldAgg *agg, const PldIndex *idx,
+                         const void *app, u32 app_size);
+
+/* Read and check the header.  Returns 0, or -1 if the file is missing,
+ * short or not a snapshot of this version. */
+Result pld_snapshot_header(const char *path, PldSnapHeader *out);
+
+/* Load one part described by h.  Each returns 0, or -1 on a read error or
+ * CRC mismatch (outputs are then unusable; a log is left freed).
+ * pld_snapshot_load_app needs app_cap >= h->app_size. */
+Result pld_snapshot_load_summaries(const char *path, const PldSnapHeader *h,
+                                   PldFile *out);
+Result pld_snapshot_load_sessions(const char *path, const PldSnapHeader *h,
+                                  PldSessionLog *log, PldAgg *agg,
+                                  PldIndex *idx);
+Result pld_snapshot_load_app(const char *path, const PldSnapHeader *h,
+                             void *app, u32 app_cap);
+
+/* ── Connection setup (pld_link.c) ──────────────────────────────── */
+
+/*
+ * Two consoles find each other and open the sync connection in steps a
+ * frame loop can drive: the host broadcasts on UDP and accepts on TCP,
+ * the client answers the first broadcast it hears by connecting, and the
+ * two trade magics (and, on PLD4, codec masks) before any payload moves.
+ * pld_link_tick does what the sockets allow without waiting and returns;
+ * each step that waits on the peer has a deadline.  A client whose attempt
+ * fails backs off, doubling the delay up to a cap, then scans again; a
+ * host drops the connection and goes back to listening.
+ */
+
+#define PLD_LINK_MAGIC        0x504C4433u  /* "PLD3": one-pass full-duplex
+                                              sync                        */
+#define PLD_LINK_MAGIC_CODEC  0x504C4434u  /* "PLD4": PLD3, payload codecs
+                                              traded after the handshake  */
+
+#define PLD_LINK_BCAST_MS       1000u   /* host: discovery broadcast period */
+#define PLD_LINK_CONNECT_MS     3000u   /* client: TCP connect deadline     */
+#define PLD_LINK_HANDSHAKE_MS   3000u   /* magics and codecs deadline       */
+#define PLD_LINK_BACKOFF_MS      250u   /* client: first retry delay        */
+#define PLD_LINK_BACKOFF_MAX    8000u   /* client: retry delay cap          */
+
+typedef enum {
+    PLD_LINK_CLOSED,
+    PLD_LINK_LISTENING,   /* host: broadcasting, accepting              */
+    PLD_LINK_SCANNING,    /* client: waiting for a broadcast            */
+    PLD_LINK_CONNECTING,  /* client: TCP connect in progress            */
+    PLD_LINK_HANDSHAKE,   /* magics and codec masks in flight           */
+    PLD_LINK_BACKOFF,     /* client: waiting to retry after a failure   */
+    PLD_LINK_READY,       /* tcp is the data socket                     */
+    PLD_LINK_FAILED,      /* a socket could not be created              */
+} PldLinkPhase;
+
+typedef struct {
+    bool         host;
+    PldLinkPhase phase;
+    int          udp;           /* discovery socket; -1 = none            */
+    int          listen;        /* host: server socket; -1 = none         */
+    int          tcp;           /* connection; -1 = none                  */
+    u16          udp_port, tcp_port;
+    u32          bcast_addr;    /* host byte order; INADDR_BROADCAST      */
+    u32          codecs;        /* PLD_CODEC_* this end reads             */
+    /* timings, ms; pld_link_init sets the PLD_LINK_* defaults */
+    u32          bcast_ms, connect_ms, handshake_ms;
+    u32          backoff_min_ms, backoff_max_ms;
+    /* progress */
+    u32          peer_addr;     /* network byte order; 0 until heard      */
+    bool         peer_codec;    /* client: the host broadcast PLD4        */
+    u32          codec;         /* once READY: PLD_CODEC_* both ends read */
+    u64          deadline;      /* current step fails at this time        */
+    u64          next_bcast;
+    u64          retry_at;
+    u32          backoff_ms;    /* client: next retry delay               */
+    u32          failures;      /* attempts dropped since opening         */
+    int          step;          /* handshake step                         */
+    u8           out[8];        /* handshake bytes queued to send         */
+    u32          out_len, out_pos;
+    u8           in[4];         /* handshake word being received          */
+    u32          in_got;
+} PldLink;
+
+/* Set *l up as host or client on the given ports with default timings and
+ * every codec offered; no sockets yet, all of them -1. */
+void         pld_link_init(PldLink *l, bool host, u16 udp_port, u16 tcp_port);
+/* Create the sockets (non-blocking) and start listening or scanning.
+ * Returns 0, or -1 with everything closed and the phase PLD_LINK_FAILED. */
+int          pld_link_open(PldLink *l, u64 now_ms);
+/* Advance by what the sockets allow at now_ms (a monotonic clock) without
+ * blocking; returns the phase.  Once READY, l->tcp and l->codec are the
+ * connection and its codecs, and the discovery sockets are closed. */
+PldLinkPhase pld_link_tick(PldLink *l, u64 now_ms);
+/* Close every socket the link holds; the phase becomes PLD_LINK_CLOSED. */
+void         pld_link_close(PldLink *l);
+
+/* ── Wire transfer (pld_wire.c) ─────────────────────────────────── */
+
+/*
+ * Sync payloads are count-prefixed arrays: a u32 element count, then that
+ * many fixed-size elements.  pld_wire_exchange sends this side's arrays
+ * and receives the peer's in the same pass, polling one socket in both
+ * directions and moving PLD_WIRE_CHUNK bytes at a time, so neither
+ * direction of the link waits for the other.  Both peers run it with the
+ * same array layout; neither goes first.
+ */
+
+#define PLD_WIRE_CHUNK       4096u     /* bytes staged per send */
+#define PLD_WIRE_TIMEOUT_MS 10000u     /* default idle timeout   */
+
+/* Writes the next element of an outgoing array to elem_out. */
+typedef void (*PldWireNext)(void *state, void *elem_out);
+
+/* Takes the next n (>= 1) elements of an incoming array; returning -1
+ * fails the exchange. */
+typedef int (*PldWireSink)(void *state, const void *elems, u32 n);
+
+typedef struct {
+    const void  *data;      /* count elements, or the state for next    */
+    PldWireNext  next;      /* NULL: data is the array itself           */
+    u32          count;
+    u32          elem;      /* element size, bytes                      */
+} PldWireOut;
+
+typedef struct {
+    void        *data;      /* pld_scratch_alloc'd, NULL if count is 0  */
+    u32          count;
+    u32          elem;      /* element size, bytes                      */
+    u32          max;       /* a larger count is a protocol error       */
+    PldWireSink  sink;      /* non-NULL: elements are handed to it as   */
+    void        *sink_state; /* they arrive, at most a PLD_WIRE_CHUNK of
+                               them at a time, and data stays NULL      */
+} PldWireIn;
+
+typedef struct {
+    u64 bytes_sent;
+    u64 bytes_recv;
+} PldWireStats;
+
+/* Send out[0..n_out) while receiving in[0..n_in) on the connected stream
+ * socket fd, each array as its count and elements.  The socket is made
+ * non-blocking for the call and restored after.  A sink array costs one
+ * chunk of stack however long it is.  Returns 0, or -1 on an
+ * I/O or protocol error, a close by the peer, the socket moving nothing
+ * either way for the idle timeout, or OOM; the in arrays
+ * received so far are left for the caller to free, newest first, with
+ * pld_scratch_free.  stats, if non-NULL, is added to. */
+int    pld_wire_exchange(int fd, const PldWireOut *out, int n_out,
+                         PldWireIn *in, int n_in, PldWireStats *stats);
+
+/* Idle timeout of pld_wire_exchange in ms; PLD_WIRE_TIMEOUT_MS until set,
+ * 0 waits forever. */
+void   pld_wire_set_timeout(u32 ms);
+u32    pld_wire_get_timeout(void);
+
+/* ── Payload codec (pld_codec.c) ────────────────────────────────── */
+
+/*
+ * Compact form of the bulky sync payloads, for peers that both read it
+ * (net.c settles that in the handshake; others get raw arrays).  A payload
+ * is a run of blocks, each decodable on its own: a header of two u16s,
+ * stored and plain size, then the stored bytes.  Those are the block's
+ * plain bytes LZ-compressed when PLD_CODEC_LZ is on and that came out
+ * smaller, else the plain bytes as they are.
+ *
+ * Plain bytes of sessions are grouped by title: the title_id, a u16 record
+ * count, then per record a varint timestamp step from the previous record
+ * (in hours when a whole number of them) and a varint play_secs.  Plain
+ * bytes of fixed-size elements (title names) are each element with its
+ * trailing zero bytes dropped, behind a varint length.
+ */
+
+#define PLD_CODEC_VARINT  0x1u      /* grouped delta + varint encoding   */
+#define PLD_CODEC_LZ      0x2u      /* then LZ per block                 */
+#define PLD_CODEC_ALL     (PLD_CODEC_VARINT | PLD_CODEC_LZ)
+
+#define PLD_CODEC_BLOCK     4096u   /* plain bytes per block, at most    */
+#define PLD_CODEC_ELEM_MAX  256u    /* largest fixed-size element        */
+#define PLD_CODEC_SESSION_MAX 20u   /* plain bytes of a session, at most */
+
+/* Largest payload n items of at most per plain bytes each encode to. */
+#define PLD_CODEC_BOUND(n, per) \
+    ((n) * (per) + 4u * ((n) * (per) / (PLD_CODEC_BLOCK - (per)) + 1u))
+
+/* Encode n sessions, each written by next(state, ...), into out; with out
+ * NULL, only measure.  Returns the payload size (with out NULL, the size
+ * it has uncompressed, which bounds the real one), or -1 on OOM. */
+int    pld_codec_encode_sessions(PldWireNext next, void *state, u32 n,
+                                 u32 codec, u8 *out);
+
+/* The same for n elements of elem (<= PLD_CODEC_ELEM_MAX) bytes. */
+int    pld_codec_encode_elems(const void *elems, u32 n, u32 elem, u32 codec,
+                              u8 *out);
+
+/* Streaming decoder: the payload goes in through pld_codec_feed in pieces
+ * of any size, and what it decodes comes out through sink, as PldSessions
+ * (elem 0) or as elements of elem bytes, in batches.  About two blocks in
+ * size: callers put it in scratch rather than on a worker's stack. */
+typedef struct {
+    u32          elem;
+    PldWireSink  sink;
+    void        *sink_state;
+    u8           hdr[4];
+    u32          have;          /* header bytes of this block in         */
+    u32          stored;        /* this block's sizes, once have is 4    */
+    u32          plain;
+    u32          got;           /* stored bytes in                       */
+    u32          items;         /* decoded so far                        */
+    u8           in[PLD_CODEC_BLOCK];
+    u8           out[PLD_CODEC_BLOCK];
+} PldCodecReader;
+
+void   pld_codec_reader_init(PldCodecReader *r, u32 elem, PldWireSink sink,
+                             void *sink_state);
+/* A PldWireSink of bytes for a PldCodecReader.  Returns -1 on a malformed
+ * block or if the reader's sink failed. */
+int    pld_codec_feed(void *reader, const void *bytes, u32 n);
+/* True if what was fed ends on a block boundary. */
+bool   pld_codec_reader_done(const PldCodecReader *r);
+
+/* Decode a whole payload of elements into *out (pld_scratch_alloc'd, NULL
+ * if none), *count_out of them.  Returns 0, or -1 if malformed or OOM. */
+int    pld_codec_decode_elems(const u8 *in, u32 len, u32 elem, void **out,
+                              u32 *count_out);
+
+/* ── Session reconciliation (pld_recon.c) ───────────────────────── */
+
+/*
+ * Delta sync of two session logs over a connected stream socket.  The
+ * peers trade a digest (record count, chained pld_hash64 of the records as
+ * PldSessions) per title.  A title they hold differently is a range of its
+ * own, or, when pld_recon_by_span says so, is split into PLD_RECON_SPAN
+ * ranges whose digests are traded next.  Only the records of ranges the
+ * other side lacks or holds differently cross the wire, and each side
+ * merges them as pld_merge_sessions would while they arrive, a chunk at a
+ * time, so the peer's records are never held whole.  That leaves both logs
+ * identical; ranges the peers already agree on are not re-summed, as a
+ * full exchange would.
+ */
+
+#define PLD_RECON_SPAN   (32u * 86400u)   /* seconds per span digest */
+
+typedef struct {
+    u64 title_id;
+    u32 count;
+    u32 spans;          /* spans the title's records fall in */
+    u64 hash;
+} PldReconTitle;        /* 24 bytes, wire format */
+
+typedef struct {
+    u64 title_id;
+    u32 span;           /* timestamp / PLD_RECON_SPAN */
+    u32 count;
+    u64 hash;
+} PldReconDigest;       /* 24 bytes, wire format */
+
+typedef struct {
+    u64 bytes_sent;
+    u64 bytes_recv;
+    u32 records_sent;
+    u32 records_recv;
+} PldReconStats;
+
+/* True if a title held as a on one side and b on the other is settled
+ * span by span rather than whole (symmetric in a and b). */
+bool   pld_recon_by_span(const PldReconTitle *a, const PldReconTitle *b);
+
+/* Handed what a sync that filled the log received: merged, the log with
+ * every record that fit, and the n records the peer sent past that.
+ * Returns 0 once it has put them elsewhere, or -1. */
+typedef int (*PldReconFull)(void *state, const PldSessionLog *merged,
+                            const PldSession *rest, int n);
+
+/* Reconcile *local (sorted first) with the peer on fd, each round through
+ * pld_wire_exchange, merging the peer's records into *local as they
+ * arrive; agg (may be NULL) is kept as pld_merge_sessions_agg keeps it.
+ * The records travel encoded with codec (PLD_CODEC_*, alike on both
+ * ends), or as PldSessions if it is 0.  side_out / side_in (n_side each,
+ * may be 0) are other payloads carried in round one, so they cost no
+ * round trip of their own; side_in is filled as pld_wire_exchange fills
+ * its arrays.  Returns the number of records added; -1 on an I/O or
+ * protocol error, with *local as it was; -2 if *local filled up, after
+ * full (may be NULL) has been given the merge, with *local put back as it
+ * was and agg rebuilt over it (-1 instead if full fails).  stats may be
+ * NULL. */
+int    pld_recon_exchange(int fd, PldSessionLog *local, PldAgg *agg,
+                          u32 codec, const PldWireOut *side_out,
+                          PldWireIn *side_in, int n_side, PldReconFull full,
+                          void *full_state, PldReconStats *stats);
 
 /* ── Formatting helpers ─────────────────────────────────────────── */
 
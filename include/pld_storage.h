@@ -0,0 +1,46 @@
+#pragma once
+
+#include "pld_types.h"
+#include <stdbool.h>
+
+/*
+ * pld_storage.h — minimal random-access backend for pld images
+ *
+ * The parsing, compaction and serialization code in pld_core.c only ever
+ * needs "read/write N bytes at offset X", so it talks to this interface
+ * instead of libctru or stdio directly.  Device code wraps an FS file
+ * Handle (see pld.c); SD paths and the host build use the stdio backend
+ * below.
+ */
+
+typedef struct PldStorage PldStorage;
+
+struct PldStorage {
+    Result (*read)(PldStorage *st, u32 offset, void *buf, u32 len);
+    Result (*write)(PldStorage *st, u32 offset, const void *buf, u32 len);
+    Result (*close)(PldStorage *st);   /* flushes; storage is unusable after */
+
+    void *file;     /* backend-private: FILE * for stdio               */
+    u32   handle;   /* backend-private: FS file Handle on device       */
+};
+
+/* Open path with stdio.  write=false opens read-only; write=true truncates
+ * or creates the file.  Returns 0 on success, -1 if the file can't be opened. */
+Result pld_storage_open_stdio(PldStorage *st, const char *path, bool write);
+
+static inline Result pld_storage_read(PldStorage *st, u32 offset,
+                                      void *buf, u32 len)
+{
+    return st->read(st, offset, buf, len);
+}
+
+static inline Result pld_storage_write(PldStorage *st, u32 offset,
+                                       const void *buf, u32 len)
+{
+    return st->write(st, offset, buf, len);
+}
+
+static inline Result pld_storage_close(PldStorage *st)
+{
+    return st->close(st);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+/*
+ * pld_types.h — scalar types shared by the portable pld core
+ *
+ * On device these come straight from <3ds.h>.  The host build (see
+ * host/host.mk) has no libctru, so the handful of types the core needs are
+ * mirrored here with the same widths and Result semantics.
+ */
+
+#ifdef __3DS__
+#include <3ds.h>
+#else
+#include <stdint.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t   s8;
+typedef int16_t  s16;
+typedef int32_t  s32;
+typedef int64_t  s64;
+
+typedef s32 Result;
+
+#define R_SUCCEEDED(res) ((res) >= 0)
+#define R_FAILED(res)    ((res) < 0)
+#endif
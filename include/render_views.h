@@ -74,10 +74,12 @@ void render_rankings_top(const PldSummary *ranked[], int rank_count,
                          const u32 rank_metric[], ViewMode mode,
                          float anim_t, float sel_pop);
 
+/* recs[0..sess_count-1]: the title's sessions, oldest first; listed newest
+ * first.  all_time, if not NULL, is the title's history in merged2.dat,
+ * rolled-up years included. */
 void render_detail_top(const PldSummary *s, const char *name,
-                       const PldSessionLog *sessions,
-                       const int *sess_indices, int sess_count,
-                       int detail_scroll);
+                       const PldRec *recs, int sess_count,
+                       int detail_scroll, const PldExtTitleStats *all_time);
 void render_detail_bot(bool is_hidden);
 
 void render_menu(int sel);
@@ -17,11 +17,33 @@
 extern const u32  min_play_options[MIN_PLAY_OPTION_COUNT];
 extern const char *min_play_labels[MIN_PLAY_OPTION_COUNT];
 
+#define BACKUP_KEEP_OPTION_COUNT 7
+#define BACKUP_SIZE_OPTION_COUNT 5
+
+extern const u32  backup_keep_options[BACKUP_KEEP_OPTION_COUNT];
+extern const char *backup_keep_labels[BACKUP_KEEP_OPTION_COUNT];
+extern const u32  backup_size_options[BACKUP_SIZE_OPTION_COUNT];  /* KB */
+extern const char *backup_size_labels[BACKUP_SIZE_OPTION_COUNT];
+
+/* History rollup presets: ages in days for daily and weekly records in
+ * merged2.dat (0 = never). */
+#define ROLLUP_OPTION_COUNT 4
+
+extern const u32  rollup_day_options[ROLLUP_OPTION_COUNT];
+extern const u32  rollup_week_options[ROLLUP_OPTION_COUNT];
+extern const char *rollup_labels[ROLLUP_OPTION_COUNT];
+
+/* Fields after music_enabled were added later; settings files without
+ * them load with their defaults. */
 typedef struct {
     u32 magic;
     u32 min_play_secs;   /* default 600 (10 min) */
     u32 starting_view;   /* ViewMode enum value   */
     u32 music_enabled;   /* 1 = on (default), 0 = off */
+    u32 backup_keep;     /* backups kept, default 10 */
+    u32 backup_max_kb;   /* backup space limit in KB, 0 = none (default) */
+    u32 rollup_day_after;  /* merged2.dat daily rollups, days; 0 = off (default) */
+    u32 rollup_week_after; /* weekly rollups, days; 0 = off (default) */
 } AppSettings;
 
 void settings_defaults(AppSettings *s);
@@ -32,6 +54,20 @@ void settings_save(const AppSettings *s);
  * default index (2 = 10 min) if not found. */
 int  settings_min_play_index(u32 secs);
 
+/* Index into backup_keep_options / backup_size_options for a value, or
+ * the default's index if not found. */
+int  settings_backup_keep_index(u32 count);
+int  settings_backup_size_index(u32 kb);
+
+/* Index into the rollup presets for a pair of ages, or 0 (off). */
+int  settings_rollup_index(u32 day_after, u32 week_after);
+
+/* Hand the backup limits to pld_backup_set_retention. */
+void settings_apply_backup_retention(const AppSettings *s);
+
+/* Hand the rollup ages to pld_ext_set_rollup. */
+void settings_apply_rollup(const AppSettings *s);
+
 /* ── Hidden games ───────────────────────────────────────────────── */
 
 #define MAX_HIDDEN 256
@@ -5,5 +5,5 @@
 u32  load_sync_count(void);
 void save_sync_count(u32 n);
 
-void run_sync_flow(PldFile *pld, PldSessionLog *sessions,
+void run_sync_flow(PldFile *pld, PldSessionLog *sessions, PldAgg *agg,
                    u32 *sync_count, char *status_msg, int status_msg_len);
@@ -20,6 +20,13 @@ void        title_names_load(void);
  * Returns the number of new entries added. */
 int         title_names_scan_installed(void);
 
+/* Hash of the installed-title lists the scan above walks (0 if the AM
+ * service is unavailable).  Cheap next to the scan: no SMDH is read. */
+u64         title_names_installed_hash(void);
+
+/* Hash of TITLE_NAMES_PATH as last loaded or saved (0 if neither). */
+u64         title_names_hash(void);
+
 /* Binary-search the in-memory store for a title ID.
  * Returns a pointer to the stored name, or NULL if not found.
  * Does NOT fall back to the embedded title_db. */
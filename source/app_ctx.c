@@ -1,4 +1,11 @@
+#include <stdio.h>
+#include <string.h>
+
 #include "app_ctx.h"
+#include "screens.h"
+#include "audio.h"
+#include "ui.h"
+#include "title_names.h"
 
 void app_ctx_rebuild(AppCtx *ctx)
 {
@@ -22,3 +29,151 @@ void app_ctx_rebuild(AppCtx *ctx)
         ctx->list_anim_frame = 0;
     }
 }
+
+void app_ctx_data_changed(AppCtx *ctx)
+{
+    pld_index_build(ctx->index, &ctx->pld, &ctx->sessions);
+    app_ctx_rebuild(ctx);
+    ctx->data_changed = true;
+}
+
+/* Title under the cursor in the current view, 0 if none. */
+static u64 selected_title(const AppCtx *ctx)
+{
+    if (view_is_rank(ctx->view_mode))
+        return ctx->rank_count > 0 ? ctx->ranked[ctx->rank_sel]->title_id : 0;
+    return ctx->n > 0 ? ctx->valid[ctx->sel]->title_id : 0;
+}
+
+/* Rebuild, then put the cursor back on title_id (if it is still listed)
+ * without replaying the list's entry animation. */
+static void rebuild_keep_selection(AppCtx *ctx, u64 title_id)
+{
+    int scroll_top = ctx->scroll_top, rank_scroll = ctx->rank_scroll;
+    float scroll_y = ctx->scroll_y;
+    int list_anim  = ctx->list_anim_frame, rank_anim = ctx->rank_anim_frame;
+    app_ctx_rebuild(ctx);
+    ctx->list_anim_frame = list_anim;
+    ctx->rank_anim_frame = rank_anim;
+    if (!title_id) return;
+
+    if (view_is_rank(ctx->view_mode)) {
+        for (int i = 0; i < ctx->rank_count; i++) {
+            if (ctx->ranked[i]->title_id != title_id) continue;
+            ctx->rank_sel    = i;
+            ctx->rank_scroll = rank_scroll;
+            if (i < rank_scroll) ctx->rank_scroll = i;
+            if (i >= rank_scroll + UI_VISIBLE_ROWS)
+                ctx->rank_scroll = i - UI_VISIBLE_ROWS + 1;
+            break;
+        }
+    } else {
+        for (int i = 0; i < ctx->n; i++) {
+            if (ctx->valid[i]->title_id != title_id) continue;
+            ctx->sel        = i;
+            ctx->scroll_top = scroll_top;
+            if (i < scroll_top) ctx->scroll_top = i;
+            if (i >= scroll_top + UI_VISIBLE_ROWS)
+                ctx->scroll_top = i - UI_VISIBLE_ROWS + 1;
+            ctx->scroll_y   = scroll_y;
+            break;
+        }
+    }
+}
+
+static void adopt_load(AppCtx *ctx)
+{
+    SessionLoad *l = ctx->load;
+    pld_fence_wait(&l->fence);
+    ctx->load    = NULL;
+    ctx->load_rc = l->rc;
+    if (R_FAILED(l->rc)) {
+        pld_sessions_free(&l->sessions);
+        snprintf(ctx->status_msg, sizeof(ctx->status_msg),
+                 "Session load failed: 0x%08lX", l->rc);
+        return;
+    }
+    u64 title_id  = selected_title(ctx);
+    ctx->pld      = l->pld;
+    ctx->sessions = l->sessions;
+    rebuild_keep_selection(ctx, title_id);
+}
+
+bool app_ctx_poll_sessions(AppCtx *ctx)
+{
+    if (!ctx->load || !pld_fence_ready(&ctx->load->fence)) return false;
+    adopt_load(ctx);
+    return true;
+}
+
+bool app_ctx_need_sessions(AppCtx *ctx)
+{
+    if (ctx->load) {
+        while (!pld_fence_ready(&ctx->load->fence) && aptMainLoop()) {
+            audio_tick();
+            draw_loading_screen("Activity Log++", "Loading play sessions...");
+        }
+        adopt_load(ctx);
+    }
+    if (R_FAILED(ctx->load_rc)) {
+        snprintf(ctx->status_msg, sizeof(ctx->status_msg),
+                 "Sessions unavailable: 0x%08lX", ctx->load_rc);
+        return false;
+    }
+    return true;
+}
+
+/* Everything collect_valid, sort_valid and build_rankings read. */
+static u64 view_inputs(const AppCtx *ctx)
+{
+    u32 v[4] = { (u32)ctx->view_mode, ctx->settings.min_play_secs,
+                 ctx->show_system, ctx->show_unknown };
+    u64 h = pld_summary_hash(&ctx->pld);
+    h = pld_hash64(v, sizeof(v), h);
+    h = pld_hash64(ctx->hidden.title_ids,
+                   (size_t)ctx->hidden.count * sizeof(u64), h);
+    u64 names = title_names_hash();
+    return pld_hash64(&names, sizeof(names), h);
+}
+
+void app_ctx_save_view(const AppCtx *ctx, AppViewSnap *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->inputs     = view_inputs(ctx);
+    out->n          = ctx->n;
+    out->rank_count = ctx->rank_count;
+    for (int i = 0; i < ctx->n; i++)
+        out->valid[i] = (s16)(ctx->valid[i] - ctx->pld.summaries);
+    for (int i = 0; i < ctx->rank_count; i++) {
+        out->ranked[i]      = (s16)(ctx->ranked[i] - ctx->pld.summaries);
+        out->rank_metric[i] = ctx->rank_metric[i];
+    }
+}
+
+bool app_ctx_restore_view(AppCtx *ctx, const AppViewSnap *snap)
+{
+    if (snap->inputs != view_inputs(ctx) ||
+        snap->n < 0 || snap->n > PLD_SUMMARY_COUNT ||
+        snap->rank_count < 0 || snap->rank_count > RANK_MAX)
+        return false;
+    for (int i = 0; i < snap->n; i++)
+        if (snap->valid[i] < 0 || snap->valid[i] >= PLD_SUMMARY_COUNT)
+            return false;
+    for (int i = 0; i < snap->rank_count; i++)
+        if (snap->ranked[i] < 0 || snap->ranked[i] >= PLD_SUMMARY_COUNT)
+            return false;
+
+    ctx->n = snap->n;
+    for (int i = 0; i < snap->n; i++)
+        ctx->valid[i] = &ctx->pld.summaries[snap->valid[i]];
+    ctx->rank_count = snap->rank_count;
+    for (int i = 0; i < snap->rank_count; i++) {
+        ctx->ranked[i]      = &ctx->pld.summaries[snap->ranked[i]];
+        ctx->rank_metric[i] = snap->rank_metric[i];
+    }
+    ctx->sel = ctx->scroll_top = 0;
+    ctx->scroll_y = 0.0f;
+    ctx->rank_sel = ctx->rank_scroll = 0;
+    ctx->list_anim_frame = ctx->rank_anim_frame = 0;
+    return true;
+}
@@ -7,6 +7,7 @@
 #include "vendor/minimp3.h"
 
 #include "audio.h"
+#include "memprof.h"
 
 /* ── Constants ──────────────────────────────────────────────────── */
 
@@ -156,10 +157,10 @@ void audio_init(const char *path)
     fseek(f, 0, SEEK_END);
     s_mp3_size = (size_t)ftell(f);
     fseek(f, 0, SEEK_SET);
-    s_mp3_buf = malloc(s_mp3_size);
+    s_mp3_buf = MEM_MALLOC(MEM_AUDIO, s_mp3_size);
     if (!s_mp3_buf) { fclose(f); return; }
     if (fread(s_mp3_buf, 1, s_mp3_size, f) != s_mp3_size) {
-        free(s_mp3_buf);
+        MEM_FREE(s_mp3_buf);
         s_mp3_buf = NULL;
         fclose(f);
         return;
@@ -197,7 +198,7 @@ void audio_init(const char *path)
 
     /* Init NDSP */
     if (R_FAILED(ndspInit())) {
-        free(s_mp3_buf);
+        MEM_FREE(s_mp3_buf);
         s_mp3_buf = NULL;
         return;
     }
@@ -219,12 +220,12 @@ void audio_init(const char *path)
     /* Allocate linear NDSP buffers */
     size_t buf_bytes = (size_t)PCM_BUF_SAMPLES * s_channels * sizeof(s16);
     for (int i = 0; i < NUM_BUFS; i++) {
-        s_ndsp_buf[i] = linearAlloc(buf_bytes);
+        s_ndsp_buf[i] = MEM_LINEAR_ALLOC(MEM_AUDIO, buf_bytes);
         if (!s_ndsp_buf[i]) {
-            for (int j = 0; j < i; j++) linearFree(s_ndsp_buf[j]);
+            for (int j = 0; j < i; j++) MEM_LINEAR_FREE(s_ndsp_buf[j]);
             memset(s_ndsp_buf, 0, sizeof(s_ndsp_buf));
             ndspExit();
-            free(s_mp3_buf);
+            MEM_FREE(s_mp3_buf);
             s_mp3_buf = NULL;
             return;
         }
@@ -285,10 +286,10 @@ void audio_exit(void)
     ndspExit();
 
     for (int i = 0; i < NUM_BUFS; i++) {
-        if (s_ndsp_buf[i]) { linearFree(s_ndsp_buf[i]); s_ndsp_buf[i] = NULL; }
+        if (s_ndsp_buf[i]) { MEM_LINEAR_FREE(s_ndsp_buf[i]); s_ndsp_buf[i] = NULL; }
     }
 
-    free(s_mp3_buf);
+    MEM_FREE(s_mp3_buf);
     s_mp3_buf = NULL;
     s_inited  = false;
 }
@@ -31,7 +31,7 @@ static void json_write_escaped(FILE *f, const char *s)
     }
 }
 
-Result export_data(const PldFile *pld, const PldSessionLog *sessions)
+Result export_data(const PldFile *pld, const PldIndex *index)
 {
     mkdir("sdmc:/3ds/activity-log-pp", 0755);
 
@@ -61,7 +61,8 @@ Result export_data(const PldFile *pld, const PldSessionLog *sessions)
         pld_fmt_date(s->first_played_days, first_buf, sizeof(first_buf));
         pld_fmt_date(s->last_played_days, last_buf, sizeof(last_buf));
 
-        int sess_count = pld_count_sessions_for(sessions, s->title_id);
+        const PldRec *recs;
+        int sess_count = pld_index_range(index, i, &recs);
         u32 avg_secs = (s->launch_count > 0) ? (s->total_secs / s->launch_count) : 0;
         char avg_buf[20];
         pld_fmt_time(avg_secs, avg_buf, sizeof(avg_buf));
@@ -101,5 +102,5 @@ Result export_data(const PldFile *pld, const PldSessionLog *sessions)
 
 void export_work(void *raw) {
     ExportArgs *a = (ExportArgs *)raw;
-    a->rc = export_data(a->pld, a->sessions);
+    a->rc = export_data(a->pld, a->index);
 }
@@ -5,6 +5,12 @@
  * Cover art is centre-cropped and scaled to 128×128, then converted to
  * Morton-tiled RGB565 for the GPU icon store.
  */
+#include "memprof.h"
+
+/* Decode buffers count against the fetch (MEMPROF=1 builds). */
+#define STBI_MALLOC(sz)         MEM_MALLOC(MEM_ICON, sz)
+#define STBI_REALLOC(p, newsz)  MEM_REALLOC(MEM_ICON, p, newsz)
+#define STBI_FREE(p)            MEM_FREE(p)
 #define STB_IMAGE_IMPLEMENTATION
 #include "vendor/stb_image.h"
 
@@ -142,7 +148,7 @@ void icon_fetch_missing(const PldSummary *const valid[], int n)
 
     if (R_FAILED(httpcInit(0))) return;
 
-    u8 *fetch_buf = (u8 *)malloc(FETCH_BUF_SIZE);
+    u8 *fetch_buf = (u8 *)MEM_MALLOC(MEM_ICON, FETCH_BUF_SIZE);
     if (!fetch_buf) {
         httpcExit();
         return;
@@ -221,23 +227,24 @@ void icon_fetch_missing(const PldSummary *const valid[], int n)
         if (!pixels || w <= 0 || h <= 0) continue;
 
         /* Top-left-crop + scale to ICON_SRC_SIZE × ICON_SRC_SIZE */
-        unsigned char *scaled = (unsigned char *)malloc(ICON_SRC_SIZE * ICON_SRC_SIZE * 3);
+        unsigned char *scaled =
+            (unsigned char *)MEM_MALLOC(MEM_ICON, ICON_SRC_SIZE * ICON_SRC_SIZE * 3);
         if (!scaled) { stbi_image_free(pixels); continue; }
         rgb888_crop_scale(pixels, w, h, scaled);
 
         /* Convert flat RGB888 → Morton-tiled RGB565 */
-        u16 *tile_data = (u16 *)malloc(ICON_TILE_BYTES);
-        if (!tile_data) { free(scaled); stbi_image_free(pixels); continue; }
+        u16 *tile_data = (u16 *)MEM_MALLOC(MEM_ICON, ICON_TILE_BYTES);
+        if (!tile_data) { MEM_FREE(scaled); stbi_image_free(pixels); continue; }
         rgb888_to_smdh_tile(scaled, tile_data);
         stbi_image_free(pixels);
-        free(scaled);
+        MEM_FREE(scaled);
 
         /* Load into in-memory icon store and persist to SD cache */
         title_icon_load_from_tile_data(title_id, tile_data);
         title_icon_save_sd(title_id, tile_data);
-        free(tile_data);
+        MEM_FREE(tile_data);
     }
 
-    free(fetch_buf);
+    MEM_FREE(fetch_buf);
     httpcExit();
 }
@@ -19,6 +19,7 @@
 #include "app_ctx.h"
 #include "modal_views.h"
 #include "audio.h"
+#include "memprof.h"
 
 /* ── Constants ──────────────────────────────────────────────────── */
 
@@ -29,6 +30,19 @@ static const u32 region_ids[] = {
     ACTIVITY_SAVE_ID_KOR,
 };
 
+/* Per-title aggregates and session index for ctx.sessions, and the
+ * startup load that fills them (kept off the stack) */
+static PldAgg      s_agg;
+static PldIndex    s_index;
+static SessionLoad s_load;
+
+/* Warm-start snapshot left by the last clean exit (header valid only if
+ * s_warm), its saved view, and the installed-title hash step 4 took */
+static PldSnapHeader s_snap;
+static bool          s_warm;
+static AppViewSnap   s_view;
+static u64           s_installed_hash;
+
 /* ── Worker arg structs and functions ──────────────────────────── */
 
 /* Step 1: Open archive */
@@ -48,59 +62,179 @@ static void open_archive_work(void *raw) {
     }
 }
 
-/* Step 2: Read summary + sessions */
+/* Step 2: Read the summary table (all the list needs) */
 typedef struct {
     FS_Archive     archive;
     PldFile       *pld;
-    PldSessionLog *sessions;
-    Result         rc_summary;
-    Result         rc_sessions;
+    Result         rc;
 } ReadPldArgs;
 
 static void read_pld_work(void *raw) {
     ReadPldArgs *a = (ReadPldArgs *)raw;
-    a->rc_summary = pld_read_summary(a->archive, a->pld);
-    if (R_FAILED(a->rc_summary)) {
-        a->rc_sessions = -1;
-        return;
-    }
-    a->rc_sessions = pld_read_sessions(a->archive, a->sessions);
+    a->rc = pld_read_summary(a->archive, a->pld);
 }
 
-/* Step 3: Merge */
+/* Merge of merged.dat into the NAND data, run by load_sessions_work */
 typedef struct {
     PldFile       *pld;
     PldSessionLog *sessions;
+    PldAgg        *agg;
 } MergeArgs;
 
 static void merge_work(void *raw) {
     MergeArgs *a = (MergeArgs *)raw;
-    PldFile       sd_pld;
-    PldSessionLog sd_sessions = {NULL, 0};
+    PldView sd_view;
+    PldJournal jnl;
     mkdir(PLD_BACKUP_DIR, 0777);
-    if (R_SUCCEEDED(pld_read_sd(PLD_MERGED_PATH, &sd_pld, &sd_sessions))) {
-        pld_merge_sessions(a->sessions, &sd_sessions, true);
-        pld_merge_summaries(a->pld, sd_pld.summaries, sd_pld.summary_count, true);
-        pld_sessions_free(&sd_sessions);
-        for (int i = 0; i < PLD_SUMMARY_COUNT; i++) {
-            PldSummary *s = &a->pld->summaries[i];
-            if (pld_summary_is_empty(s)) continue;
-            s->total_secs = 0;
-            for (int j = 0; j < a->sessions->count; j++)
-                if (a->sessions->entries[j].title_id == s->title_id)
-                    s->total_secs += a->sessions->entries[j].play_secs;
-        }
+    /* Aggregate the NAND log once; the merge then folds in only the
+     * records it adds from merged.dat. */
+    pld_agg_build(a->agg, a->sessions);
+    /* merged.dat is already this NAND image, sorted with totals applied,
+     * and nothing more: skip reading and rewriting it.  Anything in the
+     * journal came later, so the shortcut only holds without one. */
+    u64 nand_hash = a->pld->image_hash;
+    pld_journal_load(PLD_MERGED_PATH, PLD_JOURNAL_PATH, &jnl);
+    if (jnl.commits == 0 && pld_sd_matches_nand(PLD_MERGED_PATH, nand_hash)) {
+        pld_agg_apply_totals(a->agg, a->pld);
+        pld_sort_sessions(a->sessions);
+        pld_journal_free(&jnl);
+        return;
+    }
+    /* Stream merged.dat, with the journal replayed on top, through a 4 KB
+     * window rather than loading a second 800 KB session table next to the
+     * NAND one. */
+    bool nand_only = true;
+    if (R_SUCCEEDED(pld_view_open(&sd_view, PLD_MERGED_PATH))) {
+        pld_view_set_overlay(&sd_view, &jnl);
+        int new_sess = pld_merge_sessions_view(a->sessions, &sd_view, true,
+                                               a->agg);
+        int new_apps = pld_merge_summaries_view(a->pld, &sd_view, true);
+        pld_view_close(&sd_view);
+        nand_only = (new_sess == 0 && new_apps == 0);
+        pld_agg_refresh(a->agg, a->sessions);
+    }
+    pld_journal_free(&jnl);
+    pld_agg_apply_totals(a->agg, a->pld);
+    /* Keep merged.dat in key order so the next launch merge-joins it
+     * without sorting (a no-op if the merge above already ran).  Only what
+     * the NAND added is appended to the journal; nothing is written when
+     * the result matches what is on SD. */
+    PldCommit commit = { .nand_hash = nand_hash, .nand_only = nand_only };
+    /* A checkpoint builds the image in the arena, held just for this;
+     * without one (low memory) it goes through malloc as before. */
+    PldArena arena;
+    bool staged = pld_arena_begin(&arena, PLD_ARENA_BYTES);
+    pld_journal_commit(PLD_MERGED_PATH, PLD_JOURNAL_PATH, a->pld, a->sessions,
+                       &commit);
+    if (staged) pld_arena_end(&arena);
+}
+
+/* Take the merged result from the snapshot: its NAND image matched, so
+ * it holds if merged.dat and the journal are still what it was made from. */
+static bool load_snapshot(SessionLoad *l) {
+    u64 sd_hash;
+    if (!pld_journal_state_hash(PLD_MERGED_PATH, PLD_JOURNAL_PATH, true,
+                                &sd_hash) ||
+        sd_hash != l->snap->key.sd_hash ||
+        R_FAILED(pld_snapshot_load_summaries(PLD_SNAPSHOT_PATH, l->snap,
+                                             &l->pld)))
+        return false;
+    return R_SUCCEEDED(pld_snapshot_load_sessions(PLD_SNAPSHOT_PATH, l->snap,
+                                                  &l->sessions, l->agg,
+                                                  l->index));
+}
+
+/* Background, behind s_load.fence: read the whole image (one open, one
+ * read), merge merged.dat into it and index the result, or on a warm start
+ * only hash the image and load the snapshot.  The UI thread leaves pld
+ * data alone until the load is adopted (app_ctx_need_sessions). */
+static void load_sessions_work(void *raw) {
+    SessionLoad *l = (SessionLoad *)raw;
+    l->rc = pld_read_all_unless(l->archive, l->snap ? l->snap->key.nand_hash : 0,
+                                &l->pld, &l->sessions);
+    if (l->rc == PLD_RC_UNCHANGED) {
+        l->from_snap = load_snapshot(l);
+        l->rc = l->from_snap ? 0
+                             : pld_read_all(l->archive, &l->pld, &l->sessions);
+    }
+    FSUSER_CloseArchive(l->archive);
+    if (l->from_snap) {
+        l->key = l->snap->key;
+    } else if (R_SUCCEEDED(l->rc)) {
+        /* The commit may clear image_hash. */
+        l->key.nand_hash = l->pld.image_hash;
+        MergeArgs merge_args = { &l->pld, &l->sessions, l->agg };
+        merge_work(&merge_args);
+        pld_index_build(l->index, &l->pld, &l->sessions);
+        if (!pld_journal_state_hash(PLD_MERGED_PATH, PLD_JOURNAL_PATH, true,
+                                    &l->key.sd_hash))
+            l->key.nand_hash = 0;       /* nothing to key a snapshot on */
     }
-    pld_write_sd(PLD_MERGED_PATH, a->pld, a->sessions);
+    l->done_tick = svcGetSystemTick();
 }
 
-/* Step 4: title_names_load */
+static ViewMode starting_view(const AppSettings *s)
+{
+    ViewMode v = (ViewMode)s->starting_view;
+    return v < VIEW_COUNT ? v : VIEW_LAST_PLAYED;
+}
+
+/* At a clean exit, snapshot what startup derived for the next launch to
+ * start from, if it still describes pld.dat and merged.dat (nothing
+ * synced, restored or reset since); otherwise drop the old snapshot.  The
+ * saved view is the one startup builds: starting view, default filters. */
+static void save_snapshot(AppCtx *ctx)
+{
+    u64 sd_hash;
+    if (ctx->load || R_FAILED(ctx->load_rc) || ctx->data_changed ||
+        s_load.key.nand_hash == 0 ||
+        !pld_journal_state_hash(PLD_MERGED_PATH, PLD_JOURNAL_PATH, false,
+                                &sd_hash) ||
+        sd_hash != s_load.key.sd_hash) {
+        remove(PLD_SNAPSHOT_PATH);
+        return;
+    }
+    pld_agg_refresh(ctx->agg, &ctx->sessions);
+    pld_index_refresh(ctx->index, &ctx->pld, &ctx->sessions);
+    ctx->view_mode    = starting_view(&ctx->settings);
+    ctx->show_system  = false;
+    ctx->show_unknown = false;
+    app_ctx_rebuild(ctx);
+    app_ctx_save_view(ctx, &s_view);
+
+    PldSnapKey key = s_load.key;
+    key.names_hash     = title_names_hash();
+    key.installed_hash = s_installed_hash;
+    if (s_warm && s_load.from_snap &&
+        memcmp(&key, &s_snap.key, sizeof(key)) == 0 &&
+        pld_crc32(&s_view, sizeof(s_view), 0) == s_snap.app_crc)
+        return;                         /* already on SD */
+    pld_snapshot_save(PLD_SNAPSHOT_PATH, &key, &ctx->pld, &ctx->sessions,
+                      ctx->agg, ctx->index, &s_view, sizeof(s_view));
+}
+
+/* Status line for startup timing: time to the first interactive frame and,
+ * once adopted, to the session load finishing. */
+static void report_startup(AppCtx *ctx, u64 start, u64 first_frame,
+                           u64 sessions_done)
+{
+    u32 ready_ms = (u32)((first_frame - start) / CPU_TICKS_PER_MSEC);
+    if (ctx->load)
+        snprintf(ctx->status_msg, sizeof(ctx->status_msg),
+                 "Ready in %lu ms, loading sessions", (unsigned long)ready_ms);
+    else if (sessions_done)
+        snprintf(ctx->status_msg, sizeof(ctx->status_msg),
+                 "Ready in %lu ms, sessions in %lu ms", (unsigned long)ready_ms,
+                 (unsigned long)((sessions_done - start) / CPU_TICKS_PER_MSEC));
+}
+
+/* Step 3: title_names_load */
 static void title_names_load_work(void *arg) {
     (void)arg;
     title_names_load();
 }
 
-/* Step 5: Scan installed titles */
+/* Step 4: Scan installed titles */
 typedef struct {
     int new_names;
 } ScanNamesArgs;
@@ -111,13 +245,13 @@ static void scan_names_work(void *raw) {
     if (a->new_names > 0) title_names_save();
 }
 
-/* Step 6: title_icons_load_sd_cache */
+/* Step 5: title_icons_load_sd_cache */
 static void title_icons_load_work(void *arg) {
     (void)arg;
     title_icons_load_sd_cache();
 }
 
-/* Step 7 + post-sync: icon_fetch_missing */
+/* Step 6 + post-sync: icon_fetch_missing */
 typedef struct {
     const PldSummary *const *valid;
     int n;
@@ -132,6 +266,7 @@ static void icon_fetch_work(void *raw) {
 
 int main(void)
 {
+    u64 start_tick = svcGetSystemTick();
     gfxInitDefault();
     ui_init();
     fsInit();
@@ -140,7 +275,7 @@ int main(void)
 
     /* Step 1: Open save archive */
     OpenArchiveArgs oa_args = { region_ids, 4, 0, -1 };
-    run_with_spinner("Activity Log++", "Opening save archive...", 1, 7,
+    run_with_spinner("Activity Log++", "Opening save archive...", 1, 6,
                      open_archive_work, &oa_args);
     if (R_FAILED(oa_args.rc)) {
         char err_body[96];
@@ -160,21 +295,23 @@ int main(void)
         return 1;
     }
 
-    /* Step 2: Read summary + sessions */
+    /* Step 2: Read the summary table */
     AppCtx ctx;
     memset(&ctx, 0, sizeof(ctx));
     ctx.region_ids   = region_ids;
     ctx.region_count = 4;
+    ctx.agg          = &s_agg;
+    ctx.index        = &s_index;
 
-    ReadPldArgs rp_args = { oa_args.archive, &ctx.pld, &ctx.sessions, -1, -1 };
-    run_with_spinner("Activity Log++", "Reading pld.dat...", 2, 7,
+    ReadPldArgs rp_args = { oa_args.archive, &ctx.pld, -1 };
+    run_with_spinner("Activity Log++", "Reading pld.dat...", 2, 6,
                      read_pld_work, &rp_args);
-    FSUSER_CloseArchive(oa_args.archive);
-    if (R_FAILED(rp_args.rc_summary)) {
+    if (R_FAILED(rp_args.rc)) {
+        FSUSER_CloseArchive(oa_args.archive);
         char err_body[80];
         snprintf(err_body, sizeof(err_body),
-                 "Error reading summary: 0x%08lX\n\nPress START to exit.",
-                 rp_args.rc_summary);
+                 "Error reading pld.dat: 0x%08lX\n\nPress START to exit.",
+                 rp_args.rc);
         while (aptMainLoop()) {
             hidScanInput();
             if (hidKeysDown() & KEY_START) break;
@@ -187,56 +324,76 @@ int main(void)
         gfxExit();
         return 1;
     }
-    if (R_FAILED(rp_args.rc_sessions)) {
-        char err_body[80];
-        snprintf(err_body, sizeof(err_body),
-                 "Error reading sessions: 0x%08lX\n\nPress START to exit.",
-                 rp_args.rc_sessions);
-        while (aptMainLoop()) {
-            hidScanInput();
-            if (hidKeysDown() & KEY_START) break;
-            draw_message_screen("Error", err_body);
-        }
-        audio_exit();
-        ui_fini();
-        romfsExit();
-        fsExit();
-        gfxExit();
-        return 1;
+
+    /* Load user settings and hidden-games list (the merge below commits
+     * under the backup and rollup settings) */
+    settings_load(&ctx.settings);
+    settings_apply_backup_retention(&ctx.settings);
+    settings_apply_rollup(&ctx.settings);
+    hidden_load(&ctx.hidden);
+    ctx.view_mode = starting_view(&ctx.settings);
+
+    /* Warm start: the last exit's snapshot was taken over this NAND summary
+     * table and merged.dat, so the list starts from its merged summaries
+     * (the load below still checks the rest of the image). */
+    u64 sd_hash;
+    s_load.key.summary_hash = pld_summary_hash(&ctx.pld);
+    s_warm = R_SUCCEEDED(pld_snapshot_header(PLD_SNAPSHOT_PATH, &s_snap)) &&
+             s_snap.key.summary_hash == s_load.key.summary_hash &&
+             pld_journal_state_hash(PLD_MERGED_PATH, PLD_JOURNAL_PATH, false,
+                                    &sd_hash) &&
+             sd_hash == s_snap.key.sd_hash;
+    if (s_warm) {
+        PldFile snap_pld;
+        s_warm = R_SUCCEEDED(pld_snapshot_load_summaries(PLD_SNAPSHOT_PATH,
+                                                         &s_snap, &snap_pld));
+        if (s_warm) ctx.pld = snap_pld;
     }
 
-    /* Step 3: Load SD merged.dat and add-only merge into NAND data */
-    MergeArgs merge_args = { &ctx.pld, &ctx.sessions };
-    run_with_spinner("Activity Log++", "Loading merged data...", 3, 7,
-                     merge_work, &merge_args);
+    /* Sessions: read, merge with SD merged.dat and index in the background
+     * while the remaining steps and the list run on the summaries. */
+    s_load.archive = oa_args.archive;
+    s_load.agg     = ctx.agg;
+    s_load.index   = ctx.index;
+    s_load.snap    = s_warm ? &s_snap : NULL;
+    ctx.load       = &s_load;
+    pld_fence_start(&s_load.fence, load_sessions_work, &s_load);
 
     ctx.sync_count = load_sync_count();
 
-    /* Step 4: Load persisted title names */
-    run_with_spinner("Activity Log++", "Loading title names...", 4, 7,
+    /* Step 3: Load persisted title names */
+    run_with_spinner("Activity Log++", "Loading title names...", 3, 6,
                      title_names_load_work, NULL);
 
-    /* Step 5: Scan installed titles */
-    ScanNamesArgs sn_args = { 0 };
-    run_with_spinner("Activity Log++", "Scanning installed titles...", 5, 7,
-                     scan_names_work, &sn_args);
-
-    /* Load user settings and hidden-games list */
-    settings_load(&ctx.settings);
-    hidden_load(&ctx.hidden);
-    ctx.view_mode = (ViewMode)ctx.settings.starting_view;
-    if (ctx.view_mode >= VIEW_COUNT) ctx.view_mode = VIEW_LAST_PLAYED;
-
-    /* Build valid[] before icon fetch so fetch knows which titles need icons */
-    app_ctx_rebuild(&ctx);
+    /* Step 4: Scan installed titles, unless nothing has been installed or
+     * removed and the names are the ones the snapshot's view was sorted by */
+    s_installed_hash = title_names_installed_hash();
+    bool names_warm = s_warm && s_installed_hash &&
+                      s_installed_hash == s_snap.key.installed_hash &&
+                      title_names_hash() == s_snap.key.names_hash;
+    if (!names_warm) {
+        ScanNamesArgs sn_args = { 0 };
+        run_with_spinner("Activity Log++", "Scanning installed titles...", 4, 6,
+                         scan_names_work, &sn_args);
+    }
 
-    /* Step 6: Load icon cache */
-    run_with_spinner("Activity Log++", "Loading icon cache...", 6, 7,
+    /* Build valid[] before icon fetch so fetch knows which titles need
+     * icons; titles only merged.dat knows are in it if the load is done.
+     * A warm start takes the order the last exit saved. */
+    if (!app_ctx_poll_sessions(&ctx) &&
+        !(names_warm && s_snap.app_size == sizeof(s_view) &&
+          R_SUCCEEDED(pld_snapshot_load_app(PLD_SNAPSHOT_PATH, &s_snap,
+                                            &s_view, sizeof(s_view))) &&
+          app_ctx_restore_view(&ctx, &s_view)))
+        app_ctx_rebuild(&ctx);
+
+    /* Step 5: Load icon cache */
+    run_with_spinner("Activity Log++", "Loading icon cache...", 5, 6,
                      title_icons_load_work, NULL);
 
-    /* Step 7: Fetch missing icons */
+    /* Step 6: Fetch missing icons */
     IconFetchArgs if_args = { ctx.valid, ctx.n };
-    run_with_spinner("Activity Log++", "Fetching missing icons (this may take a moment)...", 7, 7,
+    run_with_spinner("Activity Log++", "Fetching missing icons (this may take a moment)...", 6, 6,
                      icon_fetch_work, &if_args);
 
     /* Start background music after all setup is complete */
@@ -262,10 +419,18 @@ int main(void)
     int  prev_rank_sel = -1;
     float rank_sel_pop = 0.0f;
 
+    /* Startup timing, reported in the status line */
+    u64 first_frame_tick = 0;
+
     /* ── Input loop ── */
     bool quit_requested = false;
     while (!quit_requested && aptMainLoop()) {
         audio_tick();
+        if (app_ctx_poll_sessions(&ctx) && first_frame_tick &&
+            R_SUCCEEDED(ctx.load_rc) &&
+            strncmp(ctx.status_msg, "Ready in ", 9) == 0)
+            report_startup(&ctx, start_tick, first_frame_tick,
+                           s_load.done_tick);
         hidScanInput();
         u32 keys = hidKeysDown();
         u32 held = hidKeysHeld();
@@ -307,6 +472,11 @@ int main(void)
                 menu_open = false;
             } else if (keys & KEY_START) {
                 quit_requested = true;
+            } else if ((keys & KEY_A) && menu_sel >= 1 && menu_sel <= 6 &&
+                       !app_ctx_need_sessions(&ctx)) {
+                /* Everything from Sync to Settings reads sessions or
+                 * writes pld data, so waits for the startup load. */
+                menu_open = false;
             } else if (keys & KEY_A) {
                 switch (menu_sel) {
                     case 0: /* Charts */
@@ -319,10 +489,11 @@ int main(void)
                         break;
 
                     case 1: /* Sync */
-                        run_sync_flow(&ctx.pld, &ctx.sessions, &ctx.sync_count,
+                        run_sync_flow(&ctx.pld, &ctx.sessions, ctx.agg,
+                                      &ctx.sync_count,
                                       ctx.status_msg, sizeof(ctx.status_msg));
                         ctx.view_mode = VIEW_LAST_PLAYED;
-                        app_ctx_rebuild(&ctx);
+                        app_ctx_data_changed(&ctx);
                         {
                             IconFetchArgs psif_args = { ctx.valid, ctx.n };
                             run_loading_with_spinner("Activity Log++",
@@ -334,8 +505,12 @@ int main(void)
 
                     case 2: /* Backup */
                         {
-                            Result bk_rc = pld_backup_from_path(PLD_MERGED_PATH);
-                            if (R_SUCCEEDED(bk_rc))
+                            Result bk_rc = pld_journal_backup(PLD_MERGED_PATH,
+                                                              PLD_JOURNAL_PATH);
+                            if (bk_rc == PLD_RC_UNCHANGED)
+                                snprintf(ctx.status_msg, sizeof(ctx.status_msg),
+                                         "Backup unchanged");
+                            else if (R_SUCCEEDED(bk_rc))
                                 snprintf(ctx.status_msg, sizeof(ctx.status_msg),
                                          "Backup OK");
                             else
@@ -347,7 +522,7 @@ int main(void)
 
                     case 3: /* Export */
                         {
-                            ExportArgs exp_args = { &ctx.pld, &ctx.sessions, -1 };
+                            ExportArgs exp_args = { &ctx.pld, ctx.index, -1 };
                             run_loading_with_spinner("Activity Log++",
                                 "Exporting data...",
                                 export_work, &exp_args);
@@ -449,8 +624,14 @@ int main(void)
                     if ((keys & KEY_A) && ctx.n > 0)
                         det_s = ctx.valid[ctx.sel];
                 }
-                if (det_s)
-                    run_detail_view(&ctx, det_s);
+                /* The wait may adopt the load and rebuild the view, with
+                 * the cursor kept on the same title. */
+                if (det_s && app_ctx_need_sessions(&ctx)) {
+                    det_s = view_is_rank(ctx.view_mode)
+                          ? (ctx.rank_count > 0 ? ctx.ranked[ctx.rank_sel] : NULL)
+                          : (ctx.n > 0 ? ctx.valid[ctx.sel] : NULL);
+                    if (det_s) run_detail_view(&ctx, det_s);
+                }
             }
         }
 
@@ -511,8 +692,21 @@ int main(void)
                 ui_end_frame();
             }
         }
+
+        if (!first_frame_tick) {
+            first_frame_tick = svcGetSystemTick();
+            if (ctx.status_msg[0] == '\0' && R_SUCCEEDED(ctx.load_rc))
+                report_startup(&ctx, start_tick, first_frame_tick,
+                               s_load.done_tick);
+        }
     }
 
+    /* The load may still be committing merged.dat. */
+    app_ctx_need_sessions(&ctx);
+    save_snapshot(&ctx);
+
+    /* Peaks are what matter; cur shows what is still live at exit. */
+    MEM_REPORT(MEMPROF_PATH);
     pld_sessions_free(&ctx.sessions);
     title_icons_free();
     title_names_free();
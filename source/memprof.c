@@ -0,0 +1,299 @@
+#include "memprof.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __3DS__
+#include <3ds.h>
+#include <malloc.h>
+#else
+#include <pthread.h>
+#endif
+
+/*
+ * memprof.c — bookkeeping behind the MEM_* macros
+ *
+ * Live blocks sit in an open-addressed table keyed by address (linear
+ * probing, backward-shift deletion); each remembers its size and call
+ * site.  Sites are interned in first-seen order by name, so one MEM_SITE
+ * string repeated across translation units is still one site.  Once
+ * either table is full, new sites share the last slot ("other") and new
+ * blocks go untracked (counted in the report).
+ *
+ * Icon fetching runs on a worker thread while the UI thread allocates, so
+ * every update is made under one lock.
+ */
+
+typedef struct {
+    const void *p;        /* NULL = empty slot */
+    size_t      size;
+    int         site;
+} Block;
+
+typedef struct {
+    const char *name;
+    MemSub      sub;
+    MemStat     st;
+} Site;
+
+static Block   s_blocks[MEMPROF_BLOCKS];
+static Site    s_sites[MEMPROF_SITES];
+static int     s_site_count;
+static MemStat s_subs[MEM_SUB_COUNT];
+static u32     s_untracked;
+
+static const char *const s_sub_names[MEM_SUB_COUNT] = {
+    "pld", "net", "icon", "tex", "audio",
+};
+
+#ifdef __3DS__
+static LightLock s_lock;
+static bool      s_lock_ready;
+
+static void lock(void)
+{
+    /* First use is on the main thread, before any worker starts. */
+    if (!s_lock_ready) {
+        LightLock_Init(&s_lock);
+        s_lock_ready = true;
+    }
+    LightLock_Lock(&s_lock);
+}
+
+static void unlock(void)
+{
+    LightLock_Unlock(&s_lock);
+}
+#else
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void lock(void)
+{
+    pthread_mutex_lock(&s_lock);
+}
+
+static void unlock(void)
+{
+    pthread_mutex_unlock(&s_lock);
+}
+#endif
+
+static inline u32 slot_of(const void *p)
+{
+    u64 h = (u64)(uintptr_t)p * 0x9E3779B97F4A7C15ULL;
+    return (u32)(h >> 40) % MEMPROF_BLOCKS;
+}
+
+static int site_index(MemSub sub, const char *name)
+{
+    for (int i = 0; i < s_site_count; i++)
+        if (s_sites[i].name == name || strcmp(s_sites[i].name, name) == 0)
+            return i;
+    if (s_site_count == MEMPROF_SITES - 1) {
+        s_sites[s_site_count].name = "other";
+        s_sites[s_site_count].sub  = sub;
+        s_site_count++;
+    }
+    if (s_site_count == MEMPROF_SITES) return MEMPROF_SITES - 1;
+    s_sites[s_site_count].name = name;
+    s_sites[s_site_count].sub  = sub;
+    return s_site_count++;
+}
+
+static void stat_add(MemStat *st, size_t n)
+{
+    st->cur += n;
+    st->allocs++;
+    if (st->cur > st->peak) st->peak = st->cur;
+}
+
+/* Callers hold the lock. */
+static void track(MemSub sub, const char *site, const void *p, size_t n)
+{
+    if (!p) return;
+    u32 i = slot_of(p);
+    for (u32 probes = 0; s_blocks[i].p; probes++) {
+        if (probes == MEMPROF_BLOCKS) {
+            s_untracked++;
+            return;
+        }
+        i = (i + 1) % MEMPROF_BLOCKS;
+    }
+    int s = site_index(sub, site);
+    s_blocks[i].p    = p;
+    s_blocks[i].size = n;
+    s_blocks[i].site = s;
+    stat_add(&s_sites[s].st, n);
+    stat_add(&s_subs[s_sites[s].sub], n);
+}
+
+/* Remove p, returning its entry (p NULL if it wasn't tracked). */
+static Block untrack(const void *p)
+{
+    Block none = { NULL, 0, 0 };
+    if (!p) return none;
+    u32 i = slot_of(p);
+    for (u32 probes = 0; s_blocks[i].p != p; probes++) {
+        if (!s_blocks[i].p || probes == MEMPROF_BLOCKS) return none;
+        i = (i + 1) % MEMPROF_BLOCKS;
+    }
+    Block b = s_blocks[i];
+    Site *s = &s_sites[b.site];
+    s->st.cur -= b.size;
+    s_subs[s->sub].cur -= b.size;
+
+    /* Backward shift: pull later members of the probe run into the hole
+     * unless that would move them before their home slot. */
+    u32 hole = i, j = i;
+    for (u32 n = 1; n < MEMPROF_BLOCKS; n++) {
+        j = (j + 1) % MEMPROF_BLOCKS;
+        if (!s_blocks[j].p) break;
+        u32 home = slot_of(s_blocks[j].p);
+        bool movable = (hole <= j) ? (home <= hole || home > j)
+                                   : (home <= hole && home > j);
+        if (movable) {
+            s_blocks[hole] = s_blocks[j];
+            hole = j;
+        }
+    }
+    s_blocks[hole].p = NULL;
+    return b;
+}
+
+/* ── Allocators ─────────────────────────────────────────────────── */
+
+void *memprof_malloc(MemSub sub, const char *site, size_t n)
+{
+    void *p = malloc(n);
+    lock();
+    track(sub, site, p, n);
+    unlock();
+    return p;
+}
+
+void *memprof_calloc(MemSub sub, const char *site, size_t n, size_t size)
+{
+    void *p = calloc(n, size);
+    lock();
+    track(sub, site, p, n * size);
+    unlock();
+    return p;
+}
+
+void *memprof_realloc(MemSub sub, const char *site, void *p, size_t n)
+{
+    /* Dropped first: once realloc moves the block, another thread's
+     * allocation may land at p. */
+    lock();
+    Block old = untrack(p);
+    unlock();
+    void *q = realloc(p, n);
+    lock();
+    if (q) {
+        track(sub, site, q, n);
+    } else if (old.p) {
+        /* p is untouched; put it back.  A second allocation counted. */
+        track(s_sites[old.site].sub, s_sites[old.site].name, old.p, old.size);
+    }
+    unlock();
+    return q;
+}
+
+void memprof_free(void *p)
+{
+    memprof_forget(p);
+    free(p);
+}
+
+#ifdef __3DS__
+void *memprof_memalign(MemSub sub, const char *site, size_t align, size_t n)
+{
+    void *p = memalign(align, n);
+    lock();
+    track(sub, site, p, n);
+    unlock();
+    return p;
+}
+
+void *memprof_linear_alloc(MemSub sub, const char *site, size_t n)
+{
+    void *p = linearAlloc(n);
+    lock();
+    track(sub, site, p, n);
+    unlock();
+    return p;
+}
+
+void memprof_linear_free(void *p)
+{
+    memprof_forget(p);
+    linearFree(p);
+}
+#endif
+
+void memprof_note(MemSub sub, const char *site, const void *p, size_t n)
+{
+    lock();
+    track(sub, site, p, n);
+    unlock();
+}
+
+void memprof_forget(const void *p)
+{
+    lock();
+    untrack(p);
+    unlock();
+}
+
+/* ── Report ─────────────────────────────────────────────────────── */
+
+void memprof_sub_stat(MemSub sub, MemStat *out)
+{
+    lock();
+    *out = s_subs[sub];
+    unlock();
+}
+
+bool memprof_site_stat(const char *site, MemStat *out)
+{
+    bool found = false;
+    lock();
+    for (int i = 0; i < s_site_count && !found; i++) {
+        if (strcmp(s_sites[i].name, site) == 0) {
+            *out  = s_sites[i].st;
+            found = true;
+        }
+    }
+    unlock();
+    return found;
+}
+
+bool memprof_report(const char *path)
+{
+    FILE *f = path ? fopen(path, "w") : stdout;
+    if (!f) return false;
+
+    lock();
+    fprintf(f, "{\n  \"subsystems\": [\n");
+    for (int i = 0; i < MEM_SUB_COUNT; i++)
+        fprintf(f, "    { \"name\": \"%s\", \"cur\": %llu, \"peak\": %llu, "
+                "\"allocs\": %u }%s\n", s_sub_names[i],
+                (unsigned long long)s_subs[i].cur,
+                (unsigned long long)s_subs[i].peak, (unsigned)s_subs[i].allocs,
+                i + 1 < MEM_SUB_COUNT ? "," : "");
+    fprintf(f, "  ],\n  \"sites\": [\n");
+    for (int i = 0; i < s_site_count; i++)
+        fprintf(f, "    { \"site\": \"%s\", \"subsystem\": \"%s\", "
+                "\"cur\": %llu, \"peak\": %llu, \"allocs\": %u }%s\n",
+                s_sites[i].name, s_sub_names[s_sites[i].sub],
+                (unsigned long long)s_sites[i].st.cur,
+                (unsigned long long)s_sites[i].st.peak,
+                (unsigned)s_sites[i].st.allocs,
+                i + 1 < s_site_count ? "," : "");
+    fprintf(f, "  ],\n  \"untracked_blocks\": %u\n}\n", (unsigned)s_untracked);
+    unlock();
+
+    bool ok = !ferror(f);
+    if (path) ok = (fclose(f) == 0) && ok;
+    return ok;
+}
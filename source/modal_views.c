@@ -26,6 +26,7 @@ static void reset_read_work(void *raw)
 {
     ResetReadArgs *a = (ResetReadArgs *)raw;
     a->sessions.entries = NULL;
+    a->sessions.titles  = NULL;
     a->sessions.count   = 0;
     a->rc = -1;
     FS_Archive rst_archive = 0;
@@ -34,13 +35,63 @@ static void reset_read_work(void *raw)
         if (R_SUCCEEDED(a->rc)) break;
     }
     if (R_FAILED(a->rc)) return;
-    a->rc = pld_read_summary(rst_archive, &a->pld);
-    if (R_FAILED(a->rc)) { FSUSER_CloseArchive(rst_archive); return; }
-    a->rc = pld_read_sessions(rst_archive, &a->sessions);
+    a->rc = pld_read_all(rst_archive, &a->pld, &a->sessions);
     FSUSER_CloseArchive(rst_archive);
-    if (R_FAILED(a->rc)) { pld_sessions_free(&a->sessions); return; }
-    pld_backup_from_path(PLD_MERGED_PATH);
-    a->rc = pld_write_sd(PLD_MERGED_PATH, &a->pld, &a->sessions);
+    if (R_FAILED(a->rc)) return;
+    pld_sort_sessions(&a->sessions);
+    PldCommit commit = { .backup = true };
+    a->rc = pld_journal_checkpoint(PLD_MERGED_PATH, PLD_JOURNAL_PATH,
+                                   &a->pld, &a->sessions, &commit);
+    if (R_FAILED(a->rc)) pld_sessions_free(&a->sessions);
+}
+
+/* ── Merge-all worker (used only by run_restore_view) ──────────── */
+
+typedef struct {
+    AppCtx           *ctx;
+    const PldCatalog *cat;
+    PldFile           pld;
+    PldSessionLog     sessions;
+    int               added;
+    Result            rc;
+} MergeAllArgs;
+
+/* Folds every backup into a copy of the current data in one k-way merge;
+ * sessions already present win, so older snapshots of the same history
+ * add only what has since been lost.  The copy is kept only once it is
+ * committed, so a failed merge leaves ctx as it was. */
+static void merge_all_work(void *raw)
+{
+    MergeAllArgs *a = (MergeAllArgs *)raw;
+    AppCtx *ctx = a->ctx;
+    a->rc = -1;
+    if (!pld_log_alloc(&a->sessions)) return;
+    a->pld = ctx->pld;
+    memcpy(a->sessions.entries, ctx->sessions.entries,
+           (size_t)ctx->sessions.count * sizeof(PldRec));
+    a->sessions.count = ctx->sessions.count;
+    *a->sessions.titles = *ctx->sessions.titles;
+    char (*names)[160] = malloc((size_t)a->cat->count * sizeof(*names));
+    const char **paths = malloc((size_t)a->cat->count * sizeof(*paths));
+    if (names && paths) {
+        for (int i = 0; i < a->cat->count; i++) {
+            snprintf(names[i], sizeof(names[i]), "%s/%s", PLD_BACKUP_DIR,
+                     a->cat->entries[i].name);
+            paths[i] = names[i];
+        }
+        a->added = pld_merge_many(&a->pld, &a->sessions, paths,
+                                  a->cat->count, true, PLD_BACKUP_DIR);
+        if (a->added >= 0) {
+            PldCommit commit = { .backup = true };
+            a->rc = pld_journal_commit(PLD_MERGED_PATH, PLD_JOURNAL_PATH,
+                                       &a->pld, &a->sessions, &commit);
+            if (R_SUCCEEDED(a->rc))
+                pld_ext_fold_log(PLD_EXT_PATH, &a->pld, &a->sessions,
+                                 NULL, 0);
+        }
+    }
+    free(paths);
+    free(names);
     if (R_FAILED(a->rc)) pld_sessions_free(&a->sessions);
 }
 
@@ -57,23 +108,21 @@ void run_detail_view(AppCtx *ctx, const PldSummary *game)
         det_name = det_fallback;
     }
 
-    int *det_indices = malloc(ctx->sessions.count * sizeof(int));
-    int  det_count = 0;
-    if (det_indices) {
-        for (int i = 0; i < ctx->sessions.count; i++) {
-            if (ctx->sessions.entries[i].title_id == game->title_id)
-                det_indices[det_count++] = i;
-        }
-        for (int i = 0; i < det_count - 1; i++) {
-            for (int j = i + 1; j < det_count; j++) {
-                if (ctx->sessions.entries[det_indices[i]].timestamp <
-                    ctx->sessions.entries[det_indices[j]].timestamp) {
-                    int tmp = det_indices[i];
-                    det_indices[i] = det_indices[j];
-                    det_indices[j] = tmp;
-                }
-            }
-        }
+    const PldRec *det_recs;
+    pld_index_refresh(ctx->index, &ctx->pld, &ctx->sessions);
+    int det_count = pld_index_range(ctx->index,
+                                    (int)(game - ctx->pld.summaries),
+                                    &det_recs);
+
+    /* Rolled-up years only live in merged2.dat; one title's blocks and
+     * its rollups are a small read. */
+    PldExtTitleStats det_all;
+    bool det_have_all = false;
+    PldExtReader det_xr;
+    if (R_SUCCEEDED(pld_ext_open(&det_xr, PLD_EXT_PATH))) {
+        det_have_all = pld_ext_title_stats(&det_xr, game->title_id,
+                                           &det_all) == 0;
+        pld_ext_close(&det_xr);
     }
 
     int detail_scroll = 0;
@@ -107,15 +156,13 @@ void run_detail_view(AppCtx *ctx, const PldSummary *game)
             bool is_hidden = hidden_contains(&ctx->hidden, game->title_id);
             ui_begin_frame();
             ui_target_top();
-            render_detail_top(game, det_name, &ctx->sessions,
-                              det_indices, det_count,
-                              detail_scroll);
+            render_detail_top(game, det_name, det_recs, det_count,
+                              detail_scroll, det_have_all ? &det_all : NULL);
             ui_target_bot();
             render_detail_bot(is_hidden);
             ui_end_frame();
         }
     }
-    free(det_indices);
     if (det_hidden_toggled)
         app_ctx_rebuild(ctx);
 }
@@ -129,6 +176,10 @@ void run_settings_view(AppCtx *ctx)
     int svi = (int)ctx->settings.starting_view;
     if (svi < 0 || svi >= VIEW_COUNT) svi = 0;
     int music_on = ctx->settings.music_enabled ? 1 : 0;
+    int bki = settings_backup_keep_index(ctx->settings.backup_keep);
+    int bsi = settings_backup_size_index(ctx->settings.backup_max_kb);
+    int roi = settings_rollup_index(ctx->settings.rollup_day_after,
+                                    ctx->settings.rollup_week_after);
     bool set_done = false;
     nav_reset();
     while (!set_done && aptMainLoop()) {
@@ -142,7 +193,7 @@ void run_settings_view(AppCtx *ctx)
         } else if (snav & KEY_UP) {
             if (set_sel > 0) set_sel--;
         } else if (snav & KEY_DOWN) {
-            if (set_sel < 2) set_sel++;
+            if (set_sel < 5) set_sel++;
         } else if (skeys & (KEY_LEFT | KEY_RIGHT)) {
             int dir = (skeys & KEY_RIGHT) ? 1 : -1;
             if (set_sel == 0) {
@@ -150,8 +201,16 @@ void run_settings_view(AppCtx *ctx)
                       % MIN_PLAY_OPTION_COUNT;
             } else if (set_sel == 1) {
                 svi = (svi + dir + VIEW_COUNT) % VIEW_COUNT;
-            } else {
+            } else if (set_sel == 2) {
                 music_on = !music_on;
+            } else if (set_sel == 3) {
+                bki = (bki + dir + BACKUP_KEEP_OPTION_COUNT)
+                      % BACKUP_KEEP_OPTION_COUNT;
+            } else if (set_sel == 4) {
+                bsi = (bsi + dir + BACKUP_SIZE_OPTION_COUNT)
+                      % BACKUP_SIZE_OPTION_COUNT;
+            } else {
+                roi = (roi + dir + ROLLUP_OPTION_COUNT) % ROLLUP_OPTION_COUNT;
             }
         }
 
@@ -164,8 +223,8 @@ void run_settings_view(AppCtx *ctx)
                          UI_COL_HEADER_TXT, "Settings");
 
             float sy = 40.0f;
-            for (int r = 0; r < 3; r++) {
-                float ry = sy + (float)r * 36.0f;
+            for (int r = 0; r < 6; r++) {
+                float ry = sy + (float)r * 33.0f;
                 u32 rbg = (r == set_sel) ? UI_COL_ROW_SEL
                         : (r % 2 == 0)   ? UI_COL_BG
                                           : UI_COL_ROW_ALT;
@@ -173,7 +232,10 @@ void run_settings_view(AppCtx *ctx)
 
                 const char *label = (r == 0) ? "Min playtime"
                                    : (r == 1) ? "Starting view"
-                                              : "Music";
+                                   : (r == 2) ? "Music"
+                                   : (r == 3) ? "Backups kept"
+                                   : (r == 4) ? "Backup space"
+                                              : "Old history";
                 ui_draw_text(8, ry + 4, UI_SCALE_LG,
                              UI_COL_TEXT, label);
 
@@ -182,8 +244,14 @@ void run_settings_view(AppCtx *ctx)
                     val = min_play_labels[mpi];
                 } else if (r == 1) {
                     val = view_labels[svi];
-                } else {
+                } else if (r == 2) {
                     val = music_on ? "On" : "Off";
+                } else if (r == 3) {
+                    val = backup_keep_labels[bki];
+                } else if (r == 4) {
+                    val = backup_size_labels[bsi];
+                } else {
+                    val = rollup_labels[roi];
                 }
                 ui_draw_text_right(UI_TOP_W - 12, ry + 4,
                                    UI_SCALE_LG,
@@ -209,33 +277,35 @@ void run_settings_view(AppCtx *ctx)
     ctx->settings.min_play_secs  = min_play_options[mpi];
     ctx->settings.starting_view  = (u32)svi;
     ctx->settings.music_enabled  = music_on ? 1 : 0;
+    ctx->settings.backup_keep    = backup_keep_options[bki];
+    ctx->settings.backup_max_kb  = backup_size_options[bsi];
+    ctx->settings.rollup_day_after  = rollup_day_options[roi];
+    ctx->settings.rollup_week_after = rollup_week_options[roi];
     settings_save(&ctx->settings);
+    settings_apply_backup_retention(&ctx->settings);
+    settings_apply_rollup(&ctx->settings);
     audio_set_enabled(music_on);
     app_ctx_rebuild(ctx);
 }
 
 /* ── Restore view ──────────────────────────────────────────────── */
 
+#define RESTORE_ROWS 10
+
 void run_restore_view(AppCtx *ctx)
 {
-    PldBackupList bklist;
-    Result list_rc = pld_list_backups(&bklist);
-    if (R_FAILED(list_rc) || bklist.count == 0) {
+    PldCatalog cat;
+    Result list_rc = pld_catalog_load(PLD_BACKUP_DIR, &cat);
+    if (R_FAILED(list_rc) || cat.count == 0) {
         snprintf(ctx->status_msg, sizeof(ctx->status_msg),
-                 bklist.count == 0 ? "No backups found"
-                                   : "Error listing backups");
+                 cat.count == 0 ? "No backups found"
+                                : "Error listing backups");
+        pld_catalog_free(&cat);
         return;
     }
 
-    int app_counts[PLD_MAX_BACKUPS] = {0};
-    for (int i = 0; i < bklist.count; i++) {
-        char fp[128];
-        snprintf(fp, sizeof(fp), "%s/%s",
-                 PLD_BACKUP_DIR, bklist.names[i]);
-        pld_backup_app_count(fp, &app_counts[i]);
-    }
-
     int  chooser_sel  = 0;
+    int  chooser_top  = 0;
     bool chooser_done = false;
     nav_reset();
     while (!chooser_done && aptMainLoop()) {
@@ -250,24 +320,59 @@ void run_restore_view(AppCtx *ctx)
         } else if (cnav & KEY_UP) {
             if (chooser_sel > 0) chooser_sel--;
         } else if (cnav & KEY_DOWN) {
-            if (chooser_sel < bklist.count - 1) chooser_sel++;
+            if (chooser_sel < cat.count - 1) chooser_sel++;
+        } else if (ckeys & (KEY_LEFT | KEY_L)) {
+            chooser_sel -= RESTORE_ROWS;
+            if (chooser_sel < 0) chooser_sel = 0;
+        } else if (ckeys & (KEY_RIGHT | KEY_R)) {
+            chooser_sel += RESTORE_ROWS;
+            if (chooser_sel > cat.count - 1) chooser_sel = cat.count - 1;
+        } else if (ckeys & KEY_X) {
+            MergeAllArgs ma_args;
+            memset(&ma_args, 0, sizeof(ma_args));
+            ma_args.ctx = ctx;
+            ma_args.cat = &cat;
+            ma_args.rc  = -1;
+            run_loading_with_spinner("Activity Log++",
+                                     "Merging all backups...",
+                                     merge_all_work, &ma_args);
+            if (R_SUCCEEDED(ma_args.rc)) {
+                pld_sessions_free(&ctx->sessions);
+                ctx->pld      = ma_args.pld;
+                ctx->sessions = ma_args.sessions;
+                pld_agg_build(ctx->agg, &ctx->sessions);
+                pld_agg_apply_totals(ctx->agg, &ctx->pld);
+                ctx->view_mode = VIEW_LAST_PLAYED;
+                app_ctx_data_changed(ctx);
+                snprintf(ctx->status_msg, sizeof(ctx->status_msg),
+                         "Merged %d backups: +%d sess", cat.count,
+                         ma_args.added);
+            } else {
+                snprintf(ctx->status_msg, sizeof(ctx->status_msg),
+                         "Merge failed: 0x%08lX", ma_args.rc);
+            }
+            chooser_done = true;
         } else if (ckeys & KEY_A) {
-            char full_path[128];
+            char full_path[160];
             snprintf(full_path, sizeof(full_path), "%s/%s",
-                     PLD_BACKUP_DIR, bklist.names[chooser_sel]);
+                     PLD_BACKUP_DIR, cat.entries[chooser_sel].name);
 
             PldFile       rst_pld;
-            PldSessionLog rst_sessions = {NULL, 0};
-            Result rst_rc = pld_read_sd(full_path, &rst_pld, &rst_sessions);
+            PldSessionLog rst_sessions = {NULL, 0, NULL};
+            Result rst_rc = pld_backup_read(full_path, &rst_pld, &rst_sessions);
             if (R_SUCCEEDED(rst_rc)) {
-                rst_rc = pld_write_sd(PLD_MERGED_PATH, &rst_pld, &rst_sessions);
+                pld_sort_sessions(&rst_sessions);
+                rst_rc = pld_journal_checkpoint(PLD_MERGED_PATH,
+                                                PLD_JOURNAL_PATH, &rst_pld,
+                                                &rst_sessions, NULL);
             }
             if (R_SUCCEEDED(rst_rc)) {
                 pld_sessions_free(&ctx->sessions);
                 ctx->pld      = rst_pld;
                 ctx->sessions = rst_sessions;
+                pld_agg_build(ctx->agg, &ctx->sessions);
                 ctx->view_mode = VIEW_LAST_PLAYED;
-                app_ctx_rebuild(ctx);
+                app_ctx_data_changed(ctx);
             } else {
                 pld_sessions_free(&rst_sessions);
             }
@@ -280,6 +385,10 @@ void run_restore_view(AppCtx *ctx)
             chooser_done = true;
         }
 
+        if (chooser_sel < chooser_top) chooser_top = chooser_sel;
+        if (chooser_sel >= chooser_top + RESTORE_ROWS)
+            chooser_top = chooser_sel - RESTORE_ROWS + 1;
+
         if (!chooser_done) {
             ui_begin_frame();
             ui_target_top();
@@ -287,24 +396,38 @@ void run_restore_view(AppCtx *ctx)
             ui_draw_text(6, 4, UI_SCALE_HDR, UI_COL_HEADER_TXT,
                          "Restore from Backup");
             ui_draw_text(6, 28, UI_SCALE_SM, UI_COL_TEXT_DIM,
-                         "Up/Down:select  A:restore  B:cancel");
-            for (int i = 0; i < bklist.count; i++) {
-                float ry = 46.0f + (float)i * 18.0f;
+                         "Up/Dn:select  L/R:page  A:restore  X:merge all  B:cancel");
+            for (int r = 0; r < RESTORE_ROWS; r++) {
+                int i = chooser_top + r;
+                if (i >= cat.count) break;
+                const PldBackupEntry *e = &cat.entries[i];
+                float ry = 46.0f + (float)r * 18.0f;
                 u32 rbg = (i == chooser_sel) ? UI_COL_ROW_SEL :
                           (i % 2 == 0) ? UI_COL_BG : UI_COL_ROW_ALT;
                 ui_draw_rect(0, ry, UI_TOP_W, 18, rbg);
                 char label[32];
-                fmt_backup_label(bklist.names[i], label, sizeof(label));
+                fmt_backup_label(e->name, label, sizeof(label));
                 ui_draw_textf(6, ry + 2, UI_SCALE_LG, UI_COL_TEXT,
-                              "%s  %d apps", label, app_counts[i]);
+                              "%s  %u apps", label, (unsigned)e->app_count);
+                char count[24];
+                snprintf(count, sizeof(count), "%lu sessions",
+                         (unsigned long)e->session_count);
+                ui_draw_text_right(UI_TOP_W - 8, ry + 2, UI_SCALE_LG,
+                                   UI_COL_TEXT_DIM, count);
             }
             ui_target_bot();
             ui_draw_header(UI_BOT_W);
             ui_draw_text(6, 4, UI_SCALE_HDR, UI_COL_HEADER_TXT,
                          "Activity Log++");
+            ui_draw_textf(8, 36, UI_SCALE_LG, UI_COL_TEXT_DIM,
+                          "Backup %d of %d", chooser_sel + 1, cat.count);
+            ui_draw_textf(8, 56, UI_SCALE_LG, UI_COL_TEXT_DIM,
+                          "%lu KB on SD",
+                          (unsigned long)((cat.total_bytes + 1023) / 1024));
             ui_end_frame();
         }
     }
+    pld_catalog_free(&cat);
 }
 
 /* ── Reset view ────────────────────────────────────────────────── */
@@ -343,10 +466,11 @@ void run_reset_view(AppCtx *ctx)
             pld_sessions_free(&ctx->sessions);
             ctx->pld      = rr_args.pld;
             ctx->sessions = rr_args.sessions;
+            pld_agg_build(ctx->agg, &ctx->sessions);
             ctx->view_mode = VIEW_LAST_PLAYED;
             ctx->sync_count = 0;
             save_sync_count(0);
-            app_ctx_rebuild(ctx);
+            app_ctx_data_changed(ctx);
             snprintf(ctx->status_msg, sizeof(ctx->status_msg), "Reset to local data");
         } else {
             snprintf(ctx->status_msg, sizeof(ctx->status_msg),
@@ -1,13 +1,10 @@
 #include "net.h"          /* must come first — pulls in <3ds.h> for SOC service */
 #include "title_names.h"  /* TitleNameEntry, title_names_get_all, title_names_merge */
+#include "memprof.h"
 
 #include <stdio.h>
 #include <string.h>
-#include <errno.h>
 #include <malloc.h>
-#include <unistd.h>
-#include <fcntl.h>
-#include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
@@ -15,41 +12,16 @@ static u32 *s_soc_buf = NULL;
 
 /* ── Helpers ──────────────────────────────────────────────────────── */
 
-static void set_nonblocking(int fd)
+static u64 now_ms(void)
 {
-    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    return (u64)(svcGetSystemTick() / CPU_TICKS_PER_MSEC);
 }
 
-static void close_sock(int *fd)
+static void soc_release(void)
 {
-    if (*fd >= 0) {
-        close(*fd);
-        *fd = -1;
-    }
-}
-
-/* Receive exactly len bytes from a blocking socket; returns len on success,
- * 0 on clean close, -1 on error. MSG_WAITALL is unreliable on 3DS SOC. */
-static int recv_all(int fd, void *buf, int len)
-{
-    int total = 0;
-    while (total < len) {
-        int n = recv(fd, (char *)buf + total, len - total, 0);
-        if (n <= 0) return n;
-        total += n;
-    }
-    return total;
-}
-
-static int send_all(int fd, const void *buf, int len)
-{
-    int total = 0;
-    while (total < len) {
-        int n = send(fd, (const char *)buf + total, len - total, 0);
-        if (n <= 0) return -1;
-        total += n;
-    }
-    return total;
+    socExit();
+    MEM_FREE(s_soc_buf);
+    s_soc_buf = NULL;
 }
 
 /* ── net_init ─────────────────────────────────────────────────────── */
@@ -57,17 +29,16 @@ static int send_all(int fd, const void *buf, int len)
 Result net_init(NetCtx *ctx, NetRole role)
 {
     memset(ctx, 0, sizeof(*ctx));
-    ctx->tcp_sock    = -1;
-    ctx->listen_sock = -1;
-    ctx->udp_sock    = -1;
-    ctx->role        = role;
+    ctx->role = role;
+    pld_link_init(&ctx->link, role == NET_ROLE_HOST, NET_UDP_PORT,
+                  NET_TCP_PORT);
 
-    s_soc_buf = (u32 *)memalign(0x1000, NET_SOC_BUF_SIZE);
+    s_soc_buf = (u32 *)MEM_MEMALIGN(MEM_NET, 0x1000, NET_SOC_BUF_SIZE);
     if (!s_soc_buf) return -1;
 
     Result rc = socInit(s_soc_buf, NET_SOC_BUF_SIZE);
     if (R_FAILED(rc)) {
-        free(s_soc_buf);
+        MEM_FREE(s_soc_buf);
         s_soc_buf = NULL;
         return rc;
     }
@@ -77,60 +48,14 @@ Result net_init(NetCtx *ctx, NetRole role)
     own_addr.s_addr = gethostid();
     snprintf(ctx->own_ip, sizeof(ctx->own_ip), "%s", inet_ntoa(own_addr));
 
-    if (role == NET_ROLE_HOST) {
-        /* UDP socket for broadcasting discovery */
-        ctx->udp_sock = socket(AF_INET, SOCK_DGRAM, 0);
-        if (ctx->udp_sock < 0) { socExit(); free(s_soc_buf); s_soc_buf = NULL; return -1; }
-
-        int bcast = 1;
-        setsockopt(ctx->udp_sock, SOL_SOCKET, SO_BROADCAST,
-                   &bcast, sizeof(bcast));
-        set_nonblocking(ctx->udp_sock);
-
-        /* TCP listening socket */
-        ctx->listen_sock = socket(AF_INET, SOCK_STREAM, 0);
-        if (ctx->listen_sock < 0) {
-            close_sock(&ctx->udp_sock);
-            socExit(); free(s_soc_buf); s_soc_buf = NULL;
-            return -1;
-        }
-
-        struct sockaddr_in srv = {0};
-        srv.sin_family      = AF_INET;
-        srv.sin_addr.s_addr = INADDR_ANY;
-        srv.sin_port        = htons(NET_TCP_PORT);
-        if (bind(ctx->listen_sock, (struct sockaddr *)&srv, sizeof(srv)) < 0 ||
-            listen(ctx->listen_sock, 1) < 0) {
-            close_sock(&ctx->listen_sock);
-            close_sock(&ctx->udp_sock);
-            socExit(); free(s_soc_buf); s_soc_buf = NULL;
-            return -1;
-        }
-        set_nonblocking(ctx->listen_sock);
-
-        ctx->state       = NET_STATE_WAITING;
-        ctx->bcast_timer = 60; /* broadcast on first tick */
-
-    } else {
-        /* CLIENT: UDP socket bound to discovery port to receive broadcasts */
-        ctx->udp_sock = socket(AF_INET, SOCK_DGRAM, 0);
-        if (ctx->udp_sock < 0) { socExit(); free(s_soc_buf); s_soc_buf = NULL; return -1; }
-
-        struct sockaddr_in bind_addr = {0};
-        bind_addr.sin_family      = AF_INET;
-        bind_addr.sin_addr.s_addr = INADDR_ANY;
-        bind_addr.sin_port        = htons(NET_UDP_PORT);
-        if (bind(ctx->udp_sock, (struct sockaddr *)&bind_addr,
-                 sizeof(bind_addr)) < 0) {
-            close_sock(&ctx->udp_sock);
-            socExit(); free(s_soc_buf); s_soc_buf = NULL;
-            return -1;
-        }
-        set_nonblocking(ctx->udp_sock);
-
-        ctx->state = NET_STATE_SCANNING;
+    /* Host: UDP broadcast + TCP listener; client: UDP bound to the
+     * discovery port.  Broadcasting starts on the first tick. */
+    if (pld_link_open(&ctx->link, now_ms()) != 0) {
+        soc_release();
+        return -1;
     }
-
+    ctx->state = role == NET_ROLE_HOST ? NET_STATE_WAITING
+                                       : NET_STATE_SCANNING;
     return 0;
 }
 
@@ -141,260 +66,135 @@ void net_tick(NetCtx *ctx)
     if (ctx->state == NET_STATE_CONNECTED || ctx->state == NET_STATE_ERROR)
         return;
 
-    if (ctx->role == NET_ROLE_HOST) {
-        /* Broadcast discovery magic every ~60 frames */
-        ctx->bcast_timer++;
-        if (ctx->bcast_timer >= 60) {
-            ctx->bcast_timer = 0;
-            u32 magic = NET_MAGIC;
-            struct sockaddr_in bcast_addr = {0};
-            bcast_addr.sin_family      = AF_INET;
-            bcast_addr.sin_addr.s_addr = htonl(INADDR_BROADCAST);
-            bcast_addr.sin_port        = htons(NET_UDP_PORT);
-            sendto(ctx->udp_sock, &magic, 4, 0,
-                   (struct sockaddr *)&bcast_addr, sizeof(bcast_addr));
-        }
-
-        /* Check for incoming TCP connections */
-        struct sockaddr_in peer_addr = {0};
-        socklen_t peer_len = sizeof(peer_addr);
-        int fd = accept(ctx->listen_sock,
-                        (struct sockaddr *)&peer_addr, &peer_len);
-        if (fd >= 0) {
-            snprintf(ctx->peer_ip, sizeof(ctx->peer_ip), "%s",
-                     inet_ntoa(peer_addr.sin_addr));
-            /* Accepted socket may inherit O_NONBLOCK from listen_sock on 3DS;
-             * clear it so the blocking handshake recv_all works correctly. */
-            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) & ~O_NONBLOCK);
-            ctx->tcp_sock = fd;
-
-            /* Handshake: send magic, recv magic */
-            u32 magic = NET_MAGIC;
-            send(ctx->tcp_sock, &magic, 4, 0);
-
-            u32 rx = 0;
-            int got = recv_all(ctx->tcp_sock, &rx, 4);
-            if (got == 4 && rx == NET_MAGIC) {
-                ctx->state = NET_STATE_CONNECTED;
-                close_sock(&ctx->listen_sock);
-            } else {
-                close_sock(&ctx->tcp_sock);
-                /* stay in WAITING */
-            }
-        }
-
-    } else {
-        /* CLIENT: listen for UDP broadcast from host */
-        u32 rx = 0;
-        struct sockaddr_in from = {0};
-        socklen_t fromlen = sizeof(from);
-        int got = recvfrom(ctx->udp_sock, &rx, 4, 0,
-                           (struct sockaddr *)&from, &fromlen);
-        if (got == 4 && rx == NET_MAGIC) {
-            snprintf(ctx->peer_ip, sizeof(ctx->peer_ip), "%s",
-                     inet_ntoa(from.sin_addr));
-
-            /* Connect TCP to host */
-            int tcp = socket(AF_INET, SOCK_STREAM, 0);
-            if (tcp < 0) { ctx->state = NET_STATE_ERROR; return; }
-
-            struct sockaddr_in host_addr = {0};
-            host_addr.sin_family = AF_INET;
-            host_addr.sin_port   = htons(NET_TCP_PORT);
-            inet_aton(ctx->peer_ip, &host_addr.sin_addr);
-
-            if (connect(tcp, (struct sockaddr *)&host_addr,
-                        sizeof(host_addr)) < 0) {
-                close(tcp);
-                ctx->state = NET_STATE_ERROR;
-                return;
-            }
-            ctx->tcp_sock = tcp;
+    /* Discovery, connect and handshake move on by what the sockets allow
+     * right now (pld_link.c), so a slow or silent peer costs the frame
+     * nothing; the link retries on its own until it is READY. */
+    PldLinkPhase phase = pld_link_tick(&ctx->link, now_ms());
+    if (phase == PLD_LINK_FAILED) {
+        ctx->state = NET_STATE_ERROR;
+        return;
+    }
 
-            /* Handshake: recv magic, send magic */
-            u32 rx2 = 0;
-            int got2 = recv_all(ctx->tcp_sock, &rx2, 4);
-            if (got2 == 4 && rx2 == NET_MAGIC) {
-                u32 magic = NET_MAGIC;
-                send(ctx->tcp_sock, &magic, 4, 0);
-                ctx->state = NET_STATE_CONNECTED;
-                close_sock(&ctx->udp_sock);
-            } else {
-                close_sock(&ctx->tcp_sock);
-                /* stay in SCANNING */
-            }
-        }
+    ctx->peer_ip[0] = '\0';
+    if (phase == PLD_LINK_CONNECTING || phase == PLD_LINK_HANDSHAKE ||
+        phase == PLD_LINK_READY) {
+        struct in_addr peer;
+        peer.s_addr = ctx->link.peer_addr;
+        snprintf(ctx->peer_ip, sizeof(ctx->peer_ip), "%s", inet_ntoa(peer));
     }
+    if (phase == PLD_LINK_READY) ctx->state = NET_STATE_CONNECTED;
 }
 
 /* ── net_shutdown ─────────────────────────────────────────────────── */
 
 void net_shutdown(NetCtx *ctx)
 {
-    close_sock(&ctx->tcp_sock);
-    close_sock(&ctx->listen_sock);
-    close_sock(&ctx->udp_sock);
-    socExit();
-    free(s_soc_buf);
-    s_soc_buf = NULL;
+    pld_link_close(&ctx->link);
+    soc_release();
 }
 
-/* ── net_exchange_sessions ────────────────────────────────────────── */
+/* ── net_exchange ───────────────────────────────────────────────── */
 
-int net_exchange_sessions(NetCtx *ctx, PldSessionLog *local, int *new_count_out)
-{
-    int fd = ctx->tcp_sock;
-    *new_count_out = 0;
-
-    PldSession *remote_buf = malloc(PLD_SESSION_COUNT * sizeof(PldSession));
-    if (!remote_buf) return -1;
-
-    u32 remote_count = 0;
-    u32 local_count  = (u32)local->count;
-
-    if (ctx->role == NET_ROLE_HOST) {
-        if (send_all(fd, &local_count, 4) != 4) goto fail;
-        if (local_count > 0) {
-            int bytes = (int)(local_count * sizeof(PldSession));
-            if (send_all(fd, local->entries, bytes) != bytes) goto fail;
-        }
-        if (recv_all(fd, &remote_count, 4) != 4) goto fail;
-        if (remote_count > PLD_SESSION_COUNT) goto fail;
-        if (remote_count > 0) {
-            int bytes = (int)(remote_count * sizeof(PldSession));
-            if (recv_all(fd, remote_buf, bytes) != bytes) goto fail;
-        }
-    } else {
-        if (recv_all(fd, &remote_count, 4) != 4) goto fail;
-        if (remote_count > PLD_SESSION_COUNT) goto fail;
-        if (remote_count > 0) {
-            int bytes = (int)(remote_count * sizeof(PldSession));
-            if (recv_all(fd, remote_buf, bytes) != bytes) goto fail;
-        }
-        if (send_all(fd, &local_count, 4) != 4) goto fail;
-        if (local_count > 0) {
-            int bytes = (int)(local_count * sizeof(PldSession));
-            if (send_all(fd, local->entries, bytes) != bytes) goto fail;
-        }
-    }
+enum { SIDE_SUMMARIES, SIDE_NAMES, SIDE_COUNT };
 
-    PldSessionLog remote_log = { remote_buf, (int)remote_count };
-    int added = pld_merge_sessions(local, &remote_log, false);
-    free(remote_buf);
-    if (added < 0) return -1;
-    *new_count_out = added;
-    return 0;
-
-fail:
-    free(remote_buf);
-    return -1;
+/* PldReconFull: the working set is full, but merged2.dat has no cap, so
+ * what the sync gathered is kept there in full. */
+static int keep_in_ext(void *state, const PldSessionLog *merged,
+                       const PldSession *rest, int n)
+{
+    (void)state;
+    return R_SUCCEEDED(pld_ext_fold_log(PLD_EXT_PATH, NULL, merged, rest, n))
+         ? 0 : -1;
 }
 
-/* ── net_exchange_summaries ───────────────────────────────────────── */
-
-int net_exchange_summaries(NetCtx *ctx, PldFile *local, int *new_count_out)
+int net_exchange(NetCtx *ctx, PldFile *pld, PldSessionLog *local, PldAgg *agg,
+                 int *new_sess_out, int *new_apps_out)
 {
-    int fd = ctx->tcp_sock;
-    *new_count_out = 0;
+    *new_sess_out = 0;
+    *new_apps_out = 0;
 
-    PldSummary local_buf[PLD_SUMMARY_COUNT];
-    u32 local_count = 0;
+    PldSummary summaries[PLD_SUMMARY_COUNT];
+    u32 summary_count = 0;
     for (int i = 0; i < PLD_SUMMARY_COUNT; i++) {
-        if (!pld_summary_is_empty(&local->summaries[i]))
-            local_buf[local_count++] = local->summaries[i];
+        if (!pld_summary_is_empty(&pld->summaries[i]))
+            summaries[summary_count++] = pld->summaries[i];
     }
-
-    PldSummary *remote_buf = malloc(PLD_SUMMARY_COUNT * sizeof(PldSummary));
-    if (!remote_buf) return -1;
-
-    u32 remote_count = 0;
-
-    if (ctx->role == NET_ROLE_HOST) {
-        if (send_all(fd, &local_count, 4) != 4) goto fail;
-        if (local_count > 0) {
-            int bytes = (int)(local_count * sizeof(PldSummary));
-            if (send_all(fd, local_buf, bytes) != bytes) goto fail;
-        }
-        if (recv_all(fd, &remote_count, 4) != 4) goto fail;
-        if (remote_count > PLD_SUMMARY_COUNT) goto fail;
-        if (remote_count > 0) {
-            int bytes = (int)(remote_count * sizeof(PldSummary));
-            if (recv_all(fd, remote_buf, bytes) != bytes) goto fail;
-        }
-    } else {
-        if (recv_all(fd, &remote_count, 4) != 4) goto fail;
-        if (remote_count > PLD_SUMMARY_COUNT) goto fail;
-        if (remote_count > 0) {
-            int bytes = (int)(remote_count * sizeof(PldSummary));
-            if (recv_all(fd, remote_buf, bytes) != bytes) goto fail;
-        }
-        if (send_all(fd, &local_count, 4) != 4) goto fail;
-        if (local_count > 0) {
-            int bytes = (int)(local_count * sizeof(PldSummary));
-            if (send_all(fd, local_buf, bytes) != bytes) goto fail;
+    const TitleNameEntry *names;
+    int name_count;
+    title_names_get_all(&names, &name_count);
+
+    /* The app list and title names ride along with the first round of
+     * the session reconciliation, both ways at once. */
+    PldWireOut side_out[SIDE_COUNT] = {
+        { summaries, NULL, summary_count, sizeof(PldSummary) },
+        { names, NULL, (u32)name_count, sizeof(TitleNameEntry) },
+    };
+    PldWireIn side_in[SIDE_COUNT] = {
+        { NULL, 0, sizeof(PldSummary), PLD_SUMMARY_COUNT, NULL, NULL },
+        { NULL, 0, sizeof(TitleNameEntry), TITLE_NAMES_MAX, NULL, NULL },
+    };
+
+    /* Encoded, a name is its length and characters instead of 72 bytes
+     * of mostly padding. */
+    u8 *names_enc = NULL;
+    if (ctx->link.codec) {
+        int n_enc = pld_codec_encode_elems(names, (u32)name_count,
+                                           sizeof(TitleNameEntry), ctx->link.codec,
+                                           NULL);
+        names_enc = n_enc > 0 ? pld_scratch_alloc((size_t)n_enc) : NULL;
+        if (n_enc < 0 || (n_enc > 0 && !names_enc)) return -1;
+        n_enc = pld_codec_encode_elems(names, (u32)name_count,
+                                       sizeof(TitleNameEntry), ctx->link.codec,
+                                       names_enc);
+        if (n_enc < 0) {
+            pld_scratch_free(names_enc);
+            return -1;
         }
+        side_out[SIDE_NAMES].data  = names_enc;
+        side_out[SIDE_NAMES].count = (u32)n_enc;
+        side_out[SIDE_NAMES].elem  = 1;
+        side_in[SIDE_NAMES].elem   = 1;
+        side_in[SIDE_NAMES].max    = PLD_CODEC_BOUND(TITLE_NAMES_MAX,
+                                         sizeof(TitleNameEntry) + 2u);
     }
 
-    int added = pld_merge_summaries(local, remote_buf, (int)remote_count, false);
-    free(remote_buf);
-    if (added < 0) return -1;
-    *new_count_out = added;
-    return 0;
-
-fail:
-    free(remote_buf);
-    return -1;
-}
-
-/* ── net_exchange_title_names ─────────────────────────────────────── */
-
-int net_exchange_title_names(NetCtx *ctx)
-{
-    int fd = ctx->tcp_sock;
-
-    const TitleNameEntry *local;
-    int local_count_i;
-    title_names_get_all(&local, &local_count_i);
-    u32 local_count = (u32)local_count_i;
-
-    /* Allocate receive buffer for up to TITLE_NAMES_MAX remote entries */
-    TitleNameEntry *remote_buf =
-        (TitleNameEntry *)malloc(TITLE_NAMES_MAX * sizeof(TitleNameEntry));
-    if (!remote_buf) return -1;
-
-    u32 remote_count = 0;
-
-    if (ctx->role == NET_ROLE_HOST) {
-        if (send_all(fd, &local_count, 4) != 4) goto fail;
-        if (local_count > 0) {
-            int bytes = (int)(local_count * sizeof(TitleNameEntry));
-            if (send_all(fd, local, bytes) != bytes) goto fail;
-        }
-        if (recv_all(fd, &remote_count, 4) != 4) goto fail;
-        if (remote_count > TITLE_NAMES_MAX) goto fail;
-        if (remote_count > 0) {
-            int bytes = (int)(remote_count * sizeof(TitleNameEntry));
-            if (recv_all(fd, remote_buf, bytes) != bytes) goto fail;
-        }
-    } else {
-        if (recv_all(fd, &remote_count, 4) != 4) goto fail;
-        if (remote_count > TITLE_NAMES_MAX) goto fail;
-        if (remote_count > 0) {
-            int bytes = (int)(remote_count * sizeof(TitleNameEntry));
-            if (recv_all(fd, remote_buf, bytes) != bytes) goto fail;
-        }
-        if (send_all(fd, &local_count, 4) != 4) goto fail;
-        if (local_count > 0) {
-            int bytes = (int)(local_count * sizeof(TitleNameEntry));
-            if (send_all(fd, local, bytes) != bytes) goto fail;
-        }
+    void *their_names = NULL;
+    u32 their_name_count = 0;
+    int rc = 0;
+    int added = pld_recon_exchange(ctx->link.tcp, local, agg, ctx->link.codec,
+                                   side_out, side_in, SIDE_COUNT,
+                                   keep_in_ext, NULL, NULL);
+    if (added < 0) {
+        rc = added;
+        goto done;
+    }
+    *new_sess_out = added;
+
+    if (!ctx->link.codec) {
+        their_names      = side_in[SIDE_NAMES].data;
+        their_name_count = side_in[SIDE_NAMES].count;
+    } else if (pld_codec_decode_elems(side_in[SIDE_NAMES].data,
+                                      side_in[SIDE_NAMES].count,
+                                      sizeof(TitleNameEntry), &their_names,
+                                      &their_name_count) != 0 ||
+               their_name_count > TITLE_NAMES_MAX) {
+        rc = -1;
+        goto done;
     }
 
-    title_names_merge(remote_buf, (int)remote_count);
-    free(remote_buf);
-    return 0;
-
-fail:
-    free(remote_buf);
-    return -1;
+    int apps = pld_merge_summaries(pld, side_in[SIDE_SUMMARIES].data,
+                                   (int)side_in[SIDE_SUMMARIES].count, false);
+    if (apps < 0) {
+        rc = -1;
+        goto done;
+    }
+    *new_apps_out = apps;
+    title_names_merge(their_names, (int)their_name_count);
+
+done:
+    if (ctx->link.codec) pld_scratch_free(their_names);
+    pld_scratch_free(side_in[SIDE_NAMES].data);
+    pld_scratch_free(side_in[SIDE_SUMMARIES].data);
+    pld_scratch_free(names_enc);
+    return rc;
 }
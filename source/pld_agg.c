@@ -0,0 +1,136 @@
+#include "pld.h"
+
+#include <string.h>
+
+/*
+ * pld_agg.c — per-title aggregates over a session log
+ *
+ * Sorted logs are grouped by run length (one title per run, timestamps
+ * ascending).  Anything else goes through a title_id → slot hash; distinct
+ * days are then counted from day changes per title, which is exact as long
+ * as each title's records are chronological (true of the NAND log).
+ */
+
+#define AGG_EMPTY (-1)
+
+static inline u32 agg_hash(u64 title_id)
+{
+    return (u32)((title_id * 0x9E3779B97F4A7C15ULL) >> (64 - PLD_AGG_HASH_BITS));
+}
+
+void pld_agg_reset(PldAgg *agg)
+{
+    agg->count    = 0;
+    agg->valid    = false;
+    agg->overflow = false;
+    for (int i = 0; i < PLD_AGG_HASH_SIZE; i++)
+        agg->hash[i] = AGG_EMPTY;
+}
+
+/* Find or create the slot for title_id; NULL once PLD_AGG_MAX is reached. */
+static PldTitleAgg *agg_slot(PldAgg *agg, u64 title_id, bool create)
+{
+    u32 h = agg_hash(title_id);
+    for (;;) {
+        s16 idx = agg->hash[h];
+        if (idx == AGG_EMPTY) break;
+        if (agg->titles[idx].title_id == title_id) return &agg->titles[idx];
+        h = (h + 1) & (PLD_AGG_HASH_SIZE - 1);
+    }
+    if (!create) return NULL;
+    if (agg->count >= PLD_AGG_MAX) {
+        agg->overflow = true;
+        return NULL;
+    }
+    PldTitleAgg *t = &agg->titles[agg->count];
+    memset(t, 0, sizeof(*t));
+    t->title_id = title_id;
+    t->first_ts = 0xFFFFFFFFu;
+    agg->hash[h] = (s16)agg->count++;
+    return t;
+}
+
+const PldTitleAgg *pld_agg_find(const PldAgg *agg, u64 title_id)
+{
+    return agg_slot((PldAgg *)agg, title_id, false);
+}
+
+static inline void agg_record(PldTitleAgg *t, const PldRec *s)
+{
+    t->total_secs += s->play_secs;
+    t->sessions++;
+    if (s->timestamp < t->first_ts) t->first_ts = s->timestamp;
+    if (s->timestamp > t->last_ts)  t->last_ts  = s->timestamp;
+}
+
+void pld_agg_build(PldAgg *agg, const PldSessionLog *log)
+{
+    pld_agg_reset(agg);
+    const PldRec *e = log->entries;
+    int n = log->count;
+
+    if (pld_sessions_sorted(e, n)) {
+        for (int i = 0; i < n; ) {
+            PldTitleAgg *t = agg_slot(agg, pld_rec_title_id(log, &e[i]), true);
+            u32 prev_day = 0xFFFFFFFFu;
+            u16 title = e[i].title;
+            for (; i < n && e[i].title == title; i++) {
+                if (!t) continue;
+                agg_record(t, &e[i]);
+                u32 day = e[i].timestamp / 86400u;
+                if (day != prev_day) t->days++;
+                prev_day = day;
+            }
+        }
+    } else {
+        for (int i = 0; i < n; i++) {
+            PldTitleAgg *t = agg_slot(agg, pld_rec_title_id(log, &e[i]), true);
+            if (!t) continue;
+            bool first = t->sessions == 0;
+            u32 prev_day = t->last_ts / 86400u;
+            agg_record(t, &e[i]);
+            if (first || e[i].timestamp / 86400u != prev_day)
+                t->days++;
+        }
+    }
+    agg->valid = true;
+}
+
+void pld_agg_refresh(PldAgg *agg, const PldSessionLog *log)
+{
+    if (!agg->valid) pld_agg_build(agg, log);
+}
+
+void pld_agg_add(PldAgg *agg, const PldSession *s, bool new_day)
+{
+    if (!agg->valid) return;
+    PldTitleAgg *t = agg_slot(agg, s->title_id, true);
+    if (!t) return;
+    t->total_secs += s->play_secs;
+    t->sessions++;
+    if (s->timestamp < t->first_ts) t->first_ts = s->timestamp;
+    if (s->timestamp > t->last_ts)  t->last_ts  = s->timestamp;
+    if (new_day) t->days++;
+}
+
+void pld_agg_adjust(PldAgg *agg, u64 title_id, s32 delta_secs)
+{
+    if (!agg->valid || delta_secs == 0) return;
+    PldTitleAgg *t = agg_slot(agg, title_id, false);
+    if (t) t->total_secs += (u32)delta_secs;
+}
+
+void pld_agg_apply_totals(const PldAgg *agg, PldFile *pld)
+{
+    for (int i = 0; i < PLD_SUMMARY_COUNT; i++) {
+        PldSummary *s = &pld->summaries[i];
+        if (pld_summary_is_empty(s)) continue;
+        const PldTitleAgg *t = pld_agg_find(agg, s->title_id);
+        /* a title missing from an overflowed aggregate may still have
+         * sessions: keep the total it has rather than zero it */
+        if (t)
+            s->total_secs = t->total_secs;
+        else if (!agg->overflow)
+            s->total_secs = 0;
+    }
+}
@@ -0,0 +1,93 @@
+#include "pld.h"
+#include "memprof.h"
+
+#include <stdlib.h>
+
+/*
+ * pld_arena.c — operation-scoped linear allocator
+ *
+ * Each block is preceded by a 16-byte header holding its size, which keeps
+ * the returned pointer 16-byte aligned and lets pld_scratch_free pop the
+ * newest block.  Blocks that aren't the newest stay put until the arena
+ * ends: a flow's temporaries are nested, so in practice the arena never
+ * grows past its largest live set.
+ *
+ * The current arena is per thread: a flow staging images on a worker
+ * leaves the UI thread's scratch allocations on the heap, where they
+ * can't interleave with its blocks.
+ */
+
+#define HDR  16u
+
+static __thread PldArena *s_current;
+
+static inline size_t round_up(size_t n)
+{
+    return (n + (HDR - 1)) & ~(size_t)(HDR - 1);
+}
+
+bool pld_arena_begin(PldArena *a, size_t cap)
+{
+    a->base   = NULL;
+    a->cap    = 0;
+    a->used   = 0;
+    a->peak   = 0;
+    a->spills = 0;
+    if (s_current) return false;
+    cap = round_up(cap);
+    a->base = MEM_MALLOC(MEM_PLD, cap);
+    if (!a->base) return false;
+    a->cap = cap;
+    s_current = a;
+    return true;
+}
+
+void pld_arena_end(PldArena *a)
+{
+    if (!a->base) return;
+    if (s_current == a) s_current = NULL;
+    MEM_FREE(a->base);
+    a->base = NULL;
+    a->used = 0;
+}
+
+const PldArena *pld_arena_current(void)
+{
+    return s_current;
+}
+
+bool pld_scratch_owned(const void *p)
+{
+    const PldArena *a = s_current;
+    return a && p && (const u8 *)p >= a->base &&
+           (const u8 *)p < a->base + a->cap;
+}
+
+void *pld_scratch_alloc(size_t n)
+{
+    PldArena *a = s_current;
+    if (!a) return MEM_MALLOC(MEM_PLD, n);
+    size_t need = HDR + round_up(n);
+    if (need < n || need > a->cap - a->used) {
+        a->spills++;
+        return MEM_MALLOC(MEM_PLD, n);
+    }
+    u8 *block = a->base + a->used;
+    *(size_t *)block = need;
+    a->used += need;
+    if (a->used > a->peak) a->peak = a->used;
+    return block + HDR;
+}
+
+void pld_scratch_free(void *p)
+{
+    if (!p) return;
+    if (!pld_scratch_owned(p)) {
+        MEM_FREE(p);
+        return;
+    }
+    PldArena *a = s_current;
+    u8 *block = (u8 *)p - HDR;
+    if (block + *(size_t *)block == a->base + a->used)
+        a->used = (size_t)(block - a->base);
+}
@@ -0,0 +1,363 @@
+#include "pld.h"
+#include "memprof.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * pld_backup.c — compact container for SD backups
+ *
+ * A raw backup is 806 KB however little of the session table is in use.
+ * The container keeps the image's header and counts in a fixed header
+ * (so listing backups costs one 56-byte read each) and codes the two
+ * tables as runs:
+ *
+ *   payload   title dictionary: count, then ascending ids as varint deltas
+ *             session table:    (empty run, live run, live records...)*
+ *             summary table:    (empty run, live run, live records...)*
+ *
+ * An empty slot is one that is 0xFF in every byte; anything else is coded
+ * field by field, so the decoded image is byte-identical to the source and
+ * is checked against the header's image_hash.  Session records are coded
+ * against the previous live record: title as a dictionary index delta,
+ * timestamp as a delta (in hours when it is a whole number of them), then
+ * play_secs, all as zigzag LEB128 varints.  A few thousand sessions fit in
+ * tens of KB; a full 50000-session table in about a quarter of the image.
+ */
+
+typedef struct {
+    u8  *buf;
+    u32  len;
+    u32  cap;
+    bool overflow;
+} Writer;
+
+typedef struct {
+    const u8 *p;
+    const u8 *end;
+    bool      bad;
+} Reader;
+
+static void put_varint(Writer *w, u64 v)
+{
+    do {
+        if (w->len == w->cap) { w->overflow = true; return; }
+        u8 b = (u8)(v & 0x7F);
+        v >>= 7;
+        w->buf[w->len++] = b | (v ? 0x80 : 0);
+    } while (v);
+}
+
+static u64 get_varint(Reader *r)
+{
+    u64 v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (r->p == r->end) break;
+        u8 b = *r->p++;
+        v |= (u64)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    r->bad = true;
+    return 0;
+}
+
+static inline u64 zigzag(s64 v)   { return ((u64)v << 1) ^ (u64)(v >> 63); }
+static inline s64 unzigzag(u64 v) { return (s64)(v >> 1) ^ -(s64)(v & 1); }
+
+static bool slot_empty(const u8 *p, u32 size)
+{
+    for (u32 i = 0; i < size; i++)
+        if (p[i] != 0xFF) return false;
+    return true;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    u64 x = *(const u64 *)a, y = *(const u64 *)b;
+    return (x > y) - (x < y);
+}
+
+static int dict_find(const u64 *ids, int n, u64 id)
+{
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (ids[mid] < id) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* ── Record codecs ──────────────────────────────────────────────── */
+
+typedef struct {
+    const u64 *ids;
+    int        count;
+    s64        prev_title;
+    s64        prev_ts;
+} SessionCtx;
+
+static void put_session(Writer *w, SessionCtx *c, const PldSession *s)
+{
+    s64 t  = dict_find(c->ids, c->count, s->title_id);
+    s64 dt = (s64)s->timestamp - c->prev_ts;
+    bool hours = (dt % 3600) == 0;
+    put_varint(w, (zigzag(t - c->prev_title) << 1) | (hours ? 0 : 1));
+    put_varint(w, zigzag(hours ? dt / 3600 : dt));
+    put_varint(w, s->play_secs);
+    c->prev_title = t;
+    c->prev_ts    = s->timestamp;
+}
+
+static void get_session(Reader *r, SessionCtx *c, PldSession *s)
+{
+    u64 head  = get_varint(r);
+    s64 t     = c->prev_title + unzigzag(head >> 1);
+    s64 dt    = unzigzag(get_varint(r));
+    u64 secs  = get_varint(r);
+    if (dt < -(s64)0xFFFFFFFF || dt > (s64)0xFFFFFFFF) { r->bad = true; return; }
+    if (!(head & 1)) dt *= 3600;
+    s64 ts = c->prev_ts + dt;
+    if (t < 0 || t >= c->count || secs > 0xFFFFFFFFu || ts < 0 ||
+        ts > (s64)0xFFFFFFFF) {
+        r->bad = true;
+        return;
+    }
+    s->title_id  = c->ids[t];
+    s->timestamp = (u32)ts;
+    s->play_secs = (u32)secs;
+    c->prev_title = t;
+    c->prev_ts    = s->timestamp;
+}
+
+/* Summary title ids are usually in the session dictionary; code those as
+ * index + 1, others raw after a 0. */
+static void put_summary(Writer *w, const SessionCtx *c, const PldSummary *s)
+{
+    int t = dict_find(c->ids, c->count, s->title_id);
+    if (t < c->count && c->ids[t] == s->title_id) {
+        put_varint(w, (u64)t + 1);
+    } else {
+        put_varint(w, 0);
+        put_varint(w, s->title_id);
+    }
+    put_varint(w, s->total_secs);
+    put_varint(w, s->launch_count);
+    put_varint(w, s->unknown_e);
+    put_varint(w, s->first_played_days);
+    put_varint(w, s->last_played_days);
+    put_varint(w, s->unknown_14);
+}
+
+static void get_summary(Reader *r, const SessionCtx *c, PldSummary *s)
+{
+    u64 t = get_varint(r);
+    if (t > (u64)c->count) { r->bad = true; return; }
+    s->title_id          = t ? c->ids[t - 1] : get_varint(r);
+    s->total_secs        = (u32)get_varint(r);
+    s->launch_count      = (u16)get_varint(r);
+    s->unknown_e         = (u16)get_varint(r);
+    s->first_played_days = (u16)get_varint(r);
+    s->last_played_days  = (u16)get_varint(r);
+    s->unknown_14        = (u32)get_varint(r);
+}
+
+/* ── Tables as runs ─────────────────────────────────────────────── */
+
+static void put_table(Writer *w, SessionCtx *c, const u8 *table, int slots,
+                      u32 size, bool sessions)
+{
+    for (int i = 0; i < slots && !w->overflow; ) {
+        int e = i;
+        while (e < slots && slot_empty(table + (u32)e * size, size)) e++;
+        int l = e;
+        while (l < slots && !slot_empty(table + (u32)l * size, size)) l++;
+        put_varint(w, (u64)(e - i));
+        put_varint(w, (u64)(l - e));
+        for (int k = e; k < l; k++) {
+            if (sessions) {
+                PldSession s;
+                memcpy(&s, table + (u32)k * size, sizeof(s));
+                put_session(w, c, &s);
+            } else {
+                PldSummary s;
+                memcpy(&s, table + (u32)k * size, sizeof(s));
+                put_summary(w, c, &s);
+            }
+        }
+        i = l;
+    }
+}
+
+static void get_table(Reader *r, SessionCtx *c, u8 *table, int slots,
+                      u32 size, bool sessions)
+{
+    for (int i = 0; i < slots && !r->bad; ) {
+        u64 empty = get_varint(r);
+        u64 live  = get_varint(r);
+        if (empty + live == 0 || empty + live > (u64)(slots - i)) {
+            r->bad = true;
+            return;
+        }
+        memset(table + (u32)i * size, 0xFF, (u32)empty * size);
+        i += (int)empty;
+        for (u64 k = 0; k < live && !r->bad; k++, i++) {
+            if (sessions) {
+                PldSession s;
+                get_session(r, c, &s);
+                memcpy(table + (u32)i * size, &s, sizeof(s));
+            } else {
+                PldSummary s;
+                get_summary(r, c, &s);
+                memcpy(table + (u32)i * size, &s, sizeof(s));
+            }
+        }
+    }
+}
+
+/* ── Container ──────────────────────────────────────────────────── */
+
+Result pld_backup_encode(const u8 *image, u32 created, u8 **out, u32 *len)
+{
+    const PldSession *table = (const PldSession *)(image + PLD_SESSION_OFFSET);
+    const PldSummary *sums  = (const PldSummary *)(image + PLD_SUMMARY_OFFSET);
+    PldBackupHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic       = PLD_BACKUP_MAGIC;
+    hdr.version     = PLD_BACKUP_VERSION;
+    hdr.header_size = sizeof(hdr);
+    hdr.image_hash  = pld_hash64(image, PLD_FILE_SIZE, 0);
+    hdr.created     = created;
+    memcpy(&hdr.header, image + PLD_HEADER_OFFSET, sizeof(hdr.header));
+    for (int i = 0; i < PLD_SUMMARY_COUNT; i++)
+        if (!pld_summary_is_empty(&sums[i])) hdr.app_count++;
+
+    /* Dictionary: distinct title ids of the non-padding session slots. */
+    u64 *ids = MEM_MALLOC(MEM_PLD, PLD_SESSION_COUNT * sizeof(u64));
+    if (!ids) return (Result)-1;
+    int n = 0;
+    for (int i = 0; i < PLD_SESSION_COUNT; i++) {
+        if (!pld_session_is_empty(&table[i])) hdr.session_count++;
+        if (!slot_empty((const u8 *)&table[i], sizeof(PldSession)))
+            memcpy(&ids[n++], &table[i].title_id, sizeof(u64));
+    }
+    qsort(ids, (size_t)n, sizeof(u64), cmp_u64);
+    int count = 0;
+    for (int i = 0; i < n; i++)
+        if (count == 0 || ids[count - 1] != ids[i]) ids[count++] = ids[i];
+    if (count > 0xFFFF) { MEM_FREE(ids); return (Result)-1; }
+    hdr.title_count = (u16)count;
+
+    /* Capped below the image size, so a container is never mistaken for a
+     * raw backup (and is never the bigger of the two). */
+    Writer w = { MEM_MALLOC(MEM_PLD, PLD_FILE_SIZE), sizeof(hdr),
+                 PLD_FILE_SIZE - 1, false };
+    if (!w.buf) { MEM_FREE(ids); return (Result)-1; }
+    for (int i = 0; i < count; i++)
+        put_varint(&w, i ? ids[i] - ids[i - 1] : ids[0]);
+
+    SessionCtx c = { ids, count, 0, 0 };
+    put_table(&w, &c, (const u8 *)table, PLD_SESSION_COUNT,
+              sizeof(PldSession), true);
+    put_table(&w, &c, (const u8 *)sums, PLD_SUMMARY_COUNT,
+              sizeof(PldSummary), false);
+    MEM_FREE(ids);
+    if (w.overflow) { MEM_FREE(w.buf); return (Result)-1; }
+
+    hdr.payload_size = w.len - sizeof(hdr);
+    hdr.payload_crc  = pld_crc32(w.buf + sizeof(hdr), hdr.payload_size, 0);
+    memcpy(w.buf, &hdr, sizeof(hdr));
+    u8 *shrunk = MEM_REALLOC(MEM_PLD, w.buf, w.len);
+    *out = shrunk ? shrunk : w.buf;
+    *len = w.len;
+    return 0;
+}
+
+static bool header_valid(const PldBackupHeader *h)
+{
+    return h->magic == PLD_BACKUP_MAGIC && h->version == PLD_BACKUP_VERSION &&
+           h->header_size == sizeof(*h) && h->payload_size < PLD_FILE_SIZE;
+}
+
+Result pld_backup_decode(const u8 *buf, u32 len, u8 *image)
+{
+    PldBackupHeader hdr;
+    if (len < sizeof(hdr)) return (Result)-1;
+    memcpy(&hdr, buf, sizeof(hdr));
+    if (!header_valid(&hdr) || hdr.payload_size != len - sizeof(hdr) ||
+        pld_crc32(buf + sizeof(hdr), hdr.payload_size, 0) != hdr.payload_crc)
+        return (Result)-1;
+
+    u64 *ids = MEM_MALLOC(MEM_PLD,
+                          ((size_t)hdr.title_count + 1) * sizeof(u64));
+    if (!ids) return (Result)-1;
+    Reader r = { buf + sizeof(hdr), buf + len, false };
+    for (int i = 0; i < hdr.title_count; i++)
+        ids[i] = get_varint(&r) + (i ? ids[i - 1] : 0);
+
+    memcpy(image + PLD_HEADER_OFFSET, &hdr.header, sizeof(hdr.header));
+    SessionCtx c = { ids, hdr.title_count, 0, 0 };
+    get_table(&r, &c, image + PLD_SESSION_OFFSET, PLD_SESSION_COUNT,
+              sizeof(PldSession), true);
+    get_table(&r, &c, image + PLD_SUMMARY_OFFSET, PLD_SUMMARY_COUNT,
+              sizeof(PldSummary), false);
+    MEM_FREE(ids);
+    if (r.bad || r.p != r.end ||
+        pld_hash64(image, PLD_FILE_SIZE, 0) != hdr.image_hash)
+        return (Result)-1;
+    return 0;
+}
+
+Result pld_backup_read_header(const char *path, PldBackupHeader *out)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) return (Result)-1;
+    bool ok = fread(out, 1, sizeof(*out), f) == sizeof(*out) &&
+              header_valid(out) && fseek(f, 0, SEEK_END) == 0 &&
+              ftell(f) == (long)(sizeof(*out) + out->payload_size);
+    fclose(f);
+    return ok ? 0 : (Result)-1;
+}
+
+Result pld_backup_load(const char *path, u8 *image)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) return (Result)-1;
+    long size = (fseek(f, 0, SEEK_END) == 0) ? ftell(f) : -1;
+    Result rc = (Result)-1;
+
+    if (size == (long)PLD_FILE_SIZE) {
+        /* Raw backup from before the container. */
+        if (fseek(f, 0, SEEK_SET) == 0 &&
+            fread(image, 1, PLD_FILE_SIZE, f) == PLD_FILE_SIZE)
+            rc = 0;
+    } else if (size >= (long)sizeof(PldBackupHeader) &&
+               size < (long)PLD_FILE_SIZE) {
+        u8 *buf = MEM_MALLOC(MEM_PLD, (size_t)size);
+        if (buf && fseek(f, 0, SEEK_SET) == 0 &&
+            fread(buf, 1, (size_t)size, f) == (size_t)size)
+            rc = pld_backup_decode(buf, (u32)size, image);
+        MEM_FREE(buf);
+    }
+    fclose(f);
+    return rc;
+}
+
+Result pld_backup_read(const char *path, PldFile *pld_out,
+                       PldSessionLog *sessions_out)
+{
+    memset(pld_out, 0, sizeof(*pld_out));
+    sessions_out->entries = NULL;
+    sessions_out->titles  = NULL;
+    sessions_out->count   = 0;
+
+    u8 *image = pld_scratch_alloc(PLD_FILE_SIZE);
+    if (!image) return (Result)-1;
+    Result rc = pld_backup_load(path, image);
+    if (R_FAILED(rc)) { pld_scratch_free(image); return rc; }
+    u64 hash = pld_hash64(image, PLD_FILE_SIZE, 0);
+    rc = pld_parse_image(image, pld_out, sessions_out);
+    pld_out->image_hash = hash;
+    return rc;
+}
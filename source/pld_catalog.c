@@ -0,0 +1,301 @@
+#include "pld.h"
+#include "memprof.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+/*
+ * pld_catalog.c — index of the SD backups
+ *
+ * One file in the backup directory lists every backup with what the
+ * restore chooser shows (time, app and session counts) and what retention
+ * and dedup need (size, image hash), so neither opens the backups
+ * themselves:
+ *
+ *   backups.cat   CatHeader, then count PldBackupEntry, newest first
+ *
+ * The file is replaced, never edited: the new catalog is written to
+ * backups.cat.tmp, the old one removed and the temporary renamed into
+ * place.  FAT cannot rename over an existing file, so a save can stop
+ * with only the .tmp present, or with both; a .tmp that reads back whole
+ * wins, and load finishes the rename.  A missing, torn or foreign catalog
+ * is rebuilt by scanning the directory (one header read per container,
+ * one full read per raw backup) and saved again.
+ */
+
+#define CAT_MAGIC    0x43444C50u     /* "PLDC" */
+#define CAT_VERSION  1u
+
+typedef struct {
+    u32 magic;
+    u16 version;
+    u16 entry_size;     /* sizeof(PldBackupEntry) */
+    u32 count;
+    u32 crc;            /* pld_crc32 of the entries */
+} CatHeader;            /* 16 bytes */
+
+static PldRetention s_retention = { PLD_MAX_BACKUPS, 0 };
+
+static void cat_path(const char *dir, const char *suffix, char *out,
+                     size_t len)
+{
+    snprintf(out, len, "%s/%s%s", dir, PLD_CATALOG_NAME, suffix);
+}
+
+static bool backup_name(const char *n)
+{
+    return strlen(n) == 30 && strncmp(n, "pld_backup_", 11) == 0;
+}
+
+/* Names are pld_backup_YYYYMMDD_HHMMSS.dat: newest first is descending. */
+static int cmp_entries_desc(const void *a, const void *b)
+{
+    return strcmp(((const PldBackupEntry *)b)->name,
+                  ((const PldBackupEntry *)a)->name);
+}
+
+static bool reserve(PldCatalog *cat, int want)
+{
+    if (want <= cat->cap) return true;
+    int cap = cat->cap ? cat->cap : 16;
+    while (cap < want) cap *= 2;
+    PldBackupEntry *e = MEM_REALLOC(MEM_PLD, cat->entries,
+                                    (size_t)cap * sizeof(*e));
+    if (!e) return false;
+    cat->entries = e;
+    cat->cap     = cap;
+    return true;
+}
+
+static void recount(PldCatalog *cat)
+{
+    cat->total_bytes = 0;
+    for (int i = 0; i < cat->count; i++)
+        cat->total_bytes += cat->entries[i].size;
+}
+
+void pld_catalog_free(PldCatalog *cat)
+{
+    MEM_FREE(cat->entries);
+    memset(cat, 0, sizeof(*cat));
+}
+
+/* ── File ───────────────────────────────────────────────────────── */
+
+static Result read_file(const char *path, PldCatalog *out)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) return (Result)-1;
+    CatHeader h;
+    Result rc = (Result)-1;
+    if (fread(&h, 1, sizeof(h), f) == sizeof(h) && h.magic == CAT_MAGIC &&
+        h.version == CAT_VERSION && h.entry_size == sizeof(PldBackupEntry) &&
+        h.count <= PLD_CATALOG_MAX && reserve(out, (int)h.count) &&
+        fread(out->entries, sizeof(PldBackupEntry), h.count, f) == h.count &&
+        fgetc(f) == EOF &&
+        pld_crc32(out->entries, h.count * sizeof(PldBackupEntry), 0) == h.crc) {
+        out->count = (int)h.count;
+        recount(out);
+        rc = 0;
+    }
+    fclose(f);
+    return rc;
+}
+
+Result pld_catalog_save(const char *dir, const PldCatalog *cat)
+{
+    char path[160], tmp[160];
+    cat_path(dir, "", path, sizeof(path));
+    cat_path(dir, ".tmp", tmp, sizeof(tmp));
+
+    CatHeader h = { CAT_MAGIC, CAT_VERSION, sizeof(PldBackupEntry),
+                    (u32)cat->count, 0 };
+    h.crc = pld_crc32(cat->entries, (size_t)cat->count * sizeof(PldBackupEntry),
+                      0);
+    FILE *f = fopen(tmp, "wb");
+    if (!f) return (Result)-1;
+    bool ok = fwrite(&h, 1, sizeof(h), f) == sizeof(h) &&
+              fwrite(cat->entries, sizeof(PldBackupEntry), (size_t)cat->count,
+                     f) == (size_t)cat->count;
+    if (fclose(f) != 0) ok = false;
+    if (!ok) { remove(tmp); return (Result)-1; }
+
+    remove(path);
+    return rename(tmp, path) == 0 ? 0 : (Result)-1;
+}
+
+/* ── Rebuild ────────────────────────────────────────────────────── */
+
+void pld_catalog_count(const u8 *image, PldBackupEntry *e)
+{
+    e->session_count = 0;
+    e->app_count     = 0;
+    const PldSession *t = (const PldSession *)(image + PLD_SESSION_OFFSET);
+    for (int i = 0; i < PLD_SESSION_COUNT; i++)
+        if (!pld_session_is_empty(&t[i])) e->session_count++;
+    const PldSummary *s = (const PldSummary *)(image + PLD_SUMMARY_OFFSET);
+    for (int i = 0; i < PLD_SUMMARY_COUNT; i++)
+        if (!pld_summary_is_empty(&s[i])) e->app_count++;
+}
+
+/* Entry for a raw backup: the whole image is read for its hash and
+ * counts, and the time comes from the name. */
+static bool scan_raw(const char *path, const char *name, u8 *image,
+                     PldBackupEntry *e)
+{
+    if (R_FAILED(pld_backup_load(path, image))) return false;
+    e->image_hash = pld_hash64(image, PLD_FILE_SIZE, 0);
+    e->size       = PLD_FILE_SIZE;
+    e->flags      = PLD_CATALOG_RAW;
+    pld_catalog_count(image, e);
+
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    if (sscanf(name + 11, "%4d%2d%2d_%2d%2d%2d", &tm.tm_year, &tm.tm_mon,
+               &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec) == 6) {
+        tm.tm_year -= 1900;
+        tm.tm_mon  -= 1;
+        tm.tm_isdst = -1;
+        e->created  = (u32)mktime(&tm);
+    }
+    return true;
+}
+
+Result pld_catalog_rebuild(const char *dir, PldCatalog *out)
+{
+    memset(out, 0, sizeof(*out));
+    DIR *d = opendir(dir);
+    if (!d) return (Result)-1;
+
+    u8 *image = NULL;
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL && out->count < PLD_CATALOG_MAX) {
+        if (!backup_name(ent->d_name)) continue;
+        if (!reserve(out, out->count + 1)) break;
+
+        PldBackupEntry e;
+        memset(&e, 0, sizeof(e));
+        snprintf(e.name, sizeof(e.name), "%s", ent->d_name);
+        char path[160];
+        snprintf(path, sizeof(path), "%s/%s", dir, e.name);
+
+        PldBackupHeader bh;
+        if (R_SUCCEEDED(pld_backup_read_header(path, &bh))) {
+            e.image_hash    = bh.image_hash;
+            e.created       = bh.created;
+            e.size          = sizeof(bh) + bh.payload_size;
+            e.session_count = bh.session_count;
+            e.app_count     = bh.app_count;
+        } else {
+            if (!image && !(image = MEM_MALLOC(MEM_PLD, PLD_FILE_SIZE))) break;
+            if (!scan_raw(path, e.name, image, &e)) continue;
+        }
+        out->entries[out->count++] = e;
+    }
+    closedir(d);
+    MEM_FREE(image);
+
+    qsort(out->entries, (size_t)out->count, sizeof(PldBackupEntry),
+          cmp_entries_desc);
+    recount(out);
+    return 0;
+}
+
+Result pld_catalog_load(const char *dir, PldCatalog *out)
+{
+    memset(out, 0, sizeof(*out));
+    char path[160], tmp[160];
+    cat_path(dir, "", path, sizeof(path));
+    cat_path(dir, ".tmp", tmp, sizeof(tmp));
+
+    /* A complete .tmp is a save that was interrupted before the rename:
+     * it is newer than whatever catalog is still there. */
+    if (R_SUCCEEDED(read_file(tmp, out))) {
+        remove(path);
+        rename(tmp, path);
+        return 0;
+    }
+    if (R_SUCCEEDED(read_file(path, out))) {
+        remove(tmp);
+        return 0;
+    }
+
+    pld_catalog_free(out);
+    Result rc = pld_catalog_rebuild(dir, out);
+    if (R_SUCCEEDED(rc)) pld_catalog_save(dir, out);
+    return rc;
+}
+
+/* ── Updates ────────────────────────────────────────────────────── */
+
+int pld_catalog_find(const PldCatalog *cat, const char *name)
+{
+    for (int i = 0; i < cat->count; i++)
+        if (strcmp(cat->entries[i].name, name) == 0) return i;
+    return -1;
+}
+
+Result pld_catalog_insert(PldCatalog *cat, const PldBackupEntry *e)
+{
+    int at = pld_catalog_find(cat, e->name);
+    if (at >= 0) {
+        cat->total_bytes -= cat->entries[at].size;
+        cat->entries[at]  = *e;
+        cat->total_bytes += e->size;
+        return 0;
+    }
+    if (!reserve(cat, cat->count + 1)) return (Result)-1;
+    at = 0;
+    while (at < cat->count && strcmp(cat->entries[at].name, e->name) > 0)
+        at++;
+    memmove(&cat->entries[at + 1], &cat->entries[at],
+            (size_t)(cat->count - at) * sizeof(PldBackupEntry));
+    cat->entries[at] = *e;
+    cat->count++;
+    cat->total_bytes += e->size;
+    return 0;
+}
+
+int pld_catalog_prune(const char *dir, PldCatalog *cat, const PldRetention *r)
+{
+    int max_count = r->max_count;
+    if (max_count < 1 || max_count > PLD_CATALOG_MAX)
+        max_count = PLD_CATALOG_MAX;
+
+    /* Keep the newest backups that fit both limits; the newest always. */
+    int keep  = cat->count ? 1 : 0;
+    u64 bytes = keep ? cat->entries[0].size : 0;
+    while (keep < cat->count && keep < max_count &&
+           (r->max_bytes == 0 ||
+            bytes + cat->entries[keep].size <= r->max_bytes)) {
+        bytes += cat->entries[keep].size;
+        keep++;
+    }
+
+    int removed = cat->count - keep;
+    for (int i = keep; i < cat->count; i++) {
+        char path[160];
+        snprintf(path, sizeof(path), "%s/%s", dir, cat->entries[i].name);
+        remove(path);
+        pld_sidecar_remove(path);
+    }
+    cat->count = keep;
+    cat->total_bytes = bytes;
+    return removed;
+}
+
+/* ── Retention ──────────────────────────────────────────────────── */
+
+void pld_backup_set_retention(const PldRetention *r)
+{
+    s_retention = *r;
+}
+
+void pld_backup_get_retention(PldRetention *out)
+{
+    *out = s_retention;
+}
@@ -0,0 +1,472 @@
+#include "pld.h"
+
+#include <string.h>
+
+/*
+ * pld_codec.c — compact encoding of sync payloads
+ *
+ * A session record is 16 bytes on the wire, but in a sorted log most of it
+ * repeats: the title_id is the previous record's, the timestamp a few
+ * whole hours past it, play_secs well under 65536.  Grouping by title and
+ * writing each record as two varints brings it to three or four bytes.
+ * Title names are 72-byte records, mostly zero padding.
+ *
+ * Blocks hold whole records and are encoded and decoded on their own, so
+ * the receiver needs one block of buffer however long the payload is, and
+ * the LZ stage (a byte-oriented LZ77 in the manner of LZ4: literal runs
+ * and matches of 4 bytes or more, 16-bit offsets) sees one block's plain
+ * bytes at a time.  Plain bytes are built in place in the output, where
+ * they stay if compressing them does not help.
+ */
+
+#define LZ_MIN        4
+#define LZ_HASH_BITS  12
+
+typedef struct {
+    u16 table[1u << LZ_HASH_BITS];  /* position + 1 of a 4-byte string */
+    u8  buf[PLD_CODEC_BLOCK];
+} LzWork;
+
+typedef struct {
+    u8     *out;            /* NULL: measuring                          */
+    u32     len;            /* payload bytes of the closed blocks       */
+    u32     fill;           /* plain bytes of the open block            */
+    LzWork *lz;             /* NULL: no compression                     */
+    int     group;          /* sessions: offset of the open group's
+                               count in the block, -1 if none           */
+    u32     group_n;
+    u64     title;
+    u32     prev_ts;
+} Enc;
+
+/* ── LZ ─────────────────────────────────────────────────────────── */
+
+static inline u32 read32(const u8 *p)
+{
+    u32 v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline u32 lz_hash(u32 v)
+{
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static inline u32 lz_ext_len(u32 x)
+{
+    return x < 15 ? 0 : (x - 15) / 255 + 1;
+}
+
+static u32 lz_put_ext(u8 *dst, u32 x)
+{
+    u32 o = 0;
+    for (x -= 15; x >= 255; x -= 255) dst[o++] = 255;
+    dst[o++] = (u8)x;
+    return o;
+}
+
+/* Append a sequence: nlit literals, then a match of mlen bytes off back
+ * (none if mlen is 0, which only the last sequence has).  False if the
+ * output would pass cap. */
+static bool lz_seq(u8 *dst, u32 cap, u32 *o, const u8 *lit, u32 nlit,
+                   u32 off, u32 mlen)
+{
+    u32 need = 1 + lz_ext_len(nlit) + nlit +
+               (mlen ? 2 + lz_ext_len(mlen - LZ_MIN) : 0);
+    if (need > cap - *o) return false;
+    u32 m = mlen ? mlen - LZ_MIN : 0;
+    u8 *p = dst + *o;
+    *p++ = (u8)((nlit < 15 ? nlit : 15) << 4 | (m < 15 ? m : 15));
+    if (nlit >= 15) p += lz_put_ext(p, nlit);
+    memcpy(p, lit, nlit);
+    p += nlit;
+    if (mlen) {
+        *p++ = (u8)off;
+        *p++ = (u8)(off >> 8);
+        if (m >= 15) p += lz_put_ext(p, m);
+    }
+    *o = (u32)(p - dst);
+    return true;
+}
+
+/* Compress src[0..n) into dst; the size, or 0 if it would pass cap. */
+static u32 lz_compress(const u8 *src, u32 n, u8 *dst, u32 cap, u16 *table)
+{
+    memset(table, 0, sizeof(u16) << LZ_HASH_BITS);
+    u32 i = 0, anchor = 0, o = 0;
+    while (i + LZ_MIN <= n) {
+        u32 v = read32(src + i);
+        u32 h = lz_hash(v);
+        u32 c = table[h];
+        table[h] = (u16)(i + 1);
+        if (c == 0 || read32(src + c - 1) != v) {
+            i++;
+            continue;
+        }
+        u32 m = c - 1, len = LZ_MIN;
+        while (i + len < n && src[m + len] == src[i + len]) len++;
+        if (!lz_seq(dst, cap, &o, src + anchor, i - anchor, i - m, len))
+            return 0;
+        i += len;
+        anchor = i;
+    }
+    if (!lz_seq(dst, cap, &o, src + anchor, n - anchor, 0, 0)) return 0;
+    return o;
+}
+
+static bool lz_get_ext(const u8 *src, u32 n, u32 *i, u32 *v)
+{
+    u8 b;
+    do {
+        if (*i >= n) return false;
+        b = src[(*i)++];
+        *v += b;
+    } while (b == 255);
+    return true;
+}
+
+/* Decompress src[0..n) into exactly want bytes at dst. */
+static bool lz_decompress(const u8 *src, u32 n, u8 *dst, u32 want)
+{
+    u32 i = 0, o = 0;
+    while (i < n) {
+        u32 tok = src[i++];
+        u32 lit = tok >> 4;
+        if (lit == 15 && !lz_get_ext(src, n, &i, &lit)) return false;
+        if (lit > n - i || lit > want - o) return false;
+        memcpy(dst + o, src + i, lit);
+        i += lit;
+        o += lit;
+        if (i == n) break;
+        if (n - i < 2) return false;
+        u32 off = (u32)src[i] | (u32)src[i + 1] << 8;
+        i += 2;
+        u32 len = (tok & 15) + LZ_MIN;
+        if ((tok & 15) == 15 && !lz_get_ext(src, n, &i, &len)) return false;
+        if (off == 0 || off > o || len > want - o) return false;
+        for (u32 k = 0; k < len; k++) dst[o + k] = dst[o - off + k];
+        o += len;
+    }
+    return o == want;
+}
+
+/* ── Encoding ───────────────────────────────────────────────────── */
+
+static bool enc_init(Enc *e, u32 codec, u8 *out)
+{
+    memset(e, 0, sizeof(*e));
+    e->out   = out;
+    e->group = -1;
+    if (out && (codec & PLD_CODEC_LZ)) {
+        e->lz = pld_scratch_alloc(sizeof(LzWork));
+        if (!e->lz) return false;
+    }
+    return true;
+}
+
+static inline u8 *enc_plain(const Enc *e)
+{
+    return e->out + e->len + 4;
+}
+
+static void enc_put(Enc *e, const void *p, u32 n)
+{
+    if (e->out) memcpy(enc_plain(e) + e->fill, p, n);
+    e->fill += n;
+}
+
+static void enc_varint(Enc *e, u64 v)
+{
+    u8 b[10];
+    u32 k = 0;
+    while (v >= 0x80) {
+        b[k++] = (u8)(v | 0x80);
+        v >>= 7;
+    }
+    b[k++] = (u8)v;
+    enc_put(e, b, k);
+}
+
+static void enc_close_group(Enc *e)
+{
+    if (e->group >= 0 && e->out) {
+        enc_plain(e)[e->group]     = (u8)e->group_n;
+        enc_plain(e)[e->group + 1] = (u8)(e->group_n >> 8);
+    }
+    e->group = -1;
+}
+
+static void enc_flush(Enc *e)
+{
+    if (e->fill == 0) return;
+    enc_close_group(e);
+    u32 stored = e->fill;
+    if (e->out) {
+        u8 *blk = e->out + e->len;
+        if (e->lz) {
+            u32 z = lz_compress(blk + 4, e->fill, e->lz->buf, e->fill - 1,
+                                e->lz->table);
+            if (z) {
+                memcpy(blk + 4, e->lz->buf, z);
+                stored = z;
+            }
+        }
+        blk[0] = (u8)stored;
+        blk[1] = (u8)(stored >> 8);
+        blk[2] = (u8)e->fill;
+        blk[3] = (u8)(e->fill >> 8);
+    }
+    e->len += 4 + stored;
+    e->fill = 0;
+}
+
+/* Close the block if need more plain bytes would not fit. */
+static void enc_room(Enc *e, u32 need)
+{
+    if (e->fill + need > PLD_CODEC_BLOCK) enc_flush(e);
+}
+
+static int enc_finish(Enc *e)
+{
+    enc_flush(e);
+    pld_scratch_free(e->lz);
+    return (int)e->len;
+}
+
+static const u8 s_zero[2];
+
+static void enc_session(Enc *e, const PldSession *s)
+{
+    enc_room(e, PLD_CODEC_SESSION_MAX);
+    if (e->group < 0 || s->title_id != e->title ||
+        s->timestamp < e->prev_ts || e->group_n == 0xFFFFu) {
+        enc_close_group(e);
+        enc_put(e, &s->title_id, 8);
+        e->group   = (int)e->fill;
+        e->group_n = 0;
+        e->title   = s->title_id;
+        e->prev_ts = 0;
+        enc_put(e, s_zero, 2);
+    }
+    u32 step = s->timestamp - e->prev_ts;
+    enc_varint(e, step % 3600u == 0 ? (u64)(step / 3600u) << 1
+                                    : (u64)step << 1 | 1);
+    enc_varint(e, s->play_secs);
+    e->prev_ts = s->timestamp;
+    e->group_n++;
+}
+
+int pld_codec_encode_sessions(PldWireNext next, void *state, u32 n,
+                              u32 codec, u8 *out)
+{
+    Enc e;
+    if (!enc_init(&e, codec, out)) return -1;
+    for (u32 i = 0; i < n; i++) {
+        PldSession s;
+        next(state, &s);
+        enc_session(&e, &s);
+    }
+    return enc_finish(&e);
+}
+
+int pld_codec_encode_elems(const void *elems, u32 n, u32 elem, u32 codec,
+                           u8 *out)
+{
+    if (elem == 0 || elem > PLD_CODEC_ELEM_MAX) return -1;
+    Enc e;
+    if (!enc_init(&e, codec, out)) return -1;
+    for (u32 i = 0; i < n; i++) {
+        const u8 *p = (const u8 *)elems + (size_t)i * elem;
+        u32 len = elem;
+        while (len > 0 && p[len - 1] == 0) len--;
+        enc_room(&e, 2 + elem);
+        enc_varint(&e, len);
+        enc_put(&e, p, len);
+    }
+    return enc_finish(&e);
+}
+
+/* ── Decoding ───────────────────────────────────────────────────── */
+
+static bool get_varint(const u8 *p, u32 n, u32 *i, u64 *v)
+{
+    *v = 0;
+    for (u32 shift = 0; shift < 64; shift += 7) {
+        if (*i >= n) return false;
+        u8 b = p[(*i)++];
+        *v |= (u64)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+static int decode_sessions(PldCodecReader *r, const u8 *p, u32 n)
+{
+    PldSession batch[32];
+    u32 k = 0, i = 0;
+    while (i < n) {
+        if (n - i < 10) return -1;
+        u64 title;
+        memcpy(&title, p + i, 8);
+        u32 count = (u32)p[i + 8] | (u32)p[i + 9] << 8;
+        i += 10;
+        u64 ts = 0;
+        for (u32 j = 0; j < count; j++) {
+            u64 step, secs;
+            if (!get_varint(p, n, &i, &step) || !get_varint(p, n, &i, &secs))
+                return -1;
+            u64 d = step >> 1;
+            if (d > 0xFFFFFFFFu) return -1;
+            ts += step & 1 ? d : d * 3600u;
+            if (ts > 0xFFFFFFFFu || secs > 0xFFFFFFFFu) return -1;
+            batch[k].title_id  = title;
+            batch[k].timestamp = (u32)ts;
+            batch[k].play_secs = (u32)secs;
+            if (++k == 32) {
+                if (r->sink(r->sink_state, batch, k) != 0) return -1;
+                r->items += k;
+                k = 0;
+            }
+        }
+    }
+    if (k > 0 && r->sink(r->sink_state, batch, k) != 0) return -1;
+    r->items += k;
+    return 0;
+}
+
+static int decode_elems(PldCodecReader *r, const u8 *p, u32 n)
+{
+    u8 batch[4 * PLD_CODEC_ELEM_MAX];
+    u32 per = sizeof(batch) / r->elem, k = 0, i = 0;
+    while (i < n) {
+        u64 len;
+        if (!get_varint(p, n, &i, &len) || len > r->elem || len > n - i)
+            return -1;
+        u8 *e = batch + (size_t)k * r->elem;
+        memcpy(e, p + i, (size_t)len);
+        memset(e + len, 0, r->elem - (u32)len);
+        i += (u32)len;
+        if (++k == per) {
+            if (r->sink(r->sink_state, batch, k) != 0) return -1;
+            r->items += k;
+            k = 0;
+        }
+    }
+    if (k > 0 && r->sink(r->sink_state, batch, k) != 0) return -1;
+    r->items += k;
+    return 0;
+}
+
+void pld_codec_reader_init(PldCodecReader *r, u32 elem, PldWireSink sink,
+                           void *sink_state)
+{
+    r->elem       = elem;
+    r->sink       = sink;
+    r->sink_state = sink_state;
+    r->have       = 0;
+    r->stored     = r->plain = r->got = 0;
+    r->items      = 0;
+}
+
+int pld_codec_feed(void *raw, const void *bytes, u32 n)
+{
+    PldCodecReader *r = (PldCodecReader *)raw;
+    const u8 *p = (const u8 *)bytes;
+    while (n > 0) {
+        u32 take;
+        if (r->have < 4) {
+            take = 4 - r->have < n ? 4 - r->have : n;
+            memcpy(r->hdr + r->have, p, take);
+            r->have += take;
+            if (r->have == 4) {
+                r->stored = (u32)r->hdr[0] | (u32)r->hdr[1] << 8;
+                r->plain  = (u32)r->hdr[2] | (u32)r->hdr[3] << 8;
+                r->got    = 0;
+                if (r->plain == 0 || r->plain > PLD_CODEC_BLOCK ||
+                    r->stored == 0 || r->stored > r->plain)
+                    return -1;
+            }
+        } else {
+            take = r->stored - r->got < n ? r->stored - r->got : n;
+            memcpy(r->in + r->got, p, take);
+            r->got += take;
+            if (r->got == r->stored) {
+                const u8 *plain = r->in;
+                if (r->stored < r->plain) {
+                    if (!lz_decompress(r->in, r->stored, r->out, r->plain))
+                        return -1;
+                    plain = r->out;
+                }
+                int rc = r->elem ? decode_elems(r, plain, r->plain)
+                                 : decode_sessions(r, plain, r->plain);
+                if (rc != 0) return -1;
+                r->have = 0;
+            }
+        }
+        p += take;
+        n -= take;
+    }
+    return 0;
+}
+
+bool pld_codec_reader_done(const PldCodecReader *r)
+{
+    return r->have == 0;
+}
+
+typedef struct {
+    u8  *dst;
+    u32  elem;
+} ElemCopy;
+
+static int count_elems(void *state, const void *elems, u32 n)
+{
+    (void)state;
+    (void)elems;
+    (void)n;
+    return 0;
+}
+
+static int copy_elems(void *state, const void *elems, u32 n)
+{
+    ElemCopy *c = (ElemCopy *)state;
+    memcpy(c->dst, elems, (size_t)n * c->elem);
+    c->dst += (size_t)n * c->elem;
+    return 0;
+}
+
+/* Run the whole payload through a fresh reader; items decoded, or -1. */
+static int decode_all(const u8 *in, u32 len, u32 elem, PldWireSink sink,
+                      void *state)
+{
+    PldCodecReader *r = pld_scratch_alloc(sizeof(*r));
+    if (!r) return -1;
+    pld_codec_reader_init(r, elem, sink, state);
+    int rc = pld_codec_feed(r, in, len) == 0 && pld_codec_reader_done(r)
+             ? (int)r->items : -1;
+    pld_scratch_free(r);
+    return rc;
+}
+
+int pld_codec_decode_elems(const u8 *in, u32 len, u32 elem, void **out,
+                           u32 *count_out)
+{
+    *out       = NULL;
+    *count_out = 0;
+    if (elem == 0 || elem > PLD_CODEC_ELEM_MAX) return -1;
+    /* Count first, so the array is exact and the reader, freed in
+     * between, is the newest scratch block each time. */
+    int n = decode_all(in, len, elem, count_elems, NULL);
+    if (n <= 0) return n;
+    u8 *arr = pld_scratch_alloc((size_t)n * elem);
+    if (!arr) return -1;
+    ElemCopy c = { arr, elem };
+    if (decode_all(in, len, elem, copy_elems, &c) != n) {
+        pld_scratch_free(arr);
+        return -1;
+    }
+    *out       = arr;
+    *count_out = (u32)n;
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include "pld.h"
+
+#include <string.h>
+
+/*
+ * pld_compact.c — session-table compaction and expansion kernels
+ *
+ * Live records sit in runs separated by runs of 0xFF padding, and a written
+ * image is "all live, then all padding".  Rather than test and copy one
+ * 16-byte record at a time, the kernel ANDs the title_id words of
+ * PLD_COMPACT_STRIDE slots together (all ones ⇔ every slot empty) to skip
+ * padding a block at a time, then moves each live run with one memmove.
+ * On the ARM11 the u64 ANDs lower to pairs of 32-bit ANDs over ldm'd words,
+ * which beats the ARMv6 packed-byte ops for an all-ones test.
+ */
+
+#define PLD_COMPACT_STRIDE 8
+#define PLD_EMPTY_ID       0xFFFFFFFFFFFFFFFFULL
+
+int pld_compact_sessions_ref(PldSession *buf, int n)
+{
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        if (!pld_session_is_empty(&buf[i]))
+            buf[count++] = buf[i];
+    }
+    return count;
+}
+
+int pld_compact_sessions_to(PldSession *dst, const PldSession *src, int n)
+{
+    int out = 0;
+    int i   = 0;
+    while (i < n) {
+        /* Skip padding a block at a time, then slot by slot. */
+        while (i + PLD_COMPACT_STRIDE <= n) {
+            const PldSession *b = &src[i];
+            u64 all = b[0].title_id & b[1].title_id & b[2].title_id &
+                      b[3].title_id & b[4].title_id & b[5].title_id &
+                      b[6].title_id & b[7].title_id;
+            if (all != PLD_EMPTY_ID) break;
+            i += PLD_COMPACT_STRIDE;
+        }
+        while (i < n && src[i].title_id == PLD_EMPTY_ID)
+            i++;
+
+        /* Measure the live run and move it in one go. */
+        int run = i;
+        while (i < n && src[i].title_id != PLD_EMPTY_ID)
+            i++;
+        int len = i - run;
+        if (len > 0) {
+            if (dst + out != src + run)
+                memmove(dst + out, src + run, (size_t)len * sizeof(PldSession));
+            out += len;
+        }
+    }
+    return out;
+}
+
+int pld_compact_sessions(PldSession *buf, int n)
+{
+    return pld_compact_sessions_to(buf, buf, n);
+}
+
+void pld_expand_sessions(PldSession *table, const PldSession *live, int count)
+{
+    if (count > PLD_SESSION_COUNT) count = PLD_SESSION_COUNT;
+    if (count > 0 && table != live)
+        memmove(table, live, (size_t)count * sizeof(PldSession));
+    memset(table + count, 0xFF,
+           (size_t)(PLD_SESSION_COUNT - count) * sizeof(PldSession));
+}
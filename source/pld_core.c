@@ -0,0 +1,570 @@
+#include "pld.h"
+#include "memprof.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+/*
+ * pld_core.c — portable half of the pld module
+ *
+ * Parsing, compaction, merge and SD serialization.  Nothing in here touches
+ * libctru: NAND access goes through a PldStorage backend opened by pld.c,
+ * and SD files through the stdio backend, so this file also builds on the
+ * host for `make host-bench`.
+ */
+
+/* ── File parsing ───────────────────────────────────────────────── */
+
+Result pld_load_summary(PldStorage *st, PldFile *out)
+{
+    memset(out, 0, sizeof(*out));
+
+    /* Header */
+    Result rc = pld_storage_read(st, PLD_HEADER_OFFSET,
+                                 &out->header, sizeof(out->header));
+    if (R_FAILED(rc)) return rc;
+
+    /* Summary table — seek directly to its absolute offset */
+    rc = pld_storage_read(st, PLD_SUMMARY_OFFSET,
+                          out->summaries, sizeof(out->summaries));
+    if (R_FAILED(rc)) return rc;
+
+    /* Count live entries */
+    out->summary_count = 0;
+    for (int i = 0; i < PLD_SUMMARY_COUNT; i++) {
+        if (!pld_summary_is_empty(&out->summaries[i]))
+            out->summary_count++;
+    }
+    return 0;
+}
+
+bool pld_summary_is_empty(const PldSummary *s)
+{
+    /*
+     * Empty slots have title_id = 0xFFFFFFFFFFFFFFFF (matching the
+     * session-log empty marker pattern from the spec).
+     * Also treat a fully-zeroed slot as empty.
+     */
+    return (s->title_id == 0xFFFFFFFFFFFFFFFFULL) || (s->title_id == 0ULL);
+}
+
+bool pld_session_is_empty(const PldSession *s)
+{
+    return s->title_id == 0xFFFFFFFFFFFFFFFFULL;
+}
+
+/* buf holds n compacted PldSessions from offset 0 and is at least
+ * PLD_LOG_BYTES long.  Pack them in place and shrink buf to PLD_LOG_BYTES,
+ * or, for an arena buffer, into a log block of their own; buf is released
+ * on failure. */
+static Result pack_in_place(u8 *buf, int n, PldSessionLog *out)
+{
+    Result rc;
+    if (pld_scratch_owned(buf)) {
+        /* The arena is released at the end of the operation; the log is
+         * not. */
+        rc = pld_log_alloc(out) ? pld_log_pack(out, (const PldSession *)buf, n)
+                                : (Result)-1;
+        pld_scratch_free(buf);
+        if (R_FAILED(rc)) pld_sessions_free(out);
+        return rc;
+    }
+    pld_log_attach(out, buf);
+    rc = pld_log_pack(out, (const PldSession *)buf, n);
+    if (R_FAILED(rc)) {
+        MEM_FREE(buf);
+        out->entries = NULL;
+        out->titles  = NULL;
+        out->count   = 0;
+        return rc;
+    }
+    u8 *shrunk = MEM_REALLOC(MEM_PLD, buf, PLD_LOG_BYTES);
+    if (shrunk) pld_log_attach(out, shrunk);   /* else keep the larger block */
+    return 0;
+}
+
+Result pld_load_sessions(PldStorage *st, PldSessionLog *out)
+{
+    out->entries = NULL;
+    out->titles  = NULL;
+    out->count   = 0;
+
+    /* 800 000 B of records; PLD_LOG_BYTES is smaller, so the buffer can
+     * hold the packed log afterwards. */
+    PldSession *buf = pld_scratch_alloc(PLD_SESSION_COUNT * sizeof(PldSession));
+    if (!buf) return -1;
+
+    Result rc = pld_storage_read(st, PLD_SESSION_OFFSET,
+                                 buf, PLD_SESSION_COUNT * sizeof(PldSession));
+    if (R_FAILED(rc)) { pld_scratch_free(buf); return rc; }
+
+    int n = pld_compact_sessions(buf, PLD_SESSION_COUNT);
+    return pack_in_place((u8 *)buf, n, out);
+}
+
+Result pld_parse_image(u8 *image, PldFile *pld_out, PldSessionLog *sessions_out)
+{
+    memset(pld_out, 0, sizeof(*pld_out));
+
+    /* Header and summaries first: session compaction below reuses the front
+     * of the image (including the header bytes) as the entries array. */
+    memcpy(&pld_out->header, image + PLD_HEADER_OFFSET, sizeof(pld_out->header));
+    memcpy(pld_out->summaries, image + PLD_SUMMARY_OFFSET,
+           sizeof(pld_out->summaries));
+    for (int i = 0; i < PLD_SUMMARY_COUNT; i++) {
+        if (!pld_summary_is_empty(&pld_out->summaries[i]))
+            pld_out->summary_count++;
+    }
+
+    /* Record i sits at byte 16 + 16*i and is written to 16*count with
+     * count <= i, so the forward copy never overtakes the read cursor. */
+    int n = pld_compact_sessions_to(
+        (PldSession *)image, (const PldSession *)(image + PLD_SESSION_OFFSET),
+        PLD_SESSION_COUNT);
+    return pack_in_place(image, n, sessions_out);
+}
+
+Result pld_load_all(PldStorage *st, PldFile *pld_out,
+                    PldSessionLog *sessions_out)
+{
+    return pld_load_all_unless(st, 0, pld_out, sessions_out);
+}
+
+Result pld_load_all_unless(PldStorage *st, u64 skip_hash, PldFile *pld_out,
+                           PldSessionLog *sessions_out)
+{
+    memset(pld_out, 0, sizeof(*pld_out));
+    sessions_out->entries = NULL;
+    sessions_out->titles  = NULL;
+    sessions_out->count   = 0;
+
+    /* PLD_FILE_SIZE >= PLD_LOG_BYTES, so the image buffer doubles as the
+     * session log after parsing. */
+    u8 *image = pld_scratch_alloc(PLD_FILE_SIZE);
+    if (!image) return (Result)-1;
+
+    Result rc = pld_storage_read(st, 0, image, PLD_FILE_SIZE);
+    if (R_FAILED(rc)) { pld_scratch_free(image); return rc; }
+
+    /* Hashed before parsing overwrites the image; lets the startup merge
+     * recognise a NAND log it has already merged (pld_sd_matches_nand). */
+    u64 hash = pld_hash64(image, PLD_FILE_SIZE, 0);
+    if (skip_hash && hash == skip_hash) {
+        pld_scratch_free(image);
+        pld_out->image_hash = hash;
+        return PLD_RC_UNCHANGED;
+    }
+    rc = pld_parse_image(image, pld_out, sessions_out);
+    pld_out->image_hash = hash;
+    return rc;
+}
+
+u8 *pld_build_image(const PldFile *pld, const PldSessionLog *sessions)
+{
+    u8 *buf = pld_scratch_alloc(PLD_FILE_SIZE);
+    if (!buf) return NULL;
+
+    /* Header */
+    memcpy(buf + PLD_HEADER_OFFSET, &pld->header, sizeof(pld->header));
+
+    /* Session log: valid entries first, remaining slots 0xFF (empty). */
+    PldSession *table = (PldSession *)(buf + PLD_SESSION_OFFSET);
+    pld_log_unpack(sessions, table);
+    pld_expand_sessions(table, table, sessions->count);
+
+    /* Summary table (full 256-slot array, empties already marked) */
+    memcpy(buf + PLD_SUMMARY_OFFSET, pld->summaries, sizeof(pld->summaries));
+    return buf;
+}
+
+Result pld_store_image(PldStorage *st, const PldFile *pld,
+                       const PldSessionLog *sessions)
+{
+    u8 *buf = pld_build_image(pld, sessions);
+    if (!buf) return (Result)-1;
+
+    Result rc = pld_storage_write(st, 0, buf, PLD_FILE_SIZE);
+    pld_scratch_free(buf);
+    return rc;
+}
+
+void pld_sessions_free(PldSessionLog *log)
+{
+    MEM_FREE(log->entries);
+    log->entries = NULL;
+    log->titles  = NULL;
+    log->count   = 0;
+}
+
+/* Merge one remote summary into local.
+ * Returns 1 if inserted, 0 if matched (or skipped), -1 if the table is full. */
+static int merge_one_summary(PldFile *local, const PldSummary *r, bool add_only)
+{
+    if (pld_summary_is_empty(r)) return 0;
+
+    int found = -1;
+    for (int j = 0; j < PLD_SUMMARY_COUNT; j++) {
+        if (local->summaries[j].title_id == r->title_id) {
+            found = j; break;
+        }
+    }
+
+    if (found >= 0) {
+        if (!add_only) {
+            PldSummary *l = &local->summaries[found];
+            l->total_secs += r->total_secs;
+            u32 lc = (u32)l->launch_count + r->launch_count;
+            l->launch_count = lc > 0xFFFF ? 0xFFFF : (u16)lc;
+            if (r->first_played_days < l->first_played_days)
+                l->first_played_days = r->first_played_days;
+            if (r->last_played_days > l->last_played_days)
+                l->last_played_days = r->last_played_days;
+        }
+        /* add_only: existing entry preserved as-is */
+        return 0;
+    }
+
+    int slot = -1;
+    for (int j = 0; j < PLD_SUMMARY_COUNT; j++) {
+        if (pld_summary_is_empty(&local->summaries[j])) {
+            slot = j; break;
+        }
+    }
+    if (slot < 0) return -1;
+    local->summaries[slot] = *r;
+    local->summary_count++;
+    return 1;
+}
+
+int pld_merge_summaries(PldFile *local, const PldSummary *remote, int remote_count, bool add_only)
+{
+    int added = 0;
+    for (int i = 0; i < remote_count; i++) {
+        int rc = merge_one_summary(local, &remote[i], add_only);
+        if (rc < 0) return -1;
+        added += rc;
+    }
+    return added;
+}
+
+int pld_merge_summaries_view(PldFile *local, PldView *remote, bool add_only)
+{
+    int added = 0;
+    PldSummary r;
+    while (pld_view_next_summary(remote, &r)) {
+        int rc = merge_one_summary(local, &r, add_only);
+        if (rc < 0) return -1;
+        added += rc;
+    }
+    if (R_FAILED(remote->rc)) return -1;
+    return added;
+}
+
+Result pld_read_sd(const char *path, PldFile *pld_out, PldSessionLog *sessions_out)
+{
+    memset(pld_out, 0, sizeof(*pld_out));
+    sessions_out->entries = NULL;
+    sessions_out->titles  = NULL;
+    sessions_out->count   = 0;
+
+    PldStorage st;
+    if (R_FAILED(pld_storage_open_stdio(&st, path, false)))
+        return (Result)-1;
+
+    Result rc = pld_load_all(&st, pld_out, sessions_out);
+    pld_storage_close(&st);
+    return rc;
+}
+
+static void sidecar_init(PldSidecar *sc, const u8 *image, u64 hash)
+{
+    memset(sc, 0, sizeof(*sc));
+    sc->magic      = PLD_SIDECAR_MAGIC;
+    sc->image_hash = hash;
+    memcpy(&sc->header, image + PLD_HEADER_OFFSET, sizeof(sc->header));
+}
+
+/* Write image to path unless its sidecar shows it is already there, then
+ * (re)write the sidecar if anything in it changed.  The old sidecar is
+ * removed before the image is touched, so a failed write never leaves a
+ * sidecar vouching for a half-written file. */
+static Result write_hashed(const char *path, const u8 *image,
+                           u64 nand_hash, u32 flags)
+{
+    PldSidecar sc, old;
+    sidecar_init(&sc, image, pld_hash64(image, PLD_FILE_SIZE, 0));
+    sc.nand_hash = nand_hash;
+    sc.flags     = flags;
+
+    if (R_SUCCEEDED(pld_sidecar_read(path, &old)) &&
+        old.image_hash == sc.image_hash && pld_sidecar_current(path, &old)) {
+        if (memcmp(&old, &sc, sizeof(old)) != 0)
+            pld_sidecar_write(path, &sc);
+        return PLD_RC_UNCHANGED;
+    }
+
+    pld_sidecar_remove(path);
+    PldStorage st;
+    if (R_FAILED(pld_storage_open_stdio(&st, path, true)))
+        return (Result)-1;
+    Result rc = pld_storage_write(&st, 0, image, PLD_FILE_SIZE);
+    Result close_rc = pld_storage_close(&st);
+    if (R_FAILED(rc)) return rc;
+    if (R_FAILED(close_rc)) return close_rc;
+    pld_sidecar_write(path, &sc);  /* best effort: without it we just rewrite */
+    return 0;
+}
+
+Result pld_write_sd_merged(const char *path, const PldFile *pld,
+                           const PldSessionLog *sessions, u64 nand_hash,
+                           bool nand_only)
+{
+    u8 *image = pld_build_image(pld, sessions);
+    if (!image) return (Result)-1;
+
+    u32 flags = (nand_only && nand_hash) ? PLD_SIDECAR_NAND_ONLY : 0;
+    Result rc = write_hashed(path, image, nand_hash, flags);
+    pld_scratch_free(image);
+    return rc;
+}
+
+Result pld_write_sd(const char *path, const PldFile *pld,
+                    const PldSessionLog *sessions)
+{
+    return pld_write_sd_merged(path, pld, sessions, 0, false);
+}
+
+static Result newest_backup_hash(u64 *hash_out);
+
+Result pld_backup_from_path(const char *src_path)
+{
+    /* A current sidecar on the source answers the dedup question without
+     * reading the 806 KB image. */
+    PldSidecar sc;
+    u64  newest_hash;
+    if (R_SUCCEEDED(pld_sidecar_read(src_path, &sc)) &&
+        pld_sidecar_current(src_path, &sc) &&
+        R_SUCCEEDED(newest_backup_hash(&newest_hash)) &&
+        newest_hash == sc.image_hash)
+        return PLD_RC_UNCHANGED;
+
+    u8 *buf = pld_scratch_alloc(PLD_FILE_SIZE);
+    if (!buf) return (Result)-1;
+
+    FILE *f = fopen(src_path, "rb");
+    if (!f) { pld_scratch_free(buf); return (Result)-1; }
+    size_t n = fread(buf, 1, PLD_FILE_SIZE, f);
+    fclose(f);
+    if (n != PLD_FILE_SIZE) { pld_scratch_free(buf); return (Result)-1; }
+
+    Result rc = pld_backup_store(buf);
+    pld_scratch_free(buf);
+    return rc;
+}
+
+int pld_longest_streak(const PldRec *recs, int count)
+{
+    if (count == 0) return 0;
+
+    int best = 1, run = 1;
+    int prev_day = (int)(recs[0].timestamp / 86400u);
+
+    for (int i = 1; i < count; i++) {
+        int cur_day = (int)(recs[i].timestamp / 86400u);
+        if (cur_day == prev_day)
+            continue;                   /* same day — skip duplicate */
+        if (cur_day - prev_day == 1)
+            run++;                      /* consecutive day (ascending order) */
+        else
+            run = 1;                    /* gap — reset streak */
+        if (run > best) best = run;
+        prev_day = cur_day;
+    }
+    return best;
+}
+
+/* ── Backup / Restore ───────────────────────────────────────────── */
+
+/* Content hash of the newest backup, from the catalog. */
+static Result newest_backup_hash(u64 *hash_out)
+{
+    PldCatalog cat;
+    Result rc = pld_catalog_load(PLD_BACKUP_DIR, &cat);
+    if (R_SUCCEEDED(rc) && cat.count == 0) rc = (Result)-1;
+    if (R_SUCCEEDED(rc)) *hash_out = cat.entries[0].image_hash;
+    pld_catalog_free(&cat);
+    return rc;
+}
+
+Result pld_backup_store(const u8 *image)
+{
+    return pld_backup_store_in(PLD_BACKUP_DIR, image, (u32)time(NULL));
+}
+
+Result pld_backup_store_in(const char *dir, const u8 *image, u32 now)
+{
+    mkdir(dir, 0777);
+
+    /* Identical to the newest backup: keep the ring for real history. */
+    PldCatalog cat;
+    pld_catalog_load(dir, &cat);
+    u64 hash = pld_hash64(image, PLD_FILE_SIZE, 0);
+    if (cat.count > 0 && cat.entries[0].image_hash == hash) {
+        pld_catalog_free(&cat);
+        return PLD_RC_UNCHANGED;
+    }
+
+    /* Build timestamped filename; a second backup within the same second
+     * takes the next free one. */
+    PldBackupEntry e;
+    memset(&e, 0, sizeof(e));
+    time_t stamp = (time_t)now;
+    do {
+        struct tm *t = localtime(&stamp);
+        snprintf(e.name, sizeof(e.name),
+                 "pld_backup_%04u%02u%02u_%02u%02u%02u.dat",
+                 (unsigned)(t->tm_year + 1900) % 10000u,
+                 (unsigned)(t->tm_mon + 1) % 100u, (unsigned)t->tm_mday % 100u,
+                 (unsigned)t->tm_hour % 100u, (unsigned)t->tm_min % 100u,
+                 (unsigned)t->tm_sec % 100u);
+        stamp++;
+    } while (pld_catalog_find(&cat, e.name) >= 0);
+    char path[160];
+    snprintf(path, sizeof(path), "%s/%s", dir, e.name);
+
+    /* An image that doesn't compress is stored raw. */
+    u8 *packed = NULL;
+    u32 packed_len = 0;
+    bool raw = R_FAILED(pld_backup_encode(image, now, &packed, &packed_len));
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        MEM_FREE(packed);
+        pld_catalog_free(&cat);
+        return (Result)-1;
+    }
+    const u8 *data = raw ? image : packed;
+    u32       size = raw ? PLD_FILE_SIZE : packed_len;
+    size_t written = fwrite(data, 1, size, f);
+    int close_rc = fclose(f);
+    if (!raw) {
+        PldBackupHeader bh;
+        memcpy(&bh, packed, sizeof(bh));
+        e.session_count = bh.session_count;
+        e.app_count     = bh.app_count;
+    }
+    MEM_FREE(packed);
+    if (written != size || close_rc != 0) {
+        remove(path);
+        pld_catalog_free(&cat);
+        return (Result)-1;
+    }
+
+    if (raw) {
+        pld_catalog_count(image, &e);
+        e.flags = PLD_CATALOG_RAW;
+    }
+    e.image_hash = hash;
+    e.created    = now;
+    e.size       = size;
+
+    /* Record, prune to the retention limits, then publish both at once. */
+    PldRetention ret;
+    pld_backup_get_retention(&ret);
+    Result rc = pld_catalog_insert(&cat, &e);
+    if (R_SUCCEEDED(rc)) {
+        pld_catalog_prune(dir, &cat, &ret);
+        rc = pld_catalog_save(dir, &cat);
+    }
+    pld_catalog_free(&cat);
+    return rc;
+}
+
+Result pld_backup_app_count(const char *path, int *app_count)
+{
+    *app_count = 0;
+
+    PldBackupHeader bh;
+    if (R_SUCCEEDED(pld_backup_read_header(path, &bh))) {
+        *app_count = bh.app_count;
+        return 0;
+    }
+
+    PldView v;
+    Result rc = pld_view_open(&v, path);
+    if (R_FAILED(rc)) return rc;
+
+    int count = 0;
+    PldSummary s;
+    while (pld_view_next_summary(&v, &s))
+        count++;
+    rc = v.rc;
+    pld_view_close(&v);
+    if (R_FAILED(rc)) return rc;
+
+    *app_count = count;
+    return 0;
+}
+
+/* ── Formatting ─────────────────────────────────────────────────── */
+
+void pld_fmt_time(u32 seconds, char *buf, size_t len)
+{
+    unsigned h = seconds / 3600;
+    unsigned m = (seconds % 3600) / 60;
+    snprintf(buf, len, "%uh %02um", h, m);
+}
+
+/*
+ * Days-since-2000 → Gregorian YYYY-MM-DD.
+ * Correct for years 2000–2099 (the only range present in 3DS data).
+ * 2000 is a leap year; within 2000–2099 every year divisible by 4 is leap.
+ */
+void pld_fmt_date(u16 days, char *buf, size_t len)
+{
+    static const int month_days[12] = {
+        31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+    };
+
+    int year = 2000;
+    int d    = (int)days;
+
+    /* Consume complete 4-year blocks (1461 days each; 2000 is leap-first) */
+    year += (d / 1461) * 4;
+    d    %= 1461;
+
+    /* Remaining years within the block */
+    for (int y = 0; y < 4; y++) {
+        bool leap = (year % 4 == 0);   /* within 2000–2099, div-by-4 = leap */
+        int  days_in_year = leap ? 366 : 365;
+        if (d < days_in_year) break;
+        d -= days_in_year;
+        year++;
+    }
+
+    /* Month */
+    bool leap = (year % 4 == 0);
+    int  month = 0;
+    for (month = 0; month < 12; month++) {
+        int dim = month_days[month];
+        if (leap && month == 1) dim = 29;
+        if (d < dim) break;
+        d -= dim;
+    }
+
+    snprintf(buf, len, "%04d-%02d-%02d", year, month + 1, d + 1);
+}
+
+void pld_fmt_timestamp(u32 timestamp, char *buf, size_t len)
+{
+    /* Convert seconds-since-2000 to days + hour */
+    u32 total_days = timestamp / 86400;
+    u32 hour       = (timestamp % 86400) / 3600;
+
+    char date_buf[12];
+    pld_fmt_date((u16)total_days, date_buf, sizeof(date_buf));
+    snprintf(buf, len, "%s %02lu:00", date_buf, (unsigned long)hour);
+}
@@ -0,0 +1,977 @@
+#include "pld.h"
+#include "memprof.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * pld_ext.c — merged2.dat, the uncapped SD dataset
+ *
+ * In memory the dataset is two sorted arrays that grow by doubling.  A
+ * merge sorts and folds the remote side (LSD radix sort on the 12 key
+ * bytes, skipping byte positions on which every key agrees), then joins
+ * it into the sessions backwards from the end of the grown array, so no
+ * second buffer the size of the history is needed.
+ *
+ * On SD the sessions are cut into PLD_EXT_BLOCK-record blocks, each with
+ * its key range and CRC in the index, which is what lets pld_ext_read_range
+ * fetch one title's history without reading the rest.
+ *
+ * Rollups are a third sorted array, small next to the sessions they
+ * replace (a day of hourly sessions becomes one record, a week of them
+ * one more), kept whole in the header area so readers have them at open.
+ */
+
+typedef enum { FOLD_SUM, FOLD_KEEP, FOLD_MAX } Fold;
+
+static inline bool key_lt(const PldSession *a, const PldSession *b)
+{
+    return a->title_id < b->title_id ||
+           (a->title_id == b->title_id && a->timestamp < b->timestamp);
+}
+
+static inline bool key_eq(const PldSession *a, const PldSession *b)
+{
+    return a->title_id == b->title_id && a->timestamp == b->timestamp;
+}
+
+static inline void fold_secs(PldSession *dst, const PldSession *r, Fold f)
+{
+    if (f == FOLD_SUM) {
+        u32 sum = dst->play_secs + r->play_secs;
+        dst->play_secs = sum > 3600 ? 3600 : sum;
+    } else if (f == FOLD_MAX && r->play_secs > dst->play_secs) {
+        dst->play_secs = r->play_secs;
+    }
+}
+
+void pld_ext_init(PldExt *x)
+{
+    memset(x, 0, sizeof(*x));
+}
+
+void pld_ext_free(PldExt *x)
+{
+    MEM_FREE(x->sessions);
+    MEM_FREE(x->summaries);
+    MEM_FREE(x->rollups);
+    pld_ext_init(x);
+}
+
+static bool grow(void **p, int *cap, int want, size_t size)
+{
+    if (want <= *cap) return true;
+    int c = *cap ? *cap : 1024;
+    while (c < want) c *= 2;
+    void *n = MEM_REALLOC(MEM_PLD, *p, (size_t)c * size);
+    if (!n) return false;
+    *p   = n;
+    *cap = c;
+    return true;
+}
+
+/* ── Sessions ───────────────────────────────────────────────────── */
+
+/* Byte d of the key, least significant first: timestamp bytes 0–3, then
+ * title_id bytes 0–7. */
+static inline u32 key_byte(const PldSession *s, int d)
+{
+    if (d < 4) return (s->timestamp >> (8 * d)) & 0xFF;
+    return (u32)(s->title_id >> (8 * (d - 4))) & 0xFF;
+}
+
+static void radix_sort(PldSession *a, PldSession *tmp, int n)
+{
+    u32 ts_diff = 0;
+    u64 id_diff = 0;
+    for (int i = 1; i < n; i++) {
+        ts_diff |= a[i].timestamp ^ a[0].timestamp;
+        id_diff |= a[i].title_id ^ a[0].title_id;
+    }
+
+    PldSession *src = a, *dst = tmp;
+    for (int d = 0; d < 12; d++) {
+        u32 diff = d < 4 ? (ts_diff >> (8 * d)) & 0xFF
+                         : (u32)(id_diff >> (8 * (d - 4))) & 0xFF;
+        if (!diff) continue;
+
+        u32 count[256];
+        memset(count, 0, sizeof(count));
+        for (int i = 0; i < n; i++)
+            count[key_byte(&src[i], d)]++;
+        u32 pos = 0;
+        for (int b = 0; b < 256; b++) {
+            u32 c = count[b];
+            count[b] = pos;
+            pos += c;
+        }
+        for (int i = 0; i < n; i++)
+            dst[count[key_byte(&src[i], d)]++] = src[i];
+
+        PldSession *t = src; src = dst; dst = t;
+    }
+    if (src != a)
+        memcpy(a, src, (size_t)n * sizeof(PldSession));
+}
+
+/* Copy the live records of remote into a sorted array with equal keys
+ * folded, as the pairwise merge folds them on the way in.  Returns the
+ * count, or -1 on OOM. */
+static int prepare_remote(const PldSession *remote, int n, Fold f,
+                          PldSession **out)
+{
+    PldSession *r = MEM_MALLOC(MEM_PLD,
+                               (size_t)(n ? n : 1) * sizeof(PldSession));
+    if (!r) return -1;
+    int m = 0;
+    bool sorted = true;
+    for (int i = 0; i < n; i++) {
+        if (remote[i].title_id == 0 || pld_session_is_empty(&remote[i]))
+            continue;
+        if (m > 0 && !key_lt(&r[m - 1], &remote[i])) sorted = false;
+        r[m++] = remote[i];
+    }
+    if (!sorted) {
+        PldSession *tmp = MEM_MALLOC(MEM_PLD, (size_t)m * sizeof(PldSession));
+        if (!tmp) { MEM_FREE(r); return -1; }
+        radix_sort(r, tmp, m);
+        MEM_FREE(tmp);
+    }
+
+    int w = 0;
+    for (int i = 0; i < m; i++) {
+        if (w > 0 && key_eq(&r[w - 1], &r[i]))
+            fold_secs(&r[w - 1], &r[i], f);
+        else
+            r[w++] = r[i];
+    }
+    *out = r;
+    return w;
+}
+
+static int merge_sessions(PldExt *x, const PldSession *remote, int n, Fold f)
+{
+    PldSession *r;
+    int m = prepare_remote(remote, n, f, &r);
+    if (m < 0) return -1;
+    if (!grow((void **)&x->sessions, &x->cap, x->count + m,
+              sizeof(PldSession))) {
+        MEM_FREE(r);
+        return -1;
+    }
+
+    /* Join from the back: the write cursor w never passes the local read
+     * cursor i because it starts m slots beyond it and moves at most once
+     * per record consumed from either side. */
+    PldSession *s = x->sessions;
+    int i = x->count - 1, j = m - 1, w = x->count + m;
+    int added = 0;
+    while (j >= 0) {
+        if (i >= 0 && key_lt(&r[j], &s[i])) {
+            s[--w] = s[i--];
+        } else if (i >= 0 && key_eq(&r[j], &s[i])) {
+            s[--w] = s[i--];
+            fold_secs(&s[w], &r[j--], f);
+        } else {
+            s[--w] = r[j--];
+            added++;
+        }
+    }
+    /* Local records below the first remote key are already in place;
+     * close the gap left by folded keys. */
+    int low = i + 1;
+    if (w > low)
+        memmove(s + low, s + w, (size_t)(x->count + m - w) * sizeof(PldSession));
+    x->count += added;
+    MEM_FREE(r);
+    return added;
+}
+
+int pld_ext_merge_sessions(PldExt *x, const PldSession *remote, int n,
+                           bool add_only)
+{
+    return merge_sessions(x, remote, n, add_only ? FOLD_KEEP : FOLD_SUM);
+}
+
+/* ── Summaries ──────────────────────────────────────────────────── */
+
+static int find_summary(const PldExt *x, u64 title_id)
+{
+    int lo = 0, hi = x->summary_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (x->summaries[mid].title_id < title_id) lo = mid + 1;
+        else hi = mid;
+    }
+    return (lo < x->summary_count && x->summaries[lo].title_id == title_id)
+               ? lo : -1;
+}
+
+static void fold_summary(PldSummary *l, const PldSummary *r, Fold f)
+{
+    if (f == FOLD_KEEP) return;
+    if (f == FOLD_SUM) {
+        l->total_secs += r->total_secs;
+        u32 lc = (u32)l->launch_count + r->launch_count;
+        l->launch_count = lc > 0xFFFF ? 0xFFFF : (u16)lc;
+    } else {
+        if (r->total_secs > l->total_secs) l->total_secs = r->total_secs;
+        if (r->launch_count > l->launch_count)
+            l->launch_count = r->launch_count;
+    }
+    if (r->first_played_days < l->first_played_days)
+        l->first_played_days = r->first_played_days;
+    if (r->last_played_days > l->last_played_days)
+        l->last_played_days = r->last_played_days;
+}
+
+static int cmp_summary(const void *a, const void *b)
+{
+    u64 x = ((const PldSummary *)a)->title_id;
+    u64 y = ((const PldSummary *)b)->title_id;
+    return x < y ? -1 : x > y;
+}
+
+static int merge_summaries(PldExt *x, const PldSummary *remote, int n, Fold f)
+{
+    if (!grow((void **)&x->summaries, &x->summary_cap, x->summary_count + n,
+              sizeof(PldSummary)))
+        return -1;
+
+    /* New titles are appended past the sorted prefix, then sorted in. */
+    int sorted = x->summary_count, added = 0;
+    for (int i = 0; i < n; i++) {
+        const PldSummary *r = &remote[i];
+        if (pld_summary_is_empty(r)) continue;
+        int at = find_summary(x, r->title_id);
+        if (at < 0) {
+            for (int k = sorted; k < sorted + added; k++)
+                if (x->summaries[k].title_id == r->title_id) { at = k; break; }
+        }
+        if (at >= 0) {
+            fold_summary(&x->summaries[at], r, f);
+        } else {
+            x->summaries[sorted + added++] = *r;
+        }
+    }
+    x->summary_count = sorted + added;
+    if (added)
+        qsort(x->summaries, (size_t)x->summary_count, sizeof(PldSummary),
+              cmp_summary);
+    return added;
+}
+
+int pld_ext_merge_summaries(PldExt *x, const PldSummary *remote, int n,
+                            bool add_only)
+{
+    return merge_summaries(x, remote, n, add_only ? FOLD_KEEP : FOLD_SUM);
+}
+
+static int merge_log(PldExt *x, const PldFile *pld, const PldSessionLog *log,
+                     Fold f)
+{
+    if (x->count == 0 && x->summary_count == 0) x->header = pld->header;
+    PldSession *buf = MEM_MALLOC(MEM_PLD,
+                                 (size_t)(log->count ? log->count : 1) *
+                                 sizeof(PldSession));
+    if (!buf) return -1;
+    pld_log_unpack(log, buf);
+    int added = merge_sessions(x, buf, log->count, f);
+    MEM_FREE(buf);
+    if (added < 0 ||
+        merge_summaries(x, pld->summaries, PLD_SUMMARY_COUNT, f) < 0)
+        return -1;
+    return added;
+}
+
+int pld_ext_merge_log(PldExt *x, const PldFile *pld, const PldSessionLog *log,
+                      bool add_only)
+{
+    return merge_log(x, pld, log, add_only ? FOLD_KEEP : FOLD_SUM);
+}
+
+void pld_ext_apply_totals(PldExt *x)
+{
+    /* All three arrays ascend by title_id: one walk over each. */
+    int i = 0, j = 0;
+    for (int k = 0; k < x->summary_count; k++) {
+        PldSummary *s = &x->summaries[k];
+        while (i < x->count && x->sessions[i].title_id < s->title_id) i++;
+        while (j < x->rollup_count && x->rollups[j].title_id < s->title_id) j++;
+        u32 total = 0;
+        while (i < x->count && x->sessions[i].title_id == s->title_id)
+            total += x->sessions[i++].play_secs;
+        while (j < x->rollup_count && x->rollups[j].title_id == s->title_id)
+            total += x->rollups[j++].play_secs;
+        s->total_secs = total;
+    }
+}
+
+/* ── Rollups ────────────────────────────────────────────────────── */
+
+static PldRollupPolicy s_rollup = { 0, 0 };
+
+void pld_ext_set_rollup(const PldRollupPolicy *p)
+{
+    s_rollup = *p;
+}
+
+void pld_ext_get_rollup(PldRollupPolicy *out)
+{
+    *out = s_rollup;
+}
+
+static inline u32 period_start(u32 ts, u32 days)
+{
+    return ts - ts % (days * 86400u);
+}
+
+static inline u32 period_end(const PldRollup *r)
+{
+    return r->start + r->days * 86400u;
+}
+
+/* Does r cover s? */
+static inline bool covers(const PldRollup *r, const PldSession *s)
+{
+    return r->title_id == s->title_id && s->timestamp >= r->start &&
+           s->timestamp < period_end(r);
+}
+
+static inline bool rollup_valid(const PldRollup *r)
+{
+    return r->title_id != 0 && r->title_id != 0xFFFFFFFFFFFFFFFFULL &&
+           (r->days == PLD_ROLLUP_DAY || r->days == PLD_ROLLUP_WEEK) &&
+           r->start % (r->days * 86400u) == 0 &&
+           (r->days == PLD_ROLLUP_DAY ? r->day_mask == 1 && r->hour_mask < (1u << 24)
+                                      : r->hour_mask == 0 && r->day_mask < 0x80);
+}
+
+static void to_week(PldRollup *r)
+{
+    u32 start = period_start(r->start, PLD_ROLLUP_WEEK);
+    r->day_mask  = (u8)(r->day_mask << ((r->start - start) / 86400u));
+    r->start     = start;
+    r->days      = PLD_ROLLUP_WEEK;
+    r->hour_mask = 0;
+}
+
+/* Add session s to r, which covers it, unless its hour (its day, in a
+ * weekly rollup) is already in.  Returns whether it was added. */
+static bool absorb(PldRollup *r, const PldSession *s)
+{
+    u32 off = s->timestamp - r->start;
+    u8  day = (u8)(1u << (off / 86400u));
+    if (r->days == PLD_ROLLUP_DAY) {
+        u32 hour = 1u << (off / 3600u);
+        if (r->hour_mask & hour) return false;
+        r->hour_mask |= hour;
+    } else if (r->day_mask & day) {
+        return false;
+    }
+    r->day_mask  |= day;
+    r->play_secs += s->play_secs;
+    if (r->sessions < 0xFFFF) r->sessions++;
+    return true;
+}
+
+/* Fold r into l, whose period starts at or before r's and covers it
+ * once l is widened to r's span. */
+static void fold_rollup(PldRollup *l, const PldRollup *r, Fold f)
+{
+    if (f == FOLD_KEEP) return;
+    if (r->days > l->days) to_week(l);
+    if (f == FOLD_SUM) {
+        l->play_secs += r->play_secs;
+        u32 n = (u32)l->sessions + r->sessions;
+        l->sessions = n > 0xFFFF ? 0xFFFF : (u16)n;
+    } else {
+        if (r->play_secs > l->play_secs) l->play_secs = r->play_secs;
+        if (r->sessions > l->sessions) l->sessions = r->sessions;
+    }
+    l->day_mask |= (u8)(r->day_mask << ((r->start - l->start) / 86400u));
+    if (l->days == PLD_ROLLUP_DAY) l->hour_mask |= r->hour_mask;
+}
+
+static int cmp_rollup(const void *a, const void *b)
+{
+    const PldRollup *x = a, *y = b;
+    if (x->title_id != y->title_id) return x->title_id < y->title_id ? -1 : 1;
+    if (x->start != y->start) return x->start < y->start ? -1 : 1;
+    return (int)y->days - (int)x->days;     /* a week before its first day */
+}
+
+/* Sort, promote days before week_cut to weeks, and sum each rollup into
+ * one that covers it. */
+static void normalize_rollups(PldExt *x, u32 week_cut)
+{
+    qsort(x->rollups, (size_t)x->rollup_count, sizeof(PldRollup), cmp_rollup);
+    int w = 0;
+    for (int i = 0; i < x->rollup_count; i++) {
+        PldRollup r = x->rollups[i];
+        if (r.days == PLD_ROLLUP_DAY && r.start < week_cut) to_week(&r);
+        PldRollup *l = w > 0 ? &x->rollups[w - 1] : NULL;
+        if (l && l->title_id == r.title_id && r.start < period_end(l))
+            fold_rollup(l, &r, FOLD_SUM);
+        else
+            x->rollups[w++] = r;
+    }
+    x->rollup_count = w;
+}
+
+static int find_rollup(const PldExt *x, int n, const PldRollup *key)
+{
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        const PldRollup *m = &x->rollups[mid];
+        if (m->title_id < key->title_id ||
+            (m->title_id == key->title_id && m->start < key->start))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return (lo < n && x->rollups[lo].title_id == key->title_id &&
+            x->rollups[lo].start == key->start) ? lo : -1;
+}
+
+static int merge_rollups(PldExt *x, const PldRollup *remote, int n, Fold f)
+{
+    if (!grow((void **)&x->rollups, &x->rollup_cap, x->rollup_count + n,
+              sizeof(PldRollup)))
+        return -1;
+    int sorted = x->rollup_count, added = 0;
+    for (int i = 0; i < n; i++) {
+        if (!rollup_valid(&remote[i])) continue;
+        int at = find_rollup(x, sorted, &remote[i]);
+        if (at >= 0) fold_rollup(&x->rollups[at], &remote[i], f);
+        else x->rollups[sorted + added++] = remote[i];
+    }
+    x->rollup_count = sorted + added;
+    if (added) normalize_rollups(x, 0);
+    return added;
+}
+
+int pld_ext_merge_rollups(PldExt *x, const PldRollup *remote, int n,
+                          bool add_only)
+{
+    return merge_rollups(x, remote, n, add_only ? FOLD_KEEP : FOLD_SUM);
+}
+
+int pld_ext_rollup(PldExt *x, const PldRollupPolicy *p, u32 now)
+{
+    u32 today = now / 86400u;
+    u32 day_cut = 0, week_cut = 0;
+    if (p->day_after && p->day_after < today)
+        day_cut = (today - p->day_after) * 86400u;
+    if (p->week_after && p->week_after < today)
+        week_cut = period_start((today - p->week_after) * 86400u,
+                                PLD_ROLLUP_WEEK);
+    if (week_cut > day_cut) day_cut = week_cut;
+
+    /* At most one new rollup per session past the cut. */
+    int fresh = 0;
+    for (int i = 0; i < x->count; i++)
+        if (x->sessions[i].timestamp < day_cut) fresh++;
+    int old = x->rollup_count;
+    if (!grow((void **)&x->rollups, &x->rollup_cap, old + fresh,
+              sizeof(PldRollup)))
+        return -1;
+
+    /* Sessions and rollups both ascend by key, so the rollup that could
+     * cover a session is the last one at or before it, found by a cursor
+     * that only moves forward.  New daily rollups go past the old ones;
+     * sessions of one title and day are adjacent, so each is built in
+     * one run. */
+    PldRollup *add = x->rollups + old;
+    int na = 0, w = 0, j = 0;
+    for (int i = 0; i < x->count; i++) {
+        const PldSession *s = &x->sessions[i];
+        while (j < old && (x->rollups[j].title_id < s->title_id ||
+                           (x->rollups[j].title_id == s->title_id &&
+                            x->rollups[j].start <= s->timestamp)))
+            j++;
+        if (j > 0 && covers(&x->rollups[j - 1], s)) {
+            absorb(&x->rollups[j - 1], s);
+        } else if (s->timestamp < day_cut) {
+            u32 start = period_start(s->timestamp, PLD_ROLLUP_DAY);
+            if (na == 0 || add[na - 1].title_id != s->title_id ||
+                add[na - 1].start != start) {
+                PldRollup *r = &add[na++];
+                memset(r, 0, sizeof(*r));
+                r->title_id = s->title_id;
+                r->start    = start;
+                r->days     = PLD_ROLLUP_DAY;
+            }
+            absorb(&add[na - 1], s);
+        } else {
+            x->sessions[w++] = *s;
+        }
+    }
+    int folded = x->count - w;
+    x->count        = w;
+    x->rollup_count = old + na;
+    if (na || week_cut) normalize_rollups(x, week_cut);
+    return folded;
+}
+
+/* ── File ───────────────────────────────────────────────────────── */
+
+static void ext_tmp_path(const char *path, char *out, size_t len)
+{
+    snprintf(out, len, "%s.tmp", path);
+}
+
+static u32 block_count(int sessions)
+{
+    return (u32)((sessions + PLD_EXT_BLOCK - 1) / PLD_EXT_BLOCK);
+}
+
+Result pld_ext_write(const char *path, const PldExt *x)
+{
+    u32 nb = block_count(x->count);
+    PldExtBlock *index = MEM_CALLOC(MEM_PLD, nb ? nb : 1, sizeof(PldExtBlock));
+    if (!index) return (Result)-1;
+    for (u32 b = 0; b < nb; b++) {
+        const PldSession *s = x->sessions + (size_t)b * PLD_EXT_BLOCK;
+        int n = x->count - (int)b * PLD_EXT_BLOCK;
+        if (n > PLD_EXT_BLOCK) n = PLD_EXT_BLOCK;
+        index[b].first_title = s[0].title_id;
+        index[b].first_ts    = s[0].timestamp;
+        index[b].last_title  = s[n - 1].title_id;
+        index[b].last_ts     = s[n - 1].timestamp;
+        index[b].count       = (u32)n;
+        index[b].crc         = pld_crc32(s, (size_t)n * sizeof(PldSession), 0);
+    }
+
+    PldExtHeader h;
+    memset(&h, 0, sizeof(h));
+    h.magic         = PLD_EXT_MAGIC;
+    h.version       = PLD_EXT_VERSION;
+    h.header_size   = sizeof(h);
+    h.block_size    = PLD_EXT_BLOCK;
+    h.block_count   = nb;
+    h.session_count = (u32)x->count;
+    h.summary_count = (u32)x->summary_count;
+    h.rollup_count  = (u32)x->rollup_count;
+    h.header        = x->header;
+    h.index_crc = pld_crc32(x->summaries,
+                            (size_t)x->summary_count * sizeof(PldSummary), 0);
+    h.index_crc = pld_crc32(x->rollups,
+                            (size_t)x->rollup_count * sizeof(PldRollup),
+                            h.index_crc);
+    h.index_crc = pld_crc32(index, nb * sizeof(PldExtBlock), h.index_crc);
+
+    char tmp[192];
+    ext_tmp_path(path, tmp, sizeof(tmp));
+    FILE *f = fopen(tmp, "wb");
+    bool ok = f != NULL;
+    if (ok)
+        ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+             fwrite(x->summaries, sizeof(PldSummary),
+                    (size_t)x->summary_count, f) == (size_t)x->summary_count &&
+             fwrite(x->rollups, sizeof(PldRollup),
+                    (size_t)x->rollup_count, f) == (size_t)x->rollup_count &&
+             fwrite(index, sizeof(PldExtBlock), nb, f) == nb &&
+             fwrite(x->sessions, sizeof(PldSession), (size_t)x->count,
+                    f) == (size_t)x->count;
+    if (f && fclose(f) != 0) ok = false;
+    MEM_FREE(index);
+    if (!ok) { remove(tmp); return (Result)-1; }
+
+    /* FAT can't rename over a file; a crash between these two leaves the
+     * .tmp, which pld_ext_read prefers. */
+    remove(path);
+    return rename(tmp, path) == 0 ? 0 : (Result)-1;
+}
+
+static bool header_ok(const PldExtHeader *h)
+{
+    return h->magic == PLD_EXT_MAGIC &&
+           (h->version == PLD_EXT_VERSION ||
+            (h->version == 1 && h->rollup_count == 0)) &&
+           h->header_size == sizeof(*h) && h->block_size == PLD_EXT_BLOCK &&
+           h->block_count == block_count((int)h->session_count) &&
+           h->session_count <= 0x7FFFFFFFu && h->summary_count <= 0x7FFFFFFFu &&
+           h->rollup_count <= 0x7FFFFFFFu;
+}
+
+/* Sorted, valid, and no two periods of a title overlapping. */
+static bool rollups_ok(const PldRollup *r, u32 n)
+{
+    for (u32 i = 0; i < n; i++) {
+        if (!rollup_valid(&r[i])) return false;
+        if (i == 0) continue;
+        const PldRollup *p = &r[i - 1];
+        if (p->title_id > r[i].title_id ||
+            (p->title_id == r[i].title_id && period_end(p) > r[i].start))
+            return false;
+    }
+    return true;
+}
+
+static Result read_file(const char *path, PldExt *out)
+{
+    pld_ext_init(out);
+    FILE *f = fopen(path, "rb");
+    if (!f) return (Result)-1;
+
+    PldExtHeader h;
+    PldExtBlock *index = NULL;
+    bool ok = fread(&h, sizeof(h), 1, f) == 1 && header_ok(&h);
+    if (ok) {
+        out->header = h.header;
+        index = MEM_MALLOC(MEM_PLD, (h.block_count ? h.block_count : 1) *
+                                    sizeof(PldExtBlock));
+        ok = index &&
+             grow((void **)&out->summaries, &out->summary_cap,
+                  (int)h.summary_count, sizeof(PldSummary)) &&
+             grow((void **)&out->rollups, &out->rollup_cap,
+                  (int)h.rollup_count, sizeof(PldRollup)) &&
+             grow((void **)&out->sessions, &out->cap, (int)h.session_count,
+                  sizeof(PldSession)) &&
+             fread(out->summaries, sizeof(PldSummary), h.summary_count,
+                   f) == h.summary_count &&
+             fread(out->rollups, sizeof(PldRollup), h.rollup_count,
+                   f) == h.rollup_count &&
+             fread(index, sizeof(PldExtBlock), h.block_count,
+                   f) == h.block_count &&
+             fread(out->sessions, sizeof(PldSession), h.session_count,
+                   f) == h.session_count &&
+             fgetc(f) == EOF;
+    }
+    if (ok) {
+        u32 crc = pld_crc32(out->summaries,
+                            h.summary_count * sizeof(PldSummary), 0);
+        crc = pld_crc32(out->rollups, h.rollup_count * sizeof(PldRollup), crc);
+        ok = pld_crc32(index, h.block_count * sizeof(PldExtBlock), crc) ==
+                 h.index_crc &&
+             rollups_ok(out->rollups, h.rollup_count);
+    }
+    for (u32 b = 0; ok && b < h.block_count; b++) {
+        const PldSession *s = out->sessions + (size_t)b * PLD_EXT_BLOCK;
+        ok = index[b].count ==
+                 (b + 1 < h.block_count ? PLD_EXT_BLOCK
+                                        : h.session_count - b * PLD_EXT_BLOCK) &&
+             pld_crc32(s, index[b].count * sizeof(PldSession), 0) ==
+                 index[b].crc;
+    }
+    for (u32 i = 1; ok && i < h.session_count; i++)
+        ok = key_lt(&out->sessions[i - 1], &out->sessions[i]);
+    fclose(f);
+    MEM_FREE(index);
+    if (!ok) {
+        pld_ext_free(out);
+        return (Result)-1;
+    }
+    out->count         = (int)h.session_count;
+    out->summary_count = (int)h.summary_count;
+    out->rollup_count  = (int)h.rollup_count;
+    return 0;
+}
+
+Result pld_ext_read(const char *path, PldExt *out)
+{
+    char tmp[192];
+    ext_tmp_path(path, tmp, sizeof(tmp));
+    if (R_SUCCEEDED(read_file(tmp, out))) {
+        remove(path);
+        rename(tmp, path);
+        return 0;
+    }
+    return read_file(path, out);
+}
+
+/* ── NAND export ────────────────────────────────────────────────── */
+
+static int cmp_last_played_desc(const void *a, const void *b)
+{
+    const PldSummary *x = a, *y = b;
+    if (x->last_played_days != y->last_played_days)
+        return x->last_played_days > y->last_played_days ? -1 : 1;
+    return x->title_id < y->title_id ? -1 : x->title_id > y->title_id;
+}
+
+static int cmp_u32_desc(const void *a, const void *b)
+{
+    u32 x = *(const u32 *)a, y = *(const u32 *)b;
+    return x > y ? -1 : x < y;
+}
+
+Result pld_ext_to_nand(const PldExt *x, PldFile *pld_out,
+                       PldSessionLog *log_out)
+{
+    memset(pld_out, 0, sizeof(*pld_out));
+    log_out->entries = NULL;
+    log_out->titles  = NULL;
+    log_out->count   = 0;
+    pld_out->header  = x->header;
+
+    /* Titles: the most recently played, kept in title_id order. */
+    int nt = x->summary_count;
+    PldSummary *pick = MEM_MALLOC(MEM_PLD,
+                                  (size_t)(nt ? nt : 1) * sizeof(PldSummary));
+    if (!pick) return (Result)-1;
+    memcpy(pick, x->summaries, (size_t)nt * sizeof(PldSummary));
+    if (nt > PLD_SUMMARY_COUNT) {
+        qsort(pick, (size_t)nt, sizeof(PldSummary), cmp_last_played_desc);
+        nt = PLD_SUMMARY_COUNT;
+        qsort(pick, (size_t)nt, sizeof(PldSummary), cmp_summary);
+    }
+    memset(pld_out->summaries, 0xFF, sizeof(pld_out->summaries));
+    memcpy(pld_out->summaries, pick, (size_t)nt * sizeof(PldSummary));
+    pld_out->summary_count = nt;
+
+    /* Their sessions, newest first when they don't all fit: everything
+     * from the cutoff timestamp up, and as many at the cutoff as fit. */
+    PldSession *sel = MEM_MALLOC(MEM_PLD,
+                                 (size_t)(x->count ? x->count : 1) *
+                                 sizeof(PldSession));
+    Result rc = sel ? 0 : (Result)-1;
+    int n = 0;
+    for (int i = 0, k = 0; sel && i < x->count; i++) {
+        u64 id = x->sessions[i].title_id;
+        while (k < nt && pick[k].title_id < id) k++;
+        if (k < nt && pick[k].title_id == id) sel[n++] = x->sessions[i];
+    }
+    if (R_SUCCEEDED(rc) && n > PLD_SESSION_COUNT) {
+        u32 *ts = MEM_MALLOC(MEM_PLD, (size_t)n * sizeof(u32));
+        if (!ts) {
+            rc = (Result)-1;
+        } else {
+            for (int i = 0; i < n; i++) ts[i] = sel[i].timestamp;
+            qsort(ts, (size_t)n, sizeof(u32), cmp_u32_desc);
+            u32 cut = ts[PLD_SESSION_COUNT - 1];
+            int at_cut = 0;
+            for (int i = 0; i < PLD_SESSION_COUNT; i++)
+                if (ts[i] == cut) at_cut++;
+            MEM_FREE(ts);
+            int w = 0;
+            for (int i = 0; i < n; i++) {
+                if (sel[i].timestamp < cut) continue;
+                if (sel[i].timestamp == cut && at_cut-- <= 0) continue;
+                sel[w++] = sel[i];
+            }
+            n = w;
+        }
+    }
+    if (R_SUCCEEDED(rc) && !pld_log_alloc(log_out)) rc = (Result)-1;
+    if (R_SUCCEEDED(rc)) rc = pld_log_pack(log_out, sel, n);
+    if (R_SUCCEEDED(rc)) pld_sort_sessions(log_out);
+    else pld_sessions_free(log_out);
+    MEM_FREE(sel);
+    MEM_FREE(pick);
+    return rc;
+}
+
+/* Titles with sessions but no summary (their summary didn't fit the
+ * working set) get one built from the sessions. */
+static bool add_missing_summaries(PldExt *x)
+{
+    int k = 0, have = x->summary_count;
+    for (int i = 0; i < x->count; ) {
+        u64 id = x->sessions[i].title_id;
+        int j = i;
+        while (j < x->count && x->sessions[j].title_id == id) j++;
+        while (k < have && x->summaries[k].title_id < id) k++;
+        if (k == have || x->summaries[k].title_id != id) {
+            PldSummary s;
+            memset(&s, 0, sizeof(s));
+            s.title_id          = id;
+            s.launch_count      = j - i > 0xFFFF ? 0xFFFF : (u16)(j - i);
+            s.unknown_e         = 1;
+            s.first_played_days = (u16)(x->sessions[i].timestamp / 86400u);
+            s.last_played_days  = (u16)(x->sessions[j - 1].timestamp / 86400u);
+            if (merge_summaries(x, &s, 1, FOLD_KEEP) < 0) return false;
+            have = x->summary_count;
+        }
+        i = j;
+    }
+    return true;
+}
+
+Result pld_ext_fold_log(const char *path, const PldFile *pld,
+                        const PldSessionLog *log, const PldSession *extra,
+                        int extra_count)
+{
+    PldExt x;
+    if (R_FAILED(pld_ext_read(path, &x))) pld_ext_init(&x);
+    Result rc = 0;
+    if (pld) {
+        if (merge_log(&x, pld, log, FOLD_MAX) < 0) rc = (Result)-1;
+    } else {
+        PldFile none;
+        memset(&none, 0, sizeof(none));
+        none.header = x.header;
+        if (merge_log(&x, &none, log, FOLD_MAX) < 0) rc = (Result)-1;
+    }
+    if (R_SUCCEEDED(rc) && extra_count > 0 &&
+        merge_sessions(&x, extra, extra_count, FOLD_MAX) < 0)
+        rc = (Result)-1;
+    if (R_SUCCEEDED(rc) && !add_missing_summaries(&x)) rc = (Result)-1;
+    if (R_SUCCEEDED(rc)) {
+        u32 now = 0;
+        for (int i = 0; i < x.count; i++)
+            if (x.sessions[i].timestamp > now) now = x.sessions[i].timestamp;
+        if (pld_ext_rollup(&x, &s_rollup, now) < 0) rc = (Result)-1;
+    }
+    if (R_SUCCEEDED(rc)) {
+        pld_ext_apply_totals(&x);
+        rc = pld_ext_write(path, &x);
+    }
+    pld_ext_free(&x);
+    return rc;
+}
+
+/* ── Range reads ────────────────────────────────────────────────── */
+
+Result pld_ext_open(PldExtReader *r, const char *path)
+{
+    memset(r, 0, sizeof(*r));
+    if (R_FAILED(pld_storage_open_stdio(&r->st, path, false)))
+        return (Result)-1;
+    Result rc = pld_storage_read(&r->st, 0, &r->header, sizeof(r->header));
+    if (R_SUCCEEDED(rc) && !header_ok(&r->header)) rc = (Result)-1;
+
+    u32 sum_bytes = r->header.summary_count * sizeof(PldSummary);
+    u32 rol_bytes = r->header.rollup_count * sizeof(PldRollup);
+    u32 idx_bytes = r->header.block_count * sizeof(PldExtBlock);
+    u32 all_bytes = sum_bytes + rol_bytes + idx_bytes;
+    u8 *buf = R_SUCCEEDED(rc) ? MEM_MALLOC(MEM_PLD, all_bytes + 1) : NULL;
+    if (R_SUCCEEDED(rc) && !buf) rc = (Result)-1;
+    if (R_SUCCEEDED(rc))
+        rc = pld_storage_read(&r->st, sizeof(r->header), buf, all_bytes);
+    if (R_SUCCEEDED(rc) &&
+        (pld_crc32(buf, all_bytes, 0) != r->header.index_crc ||
+         !rollups_ok((const PldRollup *)(buf + sum_bytes),
+                     r->header.rollup_count)))
+        rc = (Result)-1;
+    if (R_SUCCEEDED(rc)) {
+        r->index   = MEM_MALLOC(MEM_PLD, idx_bytes + 1);
+        r->rollups = MEM_MALLOC(MEM_PLD, rol_bytes + 1);
+        if (!r->index || !r->rollups) {
+            rc = (Result)-1;
+        } else {
+            memcpy(r->rollups, buf + sum_bytes, rol_bytes);
+            memcpy(r->index, buf + sum_bytes + rol_bytes, idx_bytes);
+        }
+    }
+    MEM_FREE(buf);
+    r->blocks_at = sizeof(r->header) + all_bytes;
+    if (R_FAILED(rc)) pld_ext_close(r);
+    return rc;
+}
+
+void pld_ext_close(PldExtReader *r)
+{
+    if (r->st.file) pld_storage_close(&r->st);
+    MEM_FREE(r->index);
+    MEM_FREE(r->rollups);
+    r->index   = NULL;
+    r->rollups = NULL;
+}
+
+int pld_ext_read_range(PldExtReader *r, const PldSession *lo,
+                       const PldSession *hi, PldSession **out)
+{
+    *out = NULL;
+    int n = 0, cap = 0;
+    PldSession *block = MEM_MALLOC(MEM_PLD,
+                                   PLD_EXT_BLOCK * sizeof(PldSession));
+    if (!block) return -1;
+
+    for (u32 b = 0; b < r->header.block_count; b++) {
+        const PldExtBlock *e = &r->index[b];
+        PldSession first = { e->first_title, e->first_ts, 0 };
+        PldSession last  = { e->last_title, e->last_ts, 0 };
+        if (key_lt(&last, lo)) continue;
+        if (key_lt(hi, &first)) break;
+
+        u32 bytes = e->count * sizeof(PldSession);
+        if (R_FAILED(pld_storage_read(&r->st,
+                                      r->blocks_at + b * PLD_EXT_BLOCK *
+                                                         (u32)sizeof(PldSession),
+                                      block, bytes)) ||
+            pld_crc32(block, bytes, 0) != e->crc)
+            goto fail;
+        r->blocks_read++;
+
+        for (u32 i = 0; i < e->count; i++) {
+            if (key_lt(&block[i], lo) || key_lt(hi, &block[i])) continue;
+            if (!grow((void **)out, &cap, n + 1, sizeof(PldSession)))
+                goto fail;
+            (*out)[n++] = block[i];
+        }
+    }
+    MEM_FREE(block);
+    return n;
+
+fail:
+    MEM_FREE(block);
+    MEM_FREE(*out);
+    *out = NULL;
+    return -1;
+}
+
+int pld_ext_read_title(PldExtReader *r, u64 title_id, PldSession **out)
+{
+    PldSession lo = { title_id, 0, 0 };
+    PldSession hi = { title_id, 0xFFFFFFFFu, 0 };
+    return pld_ext_read_range(r, &lo, &hi, out);
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    u32 x = *(const u32 *)a, y = *(const u32 *)b;
+    return x < y ? -1 : x > y;
+}
+
+int pld_ext_title_stats(PldExtReader *r, u64 title_id, PldExtTitleStats *out)
+{
+    memset(out, 0, sizeof(*out));
+    PldSession *s;
+    int n = pld_ext_read_title(r, title_id, &s);
+    if (n < 0) return -1;
+
+    int lo = 0, hi = (int)r->header.rollup_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (r->rollups[mid].title_id < title_id) lo = mid + 1;
+        else hi = mid;
+    }
+    int end = lo;
+    while (end < (int)r->header.rollup_count &&
+           r->rollups[end].title_id == title_id)
+        end++;
+
+    /* Every played day, once per session or rollup day, then sorted. */
+    u32 *days = MEM_MALLOC(MEM_PLD,
+                           (size_t)(n + 7 * (end - lo) + 1) * sizeof(u32));
+    if (!days) { MEM_FREE(s); return -1; }
+    int nd = 0;
+    for (int k = lo; k < end; k++) {
+        const PldRollup *u = &r->rollups[k];
+        out->total_secs += u->play_secs;
+        out->sessions   += u->sessions;
+        for (u32 d = 0; d < u->days; d++)
+            if (u->day_mask & (1u << d)) days[nd++] = u->start / 86400u + d;
+    }
+    for (int i = 0; i < n; i++) {
+        out->total_secs += s[i].play_secs;
+        out->sessions++;
+        days[nd++] = s[i].timestamp / 86400u;
+    }
+    MEM_FREE(s);
+    qsort(days, (size_t)nd, sizeof(u32), cmp_u32);
+
+    int run = 0;
+    for (int i = 0; i < nd; i++) {
+        if (i > 0 && days[i] == days[i - 1]) continue;
+        run = (i > 0 && days[i] == days[i - 1] + 1) ? run + 1 : 1;
+        out->days_played++;
+        if (run > out->longest_streak) out->longest_streak = run;
+    }
+    MEM_FREE(days);
+    return 0;
+}
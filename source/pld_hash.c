@@ -0,0 +1,193 @@
+#include "pld.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * pld_hash.c — content hashing and hash sidecars for SD images
+ *
+ * pld_hash64 is the xxHash64 algorithm: four 64-bit lanes over 32-byte
+ * stripes, folded and avalanched at the end.  An 806 KB image hashes in a
+ * few milliseconds, which is far cheaper than rewriting it to SD.
+ *
+ * Every image the app writes to SD gets a small sidecar (path + ".xxh")
+ * holding the image's hash and a copy of its header.  Writers compare the
+ * hash of what they are about to write with the sidecar and skip the write
+ * when they match; the header copy plus the file size catch a file that
+ * was replaced behind the sidecar's back without reading all of it.
+ *
+ * pld_crc32 checks the small records of the merged.dat journal, where a
+ * torn or corrupted write has to be told apart from a good one.
+ */
+
+#define P1 0x9E3779B185EBCA87ULL
+#define P2 0xC2B2AE3D27D4EB4FULL
+#define P3 0x165667B19E3779F9ULL
+#define P4 0x85EBCA77C2B2AE63ULL
+#define P5 0x27D4EB2F165667C5ULL
+
+static inline u64 rotl64(u64 x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline u64 read64(const u8 *p)
+{
+    u64 v;
+    memcpy(&v, p, sizeof(v));   /* both targets are little-endian */
+    return v;
+}
+
+static inline u32 read32(const u8 *p)
+{
+    u32 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline u64 lane_round(u64 acc, u64 input)
+{
+    acc += input * P2;
+    acc  = rotl64(acc, 31);
+    return acc * P1;
+}
+
+static inline u64 lane_merge(u64 h, u64 lane)
+{
+    h ^= lane_round(0, lane);
+    return h * P1 + P4;
+}
+
+u64 pld_hash64(const void *data, size_t len, u64 seed)
+{
+    const u8 *p   = (const u8 *)data;
+    const u8 *end = p + len;
+    u64 h;
+
+    if (len >= 32) {
+        u64 v1 = seed + P1 + P2, v2 = seed + P2, v3 = seed, v4 = seed - P1;
+        const u8 *limit = end - 32;
+        do {
+            v1 = lane_round(v1, read64(p));
+            v2 = lane_round(v2, read64(p + 8));
+            v3 = lane_round(v3, read64(p + 16));
+            v4 = lane_round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = lane_merge(h, v1);
+        h = lane_merge(h, v2);
+        h = lane_merge(h, v3);
+        h = lane_merge(h, v4);
+    } else {
+        h = seed + P5;
+    }
+    h += (u64)len;
+
+    for (; p + 8 <= end; p += 8) {
+        h ^= lane_round(0, read64(p));
+        h  = rotl64(h, 27) * P1 + P4;
+    }
+    if (p + 4 <= end) {
+        h ^= (u64)read32(p) * P1;
+        h  = rotl64(h, 23) * P2 + P3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h ^= (u64)*p * P5;
+        h  = rotl64(h, 11) * P1;
+    }
+
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+/* ── CRC-32 ─────────────────────────────────────────────────────── */
+
+static u32  s_crc_table[256];
+static bool s_crc_ready;
+
+static void crc_init(void)
+{
+    for (u32 i = 0; i < 256; i++) {
+        u32 c = i;
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        s_crc_table[i] = c;
+    }
+    s_crc_ready = true;
+}
+
+u32 pld_crc32(const void *data, size_t len, u32 crc)
+{
+    if (!s_crc_ready) crc_init();
+    const u8 *p = (const u8 *)data;
+    crc = ~crc;
+    while (len--)
+        crc = s_crc_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+/* ── Sidecars ───────────────────────────────────────────────────── */
+
+static void sidecar_path(const char *path, char *out, size_t len)
+{
+    snprintf(out, len, "%s%s", path, PLD_SIDECAR_EXT);
+}
+
+Result pld_sidecar_read(const char *path, PldSidecar *out)
+{
+    char sc_path[160];
+    sidecar_path(path, sc_path, sizeof(sc_path));
+    FILE *f = fopen(sc_path, "rb");
+    if (!f) return (Result)-1;
+    size_t n = fread(out, 1, sizeof(*out), f);
+    fclose(f);
+    if (n != sizeof(*out) || out->magic != PLD_SIDECAR_MAGIC)
+        return (Result)-1;
+    return 0;
+}
+
+Result pld_sidecar_write(const char *path, const PldSidecar *sc)
+{
+    char sc_path[160];
+    sidecar_path(path, sc_path, sizeof(sc_path));
+    FILE *f = fopen(sc_path, "wb");
+    if (!f) return (Result)-1;
+    size_t n = fwrite(sc, 1, sizeof(*sc), f);
+    int close_rc = fclose(f);
+    return (n == sizeof(*sc) && close_rc == 0) ? 0 : (Result)-1;
+}
+
+void pld_sidecar_remove(const char *path)
+{
+    char sc_path[160];
+    sidecar_path(path, sc_path, sizeof(sc_path));
+    remove(sc_path);
+}
+
+bool pld_sidecar_current(const char *path, const PldSidecar *sc)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    PldHeader hdr;
+    bool ok = fread(&hdr, 1, sizeof(hdr), f) == sizeof(hdr) &&
+              fseek(f, 0, SEEK_END) == 0 &&
+              ftell(f) == (long)PLD_FILE_SIZE &&
+              memcmp(&hdr, &sc->header, sizeof(hdr)) == 0;
+    fclose(f);
+    return ok;
+}
+
+bool pld_sd_matches_nand(const char *path, u64 nand_hash)
+{
+    PldSidecar sc;
+    if (nand_hash == 0 || R_FAILED(pld_sidecar_read(path, &sc)))
+        return false;
+    return (sc.flags & PLD_SIDECAR_NAND_ONLY) && sc.nand_hash == nand_hash &&
+           pld_sidecar_current(path, &sc);
+}
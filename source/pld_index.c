@@ -0,0 +1,61 @@
+#include "pld.h"
+
+/*
+ * pld_index.c — per-title [begin, count) ranges into a sorted session log
+ */
+
+/* First position in e[0..n-1] whose title is >= title. */
+static int lower_bound(const PldRec *e, int n, u32 title)
+{
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (e[mid].title < title) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+void pld_index_build(PldIndex *idx, const PldFile *pld, PldSessionLog *log)
+{
+    pld_sort_sessions(log);
+    const PldRec *e = log->entries;
+    int n = log->count;
+
+    idx->entries = e;
+    for (int i = 0; i < PLD_SUMMARY_COUNT; i++) {
+        const PldSummary *s = &pld->summaries[i];
+        idx->begin[i] = 0;
+        idx->count[i] = 0;
+        if (pld_summary_is_empty(s)) continue;
+        int title = pld_title_find(log->titles, s->title_id);
+        if (title < 0) continue;
+        int b = lower_bound(e, n, (u32)title);
+        int k = b + lower_bound(e + b, n - b, (u32)title + 1);
+        idx->begin[i] = b;
+        idx->count[i] = k - b;
+    }
+    idx->valid = true;
+}
+
+void pld_index_invalidate(PldIndex *idx)
+{
+    idx->valid = false;
+}
+
+void pld_index_refresh(PldIndex *idx, const PldFile *pld, PldSessionLog *log)
+{
+    if (!idx->valid || idx->entries != log->entries)
+        pld_index_build(idx, pld, log);
+}
+
+int pld_index_range(const PldIndex *idx, int slot, const PldRec **out)
+{
+    if (!idx->valid || slot < 0 || slot >= PLD_SUMMARY_COUNT ||
+        idx->count[slot] == 0) {
+        *out = NULL;
+        return 0;
+    }
+    *out = idx->entries + idx->begin[slot];
+    return idx->count[slot];
+}
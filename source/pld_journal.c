@@ -0,0 +1,619 @@
+#include "pld.h"
+#include "memprof.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * pld_journal.c — append-only journal over merged.dat
+ *
+ * merged.dat is the last checkpoint; merged.journal holds what changed
+ * since, as CRC-protected records grouped into commits:
+ *
+ *   file header   magic, version, image_hash of the checkpoint it extends
+ *   record        type, count, crc32 of (type, count, payload), payload
+ *   ...
+ *   COMMIT        closes the records written since the previous COMMIT
+ *
+ * SESSIONS and SUMMARIES records are upserts keyed by (title_id, timestamp)
+ * and title_id, last write wins; HEADER replaces the header.  Loading stops
+ * at the first short or corrupt record and ignores everything after the
+ * last COMMIT, so an append cut off at any byte reads back as the previous
+ * commit; the next append overwrites the torn tail.  A journal whose base
+ * hash doesn't match merged.dat was left behind by a checkpoint that
+ * finished without removing it, and is discarded.
+ *
+ * A commit diffs the caller's dataset against the persisted one (merged.dat
+ * streamed through a view with the journal overlaid) and appends only what
+ * differs, a few hundred bytes for a typical sync.  Removals can't be said
+ * with upserts, so they, and a journal that would pass PLD_JOURNAL_MAX,
+ * checkpoint the full image instead.
+ */
+
+#define JNL_MAGIC    0x4A444C50u    /* "PLDJ" */
+#define JNL_VERSION  1u
+#define JNL_CHUNK    4096           /* items per SESSIONS record */
+
+enum {
+    JNL_SESSIONS  = 1,
+    JNL_SUMMARIES = 2,
+    JNL_HEADER    = 3,
+    JNL_COMMIT    = 4,
+};
+
+typedef struct {
+    u32 magic;
+    u32 version;
+    u64 base_hash;  /* PldSidecar.image_hash of the checkpoint */
+} JnlFileHeader;    /* 16 bytes */
+
+typedef struct {
+    u16 type;
+    u16 count;      /* payload items; 1 for HEADER, 0 for COMMIT */
+    u32 crc;        /* pld_crc32 over type, count and payload    */
+} JnlRecord;        /* 8 bytes */
+
+static u32 item_size(u16 type)
+{
+    switch (type) {
+    case JNL_SESSIONS:  return sizeof(PldSession);
+    case JNL_SUMMARIES: return sizeof(PldSummary);
+    case JNL_HEADER:    return sizeof(PldHeader);
+    default:            return 0;
+    }
+}
+
+static u32 record_crc(const JnlRecord *r, const void *payload, u32 len)
+{
+    u32 crc = pld_crc32(r, offsetof(JnlRecord, crc), 0);
+    return pld_crc32(payload, len, crc);
+}
+
+static int key_cmp(const PldSession *a, const PldSession *b)
+{
+    if (a->title_id != b->title_id) return a->title_id < b->title_id ? -1 : 1;
+    if (a->timestamp != b->timestamp) return a->timestamp < b->timestamp ? -1 : 1;
+    return 0;
+}
+
+/* image_hash of the checkpoint at dat_path, from a current sidecar or (if
+ * allowed) by reading the file.  False if there is no usable checkpoint. */
+static bool checkpoint_hash(const char *dat_path, bool allow_read, u64 *out)
+{
+    PldSidecar sc;
+    if (R_SUCCEEDED(pld_sidecar_read(dat_path, &sc)) &&
+        pld_sidecar_current(dat_path, &sc)) {
+        *out = sc.image_hash;
+        return true;
+    }
+    if (!allow_read) return false;
+
+    u8 *buf = MEM_MALLOC(MEM_PLD, PLD_FILE_SIZE);
+    if (!buf) return false;
+    FILE *f = fopen(dat_path, "rb");
+    size_t n = f ? fread(buf, 1, PLD_FILE_SIZE, f) : 0;
+    if (f) fclose(f);
+    if (n == PLD_FILE_SIZE) *out = pld_hash64(buf, PLD_FILE_SIZE, 0);
+    MEM_FREE(buf);
+    return n == PLD_FILE_SIZE;
+}
+
+/* ── Loading ────────────────────────────────────────────────────── */
+
+typedef struct {
+    PldSession s;
+    u32        seq;
+} SeqSession;
+
+static int cmp_seq_session(const void *a, const void *b)
+{
+    const SeqSession *x = (const SeqSession *)a;
+    const SeqSession *y = (const SeqSession *)b;
+    int c = key_cmp(&x->s, &y->s);
+    if (c) return c;
+    return x->seq < y->seq ? -1 : 1;
+}
+
+/* Length of the committed prefix of buf[0..len-1], with the number of
+ * commits and of session / summary items in it. */
+static u32 scan_commits(const u8 *buf, u32 len, int *commits, int *n_sess,
+                        int *n_sum)
+{
+    u32 pos = sizeof(JnlFileHeader), committed = pos;
+    int pend_sess = 0, pend_sum = 0;
+    *commits = *n_sess = *n_sum = 0;
+
+    while (len - pos >= sizeof(JnlRecord)) {
+        JnlRecord r;
+        memcpy(&r, buf + pos, sizeof(r));
+        u32 size = item_size(r.type);
+        if ((r.type == JNL_COMMIT && r.count != 0) ||
+            (r.type == JNL_HEADER && r.count != 1) ||
+            (r.type != JNL_COMMIT && size == 0))
+            break;
+        u32 plen = size * r.count;
+        if (plen > len - pos - sizeof(r) ||
+            record_crc(&r, buf + pos + sizeof(r), plen) != r.crc)
+            break;
+        pos += sizeof(r) + plen;
+
+        if (r.type == JNL_SESSIONS) pend_sess += r.count;
+        else if (r.type == JNL_SUMMARIES) pend_sum += r.count;
+        else if (r.type == JNL_COMMIT) {
+            committed = pos;
+            *n_sess += pend_sess;
+            *n_sum  += pend_sum;
+            pend_sess = pend_sum = 0;
+            (*commits)++;
+        }
+    }
+    return committed;
+}
+
+/* Collect the committed items of buf[0..committed-1] into *j, latest value
+ * per key. */
+static Result replay(PldJournal *j, const u8 *buf, u32 committed, int n_sess,
+                     int n_sum)
+{
+    SeqSession *seq = MEM_MALLOC(MEM_PLD,
+                                 (size_t)(n_sess + 1) * sizeof(SeqSession));
+    j->sessions  = MEM_MALLOC(MEM_PLD,
+                              (size_t)(n_sess + 1) * sizeof(PldSession));
+    j->summaries = MEM_MALLOC(MEM_PLD,
+                              (size_t)(n_sum + 1) * sizeof(PldSummary));
+    if (!seq || !j->sessions || !j->summaries) {
+        MEM_FREE(seq);
+        return (Result)-1;
+    }
+
+    int ns = 0;
+    for (u32 pos = sizeof(JnlFileHeader); pos < committed; ) {
+        JnlRecord r;
+        memcpy(&r, buf + pos, sizeof(r));
+        const u8 *p = buf + pos + sizeof(r);
+        pos += sizeof(r) + item_size(r.type) * r.count;
+
+        if (r.type == JNL_SESSIONS) {
+            for (int i = 0; i < r.count; i++, ns++) {
+                memcpy(&seq[ns].s, p + i * sizeof(PldSession),
+                       sizeof(PldSession));
+                seq[ns].seq = (u32)ns;
+            }
+        } else if (r.type == JNL_SUMMARIES) {
+            for (int i = 0; i < r.count; i++) {
+                PldSummary s;
+                memcpy(&s, p + i * sizeof(PldSummary), sizeof(s));
+                int k = pld_journal_find_summary(j, s.title_id);
+                if (k < 0) {
+                    if (j->summary_count == PLD_SUMMARY_COUNT) continue;
+                    k = j->summary_count++;
+                }
+                j->summaries[k] = s;
+            }
+        } else if (r.type == JNL_HEADER) {
+            memcpy(&j->header, p, sizeof(j->header));
+            j->has_header = true;
+        }
+    }
+
+    /* Sort by key, oldest write first, and keep the last of each run. */
+    qsort(seq, (size_t)ns, sizeof(SeqSession), cmp_seq_session);
+    for (int i = 0; i < ns; i++) {
+        if (i + 1 < ns && key_cmp(&seq[i].s, &seq[i + 1].s) == 0) continue;
+        j->sessions[j->session_count++] = seq[i].s;
+    }
+    MEM_FREE(seq);
+    return 0;
+}
+
+/* The journal's bytes, at most 2 * PLD_JOURNAL_MAX of them, malloc'd with
+ * *len set.  NULL if the file is missing (*found false), empty or
+ * unreadable, or (*len -1) on OOM. */
+static u8 *read_journal(const char *jnl_path, long *len, bool *found)
+{
+    *len = 0;
+    FILE *f = fopen(jnl_path, "rb");
+    *found = f != NULL;
+    if (!f) return NULL;
+
+    long size = (fseek(f, 0, SEEK_END) == 0) ? ftell(f) : -1;
+    if (size > (long)(2 * PLD_JOURNAL_MAX)) size = 2 * PLD_JOURNAL_MAX;
+    u8 *buf = (size > 0) ? MEM_MALLOC(MEM_PLD, (size_t)size) : NULL;
+    if (size > 0 && !buf) {
+        *len = -1;
+    } else if (buf && (fseek(f, 0, SEEK_SET) != 0 ||
+                       fread(buf, 1, (size_t)size, f) != (size_t)size)) {
+        MEM_FREE(buf);
+        buf = NULL;
+    } else if (buf) {
+        *len = size;
+    }
+    fclose(f);
+    return buf;
+}
+
+/* True if buf[0..len-1] starts a journal over the checkpoint hashing to
+ * base. */
+static bool journal_extends(const u8 *buf, long len, u64 base)
+{
+    JnlFileHeader fh;
+    if ((size_t)len < sizeof(fh)) return false;
+    memcpy(&fh, buf, sizeof(fh));
+    return fh.magic == JNL_MAGIC && fh.version == JNL_VERSION &&
+           fh.base_hash == base;
+}
+
+Result pld_journal_load(const char *dat_path, const char *jnl_path,
+                        PldJournal *j)
+{
+    memset(j, 0, sizeof(*j));
+    long size;
+    bool found;
+    u8 *buf = read_journal(jnl_path, &size, &found);
+    if (!found) return 0;   /* no journal: merged.dat alone is current */
+    if (size < 0) return (Result)-1;
+
+    u64 base;
+    if (!buf || !checkpoint_hash(dat_path, true, &base) ||
+        !journal_extends(buf, size, base)) {
+        MEM_FREE(buf);
+        remove(jnl_path);
+        return 0;
+    }
+
+    int n_sess, n_sum, commits;
+    u32 committed = scan_commits(buf, (u32)size, &commits, &n_sess, &n_sum);
+    Result rc = 0;
+    if (commits > 0) {
+        rc = replay(j, buf, committed, n_sess, n_sum);
+        j->commits = commits;
+        j->bytes   = committed;
+    }
+    MEM_FREE(buf);
+    if (R_FAILED(rc)) pld_journal_free(j);
+    return rc;
+}
+
+void pld_journal_free(PldJournal *j)
+{
+    MEM_FREE(j->sessions);
+    MEM_FREE(j->summaries);
+    memset(j, 0, sizeof(*j));
+}
+
+int pld_journal_find(const PldJournal *j, u64 title_id, u32 timestamp)
+{
+    PldSession key = { title_id, timestamp, 0 };
+    int lo = 0, hi = j->session_count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        int c = key_cmp(&j->sessions[mid], &key);
+        if (c == 0) return mid;
+        if (c < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return -1;
+}
+
+int pld_journal_find_summary(const PldJournal *j, u64 title_id)
+{
+    for (int i = 0; i < j->summary_count; i++)
+        if (j->summaries[i].title_id == title_id) return i;
+    return -1;
+}
+
+/* ── Replay into a loaded checkpoint ────────────────────────────── */
+
+/* Index of the record with dictionary title t and timestamp ts in a sorted
+ * log, or -1. */
+static int log_find(const PldSessionLog *log, int t, u32 ts)
+{
+    int lo = 0, hi = log->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        const PldRec *r = &log->entries[mid];
+        if (r->title < t || (r->title == t && r->timestamp < ts)) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < log->count && log->entries[lo].title == t &&
+        log->entries[lo].timestamp == ts)
+        return lo;
+    return -1;
+}
+
+Result pld_journal_apply(const PldJournal *j, PldFile *pld,
+                         PldSessionLog *log)
+{
+    if (j->has_header) pld->header = j->header;
+
+    for (int i = 0; i < j->summary_count; i++) {
+        const PldSummary *s = &j->summaries[i];
+        int slot = -1, empty = -1;
+        for (int k = 0; k < PLD_SUMMARY_COUNT && slot < 0; k++) {
+            if (pld->summaries[k].title_id == s->title_id) slot = k;
+            else if (empty < 0 && pld_summary_is_empty(&pld->summaries[k]))
+                empty = k;
+        }
+        if (slot < 0) {
+            if (empty < 0) return (Result)-1;
+            slot = empty;
+            pld->summary_count++;
+        }
+        pld->summaries[slot] = *s;
+    }
+
+    /* Replace play_secs in place; merge the new keys in one pass. */
+    pld_sort_sessions(log);
+    PldSession *fresh = MEM_MALLOC(MEM_PLD, (size_t)(j->session_count + 1) *
+                                            sizeof(PldSession));
+    if (!fresh) return (Result)-1;
+    int n = 0;
+    for (int i = 0; i < j->session_count; i++) {
+        const PldSession *s = &j->sessions[i];
+        int t = pld_title_find(log->titles, s->title_id);
+        int at = (t >= 0) ? log_find(log, t, s->timestamp) : -1;
+        if (at >= 0)
+            log->entries[at].play_secs =
+                (u16)(s->play_secs > 0xFFFFu ? 0xFFFFu : s->play_secs);
+        else
+            fresh[n++] = *s;
+    }
+    int rc = n ? pld_merge_sessions(log, fresh, n, true) : 0;
+    MEM_FREE(fresh);
+    return rc < 0 ? (Result)-1 : 0;
+}
+
+Result pld_journal_read(const char *dat_path, const char *jnl_path,
+                        PldFile *pld_out, PldSessionLog *sessions_out)
+{
+    Result rc = pld_read_sd(dat_path, pld_out, sessions_out);
+    if (R_FAILED(rc)) return rc;
+
+    PldJournal j;
+    rc = pld_journal_load(dat_path, jnl_path, &j);
+    if (R_SUCCEEDED(rc) && j.commits > 0) {
+        rc = pld_journal_apply(&j, pld_out, sessions_out);
+        pld_out->image_hash = 0;    /* no longer the checkpoint's image */
+    }
+    pld_journal_free(&j);
+    if (R_FAILED(rc)) pld_sessions_free(sessions_out);
+    return rc;
+}
+
+/* ── Committing ─────────────────────────────────────────────────── */
+
+/* What a commit appends.  `full` means the change can't be written as
+ * upserts (or the persisted side couldn't be read) and needs a checkpoint. */
+typedef struct {
+    PldSession *sessions;
+    int         session_count;
+    int         session_cap;
+    PldSummary  persisted[PLD_SUMMARY_COUNT];
+    bool        seen[PLD_SUMMARY_COUNT];
+    PldSummary  summaries[PLD_SUMMARY_COUNT];
+    int         summary_count;
+    bool        header;
+    bool        full;
+} Delta;
+
+/* Merge-join the sorted log against the persisted sessions. */
+static bool diff_sessions(PldView *v, const PldSessionLog *log, Delta *d)
+{
+    PldSession p, prev, r;
+    bool have_p = pld_view_next_session(v, &p);
+
+    for (int i = 0; i < log->count; i++) {
+        pld_rec_unpack(log, &log->entries[i], &r);
+        if (have_p && key_cmp(&p, &r) < 0)
+            return false;                   /* persisted record removed */
+        if (have_p && key_cmp(&p, &r) == 0) {
+            bool same = (p.play_secs > 0xFFFFu ? 0xFFFFu : p.play_secs) ==
+                        r.play_secs;
+            prev   = p;
+            have_p = pld_view_next_session(v, &p);
+            if (have_p && key_cmp(&prev, &p) >= 0)
+                return false;               /* persisted side unsorted */
+            if (same) continue;
+        }
+        if (d->session_count == d->session_cap) return false;
+        d->sessions[d->session_count++] = r;
+    }
+    return !have_p && R_SUCCEEDED(v->rc);
+}
+
+static bool diff_summaries(PldView *v, const PldFile *pld, Delta *d)
+{
+    int np = 0;
+    while (np < PLD_SUMMARY_COUNT &&
+           pld_view_next_summary(v, &d->persisted[np]))
+        d->seen[np++] = false;
+    if (R_FAILED(v->rc)) return false;
+
+    for (int i = 0; i < PLD_SUMMARY_COUNT; i++) {
+        const PldSummary *s = &pld->summaries[i];
+        if (pld_summary_is_empty(s)) continue;
+        int k = 0;
+        while (k < np && d->persisted[k].title_id != s->title_id) k++;
+        if (k < np) {
+            d->seen[k] = true;
+            if (memcmp(&d->persisted[k], s, sizeof(*s)) == 0) continue;
+        }
+        d->summaries[d->summary_count++] = *s;
+    }
+    for (int k = 0; k < np; k++)
+        if (!d->seen[k]) return false;      /* summary removed */
+    return true;
+}
+
+static u8 *put_record(u8 *p, u16 type, const void *payload, int count)
+{
+    JnlRecord r = { type, (u16)count, 0 };
+    u32 len = item_size(type) * (u32)count;
+    r.crc = record_crc(&r, payload, len);
+    memcpy(p, &r, sizeof(r));
+    if (len) memcpy(p + sizeof(r), payload, len);
+    return p + sizeof(r) + len;
+}
+
+/* Encode the delta as one commit.  Returns the malloc'd bytes, or NULL. */
+static u8 *encode_commit(const Delta *d, const PldFile *pld, u32 *len_out)
+{
+    int chunks = (d->session_count + JNL_CHUNK - 1) / JNL_CHUNK;
+    u32 len = (u32)(chunks + 3) * sizeof(JnlRecord) +
+              (u32)d->session_count * sizeof(PldSession) +
+              (u32)d->summary_count * sizeof(PldSummary) +
+              (d->header ? sizeof(PldHeader) : 0);
+    u8 *buf = MEM_MALLOC(MEM_PLD, len);
+    if (!buf) return NULL;
+
+    u8 *p = buf;
+    for (int i = 0; i < d->session_count; i += JNL_CHUNK) {
+        int n = d->session_count - i;
+        if (n > JNL_CHUNK) n = JNL_CHUNK;
+        p = put_record(p, JNL_SESSIONS, d->sessions + i, n);
+    }
+    if (d->summary_count)
+        p = put_record(p, JNL_SUMMARIES, d->summaries, d->summary_count);
+    if (d->header)
+        p = put_record(p, JNL_HEADER, &pld->header, 1);
+    p = put_record(p, JNL_COMMIT, NULL, 0);
+    *len_out = (u32)(p - buf);
+    return buf;
+}
+
+/* Write one commit at offset `at` (after a new file header if fh is set)
+ * and cut off whatever followed it. */
+static Result append(const char *jnl_path, const JnlFileHeader *fh, u32 at,
+                     const u8 *rec, u32 len)
+{
+    FILE *f = fopen(jnl_path, fh ? "wb" : "r+b");
+    if (!f) return (Result)-1;
+    bool ok = fh ? fwrite(fh, 1, sizeof(*fh), f) == sizeof(*fh)
+                 : fseek(f, (long)at, SEEK_SET) == 0;
+    ok = ok && fwrite(rec, 1, len, f) == len && fflush(f) == 0 &&
+         ftruncate(fileno(f), (off_t)(at + len)) == 0;
+    if (fclose(f) != 0) ok = false;
+    return ok ? 0 : (Result)-1;
+}
+
+Result pld_journal_checkpoint(const char *dat_path, const char *jnl_path,
+                              const PldFile *pld, const PldSessionLog *log,
+                              PldCommit *c)
+{
+    if (c && c->backup) pld_journal_backup(dat_path, jnl_path);
+    Result rc = c ? pld_write_sd_merged(dat_path, pld, log, c->nand_hash,
+                                        c->nand_only)
+                  : pld_write_sd(dat_path, pld, log);
+    if (R_FAILED(rc)) return rc;
+    /* Written first, removed second: a crash in between leaves a journal
+     * whose base no longer matches, which the next load discards. */
+    remove(jnl_path);
+    if (c) {
+        c->checkpoint = true;
+        c->written = (rc == PLD_RC_UNCHANGED) ? 0
+                                              : PLD_FILE_SIZE + sizeof(PldSidecar);
+    }
+    return rc;
+}
+
+Result pld_journal_commit(const char *dat_path, const char *jnl_path,
+                          const PldFile *pld, PldSessionLog *log,
+                          PldCommit *c)
+{
+    PldCommit dflt = { 0 };
+    if (!c) c = &dflt;
+    c->checkpoint = false;
+    c->written    = 0;
+    pld_sort_sessions(log);
+
+    PldJournal j;
+    JnlFileHeader fh = { JNL_MAGIC, JNL_VERSION, 0 };
+    Delta *d = MEM_CALLOC(MEM_PLD, 1, sizeof(Delta));
+    if (!d || R_FAILED(pld_journal_load(dat_path, jnl_path, &j))) {
+        MEM_FREE(d);
+        return pld_journal_checkpoint(dat_path, jnl_path, pld, log, c);
+    }
+
+    d->session_cap = (int)(PLD_JOURNAL_MAX / sizeof(PldSession));
+    d->sessions    = MEM_MALLOC(MEM_PLD,
+                                (size_t)d->session_cap * sizeof(PldSession));
+    PldView v;
+    d->full = !d->sessions ||
+              (j.commits == 0 && !checkpoint_hash(dat_path, false,
+                                                  &fh.base_hash)) ||
+              R_FAILED(pld_view_open(&v, dat_path));
+    if (!d->full) {
+        pld_view_set_overlay(&v, &j);
+        d->header = memcmp(&v.header, &pld->header, sizeof(PldHeader)) != 0;
+        d->full = !diff_summaries(&v, pld, d);
+        pld_view_rewind(&v);
+        d->full = d->full || !diff_sessions(&v, log, d);
+        pld_view_close(&v);
+    }
+
+    Result rc;
+    u32 len = 0;
+    u8 *rec = NULL;
+    u32 at = j.commits ? j.bytes : (u32)sizeof(JnlFileHeader);
+    if (!d->full && !d->session_count && !d->summary_count && !d->header) {
+        rc = PLD_RC_UNCHANGED;
+    } else if (d->full || !(rec = encode_commit(d, pld, &len)) ||
+               at + len > PLD_JOURNAL_MAX ||
+               R_FAILED(append(jnl_path, j.commits ? NULL : &fh, at, rec,
+                               len))) {
+        rc = pld_journal_checkpoint(dat_path, jnl_path, pld, log, c);
+    } else {
+        c->written = len + (j.commits ? 0 : (u32)sizeof(fh));
+        rc = 0;
+    }
+
+    MEM_FREE(rec);
+    MEM_FREE(d->sessions);
+    MEM_FREE(d);
+    pld_journal_free(&j);
+    return rc;
+}
+
+bool pld_journal_state_hash(const char *dat_path, const char *jnl_path,
+                            bool allow_read, u64 *out)
+{
+    u64 base;
+    if (!checkpoint_hash(dat_path, allow_read, &base)) return false;
+    long size;
+    bool found;
+    u8 *buf = read_journal(jnl_path, &size, &found);
+    if (size < 0) return false;
+    *out = base;
+    /* As pld_journal_load reads it: a stale journal counts as none, and
+     * only the committed prefix counts. */
+    if (buf && journal_extends(buf, size, base)) {
+        int commits, n_sess, n_sum;
+        u32 committed = scan_commits(buf, (u32)size, &commits, &n_sess, &n_sum);
+        if (commits > 0) *out = pld_hash64(buf, committed, base);
+    }
+    MEM_FREE(buf);
+    return true;
+}
+
+/* ── Backups ────────────────────────────────────────────────────── */
+
+Result pld_journal_backup(const char *dat_path, const char *jnl_path)
+{
+    PldJournal j;
+    if (R_FAILED(pld_journal_load(dat_path, jnl_path, &j))) return (Result)-1;
+    int commits = j.commits;
+    pld_journal_free(&j);
+    if (commits == 0) return pld_backup_from_path(dat_path);
+
+    PldFile       pld;
+    PldSessionLog log;
+    Result rc = pld_journal_read(dat_path, jnl_path, &pld, &log);
+    if (R_FAILED(rc)) return rc;
+    u8 *image = pld_build_image(&pld, &log);
+    rc = image ? pld_backup_store(image) : (Result)-1;
+    pld_scratch_free(image);
+    pld_sessions_free(&log);
+    return rc;
+}
@@ -0,0 +1,487 @@
+#include "pld.h"
+#include "memprof.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * pld_kmerge.c — k-way merge of many SD images
+ *
+ * Every input becomes a sorted stream of sessions:
+ *
+ *   log     the caller's log, already in memory
+ *   mem     an image or container loaded once, sorted unless its table
+ *           already is, and kept as packed records within the memory budget
+ *           (PLD_MERGE_MEM unless set)
+ *   view    a raw image that doesn't fit even alone but whose table is
+ *           in key order (merged.dat, backups of it), paged through a
+ *           PldView
+ *   run     any other input that doesn't fit, spilled to a scratch file
+ *           of sorted PldSessions
+ *
+ * Each pass takes the log and up to PLD_MERGE_FANIN - 1 files, ending
+ * early rather than spill: the files left over start the next one.  When
+ * every file of a pass is in memory, which is the usual case, each is
+ * folded into the log by one linear merge-join over packed records: the
+ * two dictionaries are both sorted, so one maps onto the other in order
+ * and keys compare as integers without unpacking, re-sorting or looking a
+ * title up per record.  Otherwise a tree of two-way merge-joins over the
+ * streams emits the merged log in one pass.  Either way the result goes
+ * to a second log, which becomes the log for the next step, so open
+ * files, buffers and scratch runs stay bounded however many paths are
+ * given.  Summaries are merged as each file is opened, in path order.
+ *
+ * The fold is the pairwise one: a capped sum, or first-seen wins for
+ * add_only, with ties between streams broken by path order.  Both are
+ * associative, so the result is what pld_merge_sessions and
+ * pld_merge_summaries give applied once per path in order.
+ */
+
+#define RUN_RECS       (PLD_VIEW_WINDOW / sizeof(PldSession))
+#define MEM_INPUT_MAX  (PLD_SESSION_COUNT * sizeof(PldRec) + \
+                        PLD_TITLE_MAX * sizeof(u64))
+
+typedef enum { SRC_LOG, SRC_VIEW, SRC_MEM, SRC_RUN } SrcKind;
+
+typedef struct {
+    SrcKind              kind;
+    bool                 bad;       /* read or write error on this stream */
+    const char          *input;     /* the path it reads                  */
+    bool                 container; /* input is a backup container        */
+    PldSession           cur;       /* stream head                        */
+    /* SRC_LOG */
+    const PldSessionLog *log;
+    int                  pos;       /* also SRC_MEM */
+    /* SRC_MEM: sorted records and the ids they index, one allocation */
+    PldRec              *recs;
+    const u64           *ids;
+    int                  count;
+    int                  nids;
+    /* SRC_VIEW */
+    PldView              view;
+    /* SRC_RUN */
+    FILE                *f;
+    PldSession          *buf;
+    int                  len;
+    int                  at;
+    char                 path[192];
+} Source;
+
+static inline bool key_lt(const PldSession *a, const PldSession *b)
+{
+    return a->title_id < b->title_id ||
+           (a->title_id == b->title_id && a->timestamp < b->timestamp);
+}
+
+static bool source_next(Source *s)
+{
+    switch (s->kind) {
+    case SRC_LOG:
+        if (s->pos >= s->log->count) return false;
+        pld_rec_unpack(s->log, &s->log->entries[s->pos++], &s->cur);
+        return true;
+    case SRC_MEM:
+        if (s->pos >= s->count) return false;
+        s->cur.title_id  = s->ids[s->recs[s->pos].title];
+        s->cur.timestamp = s->recs[s->pos].timestamp;
+        s->cur.play_secs = s->recs[s->pos].play_secs;
+        s->pos++;
+        return true;
+    case SRC_VIEW:
+        if (pld_view_next_session(&s->view, &s->cur)) return true;
+        if (R_FAILED(s->view.rc)) s->bad = true;
+        return false;
+    case SRC_RUN:
+        if (s->at == s->len) {
+            s->len = (int)fread(s->buf, sizeof(PldSession), RUN_RECS, s->f);
+            s->at  = 0;
+            if (s->len == 0) {
+                if (ferror(s->f)) s->bad = true;
+                return false;
+            }
+        }
+        s->cur = s->buf[s->at++];
+        return true;
+    }
+    return false;
+}
+
+static void source_close(Source *s)
+{
+    if (s->kind == SRC_VIEW) {
+        pld_view_close(&s->view);
+    } else if (s->kind == SRC_MEM) {
+        MEM_FREE(s->recs);
+    } else if (s->kind == SRC_RUN) {
+        if (s->f) fclose(s->f);
+        MEM_FREE(s->buf);
+        remove(s->path);
+    }
+    memset(s, 0, sizeof(*s));
+}
+
+/* Keep a sorted log's records and dictionary in one allocation sized to
+ * them, if *budget covers it. */
+static bool keep_in_memory(Source *s, const PldSessionLog *log, u32 *budget)
+{
+    size_t recs = (size_t)log->count * sizeof(PldRec);
+    size_t ids  = (size_t)log->titles->count * sizeof(u64);
+    if (recs + ids > *budget) return false;
+    u8 *block = MEM_MALLOC(MEM_PLD, recs + ids + 1);
+    if (!block) return false;
+    memcpy(block, log->entries, recs);
+    memcpy(block + recs, log->titles->ids, ids);
+    s->kind  = SRC_MEM;
+    s->recs  = (PldRec *)block;
+    s->ids   = (const u64 *)(block + recs);
+    s->count = log->count;
+    s->nids  = log->titles->count;
+    *budget -= (u32)(recs + ids);
+    return true;
+}
+
+/* Write a sorted log to s->path as a run, then reopen it for reading. */
+static Result spill_run(Source *s, const PldSessionLog *log)
+{
+    s->kind = SRC_RUN;
+    s->buf  = MEM_MALLOC(MEM_PLD, RUN_RECS * sizeof(PldSession));
+    s->f    = s->buf ? fopen(s->path, "wb") : NULL;
+    if (!s->f) return (Result)-1;
+
+    bool ok = true;
+    for (int i = 0; i < log->count && ok; ) {
+        int n = 0;
+        while (n < (int)RUN_RECS && i < log->count)
+            pld_rec_unpack(log, &log->entries[i++], &s->buf[n++]);
+        ok = fwrite(s->buf, sizeof(PldSession), (size_t)n, s->f) == (size_t)n;
+    }
+    if (fclose(s->f) != 0) ok = false;
+    s->f = ok ? fopen(s->path, "rb") : NULL;
+    return s->f ? 0 : (Result)-1;
+}
+
+/* Set up stream s for path, returning the memory source_load will want:
+ * a container's header gives its size, a raw image is assumed full. */
+static u32 source_probe(Source *s, const char *path, const char *scratch_dir,
+                        int slot)
+{
+    memset(s, 0, sizeof(*s));
+    s->input = path;
+    s->kind  = SRC_LOG;             /* nothing held until source_load */
+    snprintf(s->path, sizeof(s->path), "%s/kmerge_run_%02d.tmp", scratch_dir,
+             slot);
+
+    PldBackupHeader bh;
+    if (R_SUCCEEDED(pld_backup_read_header(path, &bh))) {
+        s->container = true;
+        return bh.session_count * (u32)sizeof(PldRec) +
+               bh.title_count * (u32)sizeof(u64);
+    }
+    return (u32)MEM_INPUT_MAX;
+}
+
+/* Stream a raw image too big for *budget through a view if its table is
+ * in key order.  Returns false with the view closed if it isn't. */
+static bool open_sorted_view(Source *s)
+{
+    if (R_FAILED(pld_view_open(&s->view, s->input))) return false;
+    PldSession prev, r;
+    bool have = false, sorted = true;
+    while (sorted && pld_view_next_session(&s->view, &r)) {
+        sorted = !have || key_lt(&prev, &r);
+        prev = r;
+        have = true;
+    }
+    if (sorted && R_SUCCEEDED(s->view.rc)) {
+        pld_view_rewind(&s->view);
+        s->kind = SRC_VIEW;
+        return true;
+    }
+    pld_view_close(&s->view);
+    return false;
+}
+
+/* Make probed stream s ready to merge, merging its summaries into *pld. */
+static Result source_load(Source *s, PldFile *pld, bool add_only,
+                          u32 *budget)
+{
+    if (!s->container && *budget < MEM_INPUT_MAX && open_sorted_view(s))
+        return pld_merge_summaries_view(pld, &s->view, add_only) < 0
+             ? (Result)-1 : 0;
+
+    /* pld_backup_read without the image hash nothing here uses. */
+    PldFile *f = MEM_MALLOC(MEM_PLD, sizeof(PldFile));
+    u8 *image = f ? pld_scratch_alloc(PLD_FILE_SIZE) : NULL;
+    PldSessionLog log = { NULL, 0, NULL };
+    Result rc = image ? pld_backup_load(s->input, image) : (Result)-1;
+    if (R_SUCCEEDED(rc)) {
+        rc = pld_parse_image(image, f, &log);
+    } else {
+        pld_scratch_free(image);
+    }
+    if (R_SUCCEEDED(rc) &&
+        pld_merge_summaries(pld, f->summaries, PLD_SUMMARY_COUNT,
+                            add_only) < 0)
+        rc = (Result)-1;
+    if (R_SUCCEEDED(rc)) {
+        if (!pld_sessions_sorted(log.entries, log.count))
+            pld_sort_sessions(&log);
+        if (!keep_in_memory(s, &log, budget)) rc = spill_run(s, &log);
+    }
+    pld_sessions_free(&log);
+    MEM_FREE(f);
+    return rc;
+}
+
+/* ── Merge tree ─────────────────────────────────────────────────── */
+
+/* A balanced tree of two-way merge-joins over the streams, in path order
+ * left to right.  Each inner node folds the equal keys its children meet
+ * before passing the record up, so inputs that share most of their keys
+ * (backups of one console) thin out at every level instead of each copy
+ * climbing a heap: a record costs one key compare per node it reaches. */
+typedef struct {
+    int         a, b;       /* children; -1 for a leaf                  */
+    Source     *src;        /* leaf: its stream                         */
+    bool        live;       /* cur holds the node's next record         */
+    PldSession  cur;
+} Node;
+
+static inline u32 fold_secs(u32 x, u32 y, bool add_only)
+{
+    if (add_only) return x;
+    u64 sum = (u64)x + y;
+    return sum > 3600 ? 3600u : (u32)sum;
+}
+
+static void node_next(Node *t, int i, bool add_only)
+{
+    Node *n = &t[i];
+    if (n->a < 0) {
+        n->live = source_next(n->src);
+        if (n->live) n->cur = n->src->cur;
+        return;
+    }
+    Node *x = &t[n->a], *y = &t[n->b];
+    if (!x->live && !y->live) {
+        n->live = false;
+        return;
+    }
+    if (!y->live || (x->live && key_lt(&x->cur, &y->cur))) {
+        n->cur = x->cur;
+        node_next(t, n->a, add_only);
+    } else if (!x->live || key_lt(&y->cur, &x->cur)) {
+        n->cur = y->cur;
+        node_next(t, n->b, add_only);
+    } else {
+        /* the left child holds the earlier paths: it meets the key first */
+        n->cur = x->cur;
+        n->cur.play_secs = fold_secs(x->cur.play_secs, y->cur.play_secs,
+                                     add_only);
+        node_next(t, n->a, add_only);
+        node_next(t, n->b, add_only);
+    }
+    n->live = true;
+}
+
+/* Build the tree over src[lo..hi) into t from *used on; returns its root,
+ * with every node holding its first record. */
+static int tree_build(Node *t, int *used, Source *src, int lo, int hi,
+                      bool add_only)
+{
+    int i = (*used)++;
+    if (hi - lo == 1) {
+        t[i].a   = t[i].b = -1;
+        t[i].src = &src[lo];
+    } else {
+        int mid = lo + (hi - lo) / 2;
+        t[i].a   = tree_build(t, used, src, lo, mid, add_only);
+        t[i].b   = tree_build(t, used, src, mid, hi, add_only);
+        t[i].src = NULL;
+    }
+    node_next(t, i, add_only);
+    return i;
+}
+
+/* Merge src[0..k-1] into out (emptied first).  Returns 0, or -1 when the
+ * result overflows the log or its dictionary, or a stream fails. */
+static int merge_pass(Source *src, int k, PldSessionLog *out, bool add_only)
+{
+    Node tree[2 * PLD_MERGE_FANIN];
+    int used = 0;
+    int root = tree_build(tree, &used, src, 0, k, add_only);
+
+    out->count = 0;
+    out->titles->count = 0;
+    PldRec *last = NULL;
+    u64 last_id = 0;
+    for (; tree[root].live; node_next(tree, root, add_only)) {
+        const PldSession *r = &tree[root].cur;
+        u16 secs = r->play_secs > 0xFFFFu ? 0xFFFFu : (u16)r->play_secs;
+        if (r->title_id == 0 || r->title_id == 0xFFFFFFFFFFFFFFFFULL) {
+            /* skipped, as pld_merger_push does */
+        } else if (last && last_id == r->title_id &&
+                   last->timestamp == r->timestamp) {
+            /* a key repeated within one input */
+            last->play_secs = (u16)fold_secs(last->play_secs, secs, add_only);
+        } else {
+            /* Keys ascend, so a new title always lands at the dictionary's
+             * end and nothing is renumbered. */
+            PldTitleDict *d = out->titles;
+            if (d->count == 0 || d->ids[d->count - 1] != r->title_id) {
+                if (pld_title_insert(d, r->title_id) < 0) return -1;
+            }
+            if (out->count == PLD_SESSION_COUNT) return -1;
+            last = &out->entries[out->count++];
+            last->timestamp = r->timestamp;
+            last->title     = (u16)(d->count - 1);
+            last->play_secs = secs;
+            last_id = r->title_id;
+        }
+    }
+    for (int i = 0; i < k; i++)
+        if (src[i].bad) return -1;
+    return 0;
+}
+
+/* ── In-memory joins ────────────────────────────────────────────── */
+
+static inline u64 rec_key(const PldRec *r)
+{
+    return ((u64)r->title << 32) | r->timestamp;
+}
+
+/* Map dictionary ids[0..n-1] onto d, which holds all of them: both are
+ * sorted, so one walk does it. */
+static void map_titles(const u64 *ids, int n, const PldTitleDict *d, u16 *map)
+{
+    int j = 0;
+    for (int i = 0; i < n; i++) {
+        while (d->ids[j] != ids[i]) j++;
+        map[i] = (u16)j;
+    }
+}
+
+/* Fold in-memory stream s into log, giving out (emptied first), the way
+ * pld_merger_push does: log records up to each key are copied as they
+ * are, and a key meeting the last record written folds into it.  Returns
+ * 0, or -1 when the result overflows the log or its dictionary. */
+static int join_mem(const PldSessionLog *log, const Source *s,
+                    PldSessionLog *out, bool add_only)
+{
+    out->count = 0;
+    *out->titles = *log->titles;
+    if (!pld_log_add_titles(out, s->ids, s->nids)) return -1;
+    u16 lmap[PLD_TITLE_MAX], smap[PLD_TITLE_MAX];
+    map_titles(log->titles->ids, log->titles->count, out->titles, lmap);
+    map_titles(s->ids, s->nids, out->titles, smap);
+
+    const PldRec *l = log->entries;
+    PldRec *e = out->entries;
+    int n = log->count, i = 0, w = 0;
+    for (int j = 0; j < s->count; j++) {
+        PldRec r = s->recs[j];
+        r.title = smap[r.title];
+        u64 k = rec_key(&r);
+        for (; i < n; i++) {
+            PldRec x = l[i];
+            x.title = lmap[x.title];
+            if (rec_key(&x) > k) break;
+            if (w == PLD_SESSION_COUNT) return -1;
+            e[w++] = x;
+        }
+        if (w > 0 && rec_key(&e[w - 1]) == k) {
+            e[w - 1].play_secs = (u16)fold_secs(e[w - 1].play_secs,
+                                                r.play_secs, add_only);
+        } else {
+            if (w == PLD_SESSION_COUNT) return -1;
+            e[w++] = r;
+        }
+    }
+    if (w + (n - i) > PLD_SESSION_COUNT) return -1;
+    for (; i < n; i++) {
+        e[w] = l[i];
+        e[w++].title = lmap[l[i].title];
+    }
+    out->count = w;
+    return 0;
+}
+
+static void log_swap(PldSessionLog *a, PldSessionLog *b)
+{
+    PldSessionLog t = *a;
+    *a = *b;
+    *b = t;
+}
+
+static u32 s_mem = PLD_MERGE_MEM;
+
+void pld_merge_set_mem(u32 bytes)
+{
+    s_mem = bytes ? bytes : PLD_MERGE_MEM;
+}
+
+u32 pld_merge_get_mem(void)
+{
+    return s_mem;
+}
+
+int pld_merge_many(PldFile *local_pld, PldSessionLog *local,
+                   const char *const *paths, int n, bool add_only,
+                   const char *scratch_dir)
+{
+    int before = local->count;
+    pld_sort_sessions(local);
+
+    Source *src = MEM_CALLOC(MEM_PLD, PLD_MERGE_FANIN, sizeof(Source));
+    if (!src) return -1;
+    PldSessionLog out = { NULL, 0, NULL };
+    int rc = 0;
+
+    for (int done = 0; done < n && rc == 0; ) {
+        int k = n - done;
+        if (k > PLD_MERGE_FANIN - 1) k = PLD_MERGE_FANIN - 1;
+        if (!out.entries && !pld_log_alloc(&out)) { rc = -1; break; }
+
+        src[0].kind = SRC_LOG;
+        src[0].log  = local;
+        u32 budget = s_mem;
+        int opened = 0;
+        while (opened < k && rc == 0) {
+            Source *s = &src[opened + 1];
+            u32 need = source_probe(s, paths[done + opened], scratch_dir,
+                                    opened + 1);
+            if (opened > 0 && need > budget) {
+                /* Another pass costs one more walk of the log, far less
+                 * than spilling this input to a scratch run and reading
+                 * it back: it starts the next pass instead. */
+                source_close(s);
+                break;
+            } else if (R_FAILED(source_load(s, local_pld, add_only,
+                                            &budget))) {
+                rc = -1;
+            }
+            opened++;
+        }
+        bool in_mem = true;
+        for (int i = 1; i <= opened; i++)
+            in_mem = in_mem && src[i].kind == SRC_MEM;
+        if (rc == 0 && in_mem) {
+            for (int i = 1; i <= opened && rc == 0; i++) {
+                rc = join_mem(local, &src[i], &out, add_only);
+                if (rc == 0) log_swap(local, &out);
+            }
+        } else if (rc == 0) {
+            rc = merge_pass(src, opened + 1, &out, add_only);
+            if (rc == 0) log_swap(local, &out);
+        }
+        for (int i = 0; i <= opened; i++)
+            source_close(&src[i]);
+        if (rc == 0) done += opened;
+    }
+
+    if (out.entries) pld_sessions_free(&out);
+    MEM_FREE(src);
+    return rc < 0 ? -1 : local->count - before;
+}
@@ -0,0 +1,375 @@
+#include "pld.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+/*
+ * pld_link.c — finding the peer and opening the sync connection
+ *
+ * pld_link_tick runs on the frame loop, so nothing in here waits: every
+ * socket is non-blocking, connect() completes in the background and is
+ * polled with a zero timeout, and the handshake moves as many of its few
+ * bytes as the socket takes, resuming where it stopped on the next tick.
+ * The bytes on the wire are those of the old blocking handshake:
+ *
+ *   host  -> PLD3
+ *   client -> PLD3                           (raw payloads)
+ *          or PLD4, mask; host -> mask       (codec = both masks)
+ *
+ * and a client says PLD4 only after hearing it broadcast, so a PLD3
+ * peer, which predates the codec trade, gets the handshake it expects.
+ * Releases from before the one-pass sync speak PLDS, which neither side
+ * accepts: both consoles must run this version.
+ */
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define DRAIN_MAX  16   /* datagrams read per tick */
+
+enum { HS_WANT_MAGIC, HS_WANT_REPLY, HS_WANT_CODECS, HS_DONE };
+
+/* ── Socket helpers ─────────────────────────────────────────────── */
+
+static bool would_block(void)
+{
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+static bool set_nonblocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static void close_fd(int *fd)
+{
+    if (*fd >= 0) {
+        close(*fd);
+        *fd = -1;
+    }
+}
+
+static struct sockaddr_in inet_addr_port(u32 addr, u16 port)
+{
+    struct sockaddr_in a;
+    memset(&a, 0, sizeof(a));
+    a.sin_family      = AF_INET;
+    a.sin_addr.s_addr = addr;
+    a.sin_port        = htons(port);
+    return a;
+}
+
+/* ── Phase changes ──────────────────────────────────────────────── */
+
+static void hs_start(PldLink *l, u64 now, int step)
+{
+    l->phase    = PLD_LINK_HANDSHAKE;
+    l->deadline = now + l->handshake_ms;
+    l->step     = step;
+    l->codec    = 0;
+    l->out_len  = l->out_pos = l->in_got = 0;
+}
+
+/* Drop the attempt: a host goes back to accepting, a client waits out its
+ * backoff before it scans again. */
+static void link_fail(PldLink *l, u64 now)
+{
+    close_fd(&l->tcp);
+    l->failures++;
+    if (l->host) {
+        l->phase      = PLD_LINK_LISTENING;
+        l->next_bcast = now;
+        return;
+    }
+    l->phase      = PLD_LINK_BACKOFF;
+    l->peer_addr  = 0;
+    l->retry_at   = now + l->backoff_ms;
+    l->backoff_ms = l->backoff_ms >= l->backoff_max_ms / 2
+                  ? l->backoff_max_ms : l->backoff_ms * 2;
+}
+
+static void link_ready(PldLink *l)
+{
+    l->phase      = PLD_LINK_READY;
+    l->backoff_ms = l->backoff_min_ms;
+    close_fd(&l->listen);
+    close_fd(&l->udp);
+}
+
+/* ── Handshake ──────────────────────────────────────────────────── */
+
+static void hs_queue(PldLink *l, u32 word)
+{
+    if (l->out_pos == l->out_len) l->out_pos = l->out_len = 0;
+    memcpy(l->out + l->out_len, &word, 4);
+    l->out_len += 4;
+}
+
+/* Act on one word from the peer; false on a protocol error. */
+static bool hs_step(PldLink *l, u32 word)
+{
+    switch (l->step) {
+    case HS_WANT_MAGIC:     /* client: the host's magic, then ours */
+        if (word != PLD_LINK_MAGIC) return false;
+        if (!l->peer_codec) {
+            hs_queue(l, PLD_LINK_MAGIC);
+            l->step = HS_DONE;
+            return true;
+        }
+        hs_queue(l, PLD_LINK_MAGIC_CODEC);
+        hs_queue(l, l->codecs);
+        l->step = HS_WANT_CODECS;
+        return true;
+    case HS_WANT_REPLY:     /* host: the client's magic says if codecs follow */
+        if (word == PLD_LINK_MAGIC) {
+            l->step = HS_DONE;
+            return true;
+        }
+        if (word != PLD_LINK_MAGIC_CODEC) return false;
+        hs_queue(l, l->codecs);
+        l->step = HS_WANT_CODECS;
+        return true;
+    case HS_WANT_CODECS:
+        l->codec = l->codecs & word;
+        l->step  = HS_DONE;
+        return true;
+    }
+    return false;
+}
+
+/* Send what is queued, then read words while the peer has them.  Returns
+ * 1 once done and flushed, 0 to resume next tick, -1 on failure. */
+static int hs_pump(PldLink *l)
+{
+    for (;;) {
+        if (l->out_pos < l->out_len) {
+            int n = send(l->tcp, l->out + l->out_pos, l->out_len - l->out_pos,
+                         MSG_NOSIGNAL);
+            if (n < 0) return would_block() ? 0 : -1;
+            l->out_pos += (u32)n;
+            continue;
+        }
+        if (l->step == HS_DONE) return 1;
+        int n = recv(l->tcp, l->in + l->in_got, 4 - l->in_got, 0);
+        if (n == 0) return -1;
+        if (n < 0) return would_block() ? 0 : -1;
+        l->in_got += (u32)n;
+        if (l->in_got < 4) continue;
+        u32 word;
+        memcpy(&word, l->in, 4);
+        l->in_got = 0;
+        if (!hs_step(l, word)) return -1;
+    }
+}
+
+static void tick_handshake(PldLink *l, u64 now)
+{
+    int rc = hs_pump(l);
+    if (rc > 0)
+        link_ready(l);
+    else if (rc < 0 || now >= l->deadline)
+        link_fail(l, now);
+}
+
+/* ── Host ───────────────────────────────────────────────────────── */
+
+static void tick_listening(PldLink *l, u64 now)
+{
+    if (now >= l->next_bcast) {
+        /* the codec magic first for clients that read it, the plain one
+         * for older ones */
+        static const u32 magics[2] = { PLD_LINK_MAGIC_CODEC, PLD_LINK_MAGIC };
+        struct sockaddr_in to = inet_addr_port(htonl(l->bcast_addr),
+                                               l->udp_port);
+        for (int i = 0; i < 2; i++)
+            sendto(l->udp, &magics[i], 4, 0, (struct sockaddr *)&to,
+                   sizeof(to));
+        l->next_bcast = now + l->bcast_ms;
+    }
+
+    struct sockaddr_in peer;
+    socklen_t len = sizeof(peer);
+    int fd = accept(l->listen, (struct sockaddr *)&peer, &len);
+    if (fd < 0) return;
+    /* whether O_NONBLOCK is inherited from the listener varies (the 3DS
+     * SOC service differs from Linux), so set it */
+    if (!set_nonblocking(fd)) {
+        close(fd);
+        return;
+    }
+    l->tcp       = fd;
+    l->peer_addr = peer.sin_addr.s_addr;
+    hs_start(l, now, HS_WANT_REPLY);
+    hs_queue(l, PLD_LINK_MAGIC);
+    tick_handshake(l, now);
+}
+
+/* ── Client ─────────────────────────────────────────────────────── */
+
+/* Read the datagrams waiting, at most DRAIN_MAX; true if one was a host's
+ * broadcast, with its address and whether it offered codecs in *l. */
+static bool drain_udp(PldLink *l)
+{
+    bool found = false;
+    for (int i = 0; i < DRAIN_MAX; i++) {
+        u32 word = 0;
+        struct sockaddr_in from;
+        socklen_t len = sizeof(from);
+        int n = recvfrom(l->udp, &word, 4, 0, (struct sockaddr *)&from, &len);
+        if (n < 0) break;
+        if (n != 4 || (word != PLD_LINK_MAGIC && word != PLD_LINK_MAGIC_CODEC))
+            continue;
+        if (!found) {
+            found         = true;
+            l->peer_addr  = from.sin_addr.s_addr;
+            l->peer_codec = false;
+        } else if (from.sin_addr.s_addr != l->peer_addr) {
+            continue;
+        }
+        if (word == PLD_LINK_MAGIC_CODEC) l->peer_codec = true;
+    }
+    return found;
+}
+
+static void tick_scanning(PldLink *l, u64 now)
+{
+    if (!drain_udp(l)) return;
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        l->phase = PLD_LINK_FAILED;
+        return;
+    }
+    l->tcp = fd;
+    if (!set_nonblocking(fd)) {
+        link_fail(l, now);
+        return;
+    }
+    struct sockaddr_in to = inet_addr_port(l->peer_addr, l->tcp_port);
+    if (connect(fd, (struct sockaddr *)&to, sizeof(to)) == 0) {
+        hs_start(l, now, HS_WANT_MAGIC);
+        tick_handshake(l, now);
+        return;
+    }
+    if (errno != EINPROGRESS && errno != EALREADY && errno != EWOULDBLOCK) {
+        link_fail(l, now);
+        return;
+    }
+    l->phase    = PLD_LINK_CONNECTING;
+    l->deadline = now + l->connect_ms;
+}
+
+static void tick_connecting(PldLink *l, u64 now)
+{
+    struct pollfd p;
+    p.fd      = l->tcp;
+    p.events  = POLLOUT;
+    p.revents = 0;
+    int n = poll(&p, 1, 0);
+    if (n > 0) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if ((p.revents & POLLNVAL) ||
+            getsockopt(l->tcp, SOL_SOCKET, SO_ERROR, &err, &len) < 0 ||
+            err != 0) {
+            link_fail(l, now);
+            return;
+        }
+        hs_start(l, now, HS_WANT_MAGIC);
+        tick_handshake(l, now);
+        return;
+    }
+    if ((n < 0 && errno != EINTR) || now >= l->deadline)
+        link_fail(l, now);
+}
+
+static void tick_backoff(PldLink *l, u64 now)
+{
+    /* broadcasts heard while waiting are stale by the time it ends */
+    drain_udp(l);
+    l->peer_addr = 0;
+    if (now >= l->retry_at) l->phase = PLD_LINK_SCANNING;
+}
+
+/* ── API ────────────────────────────────────────────────────────── */
+
+void pld_link_init(PldLink *l, bool host, u16 udp_port, u16 tcp_port)
+{
+    memset(l, 0, sizeof(*l));
+    l->host           = host;
+    l->phase          = PLD_LINK_CLOSED;
+    l->udp            = -1;
+    l->listen         = -1;
+    l->tcp            = -1;
+    l->udp_port       = udp_port;
+    l->tcp_port       = tcp_port;
+    l->bcast_addr     = INADDR_BROADCAST;
+    l->codecs         = PLD_CODEC_ALL;
+    l->bcast_ms       = PLD_LINK_BCAST_MS;
+    l->connect_ms     = PLD_LINK_CONNECT_MS;
+    l->handshake_ms   = PLD_LINK_HANDSHAKE_MS;
+    l->backoff_min_ms = PLD_LINK_BACKOFF_MS;
+    l->backoff_max_ms = PLD_LINK_BACKOFF_MAX;
+}
+
+int pld_link_open(PldLink *l, u64 now_ms)
+{
+    l->udp = socket(AF_INET, SOCK_DGRAM, 0);
+    if (l->udp < 0 || !set_nonblocking(l->udp)) goto fail;
+
+    if (l->host) {
+        int one = 1;
+        setsockopt(l->udp, SOL_SOCKET, SO_BROADCAST, &one, sizeof(one));
+        l->listen = socket(AF_INET, SOCK_STREAM, 0);
+        if (l->listen < 0) goto fail;
+        /* a sync retried straight after the last one would otherwise find
+         * the port held by the old connection's TIME_WAIT */
+        setsockopt(l->listen, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        struct sockaddr_in srv = inet_addr_port(htonl(INADDR_ANY), l->tcp_port);
+        if (bind(l->listen, (struct sockaddr *)&srv, sizeof(srv)) < 0 ||
+            listen(l->listen, 1) < 0 || !set_nonblocking(l->listen))
+            goto fail;
+        l->phase      = PLD_LINK_LISTENING;
+        l->next_bcast = now_ms;
+    } else {
+        struct sockaddr_in any = inet_addr_port(htonl(INADDR_ANY), l->udp_port);
+        if (bind(l->udp, (struct sockaddr *)&any, sizeof(any)) < 0) goto fail;
+        l->phase = PLD_LINK_SCANNING;
+    }
+    l->backoff_ms = l->backoff_min_ms;
+    l->failures   = 0;
+    return 0;
+
+fail:
+    pld_link_close(l);
+    l->phase = PLD_LINK_FAILED;
+    return -1;
+}
+
+PldLinkPhase pld_link_tick(PldLink *l, u64 now_ms)
+{
+    switch (l->phase) {
+    case PLD_LINK_LISTENING:  tick_listening(l, now_ms);  break;
+    case PLD_LINK_SCANNING:   tick_scanning(l, now_ms);   break;
+    case PLD_LINK_CONNECTING: tick_connecting(l, now_ms); break;
+    case PLD_LINK_HANDSHAKE:  tick_handshake(l, now_ms);  break;
+    case PLD_LINK_BACKOFF:    tick_backoff(l, now_ms);    break;
+    default: break;
+    }
+    return l->phase;
+}
+
+void pld_link_close(PldLink *l)
+{
+    close_fd(&l->tcp);
+    close_fd(&l->listen);
+    close_fd(&l->udp);
+    l->phase = PLD_LINK_CLOSED;
+}
@@ -0,0 +1,550 @@
+#include "pld.h"
+#include "memprof.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * pld_merge.c — session-log sort and merge engine
+ *
+ * Logs are kept sorted by (title, timestamp), which the sorted title
+ * dictionary makes the same order as (title_id, timestamp).  Sorting is an
+ * LSD radix sort over the 6 key bytes of a PldRec that skips every byte
+ * position on which all keys agree, and is skipped entirely when the input
+ * is already strictly ascending.
+ *
+ * Merging is a single forward merge-join.  pld_merger_begin parks the
+ * sorted local log at the tail of its PLD_SESSION_COUNT-slot buffer; each
+ * pushed remote record is packed against the local dictionary, pulls
+ * smaller local records down to the write cursor and is either folded into
+ * an equal key or emitted after them.  The write cursor can only catch the
+ * local read cursor when the result would exceed the buffer, which is
+ * reported as overflow.
+ *
+ * One-shot merges of unsorted PldSession input pack it against the local
+ * dictionary first and radix sort the packed copy, so the join sees
+ * ascending keys either way.
+ *
+ * A large one-shot merge can also be split by title range across threads
+ * (pld_merge_sessions_par).  Equal keys never straddle a title boundary,
+ * so each range folds exactly as the single join would, and the ranges'
+ * outputs are already in order end to end.  The app's merges don't take
+ * it: startup streams merged.dat through a view and a sync merges the
+ * peer's records as they arrive (pld_recon.c), neither holding the whole
+ * remote table it would partition.
+ */
+
+#define KEY_BYTES 6
+
+static inline u64 rec_key(const PldRec *r)
+{
+    return ((u64)r->title << 32) | r->timestamp;
+}
+
+/* Byte d of the sort key, least significant first: timestamp bytes 0–3,
+ * then title bytes 0–1. */
+static inline u32 key_byte(const PldRec *r, int d)
+{
+    if (d < 4) return (r->timestamp >> (8 * d)) & 0xFF;
+    return (u32)(r->title >> (8 * (d - 4))) & 0xFF;
+}
+
+/* Raw PldSession order, for input that arrives unpacked. */
+static inline bool raw_lt(const PldSession *a, const PldSession *b)
+{
+    return a->title_id < b->title_id ||
+           (a->title_id == b->title_id && a->timestamp < b->timestamp);
+}
+
+bool pld_sessions_sorted(const PldRec *entries, int n)
+{
+    for (int i = 1; i < n; i++)
+        if (rec_key(&entries[i - 1]) >= rec_key(&entries[i])) return false;
+    return true;
+}
+
+/* Sort a[0..n-1] using tmp[0..n-1] as the ping-pong buffer. */
+static void radix_sort(PldRec *a, PldRec *tmp, int n)
+{
+    /* Byte positions where some key differs from the first one */
+    u64 diff = 0;
+    for (int i = 1; i < n; i++)
+        diff |= rec_key(&a[i]) ^ rec_key(&a[0]);
+
+    PldRec *src = a, *dst = tmp;
+    for (int d = 0; d < KEY_BYTES; d++) {
+        if (!((diff >> (8 * d)) & 0xFF)) continue;
+
+        u32 count[256];
+        memset(count, 0, sizeof(count));
+        for (int i = 0; i < n; i++)
+            count[key_byte(&src[i], d)]++;
+        u32 pos = 0;
+        for (int b = 0; b < 256; b++) {
+            u32 c = count[b];
+            count[b] = pos;
+            pos += c;
+        }
+        for (int i = 0; i < n; i++)
+            dst[count[key_byte(&src[i], d)]++] = src[i];
+
+        PldRec *t = src; src = dst; dst = t;
+    }
+    if (src != a)
+        memcpy(a, src, (size_t)n * sizeof(PldRec));
+}
+
+static int cmp_rec_key(const void *a, const void *b)
+{
+    u64 ka = rec_key((const PldRec *)a), kb = rec_key((const PldRec *)b);
+    return ka < kb ? -1 : ka > kb;
+}
+
+/* Sort entries[0..n-1].  scratch (n slots) may be NULL, in which case one is
+ * malloc'd; if that fails too, fall back to qsort. */
+static void sort_with_scratch(PldRec *entries, int n, PldRec *scratch)
+{
+    if (n < 2 || pld_sessions_sorted(entries, n)) return;
+    if (scratch) {
+        radix_sort(entries, scratch, n);
+        return;
+    }
+    PldRec *tmp = MEM_MALLOC(MEM_PLD, (size_t)n * sizeof(PldRec));
+    if (tmp) {
+        radix_sort(entries, tmp, n);
+        MEM_FREE(tmp);
+    } else {
+        qsort(entries, (size_t)n, sizeof(PldRec), cmp_rec_key);
+    }
+}
+
+void pld_sort_sessions(PldSessionLog *log)
+{
+    /* A log holds PLD_SESSION_COUNT slots, so a half-full one can sort in
+     * its own tail without allocating. */
+    int n = log->count;
+    PldRec *scratch = (2 * n <= PLD_SESSION_COUNT) ? log->entries + n : NULL;
+    sort_with_scratch(log->entries, n, scratch);
+}
+
+/* ── Streaming merger ───────────────────────────────────────────── */
+
+static inline void fold_into(PldMerger *m, PldRec *dst, const PldRec *r)
+{
+    if (m->add_only) return;   /* existing entry preserved as-is */
+    u32 sum = dst->play_secs + r->play_secs;
+    if (sum > 3600) sum = 3600;
+    if (m->agg) pld_agg_adjust(m->agg, pld_rec_title_id(m->local, dst),
+                               (s32)sum - (s32)dst->play_secs);
+    dst->play_secs = (u16)sum;
+}
+
+static inline bool same_day(const PldRec *a, const PldRec *b)
+{
+    return a->title == b->title &&
+           a->timestamp / 86400u == b->timestamp / 86400u;
+}
+
+static void shift_titles(PldRec *e, int n, u16 from)
+{
+    for (int i = 0; i < n; i++)
+        if (e[i].title >= from) e[i].title++;
+}
+
+/* Dictionary position for a remote record's title, inserting it (and
+ * renumbering every live local record above it) if the log hasn't seen it.
+ * Returns -1 when the dictionary is full. */
+static int merger_title(PldMerger *m, u64 title_id)
+{
+    PldTitleDict *d = m->local->titles;
+    if (m->last_title >= 0 && d->ids[m->last_title] == title_id)
+        return m->last_title;
+    int t = pld_title_find(d, title_id);
+    if (t < 0) {
+        t = pld_title_insert(d, title_id);
+        if (t < 0) return -1;
+        PldRec *e = m->local->entries;
+        if (m->have_last && m->last.title >= t) m->last.title++;
+        if (m->fallback) {
+            shift_titles(e, m->local->count, (u16)t);
+        } else {
+            /* Live records are [0, w) and [r, PLD_SESSION_COUNT). */
+            shift_titles(e, m->w, (u16)t);
+            shift_titles(e + m->r, PLD_SESSION_COUNT - m->r, (u16)t);
+        }
+    }
+    m->last_title = t;
+    return t;
+}
+
+/* Finish the merge-join: slide the unread local tail down behind the
+ * output so entries[0..count-1] is the sorted result. */
+static void merger_settle(PldMerger *m)
+{
+    PldRec *e = m->local->entries;
+    int tail = PLD_SESSION_COUNT - m->r;
+    if (tail > 0 && m->w != m->r)
+        memmove(e + m->w, e + m->r, (size_t)tail * sizeof(PldRec));
+    m->local->count = m->w + tail;
+    m->sorted = m->local->count;
+    m->r = PLD_SESSION_COUNT;
+    m->w = m->local->count;
+}
+
+static int find_sorted(const PldRec *e, int n, u64 key)
+{
+    int lo = 0, hi = n - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        u64 k = rec_key(&e[mid]);
+        if (k == key) return mid;
+        if (k < key) lo = mid + 1;
+        else         hi = mid - 1;
+    }
+    return -1;
+}
+
+void pld_merger_begin(PldMerger *m, PldSessionLog *local, bool add_only,
+                      PldAgg *agg)
+{
+    memset(m, 0, sizeof(*m));
+    m->local      = local;
+    m->agg        = agg;
+    m->add_only   = add_only;
+    m->last_title = -1;
+
+    pld_sort_sessions(local);
+
+    int n = local->count;
+    PldRec *e = local->entries;
+    if (n > 0 && n < PLD_SESSION_COUNT)
+        memmove(e + PLD_SESSION_COUNT - n, e, (size_t)n * sizeof(PldRec));
+    m->r = PLD_SESSION_COUNT - n;
+    m->w = 0;
+}
+
+/* Out-of-order input: settle what has been merged so far, then fall back to
+ * binary search over that sorted prefix plus append; pld_merger_end sorts. */
+static void merger_push_unsorted(PldMerger *m, const PldRec *rec)
+{
+    PldSessionLog *l = m->local;
+    int idx = find_sorted(l->entries, m->sorted, rec_key(rec));
+    if (idx >= 0) {
+        fold_into(m, &l->entries[idx], rec);
+        return;
+    }
+    if (l->count >= PLD_SESSION_COUNT) { m->rc = -1; return; }
+    l->entries[l->count++] = *rec;
+    m->added++;
+}
+
+/* Merge one record already packed against the local dictionary. */
+static void merger_push_rec(PldMerger *m, const PldRec *rec)
+{
+    PldRec *e = m->local->entries;
+    u64 k = rec_key(rec);
+
+    if (!m->fallback && m->have_last && k < rec_key(&m->last)) {
+        merger_settle(m);
+        m->fallback = true;
+        if (m->agg) m->agg->valid = false;   /* day counts need order */
+    }
+    if (m->fallback) {
+        merger_push_unsorted(m, rec);
+        return;
+    }
+    m->last      = *rec;
+    m->have_last = true;
+
+    /* Pull local records with key <= rec down to the output. */
+    while (m->r < PLD_SESSION_COUNT && rec_key(&e[m->r]) <= k)
+        e[m->w++] = e[m->r++];
+
+    if (m->w > 0 && rec_key(&e[m->w - 1]) == k) {
+        fold_into(m, &e[m->w - 1], rec);
+    } else if (m->w < m->r) {
+        if (m->agg) {
+            bool seen = (m->w > 0 && same_day(&e[m->w - 1], rec)) ||
+                        (m->r < PLD_SESSION_COUNT && same_day(&e[m->r], rec));
+            PldSession s;
+            pld_rec_unpack(m->local, rec, &s);
+            pld_agg_add(m->agg, &s, !seen);
+        }
+        e[m->w++] = *rec;
+        m->added++;
+    } else {
+        m->rc = -1;     /* result would exceed PLD_SESSION_COUNT */
+    }
+}
+
+void pld_merger_push(PldMerger *m, const PldSession *recs, int n)
+{
+    for (int i = 0; i < n && m->rc == 0; i++) {
+        const PldSession *r = &recs[i];
+        if (r->title_id == 0 || r->title_id == 0xFFFFFFFFFFFFFFFFULL)
+            continue;
+        int t = merger_title(m, r->title_id);
+        if (t < 0) { m->rc = -1; break; }
+        PldRec rec = { r->timestamp, (u16)t,
+                       r->play_secs > 0xFFFFu ? 0xFFFFu : (u16)r->play_secs };
+        merger_push_rec(m, &rec);
+    }
+}
+
+/* Fallback finish: sort just the appended tail (in spare capacity when
+ * there is room), park it at the end of the buffer and merge it backwards
+ * into the sorted prefix.  The write cursor stays above the prefix read
+ * cursor and below the tail read cursor, so no further scratch is needed. */
+static void merger_finish_fallback(PldMerger *m)
+{
+    PldRec *e = m->local->entries;
+    int p = m->sorted;
+    int t = m->local->count - p;
+    if (t == 0) return;
+
+    int spare = PLD_SESSION_COUNT - p - t;
+    sort_with_scratch(e + p, t, spare >= t ? e + p + t : NULL);
+
+    PldRec *tail = e + PLD_SESSION_COUNT - t;
+    if (tail != e + p)
+        memmove(tail, e + p, (size_t)t * sizeof(PldRec));
+
+    int i = p - 1, j = t - 1, w = p + t - 1;
+    while (j >= 0) {
+        if (i >= 0 && rec_key(&tail[j]) < rec_key(&e[i])) e[w--] = e[i--];
+        else                                               e[w--] = tail[j--];
+    }
+}
+
+int pld_merger_end(PldMerger *m)
+{
+    if (!m->fallback) merger_settle(m);
+    else              merger_finish_fallback(m);
+    return m->rc < 0 ? -1 : m->added;
+}
+
+/* ── One-shot merges ────────────────────────────────────────────── */
+
+int pld_merge_sessions(PldSessionLog *local, const PldSession *remote,
+                       int remote_count, bool add_only)
+{
+    return pld_merge_sessions_agg(local, remote, remote_count, add_only, NULL);
+}
+
+/* Register the distinct titles of sorted src[0..n-1] (its run heads) with
+ * the log, a stack batch per renumbering pass. */
+static bool add_remote_titles(PldSessionLog *local, const PldSession *src, int n)
+{
+    u64 ids[PLD_SUMMARY_COUNT];
+    int k = 0;
+    for (int i = 0; i < n; i++) {
+        u64 id = src[i].title_id;
+        if (id == 0 || id == 0xFFFFFFFFFFFFFFFFULL) continue;
+        if (k > 0 && ids[k - 1] == id) continue;
+        if (k == PLD_SUMMARY_COUNT) {
+            if (!pld_log_add_titles(local, ids, k)) return false;
+            k = 0;
+        }
+        ids[k++] = id;
+    }
+    return pld_log_add_titles(local, ids, k);
+}
+
+static int merge_serial(PldSessionLog *local, const PldSession *remote,
+                        int remote_count, bool add_only, PldAgg *agg)
+{
+    /* Peers and merged.dat hand over sorted logs, which are joined as they
+     * are.  Anything else is packed against the local dictionary and radix
+     * sorted so the join stays linear; if there's no memory for that, the
+     * merger's unsorted fallback still gives the right answer. */
+    bool sorted = true;
+    for (int i = 1; i < remote_count && sorted; i++)
+        sorted = raw_lt(&remote[i - 1], &remote[i]);
+    PldRec *packed = sorted ? NULL
+                   : MEM_MALLOC(MEM_PLD, (size_t)remote_count * 2 *
+                                         sizeof(PldRec));
+
+    int n = 0;
+    if (packed) {
+        n = pld_log_pack_into(local, remote, remote_count, packed);
+        if (n < 0) {
+            MEM_FREE(packed);
+            return -1;
+        }
+        sort_with_scratch(packed, n, packed + n);
+    } else if (!add_remote_titles(local, remote, remote_count)) {
+        return -1;
+    }
+
+    PldMerger m;
+    pld_merger_begin(&m, local, add_only, agg);
+    if (packed) {
+        for (int i = 0; i < n && m.rc == 0; i++)
+            merger_push_rec(&m, &packed[i]);
+        MEM_FREE(packed);
+    } else {
+        pld_merger_push(&m, remote, remote_count);
+    }
+    return pld_merger_end(&m);
+}
+
+int pld_merge_sessions_agg(PldSessionLog *local, const PldSession *remote,
+                           int remote_count, bool add_only, PldAgg *agg)
+{
+    return merge_serial(local, remote, remote_count, add_only, agg);
+}
+
+int pld_merge_sessions_view(PldSessionLog *local, PldView *remote,
+                            bool add_only, PldAgg *agg)
+{
+    /* The view's summary table names nearly every title its sessions use;
+     * register those up front so the merger rarely has to renumber. */
+    u64 ids[PLD_SUMMARY_COUNT];
+    int k = 0;
+    PldSummary s;
+    while (k < PLD_SUMMARY_COUNT && pld_view_next_summary(remote, &s))
+        ids[k++] = s.title_id;
+    pld_view_rewind(remote);
+    if (!pld_log_add_titles(local, ids, k)) return -1;
+
+    PldMerger m;
+    pld_merger_begin(&m, local, add_only, agg);
+    PldSession r;
+    while (pld_view_next_session(remote, &r))
+        pld_merger_push(&m, &r, 1);
+    int added = pld_merger_end(&m);
+    if (R_FAILED(remote->rc)) return -1;
+    return added;
+}
+
+/* ── Partitioned merge ──────────────────────────────────────────── */
+
+typedef struct {
+    const PldRec *local;        /* the range's local records, sorted     */
+    PldRec       *remote;       /* its remote bucket, in pack order      */
+    PldRec       *scratch;      /* nr slots for sorting the bucket       */
+    PldRec       *out;          /* nl + nr slots                         */
+    int           nl, nr;
+    int           count;        /* records written to out                */
+    int           added;
+    bool          add_only;
+} MergePart;
+
+/* Sort the bucket and join it with the local range.  Ties put the local
+ * record first and every remote record folds into an equal key just
+ * written, as merger_push_rec does. */
+static void merge_part(void *raw)
+{
+    MergePart *p = (MergePart *)raw;
+    sort_with_scratch(p->remote, p->nr, p->scratch);
+
+    const PldRec *l = p->local, *r = p->remote;
+    PldRec *out = p->out;
+    int i = 0, j = 0, w = 0, added = 0;
+    while (j < p->nr) {
+        u64 k = rec_key(&r[j]);
+        while (i < p->nl && rec_key(&l[i]) <= k) out[w++] = l[i++];
+        if (w > 0 && rec_key(&out[w - 1]) == k) {
+            if (!p->add_only) {
+                u32 sum = (u32)out[w - 1].play_secs + r[j].play_secs;
+                out[w - 1].play_secs = (u16)(sum > 3600 ? 3600 : sum);
+            }
+        } else {
+            out[w++] = r[j];
+            added++;
+        }
+        j++;
+    }
+    while (i < p->nl) out[w++] = l[i++];
+    p->count = w;
+    p->added = added;
+}
+
+int pld_merge_sessions_par(PldSessionLog *local, const PldSession *remote,
+                           int remote_count, bool add_only, int threads)
+{
+    if (threads > PLD_PAR_MAX) threads = PLD_PAR_MAX;
+    if (threads < 2 || remote_count == 0)
+        return merge_serial(local, remote, remote_count, add_only, NULL);
+
+    /* packed + buckets: 2 × remote; out: local + remote. */
+    int nl = local->count;
+    PldRec *buf = MEM_MALLOC(MEM_PLD, ((size_t)remote_count * 3 +
+                                       (size_t)nl) * sizeof(PldRec));
+    if (!buf) return merge_serial(local, remote, remote_count, add_only, NULL);
+    PldRec *packed = buf;
+    PldRec *bucket = buf + remote_count;
+    PldRec *out    = buf + 2 * (size_t)remote_count;
+
+    int nr = pld_log_pack_into(local, remote, remote_count, packed);
+    if (nr < 0) {
+        MEM_FREE(buf);
+        return -1;
+    }
+    pld_sort_sessions(local);
+
+    /* Records per title on each side, then cut points at every
+     * total / threads records. */
+    int nt = local->titles->count;
+    int *cnt_l = MEM_CALLOC(MEM_PLD, (size_t)nt * 2 + 1, sizeof(int));
+    u8  *part  = MEM_MALLOC(MEM_PLD, (size_t)nt + 1);
+    if (!cnt_l || !part) {
+        MEM_FREE(cnt_l);
+        MEM_FREE(part);
+        MEM_FREE(buf);
+        return merge_serial(local, remote, remote_count, add_only, NULL);
+    }
+    int *cnt_r = cnt_l + nt;
+    for (int i = 0; i < nl; i++) cnt_l[local->entries[i].title]++;
+    for (int i = 0; i < nr; i++) cnt_r[packed[i].title]++;
+
+    MergePart parts[PLD_PAR_MAX];
+    int total = nl + nr, seen = 0, np = 0;
+    int lo_l = 0, lo_r = 0;
+    for (int t = 0; t < nt; ) {
+        MergePart *p = &parts[np];
+        p->nl = p->nr = 0;
+        int goal = (int)((long long)total * (np + 1) / threads);
+        for (; t < nt && (seen < goal || np == threads - 1); t++) {
+            part[t] = (u8)np;
+            p->nl += cnt_l[t];
+            p->nr += cnt_r[t];
+            seen  += cnt_l[t] + cnt_r[t];
+        }
+        p->local    = local->entries + lo_l;
+        p->remote   = bucket + lo_r;
+        p->scratch  = packed + lo_r;
+        p->out      = out + lo_l + lo_r;
+        p->add_only = add_only;
+        lo_l += p->nl;
+        lo_r += p->nr;
+        np++;
+    }
+    MEM_FREE(cnt_l);
+
+    /* Scatter the remote records to their ranges' buckets, in order. */
+    int fill[PLD_PAR_MAX];
+    for (int k = 0; k < np; k++) fill[k] = (int)(parts[k].remote - bucket);
+    for (int i = 0; i < nr; i++)
+        bucket[fill[part[packed[i].title]]++] = packed[i];
+    MEM_FREE(part);
+
+    pld_run_parallel(merge_part, parts, sizeof(MergePart), np);
+
+    int w = 0, added = 0;
+    for (int k = 0; k < np; k++) {
+        if (parts[k].out != out + w)
+            memmove(out + w, parts[k].out,
+                    (size_t)parts[k].count * sizeof(PldRec));
+        w     += parts[k].count;
+        added += parts[k].added;
+    }
+    if (w > PLD_SESSION_COUNT) {
+        MEM_FREE(buf);
+        return -1;
+    }
+    memcpy(local->entries, out, (size_t)w * sizeof(PldRec));
+    local->count = w;
+    MEM_FREE(buf);
+    return added;
+}
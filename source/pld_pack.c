@@ -0,0 +1,260 @@
+#include "pld.h"
+#include "memprof.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * pld_pack.c — 8-byte PldRec encoding and the per-log title dictionary
+ *
+ * Records are packed at the I/O boundary (pld_parse_image, merges of
+ * PldSession input) and unpacked for pld_store_image and the wire.  The
+ * dictionary stays sorted, so inserting a title shifts the indices of every
+ * later one; pld_log_add_titles batches that into a single pass.
+ */
+
+static inline u16 sat_secs(u32 secs)
+{
+    return secs > 0xFFFFu ? 0xFFFFu : (u16)secs;
+}
+
+/* First position in d->ids whose id is >= title_id. */
+static int dict_lower_bound(const PldTitleDict *d, u64 title_id)
+{
+    int lo = 0, hi = d->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (d->ids[mid] < title_id) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+int pld_title_find(const PldTitleDict *d, u64 title_id)
+{
+    int i = dict_lower_bound(d, title_id);
+    return (i < d->count && d->ids[i] == title_id) ? i : -1;
+}
+
+int pld_title_insert(PldTitleDict *d, u64 title_id)
+{
+    int i = dict_lower_bound(d, title_id);
+    if (i < d->count && d->ids[i] == title_id) return i;
+    if (d->count >= PLD_TITLE_MAX) return -1;
+    memmove(&d->ids[i + 1], &d->ids[i], (size_t)(d->count - i) * sizeof(u64));
+    d->ids[i] = title_id;
+    d->count++;
+    return i;
+}
+
+void pld_log_attach(PldSessionLog *log, void *block)
+{
+    log->entries = (PldRec *)block;
+    log->titles  = (PldTitleDict *)((u8 *)block +
+                                    PLD_SESSION_COUNT * sizeof(PldRec));
+}
+
+bool pld_log_alloc(PldSessionLog *log)
+{
+    log->count = 0;
+    void *block = MEM_MALLOC(MEM_PLD, PLD_LOG_BYTES);
+    if (!block) {
+        log->entries = NULL;
+        log->titles  = NULL;
+        return false;
+    }
+    pld_log_attach(log, block);
+    log->titles->count = 0;
+    return true;
+}
+
+/* Pack-time scratch: the dictionary under construction plus an open-
+ * addressed id → position table, so each record costs one hash probe
+ * rather than two binary searches. */
+#define PACK_HASH_BITS 12
+#define PACK_HASH      (1 << PACK_HASH_BITS)     /* 2 × PLD_TITLE_MAX */
+#define PACK_EMPTY     0xFFFFu
+
+typedef struct {
+    PldTitleDict dict;
+    u64          keys[PACK_HASH];
+    u16          pos[PACK_HASH];
+} PackScratch;
+
+static u32 pack_slot(const PackScratch *p, u64 title_id)
+{
+    u32 h = (u32)((title_id * 0x9E3779B97F4A7C15ULL) >> (64 - PACK_HASH_BITS));
+    while (p->pos[h] != PACK_EMPTY && p->keys[h] != title_id)
+        h = (h + 1) & (PACK_HASH - 1);
+    return h;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    u64 x = *(const u64 *)a, y = *(const u64 *)b;
+    return x < y ? -1 : x > y;
+}
+
+static PackScratch *scratch_new(void)
+{
+    PackScratch *p = MEM_MALLOC(MEM_PLD, sizeof(*p));
+    if (!p) return NULL;
+    p->dict.count = 0;
+    memset(p->pos, 0xFF, sizeof(p->pos));
+    return p;
+}
+
+/* Claim a table slot for every distinct title in src and list in p->dict
+ * those missing from `known` (NULL: all of them).  False once more than
+ * PLD_TITLE_MAX distinct titles turn up, which no dictionary can hold. */
+static bool scratch_collect(PackScratch *p, const PldSession *src, int n,
+                            const PldTitleDict *known)
+{
+    int seen = 0;
+    u64 last = 0;
+    for (int i = 0; i < n; i++) {
+        if (i > 0 && src[i].title_id == last) continue;
+        last = src[i].title_id;
+        if (last == 0 || last == 0xFFFFFFFFFFFFFFFFULL) continue;
+        u32 h = pack_slot(p, last);
+        if (p->pos[h] != PACK_EMPTY) continue;
+        if (++seen > PLD_TITLE_MAX) return false;
+        p->keys[h] = last;
+        p->pos[h]  = 0;
+        if (!known || pld_title_find(known, last) < 0)
+            p->dict.ids[p->dict.count++] = last;
+    }
+    return true;
+}
+
+/* Point every slot at its title's position in d, a superset of the
+ * collected titles. */
+static void scratch_index(PackScratch *p, const PldTitleDict *d)
+{
+    for (int t = 0; t < d->count; t++) {
+        u32 h = pack_slot(p, d->ids[t]);
+        p->keys[h] = d->ids[t];
+        p->pos[h]  = (u16)t;
+    }
+}
+
+static inline void pack_one(const PackScratch *p, const PldTitleDict *d,
+                            const PldSession *s, PldRec *r, int *t)
+{
+    if (d->ids[*t] != s->title_id)
+        *t = p->pos[pack_slot(p, s->title_id)];
+    r->timestamp = s->timestamp;
+    r->title     = (u16)*t;
+    r->play_secs = sat_secs(s->play_secs);
+}
+
+Result pld_log_pack(PldSessionLog *log, const PldSession *src, int n)
+{
+    /* The dictionary is built aside: when packing in place, its home at the
+     * end of the record area still holds unread source records. */
+    PackScratch *p = scratch_new();
+    if (!p) return (Result)-1;
+    log->count = 0;
+    if (!scratch_collect(p, src, n, NULL)) {
+        MEM_FREE(p);
+        log->titles->count = 0;
+        return (Result)-1;
+    }
+    PldTitleDict *d = &p->dict;
+    qsort(d->ids, (size_t)d->count, sizeof(u64), cmp_u64);
+    scratch_index(p, d);
+
+    int t = 0;
+    for (int i = 0; i < n; i++) {
+        PldSession s = src[i];
+        pack_one(p, d, &s, &log->entries[i], &t);
+    }
+
+    memcpy(log->titles, d, sizeof(*d));
+    MEM_FREE(p);
+    log->count = n;
+    return 0;
+}
+
+int pld_log_pack_into(PldSessionLog *log, const PldSession *src, int n,
+                      PldRec *out)
+{
+    PackScratch *p = scratch_new();
+    if (!p) return -1;
+    if (!scratch_collect(p, src, n, log->titles) ||
+        !pld_log_add_titles(log, p->dict.ids, p->dict.count)) {
+        MEM_FREE(p);
+        return -1;
+    }
+    const PldTitleDict *d = log->titles;
+    scratch_index(p, d);
+
+    int k = 0, t = 0;
+    for (int i = 0; i < n; i++) {
+        u64 id = src[i].title_id;
+        if (id == 0 || id == 0xFFFFFFFFFFFFFFFFULL) continue;
+        pack_one(p, d, &src[i], &out[k++], &t);
+    }
+    MEM_FREE(p);
+    return k;
+}
+
+void pld_log_unpack(const PldSessionLog *log, PldSession *dst)
+{
+    for (int i = 0; i < log->count; i++)
+        pld_rec_unpack(log, &log->entries[i], &dst[i]);
+}
+
+bool pld_log_add_titles(PldSessionLog *log, const u64 *ids, int n)
+{
+    PldTitleDict *d = log->titles;
+
+    /* Collect the missing ids, sorted and unique, in the log's spare slots
+     * (a merge target is rarely full), else on the heap. */
+    u64 *fresh = NULL;
+    bool heap = PLD_SESSION_COUNT - log->count < n;
+    int k = 0;
+    for (int i = 0; i < n; i++) {
+        u64 id = ids[i];
+        if (pld_title_find(d, id) >= 0) continue;
+        if (!fresh) {
+            fresh = heap ? MEM_MALLOC(MEM_PLD, (size_t)n * sizeof(u64))
+                         : (u64 *)(log->entries + log->count);
+            if (!fresh) return false;
+        }
+        int lo = 0, hi = k;
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (fresh[mid] < id) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo < k && fresh[lo] == id) continue;
+        memmove(&fresh[lo + 1], &fresh[lo], (size_t)(k - lo) * sizeof(u64));
+        fresh[lo] = id;
+        k++;
+    }
+    if (k == 0) return true;
+    if (d->count + k > PLD_TITLE_MAX) {
+        if (heap) MEM_FREE(fresh);
+        return false;
+    }
+
+    /* Merge from the back; map[i] is old position i's new position. */
+    u16 map[PLD_TITLE_MAX];
+    int i = d->count - 1, j = k - 1, w = d->count + k - 1;
+    while (j >= 0) {
+        if (i >= 0 && d->ids[i] > fresh[j]) {
+            map[i] = (u16)w;
+            d->ids[w--] = d->ids[i--];
+        } else {
+            d->ids[w--] = fresh[j--];
+        }
+    }
+    for (; i >= 0; i--) map[i] = (u16)i;
+    d->count += k;
+    if (heap) MEM_FREE(fresh);
+
+    for (int r = 0; r < log->count; r++)
+        log->entries[r].title = map[log->entries[r].title];
+    return true;
+}
@@ -0,0 +1,192 @@
+#include "pld.h"
+
+#include <stdlib.h>
+
+#ifdef __3DS__
+#include <3ds.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+/*
+ * pld_parallel.c — fork-join over the cores the pld core may use
+ *
+ * Merges run inside a run_with_spinner worker on core 1, which the app
+ * limits to a share of its time, while the UI thread on core 0 mostly
+ * waits for vblank.  Helper threads go to the other cores first (core 0,
+ * and core 2 on New 3DS) and to any core if those won't take them.  The
+ * host build uses pthreads.
+ *
+ * A fence's task stays on the caller's core one priority step down, so it
+ * fills the time the UI thread spends waiting for vblank without ever
+ * holding up a frame.
+ */
+
+#define TASK_STACK   0x4000
+#define FENCE_STACK  0x8000     /* as run_with_spinner's workers */
+
+typedef struct {
+    PldTaskFunc func;
+    void       *arg;
+} Task;
+
+#ifdef __3DS__
+
+int pld_parallel_cores(void)
+{
+    bool n3ds = false;
+    APT_CheckNew3DS(&n3ds);
+    return n3ds ? 3 : 2;
+}
+
+static void task_entry(void *raw)
+{
+    Task *t = (Task *)raw;
+    t->func(t->arg);
+}
+
+void pld_run_parallel(PldTaskFunc func, void *args, size_t arg_size, int n)
+{
+    Task   tasks[PLD_PAR_MAX];
+    Thread threads[PLD_PAR_MAX];
+    if (n < 1) return;
+    if (n > PLD_PAR_MAX) n = PLD_PAR_MAX;
+
+    s32 prio = 0x30;
+    svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+    int self  = svcGetProcessorID();
+    int cores = pld_parallel_cores();
+    int next  = 0;
+
+    for (int i = 1; i < n; i++) {
+        tasks[i].func = func;
+        tasks[i].arg  = (u8 *)args + (size_t)i * arg_size;
+        while (next < cores && next == self) next++;
+        int core = next < cores ? next++ : -2;
+        threads[i] = threadCreate(task_entry, &tasks[i], TASK_STACK, prio,
+                                  core, false);
+        if (!threads[i] && core != -2)
+            threads[i] = threadCreate(task_entry, &tasks[i], TASK_STACK, prio,
+                                      -2, false);
+        if (!threads[i]) func(tasks[i].arg);
+    }
+    func(args);
+    for (int i = 1; i < n; i++) {
+        if (!threads[i]) continue;
+        threadJoin(threads[i], U64_MAX);
+        threadFree(threads[i]);
+    }
+}
+
+static void fence_entry(void *raw)
+{
+    PldFence *f = (PldFence *)raw;
+    f->func(f->arg);
+    __atomic_store_n(&f->done, true, __ATOMIC_RELEASE);
+}
+
+bool pld_fence_start(PldFence *f, PldTaskFunc func, void *arg)
+{
+    f->func   = func;
+    f->arg    = arg;
+    f->done   = false;
+    f->thread = NULL;
+
+    s32 prio = 0x30;
+    svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+    if (prio < 0x3F) prio++;
+    Thread t = threadCreate(fence_entry, f, FENCE_STACK, prio,
+                            svcGetProcessorID(), false);
+    if (!t) t = threadCreate(fence_entry, f, FENCE_STACK, prio, -2, false);
+    if (!t) {
+        fence_entry(f);
+        return false;
+    }
+    f->thread = t;
+    return true;
+}
+
+void pld_fence_wait(PldFence *f)
+{
+    if (!f->thread) return;
+    threadJoin((Thread)f->thread, U64_MAX);
+    threadFree((Thread)f->thread);
+    f->thread = NULL;
+}
+
+#else
+
+int pld_parallel_cores(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) return 1;
+    return n > PLD_PAR_MAX ? PLD_PAR_MAX : (int)n;
+}
+
+static void *task_entry(void *raw)
+{
+    Task *t = (Task *)raw;
+    t->func(t->arg);
+    return NULL;
+}
+
+void pld_run_parallel(PldTaskFunc func, void *args, size_t arg_size, int n)
+{
+    Task      tasks[PLD_PAR_MAX];
+    pthread_t threads[PLD_PAR_MAX];
+    bool      started[PLD_PAR_MAX];
+    if (n < 1) return;
+    if (n > PLD_PAR_MAX) n = PLD_PAR_MAX;
+
+    for (int i = 1; i < n; i++) {
+        tasks[i].func = func;
+        tasks[i].arg  = (u8 *)args + (size_t)i * arg_size;
+        started[i] = pthread_create(&threads[i], NULL, task_entry,
+                                    &tasks[i]) == 0;
+        if (!started[i]) func(tasks[i].arg);
+    }
+    func(args);
+    for (int i = 1; i < n; i++)
+        if (started[i]) pthread_join(threads[i], NULL);
+}
+
+static void *fence_entry(void *raw)
+{
+    PldFence *f = (PldFence *)raw;
+    f->func(f->arg);
+    __atomic_store_n(&f->done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+bool pld_fence_start(PldFence *f, PldTaskFunc func, void *arg)
+{
+    f->func   = func;
+    f->arg    = arg;
+    f->done   = false;
+    f->thread = NULL;
+
+    pthread_t *t = malloc(sizeof(*t));
+    if (t && pthread_create(t, NULL, fence_entry, f) == 0) {
+        f->thread = t;
+        return true;
+    }
+    free(t);
+    fence_entry(f);
+    return false;
+}
+
+void pld_fence_wait(PldFence *f)
+{
+    if (!f->thread) return;
+    pthread_join(*(pthread_t *)f->thread, NULL);
+    free(f->thread);
+    f->thread = NULL;
+}
+
+#endif
+
+bool pld_fence_ready(const PldFence *f)
+{
+    return __atomic_load_n(&f->done, __ATOMIC_ACQUIRE);
+}
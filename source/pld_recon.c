@@ -0,0 +1,452 @@
+#include "pld.h"
+
+#include <string.h>
+
+/*
+ * pld_recon.c — delta session sync by range hashes
+ *
+ * Both logs are sorted by (title_id, timestamp), so every key range is a
+ * contiguous run that hashes the same on either console exactly when it
+ * holds the same records.  Round one trades one digest per title.  Titles
+ * both sides hold differently are then settled whole, or, where span
+ * digests cost less than the records they might save (pld_recon_by_span,
+ * decided from both title digests, so alike on both ends), span by span
+ * after round two trades their span digests.  Round three sends the
+ * records of every range the peer lacks or holds differently.  Consoles
+ * synced yesterday trade a few kilobytes of digests and a handful of
+ * spans instead of both logs.
+ *
+ * Each round is one pld_wire_exchange: both ends send their half while
+ * receiving the other's.  The records of round three go into a PldMerger
+ * a chunk at a time as they come off the socket, so merging overlaps the
+ * transfer and the peer's records never sit in a buffer of their own.
+ */
+
+/* Title states after round one, by dictionary position */
+enum { TITLE_SAME, TITLE_WHOLE, TITLE_SPANS };
+
+/* ── Digests ────────────────────────────────────────────────────── */
+
+static inline u32 span_of(const PldRec *r)
+{
+    return r->timestamp / PLD_RECON_SPAN;
+}
+
+static u64 hash_rec(const PldSessionLog *log, const PldRec *r, u64 h)
+{
+    PldSession s;
+    pld_rec_unpack(log, r, &s);
+    return pld_hash64(&s, sizeof(s), h);
+}
+
+/* Digest of the title run starting at *i; *i is left past it. */
+static PldReconTitle digest_title(const PldSessionLog *log, int *i)
+{
+    const PldRec *first = &log->entries[*i];
+    PldReconTitle d = { pld_rec_title_id(log, first), 0, 0, 0 };
+    for (; *i < log->count && log->entries[*i].title == first->title; (*i)++) {
+        const PldRec *r = &log->entries[*i];
+        if (d.count == 0 || span_of(r) != span_of(r - 1)) d.spans++;
+        d.hash = hash_rec(log, r, d.hash);
+        d.count++;
+    }
+    return d;
+}
+
+/* Span digests of the titles in state TITLE_SPANS, in key order; with out
+ * NULL, only counted. */
+static u32 digest_spans(const PldSessionLog *log, const u8 *state,
+                        PldReconDigest *out)
+{
+    u32 n = 0;
+    for (int i = 0; i < log->count; ) {
+        const PldRec *r = &log->entries[i];
+        if (state[r->title] != TITLE_SPANS) {
+            i++;
+            continue;
+        }
+        PldReconDigest d = { pld_rec_title_id(log, r), span_of(r), 0, 0 };
+        for (; i < log->count && log->entries[i].title == r->title &&
+               span_of(&log->entries[i]) == d.span; i++) {
+            if (out) d.hash = hash_rec(log, &log->entries[i], d.hash);
+            d.count++;
+        }
+        if (out) out[n] = d;
+        n++;
+    }
+    return n;
+}
+
+bool pld_recon_by_span(const PldReconTitle *a, const PldReconTitle *b)
+{
+    /* 24 bytes a span digest against 16 a record: worth it when the
+     * digests cost under half of sending both titles whole. */
+    return 3u * ((u64)a->spans + b->spans) < (u64)a->count + b->count;
+}
+
+/* The peer's arrays are binary searched: reject any out of order. */
+static bool titles_sorted(const PldReconTitle *d, u32 n)
+{
+    for (u32 i = 1; i < n; i++)
+        if (d[i - 1].title_id >= d[i].title_id) return false;
+    return true;
+}
+
+static const PldReconTitle *title_find(const PldReconTitle *d, u32 n,
+                                       u64 title_id)
+{
+    u32 lo = 0, hi = n;
+    while (lo < hi) {
+        u32 mid = lo + (hi - lo) / 2;
+        if (d[mid].title_id == title_id) return &d[mid];
+        if (d[mid].title_id < title_id) lo = mid + 1;
+        else                            hi = mid;
+    }
+    return NULL;
+}
+
+static int span_cmp(const PldReconDigest *a, u64 title_id, u32 span)
+{
+    if (a->title_id != title_id) return a->title_id < title_id ? -1 : 1;
+    if (a->span != span) return a->span < span ? -1 : 1;
+    return 0;
+}
+
+static bool spans_sorted(const PldReconDigest *d, u32 n)
+{
+    for (u32 i = 1; i < n; i++)
+        if (span_cmp(&d[i - 1], d[i].title_id, d[i].span) >= 0) return false;
+    return true;
+}
+
+static const PldReconDigest *span_find(const PldReconDigest *d, u32 n,
+                                       u64 title_id, u32 span)
+{
+    u32 lo = 0, hi = n;
+    while (lo < hi) {
+        u32 mid = lo + (hi - lo) / 2;
+        int c = span_cmp(&d[mid], title_id, span);
+        if (c == 0) return &d[mid];
+        if (c < 0) lo = mid + 1;
+        else       hi = mid;
+    }
+    return NULL;
+}
+
+/* ── Records ────────────────────────────────────────────────────── */
+
+/* Set a bit in map for each record to send; returns how many. */
+static u32 mark_records(const PldSessionLog *log, const u8 *state,
+                        const PldReconDigest *spans, const PldReconDigest *peer,
+                        u32 n_peer, u32 *map)
+{
+    u32 n = 0;
+    int k = -1;
+    bool send_span = false;
+    for (int i = 0; i < log->count; i++) {
+        const PldRec *r = &log->entries[i];
+        u8 st = state[r->title];
+        bool send = st == TITLE_WHOLE;
+        if (st == TITLE_SPANS) {
+            /* spans[] holds these runs in this order */
+            if (k < 0 || r[-1].title != r->title || span_of(r - 1) != span_of(r)) {
+                k++;
+                const PldReconDigest *p = span_find(peer, n_peer,
+                                                    spans[k].title_id,
+                                                    spans[k].span);
+                send_span = !p || p->count != spans[k].count ||
+                            p->hash != spans[k].hash;
+            }
+            send = send_span;
+        }
+        if (send) {
+            map[i >> 5] |= 1u << (i & 31);
+            n++;
+        }
+    }
+    return n;
+}
+
+/* PldWireNext over the marked records, unpacked as PldSessions. */
+typedef struct {
+    const PldSessionLog *log;
+    const u32           *map;
+    int                  i;
+} MarkedIter;
+
+static void next_record(void *raw, void *out)
+{
+    MarkedIter *m = (MarkedIter *)raw;
+    while (!(m->map[m->i >> 5] & (1u << (m->i & 31)))) m->i++;
+    pld_rec_unpack(m->log, &m->log->entries[m->i++], (PldSession *)out);
+}
+
+/* ── Receiving ──────────────────────────────────────────────────── */
+
+/* Copy of *log in one scratch block: what round three sends is read from
+ * it while the merge rewrites *log, and a failed round puts it back. */
+static bool undo_take(const PldSessionLog *log, PldSessionLog *undo)
+{
+    size_t rec_bytes = (size_t)log->count * sizeof(PldRec);
+    u8 *block = pld_scratch_alloc(rec_bytes + sizeof(PldTitleDict));
+    if (!block) return false;
+    undo->entries = (PldRec *)block;
+    undo->count   = log->count;
+    undo->titles  = (PldTitleDict *)(block + rec_bytes);
+    memcpy(undo->entries, log->entries, rec_bytes);
+    memcpy(undo->titles->ids, log->titles->ids,
+           (size_t)log->titles->count * sizeof(u64));
+    undo->titles->count = log->titles->count;
+    return true;
+}
+
+static void undo_restore(PldSessionLog *log, const PldSessionLog *undo,
+                         PldAgg *agg)
+{
+    memcpy(log->entries, undo->entries, (size_t)undo->count * sizeof(PldRec));
+    log->count = undo->count;
+    memcpy(log->titles->ids, undo->titles->ids,
+           (size_t)undo->titles->count * sizeof(u64));
+    log->titles->count = undo->titles->count;
+    if (agg) {
+        agg->valid = false;
+        pld_agg_refresh(agg, log);
+    }
+}
+
+/* Register the peer's titles this log lacks, a stack batch per
+ * renumbering pass; the merger would otherwise renumber once a title.  A
+ * full dictionary is left for the merger to report. */
+static void add_peer_titles(PldSessionLog *log, const PldReconTitle *theirs,
+                            u32 n)
+{
+    u64 ids[64];
+    int k = 0;
+    for (u32 i = 0; i < n; i++) {
+        if (pld_title_find(log->titles, theirs[i].title_id) >= 0) continue;
+        ids[k++] = theirs[i].title_id;
+        if (k == 64 || i + 1 == n) {
+            if (!pld_log_add_titles(log, ids, k)) return;
+            k = 0;
+        }
+    }
+    if (k > 0) pld_log_add_titles(log, ids, k);
+}
+
+/* PldWireSink of round three: each chunk of the peer's records goes
+ * straight into the merger, in the key order the peer sends them.  Once
+ * the log is full the rest are kept for the caller's PldReconFull. */
+typedef struct {
+    PldMerger        merger;
+    const u32       *total;     /* records the peer sends, once known */
+    u32              announced; /* encoded: the count sent ahead      */
+    u32              seen;      /* records handed over so far         */
+    PldSession      *spill;
+    u32              n_spill;
+} MergeSink;
+
+static int merge_chunk(void *raw, const void *elems, u32 n)
+{
+    MergeSink *m = (MergeSink *)raw;
+    const PldSession *recs = (const PldSession *)elems;
+    if (n > *m->total - m->seen) return -1;
+    u32 i = 0;
+    for (; i < n && m->merger.rc == 0; i++) {
+        pld_merger_push(&m->merger, &recs[i], 1);
+        if (m->merger.rc != 0) break;
+    }
+    if (i < n) {
+        if (!m->spill) {
+            m->spill = pld_scratch_alloc((size_t)(*m->total - m->seen - i) *
+                                         sizeof(PldSession));
+            if (!m->spill) return -1;
+        }
+        memcpy(m->spill + m->n_spill, &recs[i], (size_t)(n - i) * sizeof(*recs));
+        m->n_spill += n - i;
+    }
+    m->seen += n;
+    return 0;
+}
+
+/* Sink of the record count an encoded round three sends ahead. */
+static int take_total(void *raw, const void *elems, u32 n)
+{
+    MergeSink *m = (MergeSink *)raw;
+    (void)n;
+    memcpy(&m->announced, elems, 4);
+    return m->announced > PLD_SESSION_COUNT ? -1 : 0;
+}
+
+static PldWireOut wire_out(const void *data, PldWireNext next, u32 count,
+                           u32 elem)
+{
+    PldWireOut o = { data, next, count, elem };
+    return o;
+}
+
+static PldWireIn wire_in(u32 elem, u32 max)
+{
+    PldWireIn in = { NULL, 0, elem, max, NULL, NULL };
+    return in;
+}
+
+/* ── pld_recon_exchange ─────────────────────────────────────────── */
+
+int pld_recon_exchange(int fd, PldSessionLog *local, PldAgg *agg, u32 codec,
+                       const PldWireOut *side_out, PldWireIn *side_in,
+                       int n_side, PldReconFull full, void *full_state,
+                       PldReconStats *stats)
+{
+    enum { SIDE_MAX = 4 };
+    PldWireOut   out[1 + SIDE_MAX];
+    PldWireIn    in[1 + SIDE_MAX];
+    PldWireStats wire = { 0, 0 };
+    PldReconTitle *mine = NULL, *theirs = NULL;
+    PldReconDigest *spans = NULL, *their_spans = NULL;
+    PldSessionLog undo = { NULL, 0, NULL };
+    MergeSink sink;
+    PldCodecReader *reader = NULL;
+    u8 *enc = NULL;
+    u8 *state = NULL;
+    u32 *map = NULL;
+    u32 n_mine = 0, n_theirs = 0, n_spans = 0, n_their_spans = 0;
+    u32 n_send = 0;
+    int rc = -1;
+
+    sink.spill = NULL;
+    if (stats) memset(stats, 0, sizeof(*stats));
+    if (n_side > SIDE_MAX) return -1;
+    pld_sort_sessions(local);
+
+    /* Round 1: one digest per title, and the side payloads */
+    mine = pld_scratch_alloc(PLD_TITLE_MAX * sizeof(*mine));
+    if (!mine) goto done;
+    for (int i = 0; i < local->count; )
+        mine[n_mine++] = digest_title(local, &i);
+    out[0] = wire_out(mine, NULL, n_mine, sizeof(*mine));
+    in[0]  = wire_in(sizeof(*theirs), PLD_TITLE_MAX);
+    for (int k = 0; k < n_side; k++) {
+        out[1 + k] = side_out[k];
+        in[1 + k]  = side_in[k];
+    }
+    int r1 = pld_wire_exchange(fd, out, 1 + n_side, in, 1 + n_side, &wire);
+    for (int k = 0; k < n_side; k++) side_in[k] = in[1 + k];
+    theirs   = in[0].data;
+    n_theirs = in[0].count;
+    if (r1 != 0 || !titles_sorted(theirs, n_theirs)) goto done;
+
+    state = pld_scratch_alloc(PLD_TITLE_MAX);
+    if (!state) goto done;
+    memset(state, TITLE_SAME, PLD_TITLE_MAX);
+    for (u32 k = 0; k < n_mine; k++) {
+        const PldReconTitle *p = title_find(theirs, n_theirs, mine[k].title_id);
+        int t = pld_title_find(local->titles, mine[k].title_id);
+        if (!p)
+            state[t] = TITLE_WHOLE;
+        else if (p->count != mine[k].count || p->hash != mine[k].hash)
+            state[t] = pld_recon_by_span(&mine[k], p) ? TITLE_SPANS
+                                                      : TITLE_WHOLE;
+    }
+
+    /* Round 2: span digests of the TITLE_SPANS titles */
+    n_spans = digest_spans(local, state, NULL);
+    if (n_spans > 0) {
+        spans = pld_scratch_alloc(n_spans * sizeof(*spans));
+        if (!spans) goto done;
+        digest_spans(local, state, spans);
+    }
+    out[0] = wire_out(spans, NULL, n_spans, sizeof(*spans));
+    in[0]  = wire_in(sizeof(*their_spans), PLD_SESSION_COUNT);
+    int r2 = pld_wire_exchange(fd, out, 1, in, 1, &wire);
+    their_spans   = in[0].data;
+    n_their_spans = in[0].count;
+    if (r2 != 0 || !spans_sorted(their_spans, n_their_spans)) goto done;
+
+    /* Round 3: the records, merged into *local as they arrive; encoded,
+     * their count goes ahead of them */
+    size_t map_bytes = ((size_t)local->count / 32 + 1) * sizeof(u32);
+    map = pld_scratch_alloc(map_bytes);
+    if (!map) goto done;
+    memset(map, 0, map_bytes);
+    n_send = mark_records(local, state, spans, their_spans, n_their_spans, map);
+    if (!undo_take(local, &undo)) goto done;
+    add_peer_titles(local, theirs, n_theirs);
+
+    MarkedIter it = { &undo, map, 0 };
+    sink.seen    = 0;
+    sink.n_spill = 0;
+    int n_arr = 1;
+    if (codec) {
+        int n_enc = pld_codec_encode_sessions(next_record, &it, n_send, codec,
+                                              NULL);
+        enc = n_enc > 0 ? pld_scratch_alloc((size_t)n_enc) : NULL;
+        if (n_enc < 0 || (n_enc > 0 && !enc)) goto done;
+        it.i = 0;
+        n_enc = pld_codec_encode_sessions(next_record, &it, n_send, codec, enc);
+        reader = pld_scratch_alloc(sizeof(*reader));
+        if (n_enc < 0 || !reader) goto done;
+        pld_codec_reader_init(reader, 0, merge_chunk, &sink);
+        out[0] = wire_out(&n_send, NULL, 1, 4);
+        out[1] = wire_out(enc, NULL, (u32)n_enc, 1);
+        in[0]  = wire_in(4, 1);
+        in[0].sink       = take_total;
+        in[0].sink_state = &sink;
+        in[1]  = wire_in(1, PLD_CODEC_BOUND(PLD_SESSION_COUNT,
+                                            PLD_CODEC_SESSION_MAX));
+        in[1].sink       = pld_codec_feed;
+        in[1].sink_state = reader;
+        sink.total     = &sink.announced;
+        sink.announced = 0;
+        n_arr = 2;
+    } else {
+        out[0] = wire_out(&it, next_record, n_send, sizeof(PldSession));
+        in[0]  = wire_in(sizeof(PldSession), PLD_SESSION_COUNT);
+        in[0].sink       = merge_chunk;
+        in[0].sink_state = &sink;
+        sink.total = &in[0].count;
+    }
+    pld_merger_begin(&sink.merger, local, false, agg);
+    int r3 = pld_wire_exchange(fd, out, n_arr, in, n_arr, &wire);
+    if (r3 == 0 && reader &&
+        (!pld_codec_reader_done(reader) || sink.seen != sink.announced))
+        r3 = -1;
+    int added = pld_merger_end(&sink.merger);
+    if (r3 != 0) {
+        undo_restore(local, &undo, agg);
+        goto done;
+    }
+
+    if (stats) {
+        stats->records_sent = n_send;
+        stats->records_recv = sink.seen;
+    }
+    if (added < 0) {
+        /* Nothing of a sync that didn't fit stays in the log: it goes to
+         * the caller whole, and the log back to what it was, so no
+         * record is in it that the journal, summaries and totals don't
+         * know about. */
+        int full_rc = full ? full(full_state, local, sink.spill,
+                                  (int)sink.n_spill) : 0;
+        undo_restore(local, &undo, agg);
+        rc = full_rc == 0 ? -2 : -1;
+    } else {
+        rc = added;
+    }
+
+done:
+    if (stats) {
+        stats->bytes_sent = wire.bytes_sent;
+        stats->bytes_recv = wire.bytes_recv;
+    }
+    pld_scratch_free(sink.spill);
+    pld_scratch_free(reader);
+    pld_scratch_free(enc);
+    pld_scratch_free(undo.entries);
+    pld_scratch_free(map);
+    pld_scratch_free(their_spans);
+    pld_scratch_free(spans);
+    pld_scratch_free(state);
+    pld_scratch_free(theirs);
+    pld_scratch_free(mine);
+    return rc;
+}
@@ -0,0 +1,160 @@
+#include "pld.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * pld_snapshot.c — warm-start snapshot of derived startup state
+ *
+ * A cache, not a dataset: anything wrong with it (missing, torn, stale
+ * key, bad CRC) only sends the caller down the normal startup path, so it
+ * is written in place rather than through a temporary.  The header goes
+ * in last over a zeroed placeholder.
+ */
+
+u64 pld_summary_hash(const PldFile *pld)
+{
+    u64 h = pld_hash64(&pld->header, sizeof(pld->header), 0);
+    return pld_hash64(pld->summaries, sizeof(pld->summaries), h);
+}
+
+static long summary_offset(void)
+{
+    return (long)sizeof(PldSnapHeader);
+}
+
+static long session_offset(void)
+{
+    return summary_offset() + (long)sizeof(PldFile);
+}
+
+static long app_offset(const PldSnapHeader *h)
+{
+    return session_offset() + (long)h->log_count * (long)sizeof(PldRec) +
+           (long)h->title_count * (long)sizeof(u64) + (long)sizeof(PldAgg) +
+           2 * (long)sizeof(((PldIndex *)0)->begin);
+}
+
+static u32 session_crc(const PldSessionLog *log, const PldAgg *agg,
+                       const PldIndex *idx)
+{
+    u32 crc = pld_crc32(log->entries, (size_t)log->count * sizeof(PldRec), 0);
+    crc = pld_crc32(log->titles->ids,
+                    (size_t)log->titles->count * sizeof(u64), crc);
+    crc = pld_crc32(agg, sizeof(*agg), crc);
+    crc = pld_crc32(idx->begin, sizeof(idx->begin), crc);
+    return pld_crc32(idx->count, sizeof(idx->count), crc);
+}
+
+Result pld_snapshot_save(const char *path, const PldSnapKey *key,
+                         const PldFile *pld, const PldSessionLog *log,
+                         const PldAgg *agg, const PldIndex *idx,
+                         const void *app, u32 app_size)
+{
+    PldSnapHeader h;
+    memset(&h, 0, sizeof(h));
+    h.magic       = PLD_SNAPSHOT_MAGIC;
+    h.version     = PLD_SNAPSHOT_VERSION;
+    h.key         = *key;
+    h.log_count   = (u32)log->count;
+    h.title_count = (u32)log->titles->count;
+    h.app_size    = app_size;
+    h.summary_crc = pld_crc32(pld, sizeof(*pld), 0);
+    h.session_crc = session_crc(log, agg, idx);
+    h.app_crc     = pld_crc32(app, app_size, 0);
+
+    PldSnapHeader blank;
+    memset(&blank, 0, sizeof(blank));
+    FILE *f = fopen(path, "wb");
+    if (!f) return (Result)-1;
+    size_t n_rec = (size_t)log->count, n_ids = (size_t)log->titles->count;
+    bool ok = fwrite(&blank, sizeof(blank), 1, f) == 1 &&
+              fwrite(pld, sizeof(*pld), 1, f) == 1 &&
+              fwrite(log->entries, sizeof(PldRec), n_rec, f) == n_rec &&
+              fwrite(log->titles->ids, sizeof(u64), n_ids, f) == n_ids &&
+              fwrite(agg, sizeof(*agg), 1, f) == 1 &&
+              fwrite(idx->begin, sizeof(idx->begin), 1, f) == 1 &&
+              fwrite(idx->count, sizeof(idx->count), 1, f) == 1 &&
+              (app_size == 0 || fwrite(app, app_size, 1, f) == 1) &&
+              fflush(f) == 0 && fseek(f, 0, SEEK_SET) == 0 &&
+              fwrite(&h, sizeof(h), 1, f) == 1;
+    if (fclose(f) != 0) ok = false;
+    if (!ok) remove(path);
+    return ok ? 0 : (Result)-1;
+}
+
+Result pld_snapshot_header(const char *path, PldSnapHeader *out)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) return (Result)-1;
+    bool ok = fread(out, sizeof(*out), 1, f) == 1;
+    fclose(f);
+    if (!ok || out->magic != PLD_SNAPSHOT_MAGIC ||
+        out->version != PLD_SNAPSHOT_VERSION ||
+        out->log_count > PLD_SESSION_COUNT ||
+        out->title_count > PLD_TITLE_MAX)
+        return (Result)-1;
+    return 0;
+}
+
+/* Open path positioned at offset. */
+static FILE *open_at(const char *path, long offset)
+{
+    FILE *f = fopen(path, "rb");
+    if (f && fseek(f, offset, SEEK_SET) != 0) {
+        fclose(f);
+        return NULL;
+    }
+    return f;
+}
+
+Result pld_snapshot_load_summaries(const char *path, const PldSnapHeader *h,
+                                   PldFile *out)
+{
+    FILE *f = open_at(path, summary_offset());
+    if (!f) return (Result)-1;
+    bool ok = fread(out, sizeof(*out), 1, f) == 1;
+    fclose(f);
+    return ok && pld_crc32(out, sizeof(*out), 0) == h->summary_crc
+         ? 0 : (Result)-1;
+}
+
+Result pld_snapshot_load_sessions(const char *path, const PldSnapHeader *h,
+                                  PldSessionLog *log, PldAgg *agg,
+                                  PldIndex *idx)
+{
+    if (!pld_log_alloc(log)) return (Result)-1;
+    FILE *f = open_at(path, session_offset());
+    bool ok = f &&
+              fread(log->entries, sizeof(PldRec), h->log_count, f) ==
+                  h->log_count &&
+              fread(log->titles->ids, sizeof(u64), h->title_count, f) ==
+                  h->title_count &&
+              fread(agg, sizeof(*agg), 1, f) == 1 &&
+              fread(idx->begin, sizeof(idx->begin), 1, f) == 1 &&
+              fread(idx->count, sizeof(idx->count), 1, f) == 1;
+    if (f) fclose(f);
+    log->count          = (int)h->log_count;
+    log->titles->count  = (int)h->title_count;
+    idx->entries        = log->entries;
+    idx->valid          = true;
+    if (!ok || session_crc(log, agg, idx) != h->session_crc) {
+        pld_sessions_free(log);
+        pld_index_invalidate(idx);
+        pld_agg_reset(agg);
+        return (Result)-1;
+    }
+    return 0;
+}
+
+Result pld_snapshot_load_app(const char *path, const PldSnapHeader *h,
+                             void *app, u32 app_cap)
+{
+    if (h->app_size > app_cap) return (Result)-1;
+    FILE *f = open_at(path, app_offset(h));
+    if (!f) return (Result)-1;
+    bool ok = h->app_size == 0 || fread(app, h->app_size, 1, f) == 1;
+    fclose(f);
+    return ok && pld_crc32(app, h->app_size, 0) == h->app_crc ? 0 : (Result)-1;
+}
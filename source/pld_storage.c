@@ -0,0 +1,42 @@
+#include "pld_storage.h"
+
+#include <stdio.h>
+
+/* ── stdio backend ──────────────────────────────────────────────── */
+
+/* Sequential readers (PldView) ask for consecutive offsets; skipping the
+ * redundant fseek keeps stdio from discarding its read-ahead buffer. */
+static Result stdio_read(PldStorage *st, u32 offset, void *buf, u32 len)
+{
+    FILE *f = (FILE *)st->file;
+    if (ftell(f) != (long)offset &&
+        fseek(f, (long)offset, SEEK_SET) != 0) return (Result)-1;
+    if (fread(buf, 1, len, f) != len) return (Result)-1;
+    return 0;
+}
+
+static Result stdio_write(PldStorage *st, u32 offset, const void *buf, u32 len)
+{
+    FILE *f = (FILE *)st->file;
+    if (fseek(f, (long)offset, SEEK_SET) != 0) return (Result)-1;
+    if (fwrite(buf, 1, len, f) != len) return (Result)-1;
+    return 0;
+}
+
+static Result stdio_close(PldStorage *st)
+{
+    FILE *f = (FILE *)st->file;
+    st->file = NULL;
+    if (!f) return 0;
+    return (fclose(f) == 0) ? 0 : (Result)-1;
+}
+
+Result pld_storage_open_stdio(PldStorage *st, const char *path, bool write)
+{
+    st->read   = stdio_read;
+    st->write  = stdio_write;
+    st->close  = stdio_close;
+    st->handle = 0;
+    st->file   = fopen(path, write ? "wb" : "rb");
+    return st->file ? 0 : (Result)-1;
+}
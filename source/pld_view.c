@@ -0,0 +1,177 @@
+#include "pld.h"
+#include "memprof.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * pld_view.c — read-only, forward-only walks over pld images
+ *
+ * Records are copied out of the window with memcpy so buffer-backed views
+ * don't need the caller's image to be 8-byte aligned.
+ */
+
+/* Return a pointer to len bytes at image offset `offset`, refilling the
+ * window from storage if they aren't already resident. */
+static const u8 *view_at(PldView *v, u32 offset, u32 len)
+{
+    if (v->image) return v->image + offset;
+    if (R_FAILED(v->rc)) return NULL;
+
+    if (offset < v->win_off || offset + len > v->win_off + v->win_len) {
+        u32 n = PLD_VIEW_WINDOW;
+        if (offset + n > PLD_FILE_SIZE) n = PLD_FILE_SIZE - offset;
+        Result rc = pld_storage_read(&v->st, offset, v->window, n);
+        if (R_FAILED(rc)) {
+            v->rc = rc;
+            v->win_len = 0;
+            return NULL;
+        }
+        v->win_off = offset;
+        v->win_len = n;
+    }
+    return v->window + (offset - v->win_off);
+}
+
+Result pld_view_open(PldView *v, const char *path)
+{
+    memset(v, 0, sizeof(*v));
+
+    v->window = MEM_MALLOC(MEM_PLD, PLD_VIEW_WINDOW);
+    if (!v->window) return (Result)-1;
+
+    if (R_FAILED(pld_storage_open_stdio(&v->st, path, false))) {
+        MEM_FREE(v->window);
+        v->window = NULL;
+        return (Result)-1;
+    }
+
+    const u8 *p = view_at(v, PLD_HEADER_OFFSET, sizeof(v->header));
+    if (!p) {
+        Result rc = v->rc;
+        pld_view_close(v);
+        return rc;
+    }
+    memcpy(&v->header, p, sizeof(v->header));
+    return 0;
+}
+
+void pld_view_from_image(PldView *v, const u8 *image)
+{
+    memset(v, 0, sizeof(*v));
+    v->image = image;
+    memcpy(&v->header, image + PLD_HEADER_OFFSET, sizeof(v->header));
+}
+
+void pld_view_close(PldView *v)
+{
+    if (v->window) {
+        pld_storage_close(&v->st);
+        MEM_FREE(v->window);
+        v->window = NULL;
+    }
+    v->image = NULL;
+}
+
+static bool next_raw_session(PldView *v, PldSession *out)
+{
+    while (v->next_session < PLD_SESSION_COUNT) {
+        u32 off = PLD_SESSION_OFFSET +
+                  (u32)v->next_session * sizeof(PldSession);
+        const u8 *p = view_at(v, off, sizeof(PldSession));
+        if (!p) return false;
+        v->next_session++;
+        memcpy(out, p, sizeof(*out));
+        if (!pld_session_is_empty(out)) return true;
+    }
+    return false;
+}
+
+static bool next_raw_summary(PldView *v, PldSummary *out)
+{
+    while (v->next_summary < PLD_SUMMARY_COUNT) {
+        u32 off = PLD_SUMMARY_OFFSET +
+                  (u32)v->next_summary * sizeof(PldSummary);
+        const u8 *p = view_at(v, off, sizeof(PldSummary));
+        if (!p) return false;
+        v->next_summary++;
+        memcpy(out, p, sizeof(*out));
+        if (!pld_summary_is_empty(out)) return true;
+    }
+    return false;
+}
+
+static bool key_less(const PldSession *a, const PldSession *b)
+{
+    return a->title_id < b->title_id ||
+           (a->title_id == b->title_id && a->timestamp < b->timestamp);
+}
+
+/* Image records whose key the journal holds are dropped; journal records
+ * are emitted ahead of the first image record with a larger key, so a
+ * sorted image stays sorted. */
+bool pld_view_next_session(PldView *v, PldSession *out)
+{
+    const PldJournal *j = v->overlay;
+    if (!j || j->session_count == 0) return next_raw_session(v, out);
+
+    while (!v->ov_have) {
+        if (!next_raw_session(v, &v->ov_pending)) {
+            if (R_FAILED(v->rc) || v->ov_session >= j->session_count)
+                return false;
+            *out = j->sessions[v->ov_session++];
+            return true;
+        }
+        v->ov_have = pld_journal_find(j, v->ov_pending.title_id,
+                                      v->ov_pending.timestamp) < 0;
+    }
+    if (v->ov_session < j->session_count &&
+        key_less(&j->sessions[v->ov_session], &v->ov_pending)) {
+        *out = j->sessions[v->ov_session++];
+        return true;
+    }
+    *out = v->ov_pending;
+    v->ov_have = false;
+    return true;
+}
+
+bool pld_view_next_summary(PldView *v, PldSummary *out)
+{
+    const PldJournal *j = v->overlay;
+    if (!j || j->summary_count == 0) return next_raw_summary(v, out);
+
+    if (next_raw_summary(v, out)) {
+        int k = pld_journal_find_summary(j, out->title_id);
+        if (k >= 0) {
+            *out = j->summaries[k];
+            v->ov_used[k / 32] |= 1u << (k % 32);
+        }
+        return true;
+    }
+    if (R_FAILED(v->rc)) return false;
+    while (v->ov_summary < j->summary_count) {
+        int k = v->ov_summary++;
+        if (!(v->ov_used[k / 32] & (1u << (k % 32)))) {
+            *out = j->summaries[k];
+            return true;
+        }
+    }
+    return false;
+}
+
+void pld_view_rewind(PldView *v)
+{
+    v->next_session = 0;
+    v->next_summary = 0;
+    v->ov_session   = 0;
+    v->ov_summary   = 0;
+    v->ov_have      = false;
+    memset(v->ov_used, 0, sizeof(v->ov_used));
+}
+
+void pld_view_set_overlay(PldView *v, const PldJournal *j)
+{
+    pld_view_rewind(v);
+    v->overlay = j;
+    if (j && j->has_header) v->header = j->header;
+}
@@ -0,0 +1,248 @@
+#include "pld.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+/*
+ * pld_wire.c — full-duplex transfer of count-prefixed arrays
+ *
+ * One poll loop drives both directions of the socket.  The send side
+ * stages the outgoing stream a chunk at a time (headers and elements, the
+ * latter copied or produced by a PldWireNext), and hands the chunk to
+ * send() as far as the socket takes it; long runs of a plain array skip
+ * the copy.  The receive side reads each array's count and checks it,
+ * then reads the elements straight into a scratch array, or, for a sink,
+ * a chunk at a time into a buffer of its own.  Nagle's algorithm is
+ * switched off: a short last chunk would otherwise wait out the peer's
+ * delayed ACK.  A peer that goes quiet for the idle timeout fails the
+ * exchange instead of holding the caller forever.
+ */
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+typedef struct {
+    const PldWireOut *out;
+    int               n_out;
+    int               arr;      /* array being staged                   */
+    bool              header;   /* its count is staged                  */
+    u32               done;     /* its elements staged                  */
+    const u8         *buf;      /* chunk, or elements sent in place     */
+    u32               len;      /* bytes at buf                         */
+    u32               pos;      /* bytes of them already sent           */
+    u8                chunk[PLD_WIRE_CHUNK];
+} SendState;
+
+typedef struct {
+    PldWireIn *in;
+    int        n_in;
+    int        arr;             /* array being received                 */
+    u32        count;           /* its count, once got reaches 4        */
+    u32        got;             /* bytes of it received, count included */
+    u32        fill;            /* sink arrays: bytes waiting in chunk  */
+    u8         chunk[PLD_WIRE_CHUNK];
+} RecvState;
+
+static u32 s_timeout_ms = PLD_WIRE_TIMEOUT_MS;
+
+void pld_wire_set_timeout(u32 ms)
+{
+    s_timeout_ms = ms > 0x7FFFFFFFu ? 0x7FFFFFFFu : ms;
+}
+
+u32 pld_wire_get_timeout(void)
+{
+    return s_timeout_ms;
+}
+
+/* ── Socket helpers ─────────────────────────────────────────────── */
+
+static bool would_block(void)
+{
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+/* ── Send side ──────────────────────────────────────────────────── */
+
+static bool send_done(const SendState *s)
+{
+    return s->arr == s->n_out && s->pos == s->len;
+}
+
+/* Refill the chunk once the last one is out.  The rest of an array that
+ * needs no copying and fills a chunk or more goes out in place. */
+static void stage(SendState *s)
+{
+    if (s->pos < s->len) return;
+    s->buf = s->chunk;
+    s->len = s->pos = 0;
+    while (s->arr < s->n_out) {
+        const PldWireOut *o = &s->out[s->arr];
+        if (!s->header) {
+            if (s->len + 4 > PLD_WIRE_CHUNK) return;
+            memcpy(s->chunk + s->len, &o->count, 4);
+            s->len += 4;
+            s->header = true;
+        }
+        u32 rest = (o->count - s->done) * o->elem;
+        if (!o->next && s->len == 0 && rest >= PLD_WIRE_CHUNK) {
+            s->buf  = (const u8 *)o->data + (size_t)s->done * o->elem;
+            s->len  = rest;
+            s->done = o->count;
+        }
+        while (s->done < o->count) {
+            if (s->len + o->elem > PLD_WIRE_CHUNK) return;
+            if (o->next)
+                o->next((void *)o->data, s->chunk + s->len);
+            else
+                memcpy(s->chunk + s->len,
+                       (const u8 *)o->data + (size_t)s->done * o->elem,
+                       o->elem);
+            s->len += o->elem;
+            s->done++;
+        }
+        s->arr++;
+        s->header = false;
+        s->done   = 0;
+        if (s->buf != s->chunk) return;
+    }
+}
+
+static int pump_send(int fd, SendState *s, PldWireStats *st)
+{
+    stage(s);
+    if (s->pos == s->len) return 0;
+    int n = send(fd, s->buf + s->pos, s->len - s->pos, MSG_NOSIGNAL);
+    if (n < 0) return would_block() ? 0 : -1;
+    s->pos += (u32)n;
+    if (st) st->bytes_sent += (u64)n;
+    return 0;
+}
+
+/* ── Receive side ───────────────────────────────────────────────── */
+
+static bool recv_done(const RecvState *r)
+{
+    return r->arr == r->n_in;
+}
+
+/* Move past arrays that are complete, allocating the next one's elements
+ * once its count is in. */
+static int advance(RecvState *r)
+{
+    while (r->arr < r->n_in && r->got >= 4) {
+        PldWireIn *a = &r->in[r->arr];
+        if (r->count > a->max) return -1;
+        if (!a->sink && !a->data && r->count > 0) {
+            a->data = pld_scratch_alloc((size_t)r->count * a->elem);
+            if (!a->data) return -1;
+        }
+        a->count = r->count;
+        if (r->got < 4 + r->count * a->elem) return 0;
+        r->arr++;
+        r->got = r->count = 0;
+    }
+    return 0;
+}
+
+static int pump_recv(int fd, RecvState *r, PldWireStats *st)
+{
+    PldWireIn *a = &r->in[r->arr];
+    bool to_sink = a->sink && r->got >= 4;
+    u8 *dst;
+    u32 want;
+    if (r->got < 4) {
+        dst  = (u8 *)&r->count + r->got;
+        want = 4 - r->got;
+    } else {
+        want = 4 + r->count * a->elem - r->got;
+        if (to_sink) {
+            u32 room = PLD_WIRE_CHUNK / a->elem * a->elem - r->fill;
+            if (want > room) want = room;
+            dst = r->chunk + r->fill;
+        } else {
+            dst = (u8 *)a->data + (r->got - 4);
+        }
+    }
+    int n = recv(fd, dst, want, 0);
+    if (n == 0) return -1;
+    if (n < 0) return would_block() ? 0 : -1;
+    r->got += (u32)n;
+    if (st) st->bytes_recv += (u64)n;
+    if (to_sink) {
+        /* want ends at a full chunk or the end of the array */
+        r->fill += (u32)n;
+        if ((u32)n == want) {
+            u32 k = r->fill / a->elem;
+            r->fill = 0;
+            if (a->sink(a->sink_state, r->chunk, k) != 0) return -1;
+        }
+    }
+    return advance(r);
+}
+
+/* ── pld_wire_exchange ──────────────────────────────────────────── */
+
+int pld_wire_exchange(int fd, const PldWireOut *out, int n_out,
+                      PldWireIn *in, int n_in, PldWireStats *stats)
+{
+    SendState s;
+    RecvState r;
+    s.out    = out;
+    s.n_out  = n_out;
+    s.arr    = 0;
+    s.header = false;
+    s.done   = s.len = s.pos = 0;
+    s.buf    = s.chunk;
+    r.in     = in;
+    r.n_in   = n_in;
+    r.arr    = 0;
+    r.count  = r.got = r.fill = 0;
+    for (int i = 0; i < n_in; i++) {
+        in[i].data  = NULL;
+        in[i].count = 0;
+    }
+
+#ifdef TCP_NODELAY
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#endif
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) return -1;
+
+    int rc = 0;
+    while (rc == 0 && !(send_done(&s) && recv_done(&r))) {
+        struct pollfd p;
+        p.fd      = fd;
+        p.events  = (short)((send_done(&s) ? 0 : POLLOUT) |
+                            (recv_done(&r) ? 0 : POLLIN));
+        p.revents = 0;
+        int n = poll(&p, 1, s_timeout_ms ? (int)s_timeout_ms : -1);
+        if (n < 0) {
+            if (errno != EINTR) rc = -1;
+            continue;
+        }
+        if (n == 0) {
+            rc = -1;                        /* peer idle past the timeout */
+            continue;
+        }
+        if (p.revents & POLLNVAL) {
+            rc = -1;
+            continue;
+        }
+        if ((p.revents & (POLLIN | POLLHUP | POLLERR)) && !recv_done(&r))
+            rc = pump_recv(fd, &r, stats);
+        if (rc == 0 && (p.revents & (POLLOUT | POLLHUP | POLLERR)) &&
+            !send_done(&s))
+            rc = pump_send(fd, &s, stats);
+    }
+
+    fcntl(fd, F_SETFL, flags);
+    return rc;
+}
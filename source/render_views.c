@@ -625,9 +625,8 @@ void render_rankings_top(const PldSummary *ranked[], int rank_count,
 /* ── Detail screen ──────────────────────────────────────────────── */
 
 void render_detail_top(const PldSummary *s, const char *name,
-                       const PldSessionLog *sessions,
-                       const int *sess_indices, int sess_count,
-                       int detail_scroll)
+                       const PldRec *recs, int sess_count,
+                       int detail_scroll, const PldExtTitleStats *all_time)
 {
     ui_draw_rect(0, 0, UI_TOP_W, UI_TOP_H, UI_COL_BG);
 
@@ -674,7 +673,9 @@ void render_detail_top(const PldSummary *s, const char *name,
     sy += 18.0f;
 
     {
-        int streak = pld_longest_streak(sessions, sess_indices, sess_count);
+        int streak = pld_longest_streak(recs, sess_count);
+        if (all_time && all_time->longest_streak > streak)
+            streak = all_time->longest_streak;
         ui_draw_textf(136, sy, UI_SCALE_LG, UI_COL_TEXT, "Streak: %d days",
                       streak);
         sy += 18.0f;
@@ -695,6 +696,12 @@ void render_detail_top(const PldSummary *s, const char *name,
 
     ui_draw_textf(136, sy, UI_SCALE_SM, UI_COL_TEXT_DIM,
                   "ID: %016llX", (unsigned long long)s->title_id);
+    if (all_time && all_time->total_secs > s->total_secs) {
+        char abuf[40];
+        pld_fmt_time(all_time->total_secs, tbuf, sizeof(tbuf));
+        snprintf(abuf, sizeof(abuf), "All-time: %s", tbuf);
+        ui_draw_text_right(394, sy, UI_SCALE_SM, UI_COL_TEXT_DIM, abuf);
+    }
 
     ui_draw_rect(0, 152, UI_TOP_W, 1, UI_COL_DIVIDER);
     ui_draw_grad_v(0, 153, UI_TOP_W, 2,
@@ -704,8 +711,7 @@ void render_detail_top(const PldSummary *s, const char *name,
     ui_draw_text_right(394, 155, UI_SCALE_SM, UI_COL_TEXT_DIM, "Duration");
 
     for (int i = 0; i < DETAIL_VISIBLE && (detail_scroll + i) < sess_count; i++) {
-        int idx = sess_indices[detail_scroll + i];
-        const PldSession *se = &sessions->entries[idx];
+        const PldRec *se = &recs[sess_count - 1 - (detail_scroll + i)];
         float ry = DETAIL_LIST_Y + (float)i * DETAIL_ROW_H;
 
         u32 bg = ((detail_scroll + i) % 2 == 0) ? UI_COL_BG : UI_COL_ROW_ALT;
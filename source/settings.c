@@ -1,6 +1,8 @@
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include "settings.h"
+#include "pld.h"
 
 /* ── Min-play option tables ────────────────────────────────────── */
 
@@ -12,6 +14,38 @@ const char *min_play_labels[MIN_PLAY_OPTION_COUNT] = {
     "1 min", "5 min", "10 min", "30 min", "1 hour"
 };
 
+/* ── Backup retention option tables ────────────────────────────── */
+
+const u32 backup_keep_options[BACKUP_KEEP_OPTION_COUNT] = {
+    5, 10, 25, 50, 100, 250, 500
+};
+
+const char *backup_keep_labels[BACKUP_KEEP_OPTION_COUNT] = {
+    "5", "10", "25", "50", "100", "250", "500"
+};
+
+const u32 backup_size_options[BACKUP_SIZE_OPTION_COUNT] = {
+    1024, 4096, 16384, 65536, 0
+};
+
+const char *backup_size_labels[BACKUP_SIZE_OPTION_COUNT] = {
+    "1 MB", "4 MB", "16 MB", "64 MB", "No limit"
+};
+
+/* ── History rollup option tables ──────────────────────────────── */
+
+const u32 rollup_day_options[ROLLUP_OPTION_COUNT] = {
+    0, 365, 365, 2 * 365
+};
+
+const u32 rollup_week_options[ROLLUP_OPTION_COUNT] = {
+    0, 0, 3 * 365, 5 * 365
+};
+
+const char *rollup_labels[ROLLUP_OPTION_COUNT] = {
+    "Off", "Days > 1y", "Days > 1y, wks > 3y", "Days > 2y, wks > 5y"
+};
+
 /* ── AppSettings ───────────────────────────────────────────────── */
 
 void settings_defaults(AppSettings *s)
@@ -20,6 +54,10 @@ void settings_defaults(AppSettings *s)
     s->min_play_secs = 600;
     s->starting_view = 0;   /* VIEW_LAST_PLAYED */
     s->music_enabled = 1;
+    s->backup_keep   = 10;
+    s->backup_max_kb = 0;
+    s->rollup_day_after  = 0;
+    s->rollup_week_after = 0;
 }
 
 void settings_load(AppSettings *s)
@@ -27,8 +65,10 @@ void settings_load(AppSettings *s)
     settings_defaults(s);
     FILE *f = fopen(SETTINGS_PATH, "rb");
     if (!f) return;
-    AppSettings tmp;
-    if (fread(&tmp, sizeof(tmp), 1, f) == 1 && tmp.magic == SETTINGS_MAGIC) {
+    AppSettings tmp = *s;
+    size_t n = fread(&tmp, 1, sizeof(tmp), f);
+    if (n >= offsetof(AppSettings, backup_keep) &&
+        tmp.magic == SETTINGS_MAGIC) {
         *s = tmp;
     }
     fclose(f);
@@ -50,6 +90,43 @@ int settings_min_play_index(u32 secs)
     return 2; /* default: 10 min */
 }
 
+int settings_backup_keep_index(u32 count)
+{
+    for (int i = 0; i < BACKUP_KEEP_OPTION_COUNT; i++) {
+        if (backup_keep_options[i] == count) return i;
+    }
+    return 1; /* default: 10 */
+}
+
+int settings_backup_size_index(u32 kb)
+{
+    for (int i = 0; i < BACKUP_SIZE_OPTION_COUNT; i++) {
+        if (backup_size_options[i] == kb) return i;
+    }
+    return BACKUP_SIZE_OPTION_COUNT - 1; /* default: no limit */
+}
+
+int settings_rollup_index(u32 day_after, u32 week_after)
+{
+    for (int i = 0; i < ROLLUP_OPTION_COUNT; i++) {
+        if (rollup_day_options[i] == day_after &&
+            rollup_week_options[i] == week_after) return i;
+    }
+    return 0; /* default: off */
+}
+
+void settings_apply_backup_retention(const AppSettings *s)
+{
+    PldRetention r = { (int)s->backup_keep, (u64)s->backup_max_kb * 1024 };
+    pld_backup_set_retention(&r);
+}
+
+void settings_apply_rollup(const AppSettings *s)
+{
+    PldRollupPolicy p = { s->rollup_day_after, s->rollup_week_after };
+    pld_ext_set_rollup(&p);
+}
+
 /* ── HiddenGames ───────────────────────────────────────────────── */
 
 void hidden_load(HiddenGames *h)
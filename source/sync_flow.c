@@ -40,47 +40,40 @@ static void net_init_work(void *raw) {
 
 typedef struct {
     NetCtx        *ctx;
+    PldFile       *pld;
     PldSessionLog *sessions;
+    PldAgg        *agg;
     int            new_sess;
+    int            new_apps;
     int            rc;
-} NetExchSessionsArgs;
+} NetExchArgs;
 
-static void net_exch_sessions_work(void *raw) {
-    NetExchSessionsArgs *a = (NetExchSessionsArgs *)raw;
-    a->rc = net_exchange_sessions(a->ctx, a->sessions, &a->new_sess);
-}
-
-typedef struct {
-    NetCtx  *ctx;
-    PldFile *pld;
-    int      new_apps;
-    int      rc;
-} NetExchSummariesArgs;
-
-static void net_exch_summaries_work(void *raw) {
-    NetExchSummariesArgs *a = (NetExchSummariesArgs *)raw;
-    a->rc = net_exchange_summaries(a->ctx, a->pld, &a->new_apps);
+static void net_exch_work(void *raw) {
+    NetExchArgs *a = (NetExchArgs *)raw;
+    a->rc = net_exchange(a->ctx, a->pld, a->sessions, a->agg,
+                         &a->new_sess, &a->new_apps);
+    if (a->rc == 0) title_names_save();
 }
 
 typedef struct {
-    NetCtx *ctx;
-    int     rc;
-} NetExchNamesArgs;
-
-static void net_exch_names_work(void *raw) {
-    NetExchNamesArgs *a = (NetExchNamesArgs *)raw;
-    a->rc = net_exchange_title_names(a->ctx);
-    if (a->rc == 0) title_names_save();
+    const PldFile       *pld;
+    const PldSessionLog *sessions;
+    Result               rc;
+} ExtFoldArgs;
+
+static void ext_fold_work(void *raw) {
+    ExtFoldArgs *a = (ExtFoldArgs *)raw;
+    a->rc = pld_ext_fold_log(PLD_EXT_PATH, a->pld, a->sessions, NULL, 0);
 }
 
 /* ── Sync flow ──────────────────────────────────────────────────── */
 
-void run_sync_flow(PldFile *pld, PldSessionLog *sessions,
+void run_sync_flow(PldFile *pld, PldSessionLog *sessions, PldAgg *agg,
                    u32 *sync_count, char *status_msg, int status_msg_len)
 {
     NetCtx net_ctx;
     memset(&net_ctx, 0, sizeof(net_ctx));
-    net_ctx.tcp_sock = net_ctx.listen_sock = net_ctx.udp_sock = -1;
+    net_ctx.link.tcp = net_ctx.link.listen = net_ctx.link.udp = -1;
     bool net_active = false;
 
     while (aptMainLoop()) {
@@ -187,44 +180,19 @@ void run_sync_flow(PldFile *pld, PldSessionLog *sessions,
         return;
     }
 
-    int sess_rc = -1, app_rc = -1;
-    int new_sess = 0, new_apps = 0;
-
-    {
-        NetExchSessionsArgs es_args = { &net_ctx, sessions, 0, -1 };
-        run_loading_with_spinner("Syncing...", "Exchanging sessions...",
-                                 net_exch_sessions_work, &es_args);
-        sess_rc = es_args.rc;
-        new_sess = es_args.new_sess;
-    }
-
-    if (sess_rc == 0) {
-        NetExchSummariesArgs ea_args = { &net_ctx, pld, 0, -1 };
-        run_loading_with_spinner("Syncing...", "Syncing app list...",
-                                 net_exch_summaries_work, &ea_args);
-        app_rc = ea_args.rc;
-        new_apps = ea_args.new_apps;
-    }
+    NetExchArgs ex_args = { &net_ctx, pld, sessions, agg, 0, 0, -1 };
+    run_loading_with_spinner("Syncing...", "Exchanging sessions and apps...",
+                             net_exch_work, &ex_args);
+    int sync_rc  = ex_args.rc;
+    int new_sess = ex_args.new_sess;
+    int new_apps = ex_args.new_apps;
 
-    if (sess_rc == 0 && app_rc == 0) {
-        NetExchNamesArgs en_args = { &net_ctx, -1 };
-        run_loading_with_spinner("Syncing...", "Exchanging title names...",
-                                 net_exch_names_work, &en_args);
-    }
-
-    if (sess_rc == 0 && app_rc == 0) {
-        for (int i = 0; i < PLD_SUMMARY_COUNT; i++) {
-            PldSummary *s = &pld->summaries[i];
-            if (pld_summary_is_empty(s)) continue;
-            s->total_secs = 0;
-            for (int j = 0; j < sessions->count; j++) {
-                if (sessions->entries[j].title_id == s->title_id)
-                    s->total_secs += sessions->entries[j].play_secs;
-            }
-        }
+    if (sync_rc == 0) {
+        pld_agg_refresh(agg, sessions);
+        pld_agg_apply_totals(agg, pld);
     }
 
-    if (sess_rc == 0 && app_rc == 0) {
+    if (sync_rc == 0) {
         char sync_body[64];
         snprintf(sync_body, sizeof(sync_body),
                  "+%d sessions, +%d apps", new_sess, new_apps);
@@ -235,13 +203,34 @@ void run_sync_flow(PldFile *pld, PldSessionLog *sessions,
             draw_message_screen("Sync Complete", sync_body);
         }
 
-        pld_backup_from_path(PLD_MERGED_PATH);
-        Result sd_rc = pld_write_sd(PLD_MERGED_PATH, pld, sessions);
+        /* A restore point of the pre-sync state, then the synced records
+         * appended to the journal.  Both build their images in the arena,
+         * held just for this; without one (low memory) they go through
+         * malloc as before. */
+        PldArena arena;
+        bool staged = pld_arena_begin(&arena, PLD_ARENA_BYTES);
+        pld_journal_backup(PLD_MERGED_PATH, PLD_JOURNAL_PATH);
+        Result sd_rc = pld_journal_commit(PLD_MERGED_PATH, PLD_JOURNAL_PATH,
+                                          pld, sessions, NULL);
+        if (staged) pld_arena_end(&arena);
         if (R_FAILED(sd_rc)) {
             snprintf(status_msg, (size_t)status_msg_len, "SD save failed");
         } else {
             (*sync_count)++;
             save_sync_count(*sync_count);
+            /* merged2.dat keeps everything the working set ever held. */
+            ExtFoldArgs ef_args = { pld, sessions, -1 };
+            run_loading_with_spinner("Syncing...", "Updating full history...",
+                                     ext_fold_work, &ef_args);
+        }
+    } else if (sync_rc == -2) {
+        snprintf(status_msg, (size_t)status_msg_len,
+                 "History full: saved to merged2.dat");
+        for (int f = 0; f < 120 && aptMainLoop(); f++) {
+            hidScanInput();
+            draw_message_screen("History Full",
+                                "Peer's sessions saved to merged2.dat.\n"
+                                "Continuing with local data.");
         }
     } else {
         snprintf(status_msg, (size_t)status_msg_len, "Sync failed");
@@ -1,4 +1,5 @@
 #include "title_icons.h"
+#include "memprof.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -52,6 +53,8 @@ bool title_icon_load_from_tile_data(u64 title_id, const u16 *tile_data)
         return false;
     }
 
+    MEM_NOTE(MEM_TEX, entry->tex.data, entry->tex.size);
+
     /* src == tex size, so tile data is a straight memcpy */
     memcpy(entry->tex.data, tile_data, ICON_TILE_BYTES);
     C3D_TexFlush(&entry->tex);
@@ -131,7 +134,7 @@ void title_icons_load_sd_cache(void)
         }
         fseek(f, 0, SEEK_SET);
 
-        u16 *tile_data = (u16 *)malloc(ICON_TILE_BYTES);
+        u16 *tile_data = (u16 *)MEM_MALLOC(MEM_ICON, ICON_TILE_BYTES);
         if (!tile_data) { fclose(f); continue; }
 
         size_t nread = fread(tile_data, 1, ICON_TILE_BYTES, f);
@@ -140,7 +143,7 @@ void title_icons_load_sd_cache(void)
         if (nread == ICON_TILE_BYTES)
             title_icon_load_from_tile_data(title_id, tile_data);
 
-        free(tile_data);
+        MEM_FREE(tile_data);
     }
 
     closedir(dir);
@@ -151,8 +154,10 @@ void title_icons_load_sd_cache(void)
 void title_icons_free(void)
 {
     for (int i = 0; i < s_icon_count; i++) {
-        if (s_icons[i].loaded)
+        if (s_icons[i].loaded) {
+            MEM_FORGET(s_icons[i].tex.data);
             C3D_TexDelete(&s_icons[i].tex);
+        }
     }
     s_icon_count = 0;
 }
@@ -1,4 +1,5 @@
 #include "title_names.h"
+#include "pld.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -16,6 +17,7 @@
 
 static TitleNameEntry s_entries[TITLE_NAMES_MAX];
 static int            s_count = 0;
+static u64            s_file_hash = 0;   /* see title_names_hash */
 
 /* Binary search: returns index of title_id if found (>= 0),
  * or -(insertion_point + 1) if not found. */
@@ -146,45 +148,56 @@ void title_names_load(void)
         fclose(f);
         return;
     }
+    u64 h = pld_hash64(&file_count, sizeof(file_count), 0);
     if (file_count > (u32)TITLE_NAMES_MAX)
         file_count = (u32)TITLE_NAMES_MAX;
 
     TitleNameEntry tmp;
     for (u32 i = 0; i < file_count; i++) {
         if (fread(&tmp, sizeof(tmp), 1, f) != 1) break;
+        h = pld_hash64(&tmp, sizeof(tmp), h);
         tmp.name[TITLE_NAME_LEN - 1] = '\0';   /* safety */
         insert_entry(tmp.title_id, tmp.name);
     }
     fclose(f);
+    s_file_hash = h;
 }
 
+/* Installed titles on one medium, malloc'd; NULL if none or on error. */
+static u64 *list_titles(FS_MediaType media, u32 *count)
+{
+    *count = 0;
+    u32 n = 0;
+    if (R_FAILED(AM_GetTitleCount(media, &n)) || n == 0) return NULL;
+    u64 *ids = (u64 *)malloc(n * sizeof(u64));
+    if (!ids) return NULL;
+    if (R_FAILED(AM_GetTitleList(count, media, n, ids))) {
+        free(ids);
+        *count = 0;
+        return NULL;
+    }
+    return ids;
+}
+
+static const FS_MediaType s_media_types[] = {
+    MEDIATYPE_NAND, MEDIATYPE_SD, MEDIATYPE_GAME_CARD
+};
+
 int title_names_scan_installed(void)
 {
     int added = 0;
     Result rc = amInit();
     if (R_FAILED(rc)) return 0;
 
-    static const FS_MediaType media_types[] = {
-        MEDIATYPE_NAND, MEDIATYPE_SD, MEDIATYPE_GAME_CARD
-    };
     for (int m = 0; m < 3; m++) {
-        FS_MediaType media = media_types[m];
-        u32 count = 0;
-        rc = AM_GetTitleCount(media, &count);
-        if (R_FAILED(rc) || count == 0) continue;
-
-        u64 *ids = (u64 *)malloc(count * sizeof(u64));
-        if (!ids) continue;
-
+        FS_MediaType media = s_media_types[m];
         u32 read_count = 0;
-        rc = AM_GetTitleList(&read_count, media, count, ids);
-        if (R_SUCCEEDED(rc)) {
-            for (u32 i = 0; i < read_count; i++) {
-                if (title_name_lookup(ids[i])) continue;   /* already known */
-                char name[TITLE_NAME_LEN];
-                if (read_title_name(media, ids[i], name))
-                    if (insert_entry(ids[i], name)) added++;
-            }
+        u64 *ids = list_titles(media, &read_count);
+        for (u32 i = 0; i < read_count; i++) {
+            if (title_name_lookup(ids[i])) continue;   /* already known */
+            char name[TITLE_NAME_LEN];
+            if (read_title_name(media, ids[i], name))
+                if (insert_entry(ids[i], name)) added++;
         }
         free(ids);
     }
@@ -193,6 +206,26 @@ int title_names_scan_installed(void)
     return added;
 }
 
+u64 title_names_installed_hash(void)
+{
+    if (R_FAILED(amInit())) return 0;
+    u64 h = 0;
+    for (int m = 0; m < 3; m++) {
+        u32 n = 0;
+        u64 *ids = list_titles(s_media_types[m], &n);
+        h = pld_hash64(&n, sizeof(n), h);
+        if (ids) h = pld_hash64(ids, n * sizeof(u64), h);
+        free(ids);
+    }
+    amExit();
+    return h;
+}
+
+u64 title_names_hash(void)
+{
+    return s_file_hash;
+}
+
 const char *title_name_lookup(u64 title_id)
 {
     int idx = bsearch_id(title_id);
@@ -224,18 +257,25 @@ Result title_names_save(void)
     u32 cnt = (u32)s_count;
     if (fwrite(&cnt, sizeof(cnt), 1, f) != 1) {
         fclose(f);
+        s_file_hash = 0;
         return -1;
     }
     if (s_count > 0 &&
         (int)fwrite(s_entries, sizeof(TitleNameEntry), s_count, f) != s_count) {
         fclose(f);
+        s_file_hash = 0;
         return -1;
     }
     fclose(f);
+    u64 h = pld_hash64(&cnt, sizeof(cnt), 0);
+    for (int i = 0; i < s_count; i++)
+        h = pld_hash64(&s_entries[i], sizeof(s_entries[i]), h);
+    s_file_hash = h;
     return 0;
 }
 
 void title_names_free(void)
 {
     s_count = 0;
+    s_file_hash = 0;
 }